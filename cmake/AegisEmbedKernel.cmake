@@ -0,0 +1,35 @@
+# Writes a header embedding compiled kernel files, run by aegis_add_kernels():
+#   cmake -DNAME=<name> -DENTRY_POINT=<entry> -DDXIL=<file> -DREFLECTION=<file>
+#         [-DSPIRV=<file>] -DOUTPUT=<header> -P AegisEmbedKernel.cmake
+
+function(aegis_embed_array variable file out_content)
+    file(READ "${file}" hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR byte_count "${hex_length} / 2")
+    # 16 bytes per line, CMake regexes have no {n}
+    string(REPEAT "[0-9a-f]" 32 line_pattern)
+    string(REGEX REPLACE "(${line_pattern})" "\\1\n" hex "${hex}")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REPLACE "\n" "\n    " bytes "${bytes}")
+    set(${out_content} "${${out_content}}alignas(4) inline constexpr unsigned char ${variable}[] = {\n    ${bytes}\n};\ninline constexpr size_t ${variable}_size = ${byte_count};\n\n" PARENT_SCOPE)
+endfunction()
+
+set(content "// Generated by aegis_add_kernels() from ${NAME}, do not edit\n#pragma once\n\n#include <cstddef>\n#include <aegis/kernel.h>\n\nnamespace aegis_kernels {\nnamespace detail {\n")
+aegis_embed_array(${NAME}_dxil "${DXIL}" content)
+aegis_embed_array(${NAME}_reflection "${REFLECTION}" content)
+set(spirv_fields ".spirv = nullptr,\n    .spirvSize = 0,")
+if (SPIRV)
+    aegis_embed_array(${NAME}_spirv "${SPIRV}" content)
+    set(spirv_fields ".spirv = detail::${NAME}_spirv,\n    .spirvSize = detail::${NAME}_spirv_size,")
+endif ()
+string(APPEND content "}\n\n")
+string(APPEND content "inline constexpr aegis::KernelBytecode ${NAME} = {\n")
+string(APPEND content "    .entryPoint = \"${ENTRY_POINT}\",\n")
+string(APPEND content "    .dxil = detail::${NAME}_dxil,\n    .dxilSize = detail::${NAME}_dxil_size,\n")
+string(APPEND content "    .dxilReflection = detail::${NAME}_reflection,\n    .dxilReflectionSize = detail::${NAME}_reflection_size,\n")
+string(APPEND content "    ${spirv_fields}\n};\n}\n")
+
+# Only touch the header if it changed, so unchanged kernels don't rebuild their users
+file(WRITE "${OUTPUT}.tmp" "${content}")
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,75 @@
+# aegis_add_kernels(<target>
+#     SOURCES <file.hlsl>...
+#     [ENTRY_POINT <name>]              # default: main
+#     [INCLUDE_DIRECTORIES <dir>...]
+#     [DEFINES <NAME[=VALUE]>...]
+#     [DEPENDS <file>...]               # headers the sources include
+#     [SPIRV])                          # also compile SPIR-V for the Vulkan backend
+#
+# Compiles compute kernels with dxc at build time and embeds the bytecode
+# and its reflection into <target>. Every source gets a header
+# <aegis_kernels/<name>.h> declaring aegis_kernels::<name>, an
+# aegis::KernelBytecode for ComputeContext::CreateKernelFromBytecode().
+#
+# dxc writes no depfile, list the included headers under DEPENDS so a
+# change to one of them recompiles the kernels.
+
+set(_AEGIS_EMBED_KERNEL_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/AegisEmbedKernel.cmake")
+
+function(aegis_add_kernels target)
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "SPIRV" "ENTRY_POINT" "SOURCES;INCLUDE_DIRECTORIES;DEFINES;DEPENDS")
+    if (NOT AEGIS_DXC_EXECUTABLE)
+        message(FATAL_ERROR "aegis_add_kernels: dxc was not found, set AEGIS_DXC_EXECUTABLE")
+    endif ()
+    if (NOT ARG_SOURCES)
+        message(FATAL_ERROR "aegis_add_kernels: no SOURCES given")
+    endif ()
+    if (NOT ARG_ENTRY_POINT)
+        set(ARG_ENTRY_POINT main)
+    endif ()
+
+    set(dxc_flags -T cs_6_0 -E ${ARG_ENTRY_POINT} -Zpr)
+    foreach (dir IN LISTS ARG_INCLUDE_DIRECTORIES)
+        list(APPEND dxc_flags -I ${dir})
+    endforeach ()
+    foreach (define IN LISTS ARG_DEFINES)
+        list(APPEND dxc_flags -D ${define})
+    endforeach ()
+
+    set(output_dir "${CMAKE_CURRENT_BINARY_DIR}/${target}_kernels")
+    set(headers)
+    foreach (source IN LISTS ARG_SOURCES)
+        get_filename_component(source "${source}" ABSOLUTE)
+        get_filename_component(name "${source}" NAME_WE)
+        string(MAKE_C_IDENTIFIER "${name}" name)
+
+        set(dxil "${output_dir}/${name}.dxil")
+        set(reflection "${output_dir}/${name}.refl")
+        set(header "${output_dir}/aegis_kernels/${name}.h")
+        set(outputs "${dxil}" "${reflection}")
+        set(commands
+            COMMAND "${AEGIS_DXC_EXECUTABLE}" ${dxc_flags} -Fo "${dxil}" -Fre "${reflection}" "${source}")
+        set(embed_args -DNAME=${name} -DENTRY_POINT=${ARG_ENTRY_POINT} -DDXIL=${dxil} -DREFLECTION=${reflection})
+        if (ARG_SPIRV)
+            set(spirv "${output_dir}/${name}.spv")
+            list(APPEND outputs "${spirv}")
+            list(APPEND commands
+                COMMAND "${AEGIS_DXC_EXECUTABLE}" ${dxc_flags} -spirv -fspv-target-env=vulkan1.2 -Fo "${spirv}" "${source}")
+            list(APPEND embed_args -DSPIRV=${spirv})
+        endif ()
+
+        add_custom_command(
+            OUTPUT "${header}" ${outputs}
+            COMMAND "${CMAKE_COMMAND}" -E make_directory "${output_dir}/aegis_kernels"
+            ${commands}
+            COMMAND "${CMAKE_COMMAND}" ${embed_args} -DOUTPUT=${header} -P "${_AEGIS_EMBED_KERNEL_SCRIPT}"
+            DEPENDS "${source}" ${ARG_DEPENDS} "${_AEGIS_EMBED_KERNEL_SCRIPT}"
+            COMMENT "Compiling kernel ${name}"
+            VERBATIM
+        )
+        list(APPEND headers "${header}")
+    endforeach ()
+
+    target_sources(${target} PRIVATE ${headers})
+    target_include_directories(${target} PRIVATE "${output_dir}")
+endfunction()
@@ -3,6 +3,10 @@
 #include <iostream>
 #include <string>
 
+#if defined(HELLO_COMPUTE_PREBUILT_KERNEL)
+#include <aegis_kernels/add_vectors.h> // Generated by aegis_add_kernels()
+#endif
+
 std::string getShaderPath() {
     return "add_vectors.hlsl";
 }
@@ -40,8 +44,13 @@ int main()
     auto bufferC = context->CreateBuffer(bufferSize, aegis::GpuBuffer::MemoryType::DEVICE_LOCAL);
 
     // "Register Function" (Compile Kernel)
+#if defined(HELLO_COMPUTE_PREBUILT_KERNEL)
+    std::cout << "Loading the prebuilt kernel..." << std::endl;
+    auto kernel = context->CreateKernelFromBytecode(aegis_kernels::add_vectors);
+#else
     std::cout << "Compiling kernel..." << std::endl;
     auto kernel = context->CreateKernel(getShaderPath(), "main_cs");
+#endif
     if (!kernel) {
       std::cerr << "Failed to create compute kernel!" << std::endl;
       return 1;
@@ -0,0 +1,77 @@
+#include <aegis/aegis.h>
+#include <vector>
+#include <iostream>
+
+int main()
+{
+  try {
+    const int ELEMENT_COUNT = 1 << 20;
+    size_t bufferSize = ELEMENT_COUNT * sizeof(float);
+
+    // The CPU backend runs everywhere, no GPU or shader compiler needed
+    std::cout << "Creating Aegis CPU context..." << std::endl;
+    auto context = aegis::ComputeContext::Create(aegis::Backend::CPU);
+    if (!context) {
+      std::cerr << "Failed to create Aegis compute context!" << std::endl;
+      return 1;
+    }
+
+    std::vector<float> dataA(ELEMENT_COUNT);
+    std::vector<float> dataB(ELEMENT_COUNT);
+    std::vector<float> dataC_results(ELEMENT_COUNT, 0.0f);
+    for (int i = 0; i < ELEMENT_COUNT; ++i) {
+      dataA[i] = static_cast<float>(i);
+      dataB[i] = static_cast<float>(i * 2);
+    }
+
+    auto bufferA = context->CreateBuffer(bufferSize, aegis::GpuBuffer::MemoryType::DEVICE_LOCAL);
+    auto bufferB = context->CreateBuffer(bufferSize, aegis::GpuBuffer::MemoryType::DEVICE_LOCAL);
+    auto bufferC = context->CreateBuffer(bufferSize, aegis::GpuBuffer::MemoryType::DEVICE_LOCAL);
+
+    // The C++ twin of add_vectors.hlsl from 01_hello_compute
+    aegis::HostKernelDesc addVectors;
+    addVectors.numThreads = {64, 1, 1};
+    addVectors.function = [](const aegis::HostThreadContext& ctx) {
+      uint32_t i = ctx.dispatchThreadID.x;
+      ctx.Buffer<float>(2)[i] = ctx.Buffer<float>(0)[i] + ctx.Buffer<float>(1)[i];
+    };
+    auto kernel = context->CreateHostKernel(addVectors);
+
+    // From here on, it's the exact same stream code as on the GPU
+    auto stream = context->CreateStream();
+
+    stream->ResourceUpload(*bufferA, dataA.data(), bufferSize);
+    stream->ResourceUpload(*bufferB, dataB.data(), bufferSize);
+
+    stream->SetKernel(*kernel);
+    stream->SetBuffer(0, *bufferA);
+    stream->SetBuffer(1, *bufferB);
+    stream->SetBuffer(2, *bufferC);
+    stream->RecordDispatch(ELEMENT_COUNT / 64, 1, 1);
+
+    stream->ResourceDownload(dataC_results.data(), *bufferC, bufferSize);
+
+    stream->Submit();
+    stream->HostWait();
+
+    bool success = true;
+    for (int i = 0; i < ELEMENT_COUNT; ++i) {
+      float expected = dataA[i] + dataB[i];
+      if (dataC_results[i] != expected) {
+        std::cerr << "Verification FAILED at index " << i << "! "
+                  << "Expected " << expected << ", got " << dataC_results[i] << std::endl;
+        success = false;
+        break;
+      }
+    }
+
+    if (success) {
+      std::cout << "Verification SUCCEEDED!" << std::endl;
+    }
+
+    return success ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << "An exception occurred! " << e.what() << std::endl;
+  }
+  return 1;
+}
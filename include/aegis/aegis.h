@@ -8,4 +8,9 @@
 #include "buffer.h"
 #include "kernel.h"
 #include "event.h"
-#include "stream.h"
\ No newline at end of file
+#include "stream.h"
+#include "graph.h"
+#include "task_graph.h"
+#include "host_kernel.h"
+#include "host_memory.h"
+#include "coroutine.h"
\ No newline at end of file
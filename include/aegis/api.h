@@ -12,4 +12,9 @@
 
 #define AEGIS_API
 
-#endif
\ No newline at end of file
+#endif
+
+// co_await on streams and events needs C++20 coroutines
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define AEGIS_HAS_COROUTINES 1
+#endif
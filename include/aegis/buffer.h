@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory> // for std::unique_ptr
 #include "api.h"
 
@@ -14,6 +15,32 @@ namespace aegis::internal {
 
 namespace aegis {
   class ComputeContext;
+  class GpuBuffer;
+
+  /**
+   * @brief A byte range of a GpuBuffer that can be bound to a slot.
+   *
+   * Views let many tensors live in one big allocation. Create them with
+   * GpuBuffer::View().
+   * @note Bind offsets must be a multiple of the device's storage buffer
+   * alignment; 256 bytes works on every backend.
+   */
+  struct BufferView {
+    GpuBuffer* buffer = nullptr;
+    size_t offset = 0;
+    size_t size = 0;
+  };
+
+  /**
+   * @brief How a kernel or task uses a bound buffer.
+   * @note Streams only order dispatches that touch the same range with at
+   * least one WRITE or READ_WRITE access, so a wrong READ loses that order.
+   */
+  enum class BufferAccess {
+    READ,
+    WRITE,
+    READ_WRITE,
+  };
 
   /**
    * @brief Represents a block of memory on the GPU (a "variable").
@@ -34,11 +61,20 @@ namespace aegis {
      */
     [[nodiscard]] size_t GetSizeInBytes() const;
 
+    /**
+     * @brief Gets a view of a byte range of this buffer.
+     * @param offset The first byte of the range.
+     * @param byteSize The size of the range.
+     * @return The view. Throws if the range is outside the buffer.
+     */
+    [[nodiscard]] BufferView View(size_t offset, size_t byteSize);
+
     /**
      * @brief Maps the buffer's memory for CPU access.
      *
      * @warning This is a blocking operation and should only be used
-     * on buffers created with UPLOAD or READBACK memory types.
+     * on buffers created with UPLOAD, READBACK, HOST or DEVICE_HOST_VISIBLE
+     * memory types.
      *
      * @return void* A CPU-writable/readable pointer to the buffer's memory.
      */
@@ -60,7 +96,25 @@ namespace aegis {
       /** @brief CPU-visible memory for uploading data (CPU-to-GPU). */
       UPLOAD,
       /** @brief CPU-visible memory for reading data back (GPU-to-CPU). */
-      READBACK
+      READBACK,
+      /**
+       * @brief Pinned host memory the GPU copies to and from directly.
+       * CPU reads are cached. Use it as a copy source/destination, not as a kernel input.
+       */
+      HOST,
+      /**
+       * @brief Device memory the CPU writes through Map() (resizable BAR, integrated GPUs).
+       *
+       * Kernels use it like DEVICE_LOCAL memory, but small parameter blocks
+       * can be written in place instead of uploaded. Where the hardware
+       * can't do it (see ComputeContext::GetCapabilities()), the buffer is
+       * DEVICE_LOCAL and Map() returns a staging copy that the next stream
+       * using the buffer after Unmap() copies over.
+       *
+       * @warning Write only; CPU reads are uncached and don't see GPU writes
+       * in the staged case. Don't write while GPU work using the buffer is in flight.
+       */
+      DEVICE_HOST_VISIBLE
     };
 
     /**
@@ -70,15 +124,25 @@ namespace aegis {
     internal::IGpuBuffer* GetBackendBuffer() { return m_backendBuffer.get(); }
   private:
     friend class ComputeContext;
+    friend class ComputeStream;
 
     /**
      * @brief Private constructor.
      * @param context The context that owns this buffer.
      * @param backendBuffer The private implementation (e.g., D3D12Buffer).
+     * @param isPooled Whether the buffer came from ComputeStream::AllocAsync().
      */
-    GpuBuffer(ComputeContext* context, std::unique_ptr<internal::IGpuBuffer> backendBuffer);
+    GpuBuffer(ComputeContext* context, std::unique_ptr<internal::IGpuBuffer> backendBuffer, bool isPooled = false);
 
     ComputeContext* m_context;
     std::unique_ptr<internal::IGpuBuffer> m_backendBuffer;
+    bool m_isPooled;
+
+    /**
+     * @brief The UPLOAD buffer Map() returns for DEVICE_HOST_VISIBLE buffers
+     * without hardware support, and whether it changed since the last copy.
+     */
+    std::unique_ptr<internal::IGpuBuffer> m_stagingBuffer;
+    std::atomic<bool> m_stagingDirty;
   };
 }
\ No newline at end of file
@@ -4,40 +4,195 @@
  */
 
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <future> // for std::future
 #include <memory> // for std::unique_ptr
+#include <mutex> // for std::once_flag
+#include <vector>
 
 #include "api.h"
 #include "aegis/buffer.h"
 #include "aegis/kernel.h"
 #include "aegis/event.h"
 #include "aegis/stream.h"
+#include "aegis/host_kernel.h"
+#include "aegis/task_graph.h"
 
 namespace aegis::internal {
   class IComputeBackend;
+  class AsyncBufferPool;
+  class HostMemoryRegistry;
+  class DeferredReleaseQueue;
+  class CompletionWorker;
+  class ThreadPool;
 }
 
 namespace aegis {
+  class Executor;
+
+  /**
+   * @brief Selects which backend a ComputeContext runs on.
+   */
+  enum class Backend {
+    /** @brief The first compiled-in backend that initializes (D3D12, then Vulkan, then CPU). */
+    DEFAULT,
+    /** @brief Direct3D 12. */
+    D3D12,
+    /** @brief Vulkan. */
+    VULKAN,
+    /** @brief The multithreaded CPU backend. Only runs host kernels. */
+    CPU
+  };
+
+  /**
+   * @brief Options for ComputeContext::Create().
+   */
+  struct ContextDesc {
+    /** @brief The backend to use. */
+    Backend backend = Backend::DEFAULT;
+    /**
+     * @brief Size of the heaps DEVICE_LOCAL buffers are suballocated from.
+     * @note Buffers bigger than half a block get a heap of their own.
+     */
+    size_t memoryBlockSize = 64 * 1024 * 1024;
+    /** @brief Worker threads of the CPU backend. 0 uses one per hardware thread. */
+    uint32_t cpuThreadCount = 0;
+    /**
+     * @brief Bytes of FreeAsync()'d buffers the context keeps for reuse.
+     * @note Anything above this is released once the GPU is done with it.
+     */
+    size_t asyncPoolReleaseThreshold = 256 * 1024 * 1024;
+    /**
+     * @brief Hardware queues created per stream type and priority. Streams
+     * are spread over them, so more streams than this share queues.
+     * @note Vulkan is limited to the queues its queue family offers.
+     */
+    uint32_t maxHardwareQueues = 4;
+    /**
+     * @brief Directory compiled kernels are cached in across runs, empty
+     * to always compile.
+     * @note D3D12 stores the DXIL, the root signature and a pipeline
+     * library there. Entries are keyed on the source and its includes, the
+     * entry point, the compiler and the adapter/driver, so stale ones are
+     * never used. Several processes can share the directory.
+     */
+    std::string kernelCacheDirectory;
+    /**
+     * @brief Threads CreateKernelAsync() and CreateKernels() compile on,
+     * each with its own compiler instance. 0 uses one per hardware thread.
+     * @note Started with the first asynchronous compile.
+     */
+    uint32_t kernelCompileThreadCount = 0;
+  };
+
+  /**
+   * @brief Usage counters of the DEVICE_LOCAL buffer heaps.
+   */
+  struct MemoryStats {
+    /** @brief The configured ContextDesc::memoryBlockSize. */
+    size_t blockSize = 0;
+    /** @brief Number of heaps currently allocated (dedicated ones included). */
+    size_t heapCount = 0;
+    /** @brief Total size of those heaps. */
+    size_t reservedBytes = 0;
+    /** @brief Bytes handed out to buffers (including alignment rounding). */
+    size_t usedBytes = 0;
+    /** @brief Number of live buffers placed in the heaps. */
+    size_t allocationCount = 0;
+    /** @brief Number of free ranges (gaps) across all heaps. */
+    size_t freeRangeCount = 0;
+    /** @brief The largest buffer that still fits without creating a heap. */
+    size_t largestFreeRange = 0;
+    /** @brief How many buffers ever needed a heap of their own. */
+    uint64_t dedicatedCount = 0;
+    /**
+     * @brief 1 - largestFreeRange / free bytes. 0 means all free memory is
+     * one contiguous range, values close to 1 mean it's scattered in small gaps.
+     */
+    float fragmentation = 0.0f;
+  };
+
+  /**
+   * @brief Usage counters of the stream-ordered AllocAsync() pool.
+   */
+  struct AsyncPoolStats {
+    /** @brief Bytes of buffers handed out by AllocAsync() and not freed yet. */
+    size_t usedBytes = 0;
+    /** @brief Bytes of freed buffers kept for reuse. */
+    size_t cachedBytes = 0;
+    /** @brief Number of freed buffers kept for reuse. */
+    size_t cachedBufferCount = 0;
+    /** @brief AllocAsync() calls served with a recycled buffer. */
+    uint64_t reuseCount = 0;
+    /** @brief AllocAsync() calls that had to create a buffer. */
+    uint64_t createCount = 0;
+  };
+
+  /**
+   * @brief Optional hardware features, see ComputeContext::GetCapabilities().
+   */
+  struct DeviceCapabilities {
+    /** @brief The GPU uses system memory (integrated GPUs, the CPU backend). */
+    bool unifiedMemory = false;
+    /**
+     * @brief DEVICE_HOST_VISIBLE buffers are device memory the CPU writes
+     * directly. When false, they are staged through an extra copy.
+     */
+    bool deviceHostVisibleMemory = false;
+    /**
+     * @brief Size of the memory DEVICE_HOST_VISIBLE buffers come from, 0 if
+     * unknown. Without resizable BAR this is often only 256 MiB.
+     */
+    size_t deviceHostVisibleBytes = 0;
+    /**
+     * @brief COPY streams run on a separate copy engine, in parallel with
+     * kernels. When false, they share the hardware queue of COMPUTE streams.
+     */
+    bool dedicatedCopyQueue = false;
+  };
+
   class AEGIS_API ComputeContext {
   public:
     /**
      * @brief Destroys the compute context and all associated resources.
-     * @note This will block until the GPU is idle.
+     * @note This will block until the GPU is idle. Destroy every stream
+     * first; buffers, kernels and events may still be in use.
      */
     ~ComputeContext();
 
     /**
      * @brief Creates and initializes a new ComputeContext.
+     * @param backend The backend to use. DEFAULT falls back through every
+     * compiled-in backend, ending with the CPU backend.
      * @return A unique_ptr to the new ComputeContext, or nullptr if
      * initialization fails (e.g., no compatible GPU found).
+     * @note A backend asked for by name may throw std::runtime_error
+     * instead, saying why it failed (Vulkan reports a missing driver,
+     * device feature or dxcompiler). DEFAULT then moves on to the next one.
+     */
+    static std::unique_ptr<ComputeContext> Create(Backend backend = Backend::DEFAULT);
+
+    /**
+     * @brief Creates and initializes a new ComputeContext.
+     * @param desc The backend and memory options.
+     * @return A unique_ptr to the new ComputeContext, or nullptr if
+     * initialization fails. See Create(Backend) for the errors it throws.
      */
-    static std::unique_ptr<ComputeContext> Create();
+    static std::unique_ptr<ComputeContext> Create(const ContextDesc& desc);
 
     /**
-     * @brief Creates a new asynchronous compute stream.
+     * @brief Gets the backend this context is running on.
+     */
+    [[nodiscard]] Backend GetBackendType() const { return m_backendType; }
+
+    /**
+     * @brief Creates a new asynchronous compute or copy stream.
+     * @param desc The queue type and sizing of the stream's staging memory.
      * @return A new ComputeStream object.
      */
-    std::unique_ptr<ComputeStream> CreateStream();
+    std::unique_ptr<ComputeStream> CreateStream(const StreamDesc& desc = {});
 
     /**
      * @brief Creates a new synchronization event.
@@ -68,12 +223,199 @@ namespace aegis {
         const std::string& hlslFilePath,
         const std::string& entryPoint);
 
+    /**
+     * @brief Compiles an HLSL shader with preprocessor defines and compiler options.
+     * @param hlslFilePath Path to the .hlsl shader file.
+     * @param entryPoint The name of the [shader("compute")] function.
+     * @param defines The defines, e.g., {{"TILE_SIZE", "16"}, {"ELEMENT_TYPE", "half"}}.
+     * @param options Shader model, optimization level, include directories, etc.
+     * @return A new ComputeKernel object. Throws on compilation failure.
+     * @note Use CreateKernelVariants() to compile each define set once.
+     */
+    std::unique_ptr<ComputeKernel> CreateKernel(
+        const std::string& hlslFilePath,
+        const std::string& entryPoint,
+        const KernelDefines& defines,
+        const KernelCompileOptions& options = {});
+
+    /**
+     * @brief Creates the variant cache of an HLSL shader, see KernelVariants.
+     * @param hlslFilePath Path to the .hlsl shader file.
+     * @param entryPoint The name of the [shader("compute")] function.
+     * @param options The compiler options every variant is compiled with.
+     * @return A new KernelVariants object. Nothing is compiled yet.
+     */
+    std::unique_ptr<KernelVariants> CreateKernelVariants(
+        const std::string& hlslFilePath,
+        const std::string& entryPoint,
+        const KernelCompileOptions& options = {});
+
+    /**
+     * @brief Compiles an HLSL shader on the compile threads, see
+     * ContextDesc::kernelCompileThreadCount.
+     * @param hlslFilePath Path to the .hlsl shader file.
+     * @param entryPoint The name of the [shader("compute")] function.
+     * @return The kernel once it compiled. get() throws on compilation failure.
+     */
+    std::future<std::unique_ptr<ComputeKernel>> CreateKernelAsync(
+        const std::string& hlslFilePath,
+        const std::string& entryPoint);
+
+    /**
+     * @brief Compiles many kernels concurrently on the compile threads.
+     *
+     * Returns without waiting: the kernels can be bound to streams right
+     * away, and a stream only blocks at the first RecordDispatch() that
+     * uses a kernel still compiling. ComputeKernel::Wait() waits for one
+     * and reports its compile error.
+     *
+     * @param sources The kernels to compile.
+     * @return One kernel per source, in the same order.
+     */
+    std::vector<std::unique_ptr<ComputeKernel>> CreateKernels(const std::vector<KernelSource>& sources);
+
+    /**
+     * @brief Compiles HLSL source held in memory and creates a compute kernel.
+     * @param hlslSource The shader source.
+     * @param entryPoint The name of the [shader("compute")] function.
+     * @param sourceName The file name compiler errors refer to. Relative
+     * #includes are resolved from the working directory.
+     * @param defines Preprocessor defines, see CreateKernel().
+     * @param options Compiler options, see CreateKernel().
+     * @return A new ComputeKernel object. Throws on compilation failure.
+     */
+    std::unique_ptr<ComputeKernel> CreateKernelFromSource(
+        const std::string& hlslSource,
+        const std::string& entryPoint,
+        const std::string& sourceName = "kernel.hlsl",
+        const KernelDefines& defines = {},
+        const KernelCompileOptions& options = {});
+
+    /**
+     * @brief Creates a compute kernel from bytecode compiled ahead of time,
+     * without running the shader compiler or reading files.
+     * @param bytecode The compiled kernel, e.g., from aegis_add_kernels().
+     * @return A new ComputeKernel object. Throws if the bytecode has no
+     * format the backend can run.
+     */
+    std::unique_ptr<ComputeKernel> CreateKernelFromBytecode(const KernelBytecode& bytecode);
+
+    /**
+     * @brief Creates a compute kernel from a C++ callable.
+     * @note Only the CPU backend can execute host kernels.
+     * @param desc The kernel function and its thread group size.
+     * @return A new ComputeKernel object, or nullptr if the backend
+     * cannot run host code.
+     */
+    std::unique_ptr<ComputeKernel> CreateHostKernel(const HostKernelDesc& desc);
+
+    /**
+     * @brief Creates an empty task graph, which spreads dispatches and
+     * copies over streams of its own.
+     * @param desc How many streams to use, and their settings.
+     * @return A new TaskGraph object.
+     */
+    std::unique_ptr<TaskGraph> CreateTaskGraph(const TaskGraphDesc& desc = {});
+
+    /**
+     * @brief Allocates pinned host memory the GPU can copy to and from directly.
+     *
+     * ResourceUpload()/ResourceDownload() with a pointer into this memory
+     * record a direct GPU copy instead of going through staging memory and
+     * an extra memcpy(). See PinnedAllocator for use with std::vector.
+     *
+     * @param byteSize The size of the allocation.
+     * @return A CPU pointer aligned to at least 64 bytes. Throws on failure.
+     */
+    void* AllocateHostMemory(size_t byteSize);
+
+    /**
+     * @brief Frees memory from AllocateHostMemory().
+     * @note Safe while copies using it are in flight, the memory is
+     * released once they're done.
+     */
+    void FreeHostMemory(void* pointer);
+
+    /**
+     * @brief Makes existing host memory usable for direct GPU copies (like cudaHostRegister()).
+     * @note D3D12 and Vulkan need page-aligned memory and driver support.
+     * @param hostPointer The first byte of the memory.
+     * @param byteSize The size of the memory.
+     * @return false if the backend can't import it. Transfers then keep
+     * working through staging memory. Throws if the range overlaps memory
+     * that is already registered.
+     */
+    bool RegisterHostMemory(void* hostPointer, size_t byteSize);
+
+    /**
+     * @brief Undoes RegisterHostMemory(). The memory itself is left alone.
+     * @warning The caller must not free the memory while copies using it
+     * are in flight.
+     */
+    void UnregisterHostMemory(void* hostPointer);
+
     /**
      * @brief Blocks the CPU thread until all submitted work on all streams
      * is finished.
+     * @note The GPU backends signal every hardware queue and wait on all
+     * of them with a single multi-fence wait.
      */
     void WaitForIdle();
 
+    /**
+     * @brief Blocks the CPU thread until every event has been reached.
+     * @note The streams the events were recorded on must have submitted
+     * them. Events that were never recorded count as reached.
+     * @param events The events to wait on.
+     */
+    void WaitAll(const std::vector<ComputeEvent*>& events);
+
+    /**
+     * @brief Blocks the CPU thread until at least one event has been reached.
+     * @note The streams the events were recorded on must have submitted
+     * them. Events that were never recorded count as reached.
+     * @param events The events to wait on, at least one.
+     * @return The index of an event that has been reached.
+     */
+    size_t WaitAny(const std::vector<ComputeEvent*>& events);
+
+#if defined(AEGIS_HAS_COROUTINES)
+    /**
+     * @brief Sets where coroutines resume after a co_await on GPU work.
+     * @note Set it before awaiting anything. The executor must outlive the
+     * context. nullptr (the default) resumes on the completion thread.
+     */
+    void SetExecutor(Executor* executor) { m_executor = executor; }
+#endif
+
+    /**
+     * @brief Gets usage and fragmentation counters of the DEVICE_LOCAL buffer heaps.
+     */
+    [[nodiscard]] MemoryStats GetMemoryStats() const;
+
+    /**
+     * @brief Gets the optional hardware features of the device.
+     */
+    [[nodiscard]] DeviceCapabilities GetCapabilities() const;
+
+    /**
+     * @brief Releases the buffers cached by FreeAsync() that the GPU is done with.
+     * @param bytesToKeep Stop once the pool holds no more than this.
+     */
+    void TrimAsyncPool(size_t bytesToKeep = 0);
+
+    /**
+     * @brief Gets usage counters of the stream-ordered AllocAsync() pool.
+     */
+    [[nodiscard]] AsyncPoolStats GetAsyncPoolStats() const;
+
+    /**
+     * @brief Gets the number of destroyed objects (buffers, kernels, events,
+     * streams) whose backend resources wait for in-flight GPU work.
+     * @note They are released as streams submit and wait; nothing blocks on them.
+     */
+    [[nodiscard]] size_t GetPendingReleaseCount() const;
+
     /**
      * @brief Gets the internal backend implementation.
      * @note This is for internal use by other Aegis classes (Stream, Buffer)
@@ -82,16 +424,73 @@ namespace aegis {
     internal::IComputeBackend* GetBackend() const { return m_backend.get(); }
 
   private:
+    friend class ComputeStream;
+    friend class ComputeEvent;
+    friend class ComputeKernel;
+    friend class GpuBuffer;
+    friend class GpuAwaitable;
+    friend class ComputeGraph;
+
     /**
      * @brief Private constructor. Use ComputeContext::Create().
      * @param backend A unique_ptr to a concrete backend implementation
      * (e.g., D3D12Backend).
+     * @param backendType Which backend 'backend' is.
+     * @param desc The options the context was created with.
      */
-    ComputeContext(std::unique_ptr<internal::IComputeBackend> backend);
+    ComputeContext(std::unique_ptr<internal::IComputeBackend> backend, Backend backendType, const ContextDesc& desc);
+
+    /**
+     * @brief Creates the backend object for a specific (non-DEFAULT) backend.
+     * @param backend Which backend to create.
+     * @param desc The rest of the context options.
+     * @return The backend, or nullptr if it isn't compiled in or fails to initialize.
+     */
+    static std::unique_ptr<internal::IComputeBackend> createBackend(Backend backend, const ContextDesc& desc);
 
     /**
      * @brief The private implementation (e.g., D3D12Backend or VulkanBackend).
      */
     std::unique_ptr<internal::IComputeBackend> m_backend;
+    Backend m_backendType;
+
+    /**
+     * @brief The buffers behind ComputeStream::AllocAsync(). Declared after
+     * m_backend so it's destroyed first.
+     */
+    std::unique_ptr<internal::AsyncBufferPool> m_asyncPool;
+
+    /**
+     * @brief The HOST buffers behind AllocateHostMemory()/RegisterHostMemory().
+     */
+    std::unique_ptr<internal::HostMemoryRegistry> m_hostMemory;
+
+    /**
+     * @brief Backend objects of destroyed wrappers the GPU may still use.
+     */
+    std::unique_ptr<internal::DeferredReleaseQueue> m_deferredReleases;
+
+    /**
+     * @brief The thread behind ComputeStream::EnqueueHostCallback().
+     */
+    std::unique_ptr<internal::CompletionWorker> m_completionWorker;
+
+    /**
+     * @brief Resumes awaiting coroutines, nullptr for the completion thread.
+     */
+    Executor* m_executor = nullptr;
+
+    /**
+     * @brief Gets the compile threads, starting them on first use.
+     */
+    internal::ThreadPool& getCompilePool();
+
+    uint32_t m_compileThreadCount;
+    std::once_flag m_compilePoolOnce;
+    /**
+     * @brief Runs CreateKernelAsync() and CreateKernels(), nullptr until the
+     * first of them. The destructor joins it before anything else.
+     */
+    std::unique_ptr<internal::ThreadPool> m_compilePool;
   };
 }
@@ -0,0 +1,92 @@
+/**
+ * @file coroutine.h
+ * @brief Executor and GpuAwaitable, for co_await on GPU work
+ */
+
+#pragma once
+
+#include "api.h"
+
+#if defined(AEGIS_HAS_COROUTINES)
+
+#include <coroutine>
+#include <functional>
+#include <memory> // for std::unique_ptr
+
+namespace aegis::internal {
+  class IComputeEvent;
+  class ReadbackCopy;
+}
+
+namespace aegis {
+  class ComputeContext;
+  class ComputeStream;
+  class ComputeEvent;
+
+  /**
+   * @brief Decides which thread resumes a coroutine once the GPU work it
+   * awaits is done.
+   *
+   * Implement this to hand resumptions to your own thread pool or event
+   * loop, and install it with ComputeContext::SetExecutor(). Without one,
+   * coroutines resume on the context's completion thread.
+   */
+  class AEGIS_API Executor {
+  public:
+    virtual ~Executor() = default;
+
+    /**
+     * @brief Runs 'work' on a thread of the executor's choice.
+     * @note Called on the completion thread, which serves every stream,
+     * so this must not block.
+     */
+    virtual void Post(std::function<void()> work) = 0;
+  };
+
+  /**
+   * @brief A point in a stream that a coroutine can co_await.
+   *
+   * Returned by ComputeStream::SubmitAsync() and DownloadAsync(), and by
+   * co_await on a ComputeEvent. Awaiting suspends the coroutine without
+   * blocking a thread: the context's single completion thread waits on
+   * the fences of all awaited points at once and resumes the coroutine
+   * through the context's Executor when its point is reached.
+   *
+   * @note If the point is never reached (the stream is destroyed without
+   * submitting it), the coroutine is never resumed.
+   */
+  class AEGIS_API GpuAwaitable {
+  public:
+    GpuAwaitable(GpuAwaitable&& other) noexcept;
+    GpuAwaitable& operator=(GpuAwaitable&&) = delete;
+    ~GpuAwaitable();
+
+    /** @brief True if the GPU already got there, no need to suspend. */
+    bool await_ready() const;
+
+    /** @brief Hands the coroutine to the completion thread. */
+    void await_suspend(std::coroutine_handle<> handle);
+
+    /** @brief Makes sure a download's data is in place. */
+    void await_resume();
+
+  private:
+    friend class ComputeStream;
+    friend class ComputeEvent;
+
+    /**
+     * @brief Private constructor.
+     * @param context The context whose completion thread resumes the coroutine.
+     * @param event The point to wait for, owned by the awaitable.
+     * @param copy The download to copy out once the point is reached, if any.
+     */
+    GpuAwaitable(ComputeContext* context, std::unique_ptr<internal::IComputeEvent> event,
+                 std::shared_ptr<internal::ReadbackCopy> copy);
+
+    ComputeContext* m_context;
+    std::unique_ptr<internal::IComputeEvent> m_event;
+    std::shared_ptr<internal::ReadbackCopy> m_copy;
+  };
+}
+
+#endif
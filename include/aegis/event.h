@@ -5,8 +5,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory> // for std::unique_ptr
 #include "api.h"
+#include "coroutine.h"
 
 namespace aegis::internal {
   class IComputeEvent;
@@ -29,6 +31,35 @@ namespace aegis {
      */
     ~ComputeEvent();
 
+    /**
+     * @brief Checks, without blocking, whether the GPU reached the point
+     * the event was recorded at.
+     * @note Events that were never recorded count as reached.
+     */
+    [[nodiscard]] bool IsComplete() const;
+
+    /**
+     * @brief Blocks the CPU thread until the event is reached.
+     * @note The stream that recorded the event must have submitted it.
+     */
+    void HostWait();
+
+    /**
+     * @brief Blocks the CPU thread until the event is reached or the timeout expires.
+     * @param timeout How long to wait at most. Zero just polls.
+     * @return false if the timeout expired first.
+     */
+    bool HostWait(std::chrono::milliseconds timeout);
+
+#if defined(AEGIS_HAS_COROUTINES)
+    /**
+     * @brief Suspends a coroutine until the event is reached.
+     * @note Waits for the point the event was last recorded at, recording
+     * it again later doesn't change what an earlier co_await waits for.
+     */
+    GpuAwaitable operator co_await() const;
+#endif
+
     /**
      * @brief Gets the internal backend implementation.
      * @note For internal use by other Flux classes.
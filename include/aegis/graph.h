@@ -0,0 +1,102 @@
+/**
+ * @file graph.h
+ * @brief ComputeGraph class
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory> // for std::unique_ptr
+#include <vector>
+#include "api.h"
+
+namespace aegis::internal {
+  class IComputeGraph;
+}
+
+namespace aegis {
+  class ComputeContext;
+  class ComputeStream;
+  class GpuBuffer;
+  struct BufferView;
+
+  /**
+   * @brief A sequence of dispatches captured once and replayed many times
+   * (like a CUDA graph).
+   *
+   * Created by ComputeStream::EndCapture() and replayed with
+   * ComputeStream::RecordGraph(). On D3D12 the dispatches and the barriers
+   * between them are recorded into a command list once; a replay records
+   * only the transitions into it and executes it.
+   *
+   * Nodes are the captured RecordDispatch() calls, numbered from 0 in
+   * capture order. Their kernels are fixed, but the buffers bound to their
+   * slots and their grid sizes can be changed between replays without
+   * recording anything again.
+   *
+   * @note The kernels and buffers the graph uses must outlive it.
+   */
+  class AEGIS_API ComputeGraph {
+  public:
+    /**
+     * @brief Destroys the graph once no submitted replay uses it anymore.
+     */
+    ~ComputeGraph();
+
+    /**
+     * @brief Gets the number of captured dispatches.
+     */
+    [[nodiscard]] size_t GetNodeCount() const;
+
+    /**
+     * @brief Binds another buffer to a slot of a node, for the next replays.
+     * @note Only slots that were bound when the node was captured can be
+     * changed.
+     * @param node The index of the dispatch in capture order.
+     * @param slot The register slot (e.g., u0, u1...).
+     * @param buffer The buffer to bind.
+     */
+    void SetBuffer(size_t node, uint32_t slot, GpuBuffer& buffer);
+
+    /**
+     * @brief Binds a range of a buffer to a slot of a node, for the next replays.
+     * @param node The index of the dispatch in capture order.
+     * @param slot The register slot (e.g., u0, u1...).
+     * @param view The range to bind (see GpuBuffer::View()).
+     */
+    void SetBuffer(size_t node, uint32_t slot, const BufferView& view);
+
+    /**
+     * @brief Changes the grid size of a node, for the next replays.
+     * @param node The index of the dispatch in capture order.
+     */
+    void SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ);
+
+    /**
+     * @brief Gets the internal backend implementation.
+     * @note For internal use by other Flux classes.
+     */
+    internal::IComputeGraph* GetBackendGraph() const { return m_backendGraph.get(); }
+  private:
+    friend class ComputeStream;
+
+    /**
+     * @brief Private constructor. Use ComputeStream::EndCapture().
+     * @param context The context that owns this graph.
+     * @param backendGraph The private implementation (e.g., D3D12Graph).
+     * @param buffers The buffers bound to each node, in the order of its bindings.
+     */
+    ComputeGraph(ComputeContext* context, std::unique_ptr<internal::IComputeGraph> backendGraph,
+                 std::vector<std::vector<GpuBuffer*>> buffers);
+
+    /**
+     * @brief Rebinds a slot and remembers the buffer for staged writes.
+     */
+    void setBuffer(size_t node, uint32_t slot, GpuBuffer& buffer, size_t offset, size_t byteSize);
+
+    ComputeContext* m_context;
+    std::unique_ptr<internal::IComputeGraph> m_backendGraph;
+    std::vector<std::vector<GpuBuffer*>> m_buffers; // Flushed by RecordGraph() if they have staged writes
+  };
+}
@@ -0,0 +1,91 @@
+/**
+ * @file host_kernel.h
+ * @brief Host (CPU) kernel types used by the CPU backend
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "api.h"
+
+namespace aegis {
+  /**
+   * @brief A 3-component thread/group index, the C++ equivalent of an HLSL uint3.
+   */
+  struct HostUint3 {
+    uint32_t x;
+    uint32_t y;
+    uint32_t z;
+  };
+
+  /**
+   * @brief Everything a host kernel invocation can see about "its" thread.
+   *
+   * One HostThreadContext is passed to the kernel function for every thread
+   * of every thread group, mirroring the HLSL system values.
+   */
+  struct HostThreadContext {
+    /** @brief Equivalent of SV_DispatchThreadID. */
+    HostUint3 dispatchThreadID;
+    /** @brief Equivalent of SV_GroupThreadID. */
+    HostUint3 groupThreadID;
+    /** @brief Equivalent of SV_GroupID. */
+    HostUint3 groupID;
+
+    /** @brief CPU pointers to the buffers bound with SetBuffer(), indexed by slot. */
+    void* const* buffers;
+    /** @brief The size in bytes of each bound buffer, indexed by slot. */
+    const size_t* bufferSizes;
+    /** @brief The number of entries in buffers/bufferSizes. */
+    uint32_t bufferCount;
+
+    /**
+     * @brief Gets the buffer bound to a slot (the "u" register) as a typed pointer.
+     * @param slot The register slot passed to SetBuffer().
+     * @return T* The buffer memory, or nullptr if nothing is bound to the slot.
+     */
+    template <typename T>
+    T* Buffer(uint32_t slot) const {
+      return slot < bufferCount ? static_cast<T*>(buffers[slot]) : nullptr;
+    }
+
+    /** @brief CPU pointers to the blocks set with SetConstants(), indexed by slot. */
+    const void* const* constants;
+    /** @brief The size in bytes of each block, indexed by slot. */
+    const size_t* constantSizes;
+    /** @brief The number of entries in constants/constantSizes. */
+    uint32_t constantCount;
+
+    /**
+     * @brief Gets the block set for a slot (the "b" register) as a typed pointer.
+     * @param slot The register slot passed to SetConstants().
+     * @return const T* The values, or nullptr if nothing was set for the slot.
+     */
+    template <typename T>
+    const T* Constants(uint32_t slot) const {
+      return slot < constantCount ? static_cast<const T*>(constants[slot]) : nullptr;
+    }
+  };
+
+  /**
+   * @brief A kernel implemented as a C++ callable.
+   *
+   * The function is invoked once per thread. Thread groups are distributed
+   * across worker threads, so the function must be safe to call concurrently.
+   * @note There is no groupshared memory or GroupMemoryBarrier() equivalent;
+   * threads of the same group run sequentially on one worker.
+   */
+  using HostKernelFunction = std::function<void(const HostThreadContext&)>;
+
+  /**
+   * @brief Describes a host kernel for ComputeContext::CreateHostKernel().
+   */
+  struct HostKernelDesc {
+    /** @brief The function to run for every thread. */
+    HostKernelFunction function;
+    /** @brief The thread group size, equivalent of [numthreads(x, y, z)]. */
+    HostUint3 numThreads = {1, 1, 1};
+  };
+}
@@ -0,0 +1,60 @@
+/**
+ * @file host_memory.h
+ * @brief PinnedAllocator, a std allocator for pinned host memory
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "aegis/context.h"
+
+namespace aegis {
+  /**
+   * @brief A standard allocator that hands out pinned host memory.
+   *
+   * Containers using it live in memory from ComputeContext::AllocateHostMemory(),
+   * so uploads from and downloads into them are direct GPU copies:
+   *
+   * @code
+   * aegis::PinnedVector<float> batch(count, aegis::PinnedAllocator<float>(*context));
+   * stream->ResourceUpload(*buffer, batch.data(), batch.size() * sizeof(float));
+   * @endcode
+   *
+   * @note Every allocation is a separate GPU-visible buffer, so prefer
+   * reserve() over many small reallocations.
+   */
+  template <typename T>
+  class PinnedAllocator {
+  public:
+    using value_type = T;
+
+    explicit PinnedAllocator(ComputeContext& context) noexcept : m_context(&context) {}
+
+    template <typename U>
+    PinnedAllocator(const PinnedAllocator<U>& other) noexcept : m_context(other.GetContext()) {}
+
+    T* allocate(size_t count) {
+      return static_cast<T*>(m_context->AllocateHostMemory(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) noexcept {
+      m_context->FreeHostMemory(pointer);
+    }
+
+    ComputeContext* GetContext() const noexcept { return m_context; }
+
+    template <typename U>
+    bool operator==(const PinnedAllocator<U>& other) const noexcept { return m_context == other.GetContext(); }
+
+  private:
+    ComputeContext* m_context;
+  };
+
+  /**
+   * @brief A std::vector in pinned host memory.
+   */
+  template <typename T>
+  using PinnedVector = std::vector<T, PinnedAllocator<T>>;
+}
@@ -5,7 +5,14 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <future> // for std::shared_future
+#include <map>
 #include <memory> // for std::unique_ptr
+#include <mutex>
+#include <string>
+#include <vector>
 #include "api.h"
 
 namespace aegis::internal {
@@ -15,25 +22,99 @@ namespace aegis::internal {
 namespace aegis {
   class ComputeContext;
 
+  /**
+   * @brief A kernel compiled ahead of time, see ComputeContext::CreateKernelFromBytecode().
+   *
+   * aegis_add_kernels() in CMake generates one of these per shader. Each
+   * backend uses its own format and throws if it's missing.
+   *
+   * @note The memory is only read during CreateKernelFromBytecode().
+   */
+  struct KernelBytecode {
+    /** @brief The name of the [shader("compute")] function. */
+    const char* entryPoint = "main";
+    /** @brief DXIL for D3D12 (dxc -T cs_6_0). */
+    const void* dxil = nullptr;
+    size_t dxilSize = 0;
+    /**
+     * @brief The reflection of the DXIL (dxc -Fre), to build the root
+     * signature from. Can be left empty if the DXIL still holds it.
+     */
+    const void* dxilReflection = nullptr;
+    size_t dxilReflectionSize = 0;
+    /** @brief SPIR-V for Vulkan (dxc -spirv), 4-byte aligned. */
+    const void* spirv = nullptr;
+    size_t spirvSize = 0;
+  };
+
+  /**
+   * @brief Preprocessor defines of a kernel, name to value (dxc -D name=value).
+   * @note An empty value defines the name as 1.
+   */
+  using KernelDefines = std::map<std::string, std::string>;
+
+  /**
+   * @brief Compiler settings for ComputeContext::CreateKernel().
+   */
+  struct KernelCompileOptions {
+    /** @brief The compute shader model, "6_2" or later for 16-bit types. */
+    std::string shaderModel = "6_0";
+    /** @brief Optimization level from 0 to 3 (dxc -O0 to -O3). */
+    uint32_t optimizationLevel = 3;
+    /** @brief Embeds debug information (dxc -Zi), always on in debug builds of D3D12. */
+    bool debugInfo = false;
+    /** @brief Enables half/int16_t and friends (dxc -enable-16bit-types), needs shader model 6.2. */
+    bool enable16BitTypes = false;
+    /** @brief Directories #includes are searched in besides the working directory (dxc -I). */
+    std::vector<std::string> includeDirectories;
+  };
+
+  /**
+   * @brief An HLSL file and entry point, see ComputeContext::CreateKernels().
+   */
+  struct KernelSource {
+    /** @brief Path to the .hlsl shader file. */
+    std::string hlslFilePath;
+    /** @brief The name of the [shader("compute")] function. */
+    std::string entryPoint = "main";
+  };
+
   /**
    * @brief Represents a compiled compute shader "function" ready to be
    * executed on the GPU.
    *
    * This is a handle to a compiled kernel. It is created by
    * ComputeContext::CreateKernel and is bound to a ComputeStream to be run.
+   *
+   * Kernels from ComputeContext::CreateKernels() may still be compiling.
+   * They can be bound right away: a stream only waits for the compile at
+   * the first RecordDispatch() after SetKernel().
    */
   class AEGIS_API ComputeKernel {
   public:
     /**
      * @brief Destroys the compute kernel.
+     * @note Waits for the compile if it is still running.
      */
     ~ComputeKernel();
 
+    /**
+     * @brief Whether the kernel finished compiling (or failed to). Doesn't block.
+     */
+    [[nodiscard]] bool IsReady() const;
+
+    /**
+     * @brief Blocks until the kernel finished compiling.
+     * @note Throws the compile error if it failed, on every call.
+     */
+    void Wait() const;
+
     /**
      * @brief Gets the internal backend implementation.
-     * @note For internal use by other Flux classes.
+     * @note For internal use by other Flux classes. Waits for the compile
+     * like Wait().
      */
-    internal::IComputeKernel* GetBackendKernel() const { return m_backendKernel.get(); }
+    internal::IComputeKernel* GetBackendKernel() const;
   private:
     friend class ComputeContext;
 
@@ -45,6 +126,51 @@ namespace aegis {
     ComputeKernel(ComputeContext* context, std::unique_ptr<internal::IComputeKernel> backendKernel);
 
     ComputeContext* m_context;
-    std::unique_ptr<internal::IComputeKernel> m_backendKernel;
+    std::unique_ptr<internal::IComputeKernel> m_backendKernel; // Set by the compile task if m_compiled is valid
+    std::shared_future<void> m_compiled; // Only valid for kernels from CreateKernels()
+  };
+
+  /**
+   * @brief The variants of one kernel, each compiled with its own defines.
+   *
+   * Created by ComputeContext::CreateKernelVariants(). A variant is
+   * compiled on its first Get() and kept, asking for it again is a lookup.
+   * Specializing tile sizes, element types or unroll factors this way
+   * needs no generated .hlsl files.
+   *
+   * @note Thread-safe. Variants compile without holding the lock, so
+   * different variants can compile concurrently.
+   */
+  class AEGIS_API KernelVariants {
+  public:
+    ~KernelVariants();
+
+    /**
+     * @brief Gets the variant compiled with 'defines', compiling it first if needed.
+     * @note Throws on compilation failure, a failed variant isn't cached.
+     * @return The kernel, owned by this object.
+     */
+    ComputeKernel& Get(const KernelDefines& defines);
+
+    /**
+     * @brief Gets the number of variants compiled so far.
+     */
+    [[nodiscard]] size_t GetVariantCount() const;
+
+  private:
+    friend class ComputeContext;
+
+    /**
+     * @brief Private constructor. Use ComputeContext::CreateKernelVariants().
+     */
+    KernelVariants(ComputeContext* context, std::string hlslFilePath, std::string entryPoint, KernelCompileOptions options);
+
+    ComputeContext* m_context;
+    std::string m_hlslFilePath;
+    std::string m_entryPoint;
+    KernelCompileOptions m_options;
+
+    mutable std::mutex m_mutex; // Protects m_variants
+    std::map<KernelDefines, std::unique_ptr<ComputeKernel>> m_variants;
   };
 }
\ No newline at end of file
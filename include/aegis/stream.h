@@ -5,11 +5,22 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <memory> // for std::unique_ptr
+#include <utility>
+#include <vector>
 #include "api.h"
+#include "buffer.h" // for BufferAccess
+#include "coroutine.h"
 
 namespace aegis::internal {
   class IComputeStream;
+  struct GraphCapture;
+  struct GraphBinding;
 }
 
 namespace aegis {
@@ -17,6 +28,111 @@ namespace aegis {
   class GpuBuffer;
   class ComputeKernel;
   class ComputeEvent;
+  class ComputeGraph;
+
+  /**
+   * @brief The kind of hardware queue a stream submits to.
+   */
+  enum class StreamType {
+    /** @brief Runs kernels and copies. */
+    COMPUTE,
+    /**
+     * @brief Only copies, uploads and downloads, on the GPU's copy engine
+     * (DMA). Transfers on a COPY stream overlap with kernels running on
+     * COMPUTE streams; order the two with events.
+     * @note See DeviceCapabilities::dedicatedCopyQueue.
+     */
+    COPY,
+  };
+
+  /**
+   * @brief How the GPU schedules a stream's work against other streams.
+   */
+  enum class StreamPriority {
+    NORMAL,
+    /** @brief Runs ahead of NORMAL work on the device (e.g., latency-critical batches). */
+    HIGH,
+    /**
+     * @brief D3D12's global realtime priority, which needs an elevated
+     * process. Falls back to HIGH where it isn't available.
+     */
+    REALTIME,
+  };
+
+  /**
+   * @brief Options for a new stream. The staging pools grow on demand,
+   * their sizes here are only the starting sizes.
+   */
+  struct StreamDesc {
+    /** @brief The queue the stream submits to. */
+    StreamType type = StreamType::COMPUTE;
+    /**
+     * @brief The scheduling priority of the stream's hardware queue.
+     * @note The CPU backend runs every stream on a thread of its own and
+     * ignores this.
+     */
+    StreamPriority priority = StreamPriority::NORMAL;
+    /** @brief Initial size of the ring ResourceUpload() writes into. */
+    size_t uploadRingSize = 4 * 1024 * 1024;
+    /** @brief Initial size of the arena ResourceDownload() copies into. */
+    size_t readbackArenaSize = 4 * 1024 * 1024;
+    /**
+     * @brief How many submissions may execute at once. The CPU records the
+     * next batch while they run; Submit() blocks until the oldest one is
+     * done once there are this many. Values below 1 count as 1.
+     */
+    uint32_t maxInFlightSubmissions = 3;
+  };
+
+  /**
+   * @brief Usage counters for one staging pool (upload or readback).
+   */
+  struct StagingPoolStats {
+    /** @brief Current size of the pool in bytes. */
+    size_t capacity = 0;
+    /** @brief Bytes held for work the GPU hasn't finished (or HostWait() hasn't collected). */
+    size_t bytesInUse = 0;
+    /** @brief The largest bytesInUse ever reached. */
+    size_t highWaterBytes = 0;
+    /** @brief Number of suballocations made. */
+    uint64_t allocationCount = 0;
+    /** @brief Number of times the pool ran out of space and was replaced by a bigger one. */
+    uint64_t growCount = 0;
+    /** @brief Number of requests too large for the pool that got their own buffer. */
+    uint64_t dedicatedCount = 0;
+    /** @brief Number of times the pool was full at its maximum size and waited for the GPU to free space. */
+    uint64_t waitCount = 0;
+  };
+
+  /**
+   * @brief Staging memory usage of a stream.
+   * @note The CPU backend doesn't stage, so all of its counters are zero.
+   */
+  struct StagingStats {
+    StagingPoolStats upload;
+    StagingPoolStats readback;
+  };
+
+  /**
+   * @brief Resource barrier counters of a stream, since it was created.
+   * @note Only D3D12 streams track hazards per buffer; the other backends
+   * report zeros.
+   */
+  struct BarrierStats {
+    /** @brief State transitions recorded, split ones included. */
+    uint64_t transitionCount = 0;
+    /** @brief Transitions recorded as a begin/end pair with other commands in between. */
+    uint64_t splitTransitionCount = 0;
+    /** @brief UAV barriers recorded between dispatches with a read/write hazard. */
+    uint64_t uavBarrierCount = 0;
+    /**
+     * @brief UAV barriers left out: a dispatch used a buffer an earlier one
+     * used since the last barrier, but both only read or the ranges are disjoint.
+     */
+    uint64_t elidedUavBarrierCount = 0;
+    /** @brief ResourceBarrier() calls all of the above were batched into. */
+    uint64_t batchCount = 0;
+  };
 
   /**
    * @brief An asynchronous stream of compute commands (a "CUDA stream").
@@ -29,12 +145,18 @@ namespace aegis {
   public:
     /**
      * @brief Destroys the stream.
-     * @note This will wait for any pending work in this stream to complete.
+     * @note This doesn't wait: submitted work keeps running and the stream's
+     * resources are released once it's done. Work recorded since the last
+     * Submit() is dropped.
      */
     ~ComputeStream();
 
     /**
      * @brief Binds a compute kernel to the stream for the next dispatch.
+     * @note SetKernel(), SetBuffer(), SetConstants() and RecordDispatch() throw on a COPY stream.
+     * @note A kernel that is still compiling (ComputeContext::CreateKernels())
+     * doesn't block here: the next RecordDispatch() waits for it, and
+     * throws its compile error. SetKernel() throws it if it's already known.
      * @param kernel The kernel to set.
      */
     void SetKernel(ComputeKernel& kernel);
@@ -49,33 +171,133 @@ namespace aegis {
 
     /**
      * @brief Records a command to copy data from one GPU buffer to another.
+     * @note Both buffers must have the same size, copy a range otherwise.
      * @param dest The destination buffer.
      * @param src The source buffer.
      */
     void ResourceCopyBuffer(GpuBuffer& dest, GpuBuffer& src);
 
+    /**
+     * @brief Records a command to copy a byte range between GPU buffers.
+     * @note dest and src may be the same buffer if the ranges don't overlap,
+     * except on D3D12 where a buffer can't be copy source and destination at once.
+     * @param dest The destination buffer.
+     * @param destOffset Where to write in dest.
+     * @param src The source buffer.
+     * @param srcOffset Where to read in src.
+     * @param byteSize The number of bytes to copy.
+     */
+    void ResourceCopyBuffer(GpuBuffer& dest, size_t destOffset, GpuBuffer& src, size_t srcOffset, size_t byteSize);
+
     /**
      * @brief Records a command to upload data from the CPU to a GPU buffer.
+     * @note If srcData points into pinned memory (ComputeContext::AllocateHostMemory()
+     * or RegisterHostMemory()), the GPU copies straight from it when the
+     * command executes, so it must stay unchanged until the stream is done.
+     * Other memory is copied into staging memory right away.
      * @param dest The destination GPU buffer (must be DEVICE_LOCAL).
      * @param srcData A pointer to the CPU data to upload.
      * @param byteSize The size of the data to upload.
      */
     void ResourceUpload(GpuBuffer& dest, const void* srcData, size_t byteSize);
 
+    /**
+     * @brief Records a command to upload data from the CPU into a range of a GPU buffer.
+     * @param dest The destination GPU buffer (must be DEVICE_LOCAL).
+     * @param destOffset Where to write in dest.
+     * @param srcData A pointer to the CPU data to upload.
+     * @param byteSize The size of the data to upload.
+     */
+    void ResourceUpload(GpuBuffer& dest, size_t destOffset, const void* srcData, size_t byteSize);
+
     /**
      * @brief Records a command to download data from a GPU buffer to the CPU.
+     * @note If destData points into pinned memory, the GPU writes straight
+     * into it. Either way the data is only valid after HostWait().
      * @param destData A pointer to the CPU memory to receive the data.
      * @param src The source GPU buffer (must be DEVICE_LOCAL).
      * @param byteSize The size of the data to download.
      */
     void ResourceDownload(void* destData, GpuBuffer& src, size_t byteSize);
 
+    /**
+     * @brief Records a command to download a range of a GPU buffer to the CPU.
+     * @param destData A pointer to the CPU memory to receive the data.
+     * @param src The source GPU buffer (must be DEVICE_LOCAL).
+     * @param srcOffset Where to read in src.
+     * @param byteSize The size of the data to download.
+     */
+    void ResourceDownload(void* destData, GpuBuffer& src, size_t srcOffset, size_t byteSize);
+
+    /**
+     * @brief Records a download whose result is delivered through a future.
+     *
+     * The copy out of staging memory runs on the context's completion
+     * thread as soon as the GPU finishes it, whoever calls HostWait(), so
+     * the recording thread can keep going while results land.
+     *
+     * @note The future becomes ready only after Submit() sent the download.
+     * destData must stay valid until then. If the download is dropped
+     * instead (its stream is destroyed first), the future reports a
+     * broken promise.
+     * @param destData A pointer to the CPU memory to receive the data.
+     * @param src The source GPU buffer (must be DEVICE_LOCAL).
+     * @param byteSize The size of the data to download.
+     * @return A future that is ready once destData holds the data.
+     */
+    std::future<void> ResourceDownloadAsync(void* destData, GpuBuffer& src, size_t byteSize);
+
+    /**
+     * @brief Records a download of a range of a GPU buffer, delivered through a future.
+     * @param destData A pointer to the CPU memory to receive the data.
+     * @param src The source GPU buffer (must be DEVICE_LOCAL).
+     * @param srcOffset Where to read in src.
+     * @param byteSize The size of the data to download.
+     * @return A future that is ready once destData holds the data.
+     */
+    std::future<void> ResourceDownloadAsync(void* destData, GpuBuffer& src, size_t srcOffset, size_t byteSize);
+
     /**
      * @brief Binds a GPU buffer to a specific shader register (e.g., u0, u1).
      * @param slot The register slot.
      * @param buffer The buffer to bind.
+     * @param access How the kernel uses it. READ lets dispatches that only
+     * read the buffer run without a barrier between them.
+     */
+    void SetBuffer(uint32_t slot, GpuBuffer& buffer, BufferAccess access = BufferAccess::READ_WRITE);
+
+    /**
+     * @brief Binds a byte range of a GPU buffer to a shader register.
+     * @note The kernel sees the view as the whole buffer. D3D12 root
+     * descriptors carry no size, so there the range end isn't enforced.
+     * @param slot The register slot.
+     * @param view The range to bind.
+     * @param access How the kernel uses it.
+     */
+    void SetBuffer(uint32_t slot, const BufferView& view, BufferAccess access = BufferAccess::READ_WRITE);
+
+    /**
+     * @brief Sets the values of a cbuffer (e.g., b0, b1) for the next dispatches.
+     *
+     * The data is copied, it can be changed right after. On D3D12 a
+     * cbuffer of up to 64 bytes is passed as root constants, a larger one
+     * through a per-stream ring in upload memory; neither needs a copy or
+     * a barrier. Vulkan binds a block of the ring as a uniform buffer.
+     *
+     * @note Call it after SetKernel(), the size is checked against its
+     * cbuffer. On D3D12 a kernel with another root signature drops the
+     * constants, like its buffer bindings. Cannot be captured in a graph.
+     * @param slot The register slot.
+     * @param data The values, laid out by the HLSL cbuffer packing rules.
+     * @param byteSize The size of the data, at most the cbuffer's.
      */
-    void SetBuffer(uint32_t slot, GpuBuffer& buffer);
+    void SetConstants(uint32_t slot, const void* data, size_t byteSize);
+
+    /**
+     * @brief Sets a cbuffer from a struct that mirrors it, see SetConstants().
+     */
+    template<typename T>
+    void SetConstants(uint32_t slot, const T& constants) { SetConstants(slot, &constants, sizeof(T)); }
 
     /**
      * @brief Submits all recorded commands to the GPU for execution.
@@ -85,6 +307,34 @@ namespace aegis {
      */
     void Submit();
 
+#if defined(AEGIS_HAS_COROUTINES)
+    /**
+     * @brief Submits the recorded commands and returns something to co_await
+     * until they are finished.
+     * @note Staged ResourceDownload()s still need HostWait(), use
+     * DownloadAsync() to await data.
+     */
+    GpuAwaitable SubmitAsync();
+
+    /**
+     * @brief Records a download, submits, and returns something to co_await
+     * until the data is in destData.
+     * @param destData A pointer to the CPU memory to receive the data.
+     * @param src The source GPU buffer (must be DEVICE_LOCAL).
+     * @param byteSize The size of the data to download.
+     */
+    GpuAwaitable DownloadAsync(void* destData, GpuBuffer& src, size_t byteSize);
+
+    /**
+     * @brief Like DownloadAsync(), for a range of the source buffer.
+     * @param destData A pointer to the CPU memory to receive the data.
+     * @param src The source GPU buffer (must be DEVICE_LOCAL).
+     * @param srcOffset Where to read in src.
+     * @param byteSize The size of the data to download.
+     */
+    GpuAwaitable DownloadAsync(void* destData, GpuBuffer& src, size_t srcOffset, size_t byteSize);
+#endif
+
     /**
      * @brief Blocks the C++ thread until all work in *this stream* is finished.
      *
@@ -92,8 +342,36 @@ namespace aegis {
      */
     void HostWait();
 
+    /**
+     * @brief Blocks until all work in this stream is finished or the timeout expires.
+     * @param timeout How long to wait at most. Zero just polls.
+     * @return false if the timeout expired first. Pending downloads are
+     * only processed when it returns true.
+     */
+    bool HostWait(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Runs a function on the CPU once the stream reaches this point
+     * (like cudaLaunchHostFunc).
+     *
+     * The callback runs on the context's completion thread, in order with
+     * the other callbacks of this stream, after Submit() sent the work
+     * recorded before it and the GPU finished it. Nothing blocks meanwhile.
+     *
+     * @note Downloads into pinned memory are complete in the callback,
+     * staged ones still need HostWait(). Callbacks share one thread, so they
+     * should be short, must not throw and must not wait on GPU work.
+     * @param callback The function to run.
+     */
+    void EnqueueHostCallback(std::function<void()> callback);
+
     /**
      * @brief Records a command for this stream to wait for an event.
+     * @note GPU streams can share a hardware queue, which runs nothing
+     * while it waits, so the wait only reaches the GPU once the signaling
+     * stream submitted the event. Until then, this stream's Submit()
+     * blocks. It throws instead if the calling thread is the one recording
+     * events on the signaling stream: submit that stream first.
      * @param event The event to wait on.
      */
     void StreamWait(ComputeEvent& event);
@@ -105,6 +383,82 @@ namespace aegis {
      */
     void RecordEvent(ComputeEvent& event);
 
+    /**
+     * @brief Starts capturing dispatches into a graph instead of recording them.
+     *
+     * Until EndCapture(), SetKernel(), SetBuffer() and RecordDispatch() only
+     * describe the graph; nothing reaches the GPU. The capture starts with
+     * no kernel and no buffers bound. Other recording calls throw meanwhile,
+     * Submit() and HostWait() still apply to the work recorded before.
+     * Dispatching a kernel that has cbuffers throws too.
+     */
+    void BeginCapture();
+
+    /**
+     * @brief Stops capturing and turns the captured dispatches into a graph.
+     * @return The graph, replayed with RecordGraph().
+     */
+    [[nodiscard]] std::unique_ptr<ComputeGraph> EndCapture();
+
+    /**
+     * @brief Checks whether the stream is between BeginCapture() and EndCapture().
+     */
+    [[nodiscard]] bool IsCapturing() const { return m_capture != nullptr; }
+
+    /**
+     * @brief Records a replay of every dispatch in a graph, with the
+     * buffers and grid sizes it has now.
+     * @note The kernel and buffers bound on the stream are undefined
+     * afterwards, set them again before the next RecordDispatch(). Replay
+     * a graph on one stream at a time.
+     * @param graph A graph captured on any COMPUTE stream of this context.
+     */
+    void RecordGraph(ComputeGraph& graph);
+
+    /**
+     * @brief Gets the usage counters of this stream's upload ring and readback arena.
+     * @note Use this to tune StreamDesc: a non-zero growCount means the
+     * initial size was too small, a non-zero waitCount that the CPU got
+     * far enough ahead to fill the largest one.
+     */
+    [[nodiscard]] StagingStats GetStagingStats() const;
+
+    /**
+     * @brief Gets how many barriers this stream recorded and left out.
+     */
+    [[nodiscard]] BarrierStats GetBarrierStats() const;
+
+    /**
+     * @brief Allocates a DEVICE_LOCAL buffer in stream order (like cudaMallocAsync).
+     *
+     * The buffer comes from a pool owned by the context and may reuse memory
+     * that was FreeAsync()'d earlier on this stream, on a stream this one
+     * waited on with StreamWait(), or on a stream whose work has finished.
+     * Its contents are undefined.
+     *
+     * @note The buffer is ready for this stream. Other streams must be
+     * ordered after this one (through an event) before using it.
+     * @param byteSize The size of the buffer in bytes.
+     * @return A new GpuBuffer object.
+     */
+    std::unique_ptr<GpuBuffer> AllocAsync(size_t byteSize);
+
+    /**
+     * @brief Returns a buffer from AllocAsync() to the pool in stream order.
+     *
+     * The memory becomes reusable once the work recorded so far on this
+     * stream is done. Unlike destroying the buffer, this is safe while that
+     * work is still in flight.
+     *
+     * @param buffer A buffer created by AllocAsync() on any stream of this context.
+     */
+    void FreeAsync(std::unique_ptr<GpuBuffer> buffer);
+
+    /**
+     * @brief Gets the queue type the stream was created with.
+     */
+    [[nodiscard]] StreamType GetType() const { return m_type; }
+
     /**
      * @brief Gets the internal backend implementation.
      * @note For internal use by other Flux classes.
@@ -117,11 +471,46 @@ namespace aegis {
      * @brief Private constructor.
      * @param context The context that owns this stream.
      * @param backendStream The private implementation (e.g., D3D12Stream).
+     * @param type The queue type backendStream was created for.
+     */
+    ComputeStream(ComputeContext* context, std::unique_ptr<internal::IComputeStream> backendStream, StreamType type);
+
+    /**
+     * @brief Throws if this is a COPY stream.
+     */
+    void requireCompute() const;
+
+    /**
+     * @brief Throws if the stream is capturing, for calls a graph can't hold.
+     */
+    void requireNotCapturing() const;
+
+    /**
+     * @brief Binds a buffer range in the capture, SetBuffer() while capturing.
+     */
+    void captureBuffer(uint32_t slot, GpuBuffer& buffer, size_t offset, size_t byteSize, BufferAccess access);
+
+    /**
+     * @brief Records the copy of a staged DEVICE_HOST_VISIBLE buffer's CPU
+     * writes, if there are any, before the buffer is used.
+     */
+    void flushStaging(GpuBuffer& buffer);
+
+    /**
+     * @brief Binds the kernel SetKernel() deferred and the buffers and
+     * constants set since, waiting for its compile. Does nothing if there
+     * is none.
      */
-    ComputeStream(ComputeContext* context, std::unique_ptr<internal::IComputeStream> backendStream);
+    void bindPendingKernel();
 
     ComputeContext* m_context;
     std::unique_ptr<internal::IComputeStream> m_backendStream;
+    StreamType m_type;
+    uint64_t m_callbackQueue; // The completion worker queue of EnqueueHostCallback()
+    std::unique_ptr<internal::GraphCapture> m_capture; // Set between BeginCapture() and EndCapture()
+    ComputeKernel* m_pendingKernel = nullptr; // Bound by SetKernel() while it was still compiling
+    std::vector<internal::GraphBinding> m_pendingBindings; // SetBuffer() calls since, outside captures
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> m_pendingConstants; // SetConstants() calls since, by slot
   };
 
 }
\ No newline at end of file
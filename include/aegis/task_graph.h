@@ -0,0 +1,215 @@
+/**
+ * @file task_graph.h
+ * @brief TaskGraph class, which derives stream synchronization from buffer accesses
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory> // for std::unique_ptr
+#include <vector>
+#include "api.h"
+#include "buffer.h" // for BufferView
+#include "stream.h" // for StreamDesc
+
+namespace aegis {
+  class ComputeContext;
+  class ComputeKernel;
+  class ComputeEvent;
+
+  /**
+   * @brief A buffer range bound to a slot of a dispatch task, and how the
+   * kernel uses it.
+   */
+  struct TaskBuffer {
+    uint32_t slot = 0;
+    BufferView view;
+    BufferAccess access = BufferAccess::READ_WRITE;
+
+    /** @brief The kernel only reads the whole buffer. */
+    static TaskBuffer Read(uint32_t slot, GpuBuffer& buffer) { return {slot, buffer.View(0, buffer.GetSizeInBytes()), BufferAccess::READ}; }
+    /** @brief The kernel only writes the whole buffer. */
+    static TaskBuffer Write(uint32_t slot, GpuBuffer& buffer) { return {slot, buffer.View(0, buffer.GetSizeInBytes()), BufferAccess::WRITE}; }
+    /** @brief The kernel reads and writes the whole buffer. */
+    static TaskBuffer ReadWrite(uint32_t slot, GpuBuffer& buffer) { return {slot, buffer.View(0, buffer.GetSizeInBytes()), BufferAccess::READ_WRITE}; }
+  };
+
+  /**
+   * @brief Options for ComputeContext::CreateTaskGraph().
+   */
+  struct TaskGraphDesc {
+    /** @brief The most streams independent branches are spread over. Values below 1 count as 1. */
+    uint32_t maxStreams = 4;
+    /** @brief Priority and staging sizes of those streams; the type is always COMPUTE. */
+    StreamDesc stream;
+  };
+
+  /**
+   * @brief What the scheduler made of a task graph.
+   */
+  struct TaskGraphStats {
+    /** @brief The number of tasks. */
+    size_t taskCount = 0;
+    /** @brief Dependencies between tasks left after dropping the ones implied by others. */
+    size_t dependencyCount = 0;
+    /** @brief Streams the tasks were spread over. */
+    uint32_t streamCount = 0;
+    /**
+     * @brief StreamWait() calls between the tasks of one Execute().
+     * @note Each stream also waits once for every other stream at the
+     * start of a repeated Execute().
+     */
+    size_t streamWaitCount = 0;
+  };
+
+  /**
+   * @brief Runs dispatches and copies on several streams, with the events
+   * between them derived from the buffers each task reads and writes.
+   *
+   * Tasks are added in program order. Two tasks depend on each other if
+   * they access overlapping ranges of a buffer and at least one of them
+   * writes; everything else may run concurrently. Execute() turns that
+   * into a schedule:
+   * 1. Dependencies implied by other dependencies are dropped.
+   * 2. A task continues the stream of a dependency when it can, so
+   *    chains stay on one stream; independent branches get streams of
+   *    their own.
+   * 3. A StreamWait() is only recorded if the waiting stream doesn't
+   *    already know, through earlier waits, that the dependency is done.
+   *
+   * Ordering within one stream (UAV barriers between dependent dispatches)
+   * is up to the stream, as for hand-written streams.
+   *
+   * @note The kernels, buffers and host memory used by tasks must outlive
+   * the graph. Upload data is read and download data is written when the
+   * stream gets to the task, after Execute() and HostWait() respectively.
+   */
+  class AEGIS_API TaskGraph {
+  public:
+    /**
+     * @brief Identifies a task, in the order they were added (from 0).
+     */
+    using TaskId = size_t;
+
+    ~TaskGraph();
+
+    /**
+     * @brief Adds a dispatch.
+     * @param kernel The kernel to run.
+     * @param buffers The buffers to bind, and how the kernel uses them.
+     * @return The new task.
+     */
+    TaskId AddDispatch(ComputeKernel& kernel, std::vector<TaskBuffer> buffers,
+                       uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ);
+
+    /**
+     * @brief Adds a copy of a whole buffer, see ComputeStream::ResourceCopyBuffer().
+     * @note Both buffers must have the same size, copy a range otherwise.
+     * @return The new task.
+     */
+    TaskId AddCopy(GpuBuffer& dest, GpuBuffer& src);
+
+    /**
+     * @brief Adds a copy of a byte range between two buffers.
+     * @return The new task.
+     */
+    TaskId AddCopy(GpuBuffer& dest, size_t destOffset, GpuBuffer& src, size_t srcOffset, size_t byteSize);
+
+    /**
+     * @brief Adds an upload, which writes 'dest'.
+     * @note srcData is read when Execute() records the task.
+     * @return The new task.
+     */
+    TaskId AddUpload(GpuBuffer& dest, const void* srcData, size_t byteSize);
+
+    /**
+     * @brief Adds a download, which reads 'src'.
+     * @note The data is in destData once HostWait() returns.
+     * @return The new task.
+     */
+    TaskId AddDownload(void* destData, GpuBuffer& src, size_t byteSize);
+
+    /**
+     * @brief Records every task on the graph's streams and submits them.
+     * @note Can be called again to run the graph again, the next run is
+     * ordered after this one. The schedule is only rebuilt if tasks were
+     * added since.
+     */
+    void Execute();
+
+    /**
+     * @brief Blocks the CPU thread until everything Execute() submitted is done.
+     */
+    void HostWait();
+
+    /**
+     * @brief Gets the counters of the current schedule (built by Execute()).
+     */
+    [[nodiscard]] TaskGraphStats GetStats() const { return m_stats; }
+
+  private:
+    friend class ComputeContext;
+
+    /**
+     * @brief A buffer range a task accesses.
+     */
+    struct Access {
+      GpuBuffer* buffer;
+      size_t offset;
+      size_t size;
+      bool writes;
+    };
+
+    enum class TaskType { DISPATCH, COPY, UPLOAD, DOWNLOAD };
+
+    /**
+     * @brief A task, and where the schedule puts it.
+     */
+    struct Task {
+      TaskType type;
+      ComputeKernel* kernel;
+      std::vector<TaskBuffer> buffers; // DISPATCH only
+      uint32_t threadGroups[3];
+      BufferView dest; // COPY and UPLOAD
+      BufferView src; // COPY and DOWNLOAD
+      const void* hostSrc; // UPLOAD
+      void* hostDest; // DOWNLOAD
+      std::vector<Access> accesses;
+
+      uint32_t stream; // Index into m_streams
+      std::vector<TaskId> waits; // Tasks on other streams to wait for first
+      std::unique_ptr<ComputeEvent> event; // Recorded after the task if other streams wait for it
+    };
+
+    /**
+     * @brief Private constructor. Use ComputeContext::CreateTaskGraph().
+     */
+    TaskGraph(ComputeContext* context, const TaskGraphDesc& desc);
+
+    /**
+     * @brief Adds a task and its accesses.
+     */
+    TaskId addTask(Task task);
+
+    /**
+     * @brief Builds the dependencies, assigns streams and picks the waits.
+     */
+    void schedule();
+
+    /**
+     * @brief Records one task on its stream.
+     */
+    void recordTask(Task& task);
+
+    ComputeContext* m_context;
+    TaskGraphDesc m_desc;
+    std::vector<Task> m_tasks;
+    bool m_isScheduled;
+    TaskGraphStats m_stats;
+
+    std::vector<std::unique_ptr<ComputeStream>> m_streams;
+    std::vector<std::unique_ptr<ComputeEvent>> m_tailEvents; // Per stream, where the last Execute() ended
+    std::vector<bool> m_hasTail; // Per stream, whether the last Execute() used it
+  };
+}
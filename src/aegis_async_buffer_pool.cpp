@@ -0,0 +1,171 @@
+#include "internal/async_buffer_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace aegis::internal {
+  AsyncBufferPool::AsyncBufferPool(IComputeBackend *backend, size_t releaseThreshold) :
+      m_backend(backend), m_releaseThreshold(releaseThreshold), m_stats{} {}
+
+  AsyncBufferPool::~AsyncBufferPool() = default;
+
+  bool AsyncBufferPool::isComplete(const CachedBuffer &cached) const {
+    if (!cached.stream) {
+      return true; // The stream waited for its work when it was destroyed
+    }
+    auto state = m_streams.find(cached.stream);
+    if (state != m_streams.end() && state->second.retiring) {
+      return false;
+    }
+    return cached.stream->GetCompletedFenceValue() >= cached.fenceValue;
+  }
+
+  bool AsyncBufferPool::isReadyFor(const CachedBuffer &cached, IComputeStream *stream) const {
+    if (cached.stream == stream) {
+      return true; // Stream order
+    }
+    if (auto state = m_streams.find(stream); state != m_streams.end()) {
+      auto waited = state->second.waitedTicks.find(cached.stream);
+      if (waited != state->second.waitedTicks.end() && waited->second >= cached.tick) {
+        return true; // Ordered by an event
+      }
+    }
+    return isComplete(cached);
+  }
+
+  std::unique_ptr<IGpuBuffer> AsyncBufferPool::Allocate(IComputeStream *stream, size_t byteSize) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      auto [first, last] = m_cached.equal_range(byteSize);
+      for (auto it = first; it != last; ++it) {
+        if (isReadyFor(it->second, stream)) {
+          auto buffer = std::move(it->second.buffer);
+          m_cached.erase(it);
+          m_stats.cachedBytes -= byteSize;
+          m_stats.cachedBufferCount--;
+          m_stats.usedBytes += byteSize;
+          m_stats.reuseCount++;
+          return buffer;
+        }
+      }
+    }
+
+    std::unique_ptr<IGpuBuffer> buffer;
+    try {
+      buffer = m_backend->CreateBuffer(byteSize, GpuMemoryType::DEVICE_LOCAL);
+    } catch (const std::runtime_error&) {
+      // Out of memory, give back what the pool holds and try once more
+      if (Trim(0) == 0) {
+        throw;
+      }
+      buffer = m_backend->CreateBuffer(byteSize, GpuMemoryType::DEVICE_LOCAL);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.usedBytes += byteSize;
+    m_stats.createCount++;
+    return buffer;
+  }
+
+  void AsyncBufferPool::Free(IComputeStream *stream, std::unique_ptr<IGpuBuffer> buffer) {
+    std::vector<std::unique_ptr<IGpuBuffer>> released; // Destroyed after unlocking
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const size_t byteSize = buffer->GetSizeInBytes();
+    StreamState& state = m_streams[stream];
+    m_cached.emplace(byteSize, CachedBuffer{std::move(buffer), stream, ++state.tick, stream->GetRecordedFenceValue()});
+    m_stats.usedBytes -= byteSize;
+    m_stats.cachedBytes += byteSize;
+    m_stats.cachedBufferCount++;
+
+    if (m_stats.cachedBytes > m_releaseThreshold) {
+      trimLocked(m_releaseThreshold, released);
+    }
+  }
+
+  void AsyncBufferPool::Discard(size_t byteSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.usedBytes -= byteSize;
+  }
+
+  void AsyncBufferPool::OnRecordEvent(IComputeStream *stream, IComputeEvent *event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto state = m_streams.find(stream);
+    if (state == m_streams.end()) {
+      m_events.erase(event); // Nothing was ever freed on this stream
+      return;
+    }
+    m_events[event] = {stream, state->second.tick};
+  }
+
+  void AsyncBufferPool::OnStreamWait(IComputeStream *stream, IComputeEvent *event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto recorded = m_events.find(event);
+    if (recorded == m_events.end() || recorded->second.stream == stream) {
+      return;
+    }
+    uint64_t& waited = m_streams[stream].waitedTicks[recorded->second.stream];
+    waited = std::max(waited, recorded->second.tick);
+  }
+
+  void AsyncBufferPool::ForgetEvent(IComputeEvent *event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.erase(event);
+  }
+
+  void AsyncBufferPool::RetireStream(IComputeStream *stream) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (auto state = m_streams.find(stream); state != m_streams.end()) {
+      state->second.retiring = true;
+    }
+  }
+
+  void AsyncBufferPool::ForgetStream(IComputeStream *stream) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_streams.erase(stream) == 0) {
+      return;
+    }
+    for (auto& [byteSize, cached] : m_cached) {
+      if (cached.stream == stream) {
+        cached.stream = nullptr;
+      }
+    }
+
+    // A new stream may get the same address
+    for (auto& [other, state] : m_streams) {
+      state.waitedTicks.erase(stream);
+    }
+    std::erase_if(m_events, [stream](const auto& entry) { return entry.second.stream == stream; });
+  }
+
+  size_t AsyncBufferPool::trimLocked(size_t bytesToKeep, std::vector<std::unique_ptr<IGpuBuffer>> &released) {
+    size_t releasedBytes = 0;
+    for (auto it = m_cached.begin(); it != m_cached.end() && m_stats.cachedBytes > bytesToKeep;) {
+      if (!isComplete(it->second)) {
+        ++it;
+        continue;
+      }
+      released.push_back(std::move(it->second.buffer));
+      releasedBytes += it->first;
+      m_stats.cachedBytes -= it->first;
+      m_stats.cachedBufferCount--;
+      it = m_cached.erase(it);
+    }
+    return releasedBytes;
+  }
+
+  size_t AsyncBufferPool::Trim(size_t bytesToKeep) {
+    std::vector<std::unique_ptr<IGpuBuffer>> released;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return trimLocked(bytesToKeep, released);
+  }
+
+  AsyncPoolStats AsyncBufferPool::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+  }
+}
@@ -1,20 +1,43 @@
 #include "aegis/buffer.h"
+#include "aegis/context.h"
 #include "backend.h"
+#include "internal/async_buffer_pool.h"
+#include "internal/deferred_release_queue.h"
 
 namespace aegis {
-  GpuBuffer::GpuBuffer(ComputeContext *context, std::unique_ptr<internal::IGpuBuffer> backendBuffer) : m_context(context), m_backendBuffer(std::move(backendBuffer)) {}
+  GpuBuffer::GpuBuffer(ComputeContext *context, std::unique_ptr<internal::IGpuBuffer> backendBuffer, bool isPooled) : m_context(context), m_backendBuffer(std::move(backendBuffer)), m_isPooled(isPooled), m_stagingDirty(false) {}
 
-   GpuBuffer::~GpuBuffer() {  }
+  GpuBuffer::~GpuBuffer() {
+    // A pooled buffer destroyed without FreeAsync() just leaves the pool's books
+    if (m_isPooled && m_backendBuffer) {
+      m_context->m_asyncPool->Discard(m_backendBuffer->GetSizeInBytes());
+    }
+    // Submitted work may still use it
+    m_context->m_deferredReleases->Release(std::move(m_backendBuffer));
+    m_context->m_deferredReleases->Release(std::move(m_stagingBuffer));
+  }
 
   void *GpuBuffer::Map() {
+   if (m_stagingBuffer) {
+     return m_stagingBuffer->Map(); // Stays mapped, UPLOAD memory can be
+   }
    return m_backendBuffer->Map();
   }
 
   void GpuBuffer::Unmap() {
+   if (m_stagingBuffer) {
+     m_stagingDirty = true;
+     return;
+   }
    m_backendBuffer->Unmap();
   }
 
   size_t GpuBuffer::GetSizeInBytes() const {
     return m_backendBuffer->GetSizeInBytes();
   }
+
+  BufferView GpuBuffer::View(size_t offset, size_t byteSize) {
+    internal::CheckBufferRange(m_backendBuffer.get(), offset, byteSize, "View is outside the buffer.");
+    return {this, offset, byteSize};
+  }
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "internal/captured_graph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace aegis::internal {
+  GraphBinding &CapturedGraph::findBinding(size_t node, uint32_t slot) {
+    if (node >= m_nodes.size()) {
+      throw std::runtime_error("Graph node index out of range.");
+    }
+    auto& bindings = m_nodes[node].bindings;
+    auto it = std::lower_bound(bindings.begin(), bindings.end(), slot,
+                               [](const GraphBinding& binding, uint32_t s) { return binding.slot < s; });
+    if (it == bindings.end() || it->slot != slot) {
+      // Baked graphs have a fixed set of root arguments per node
+      throw std::runtime_error("The graph node wasn't captured with a buffer in this slot.");
+    }
+    return *it;
+  }
+
+  void CapturedGraph::SetBuffer(size_t node, uint32_t slot, IGpuBuffer *buffer, size_t offset, size_t byteSize) {
+    CheckBufferRange(buffer, offset, byteSize, "Bound range is outside the buffer.");
+    GraphBinding& binding = findBinding(node, slot);
+    binding.buffer = buffer;
+    binding.offset = offset;
+    binding.byteSize = byteSize;
+  }
+
+  void CapturedGraph::SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    if (node >= m_nodes.size()) {
+      throw std::runtime_error("Graph node index out of range.");
+    }
+    m_nodes[node].threadGroups[0] = threadGroupsX;
+    m_nodes[node].threadGroups[1] = threadGroupsY;
+    m_nodes[node].threadGroups[2] = threadGroupsZ;
+  }
+
+  void IComputeStream::RecordGraph(IComputeGraph *graph) {
+    IComputeKernel* currentKernel = nullptr;
+    for (const GraphNode& node : graph->GetNodes()) {
+      if (node.kernel != currentKernel) {
+        SetKernel(node.kernel);
+        currentKernel = node.kernel;
+      }
+      for (const GraphBinding& binding : node.bindings) {
+        SetBuffer(binding.slot, binding.buffer, binding.offset, binding.byteSize, binding.access);
+      }
+      RecordDispatch(node.threadGroups[0], node.threadGroups[1], node.threadGroups[2]);
+    }
+  }
+
+  std::unique_ptr<IComputeGraph> IComputeBackend::CreateGraph(std::vector<GraphNode> nodes) {
+    return std::make_unique<CapturedGraph>(std::move(nodes));
+  }
+}
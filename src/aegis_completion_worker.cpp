@@ -0,0 +1,85 @@
+#include "internal/completion_worker.h"
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace aegis::internal {
+  CompletionWorker::CompletionWorker(IComputeBackend *backend) :
+      m_backend(backend), m_wakeEvent(backend->CreateHostEvent()), m_nextQueue(1), m_stopping(false) {}
+
+  CompletionWorker::~CompletionWorker() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+      m_backend->SignalHostEvent(m_wakeEvent.get());
+    }
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+  }
+
+  uint64_t CompletionWorker::CreateQueue() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nextQueue++;
+  }
+
+  void CompletionWorker::Enqueue(uint64_t queue, std::unique_ptr<IComputeEvent> event, std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queues[queue].push_back({std::move(event), std::move(callback)});
+
+    if (!m_thread.joinable()) {
+      m_thread = std::thread(&CompletionWorker::workerLoop, this);
+    }
+    // Signaled under the lock, so it can't land before the worker re-arms the event
+    m_backend->SignalHostEvent(m_wakeEvent.get());
+  }
+
+  void CompletionWorker::workerLoop() {
+    std::vector<IComputeEvent*> waits;
+    std::vector<Pending> ready;
+
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_wakeEvent->IsComplete()) {
+          m_backend->ResetHostEvent(m_wakeEvent.get());
+        }
+
+        for (auto it = m_queues.begin(); it != m_queues.end();) {
+          auto& pending = it->second;
+          while (!pending.empty() && pending.front().event->IsComplete()) {
+            ready.push_back(std::move(pending.front()));
+            pending.pop_front();
+          }
+          it = pending.empty() ? m_queues.erase(it) : std::next(it);
+        }
+
+        if (ready.empty()) {
+          if (m_stopping) {
+            return; // What's left was never submitted
+          }
+
+          // The queues complete in order, so their oldest events are enough
+          waits.clear();
+          waits.push_back(m_wakeEvent.get());
+          for (auto& [id, pending] : m_queues) {
+            waits.push_back(pending.front().event.get());
+          }
+        }
+      }
+
+      if (!ready.empty()) {
+        // Callbacks run outside the lock, they may enqueue more
+        for (auto& pending : ready) {
+          pending.callback();
+        }
+        ready.clear();
+        continue;
+      }
+
+      // Only this thread pops from the queues, so the events stay alive
+      m_backend->WaitForEvents(waits.data(), waits.size(), false, kInfiniteTimeout);
+    }
+  }
+}
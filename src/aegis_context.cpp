@@ -5,46 +5,95 @@
 #include "aegis/event.h"
 
 #include "internal/backend.h"
+#include "internal/async_buffer_pool.h"
+#include "internal/host_memory_registry.h"
+#include "internal/deferred_release_queue.h"
+#include "internal/completion_worker.h"
+#include "internal/thread_pool.h"
 
 #if defined(AEGIS_ENABLE_D3D12)
     #include "internal/d3d12_backend.h"
 #endif
 #if defined(AEGIS_ENABLE_VULKAN)
-    #include "internal/vulkan_backend.h" // won't be implemented untill we manage to get a working d3d12
+    #include "internal/vulkan_backend.h"
+#endif
+#if defined(AEGIS_ENABLE_CPU)
+    #include "internal/cpu_backend.h"
 #endif
 
 #include <stdexcept> // for std::runtime_error
 
 namespace aegis {
-  ComputeContext::ComputeContext(std::unique_ptr<internal::IComputeBackend> backend) : m_backend(std::move(backend)) {}
+  ComputeContext::ComputeContext(std::unique_ptr<internal::IComputeBackend> backend, Backend backendType, const ContextDesc& desc) :
+      m_backend(std::move(backend)), m_backendType(backendType),
+      m_asyncPool(std::make_unique<internal::AsyncBufferPool>(m_backend.get(), desc.asyncPoolReleaseThreshold)),
+      m_hostMemory(std::make_unique<internal::HostMemoryRegistry>()),
+      m_deferredReleases(std::make_unique<internal::DeferredReleaseQueue>()),
+      m_completionWorker(std::make_unique<internal::CompletionWorker>(m_backend.get())),
+      m_compileThreadCount(desc.kernelCompileThreadCount) {}
 
   ComputeContext::~ComputeContext() {
+    // Finishes the queued compiles, their kernels are released below
+    m_compilePool.reset();
     // Ensure all GPU work is finished before destroying the device
     if (m_backend) m_backend->WaitForIdle();
+    // Runs the callbacks of everything that was submitted
+    m_completionWorker.reset();
+    m_deferredReleases->Drain();
   }
 
-  std::unique_ptr<ComputeContext> ComputeContext::Create() {
-    std::unique_ptr<internal::IComputeBackend> backend = nullptr;
-
+  std::unique_ptr<internal::IComputeBackend> ComputeContext::createBackend(Backend backend, const ContextDesc& desc) {
+    switch (backend) {
 #if defined(AEGIS_ENABLE_D3D12)
-    backend = internal::D3D12Backend::Create();
-#elif defined(AEGIS_ENABLE_VULKAN)
-    // backend = internal::VulkanBackend::Create(); // Not implemented
-#else
-    // No backend was compiled in.
-    // TODO: log an error here.
-    return nullptr;
+      case Backend::D3D12: return internal::D3D12Backend::Create(desc);
+#endif
+#if defined(AEGIS_ENABLE_VULKAN)
+      case Backend::VULKAN: return internal::VulkanBackend::Create(desc);
 #endif
+#if defined(AEGIS_ENABLE_CPU)
+      case Backend::CPU: return internal::CpuBackend::Create(desc);
+#endif
+      default:
+        // This backend wasn't compiled in.
+        // TODO: log an error here.
+        return nullptr;
+    }
+  }
 
-    if (!backend) return nullptr;
+  std::unique_ptr<ComputeContext> ComputeContext::Create(Backend backend) {
+    ContextDesc desc;
+    desc.backend = backend;
+    return Create(desc);
+  }
 
-    return std::unique_ptr<ComputeContext>(new ComputeContext(std::move(backend)));
+  std::unique_ptr<ComputeContext> ComputeContext::Create(const ContextDesc& desc) {
+    if (desc.backend != Backend::DEFAULT) {
+      // Errors the backend throws reach the caller, they say what is missing
+      auto backendImpl = createBackend(desc.backend, desc);
+      if (!backendImpl) return nullptr;
+      return std::unique_ptr<ComputeContext>(new ComputeContext(std::move(backendImpl), desc.backend, desc));
+    }
+
+    // Prefer the GPU, fall back to the CPU backend on hosts without one
+    for (Backend candidate : {Backend::D3D12, Backend::VULKAN, Backend::CPU}) {
+      std::unique_ptr<internal::IComputeBackend> backendImpl;
+      try {
+        backendImpl = createBackend(candidate, desc);
+      } catch (const std::runtime_error&) {
+        continue; // Ask for the backend explicitly to get the reason
+      }
+      if (backendImpl) {
+        return std::unique_ptr<ComputeContext>(new ComputeContext(std::move(backendImpl), candidate, desc));
+      }
+    }
+    return nullptr;
   }
 
-  std::unique_ptr<ComputeStream> ComputeContext::CreateStream() {
-    auto backendStream = m_backend->CreateStream();
+  std::unique_ptr<ComputeStream> ComputeContext::CreateStream(const StreamDesc& desc) {
+    auto backendStream = m_backend->CreateStream(desc);
     if (!backendStream) return nullptr;
-    return std::unique_ptr<ComputeStream>(new ComputeStream(this, std::move(backendStream)));
+    m_deferredReleases->AddStream(backendStream.get());
+    return std::unique_ptr<ComputeStream>(new ComputeStream(this, std::move(backendStream), desc.type));
   }
 
   std::unique_ptr<ComputeEvent> ComputeContext::CreateEvent() {
@@ -60,19 +109,189 @@ namespace aegis {
     switch (memoryType) {
       case GpuBuffer::MemoryType::UPLOAD: backendMemType = internal::GpuMemoryType::UPLOAD; break;
       case GpuBuffer::MemoryType::READBACK: backendMemType = internal::GpuMemoryType::READBACK; break;
+      case GpuBuffer::MemoryType::HOST: backendMemType = internal::GpuMemoryType::HOST; break;
+      case GpuBuffer::MemoryType::DEVICE_HOST_VISIBLE: backendMemType = internal::GpuMemoryType::DEVICE_HOST_VISIBLE; break;
       default: backendMemType = internal::GpuMemoryType::DEVICE_LOCAL; break;
     }
 
+    // Without CPU-visible device memory, the CPU writes an UPLOAD copy that
+    // streams copy over before they use the buffer
+    std::unique_ptr<internal::IGpuBuffer> stagingBuffer;
+    if (backendMemType == internal::GpuMemoryType::DEVICE_HOST_VISIBLE && !m_backend->GetCapabilities().deviceHostVisibleMemory) {
+      backendMemType = internal::GpuMemoryType::DEVICE_LOCAL;
+      stagingBuffer = m_backend->CreateBuffer(byteSize, internal::GpuMemoryType::UPLOAD);
+      if (!stagingBuffer) return nullptr;
+    }
+
     auto backendBuffer = m_backend->CreateBuffer(byteSize, backendMemType);
     if (!backendBuffer) return nullptr;
-    return std::unique_ptr<GpuBuffer>(new GpuBuffer(this, std::move(backendBuffer)));
+    auto buffer = std::unique_ptr<GpuBuffer>(new GpuBuffer(this, std::move(backendBuffer)));
+    buffer->m_stagingBuffer = std::move(stagingBuffer);
+    return buffer;
   }
 
   std::unique_ptr<ComputeKernel> ComputeContext::CreateKernel(const std::string &hlslFilePath, const std::string &entryPoint) {
-    auto backendKernel = m_backend->CreateKernel(hlslFilePath, entryPoint);
+    return CreateKernel(hlslFilePath, entryPoint, {}, {});
+  }
+
+  std::unique_ptr<ComputeKernel> ComputeContext::CreateKernel(const std::string &hlslFilePath, const std::string &entryPoint,
+                                                            const KernelDefines &defines, const KernelCompileOptions &options) {
+    auto backendKernel = m_backend->CreateKernel(hlslFilePath, entryPoint, defines, options);
     if (!backendKernel) return nullptr;
     return std::unique_ptr<ComputeKernel>(new ComputeKernel(this, std::move(backendKernel)));
   }
 
-  void ComputeContext::WaitForIdle() { m_backend->WaitForIdle(); }
+  std::unique_ptr<KernelVariants> ComputeContext::CreateKernelVariants(const std::string &hlslFilePath, const std::string &entryPoint,
+                                                                     const KernelCompileOptions &options) {
+    return std::unique_ptr<KernelVariants>(new KernelVariants(this, hlslFilePath, entryPoint, options));
+  }
+
+  internal::ThreadPool &ComputeContext::getCompilePool() {
+    std::call_once(m_compilePoolOnce, [this] {
+      m_compilePool = std::make_unique<internal::ThreadPool>(m_compileThreadCount);
+    });
+    return *m_compilePool;
+  }
+
+  std::future<std::unique_ptr<ComputeKernel>> ComputeContext::CreateKernelAsync(const std::string &hlslFilePath,
+                                                                                const std::string &entryPoint) {
+    // std::function needs a copyable callable, so the promise is shared
+    auto promise = std::make_shared<std::promise<std::unique_ptr<ComputeKernel>>>();
+    auto future = promise->get_future();
+    getCompilePool().Submit([this, hlslFilePath, entryPoint, promise] {
+      try {
+        promise->set_value(CreateKernel(hlslFilePath, entryPoint));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    });
+    return future;
+  }
+
+  std::vector<std::unique_ptr<ComputeKernel>> ComputeContext::CreateKernels(const std::vector<KernelSource> &sources) {
+    std::vector<std::unique_ptr<ComputeKernel>> kernels;
+    kernels.reserve(sources.size());
+    auto& pool = getCompilePool();
+    for (const KernelSource& source : sources) {
+      auto promise = std::make_shared<std::promise<void>>();
+      auto kernel = std::unique_ptr<ComputeKernel>(new ComputeKernel(this, nullptr));
+      kernel->m_compiled = promise->get_future().share();
+
+      // The kernel waits for this task before it is destroyed
+      pool.Submit([this, source, promise, target = kernel.get()] {
+        try {
+          target->m_backendKernel = m_backend->CreateKernel(source.hlslFilePath, source.entryPoint, {}, {});
+          if (!target->m_backendKernel) {
+            throw std::runtime_error("Failed to compile kernel: " + source.hlslFilePath);
+          }
+          promise->set_value();
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      });
+      kernels.push_back(std::move(kernel));
+    }
+    return kernels;
+  }
+
+  std::unique_ptr<ComputeKernel> ComputeContext::CreateKernelFromSource(const std::string &hlslSource, const std::string &entryPoint,
+                                                                      const std::string &sourceName, const KernelDefines &defines,
+                                                                      const KernelCompileOptions &options) {
+    auto backendKernel = m_backend->CreateKernelFromSource(hlslSource, sourceName, entryPoint, defines, options);
+    if (!backendKernel) return nullptr;
+    return std::unique_ptr<ComputeKernel>(new ComputeKernel(this, std::move(backendKernel)));
+  }
+
+  std::unique_ptr<ComputeKernel> ComputeContext::CreateKernelFromBytecode(const KernelBytecode &bytecode) {
+    auto backendKernel = m_backend->CreateKernelFromBytecode(bytecode);
+    if (!backendKernel) return nullptr;
+    return std::unique_ptr<ComputeKernel>(new ComputeKernel(this, std::move(backendKernel)));
+  }
+
+  std::unique_ptr<ComputeKernel> ComputeContext::CreateHostKernel(const HostKernelDesc &desc) {
+    auto backendKernel = m_backend->CreateHostKernel(desc);
+    if (!backendKernel) return nullptr;
+    return std::unique_ptr<ComputeKernel>(new ComputeKernel(this, std::move(backendKernel)));
+  }
+
+  std::unique_ptr<TaskGraph> ComputeContext::CreateTaskGraph(const TaskGraphDesc &desc) {
+    return std::unique_ptr<TaskGraph>(new TaskGraph(this, desc));
+  }
+
+  void *ComputeContext::AllocateHostMemory(size_t byteSize) {
+    const size_t size = byteSize > 0 ? byteSize : 1;
+    auto buffer = m_backend->CreateBuffer(size, internal::GpuMemoryType::HOST);
+    void* pointer = buffer->Map(); // Stays mapped until FreeHostMemory()
+    m_hostMemory->Add(pointer, size, std::move(buffer), false);
+    return pointer;
+  }
+
+  void ComputeContext::FreeHostMemory(void *pointer) {
+    if (!pointer) {
+      return;
+    }
+    auto buffer = m_hostMemory->Remove(pointer, false);
+    if (!buffer) {
+      throw std::runtime_error("FreeHostMemory() needs a pointer from AllocateHostMemory().");
+    }
+    m_deferredReleases->Release(std::move(buffer));
+  }
+
+  bool ComputeContext::RegisterHostMemory(void *hostPointer, size_t byteSize) {
+    if (!hostPointer || byteSize == 0) {
+      return false;
+    }
+    auto buffer = m_backend->ImportHostMemory(hostPointer, byteSize);
+    if (!buffer) {
+      return false;
+    }
+    m_hostMemory->Add(hostPointer, byteSize, std::move(buffer), true);
+    return true;
+  }
+
+  void ComputeContext::UnregisterHostMemory(void *hostPointer) {
+    m_deferredReleases->Release(m_hostMemory->Remove(hostPointer, true));
+  }
+
+  void ComputeContext::WaitForIdle() {
+    m_backend->WaitForIdle();
+    m_deferredReleases->Collect();
+  }
+
+  void ComputeContext::WaitAll(const std::vector<ComputeEvent*>& events) {
+    if (events.empty()) {
+      return;
+    }
+    std::vector<internal::IComputeEvent*> backendEvents;
+    backendEvents.reserve(events.size());
+    for (ComputeEvent* event : events) {
+      backendEvents.push_back(event->GetBackendEvent());
+    }
+    m_backend->WaitForEvents(backendEvents.data(), backendEvents.size(), true, internal::kInfiniteTimeout);
+    m_deferredReleases->Collect();
+  }
+
+  size_t ComputeContext::WaitAny(const std::vector<ComputeEvent*>& events) {
+    if (events.empty()) {
+      throw std::runtime_error("WaitAny() needs at least one event.");
+    }
+    std::vector<internal::IComputeEvent*> backendEvents;
+    backendEvents.reserve(events.size());
+    for (ComputeEvent* event : events) {
+      backendEvents.push_back(event->GetBackendEvent());
+    }
+    const size_t index = m_backend->WaitForEvents(backendEvents.data(), backendEvents.size(), false, internal::kInfiniteTimeout);
+    m_deferredReleases->Collect();
+    return index;
+  }
+
+  MemoryStats ComputeContext::GetMemoryStats() const { return m_backend->GetMemoryStats(); }
+
+  DeviceCapabilities ComputeContext::GetCapabilities() const { return m_backend->GetCapabilities(); }
+
+  void ComputeContext::TrimAsyncPool(size_t bytesToKeep) { m_asyncPool->Trim(bytesToKeep); }
+
+  AsyncPoolStats ComputeContext::GetAsyncPoolStats() const { return m_asyncPool->GetStats(); }
+
+  size_t ComputeContext::GetPendingReleaseCount() const { return m_deferredReleases->GetPendingCount(); }
 }
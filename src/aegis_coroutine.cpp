@@ -0,0 +1,83 @@
+#include "aegis/coroutine.h"
+
+#if defined(AEGIS_HAS_COROUTINES)
+#include "aegis/buffer.h"
+#include "aegis/context.h"
+#include "aegis/event.h"
+#include "aegis/stream.h"
+#include "backend.h"
+#include "internal/completion_worker.h"
+#include "internal/host_memory_registry.h"
+#include "internal/readback_copy.h"
+
+namespace aegis {
+  GpuAwaitable::GpuAwaitable(ComputeContext *context, std::unique_ptr<internal::IComputeEvent> event,
+                             std::shared_ptr<internal::ReadbackCopy> copy) :
+      m_context(context), m_event(std::move(event)), m_copy(std::move(copy)) {}
+
+  GpuAwaitable::GpuAwaitable(GpuAwaitable &&other) noexcept = default;
+
+  GpuAwaitable::~GpuAwaitable() = default;
+
+  bool GpuAwaitable::await_ready() const {
+    return m_event->IsComplete();
+  }
+
+  void GpuAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    // Each await gets a queue of its own, awaits don't complete in order
+    internal::CompletionWorker* worker = m_context->m_completionWorker.get();
+    Executor* executor = m_context->m_executor;
+    worker->Enqueue(worker->CreateQueue(), std::move(m_event), [handle, executor, copy = m_copy] {
+      // The copy runs here, not on the resuming thread
+      if (copy) copy->Finish();
+      if (executor) {
+        executor->Post([handle] { handle.resume(); });
+      } else {
+        handle.resume();
+      }
+    });
+  }
+
+  void GpuAwaitable::await_resume() {
+    if (m_copy) {
+      m_copy->Finish();
+    }
+  }
+
+  GpuAwaitable ComputeEvent::operator co_await() const {
+    return GpuAwaitable(m_context, m_backendEvent->Clone(), nullptr);
+  }
+
+  GpuAwaitable ComputeStream::SubmitAsync() {
+    requireNotCapturing();
+    Submit();
+
+    // Recorded right after Submit(), the event marks the end of the submission
+    auto event = m_context->m_backend->CreateEvent();
+    m_backendStream->RecordEvent(event.get());
+    return GpuAwaitable(m_context, std::move(event), nullptr);
+  }
+
+  GpuAwaitable ComputeStream::DownloadAsync(void *destData, GpuBuffer &src, size_t byteSize) {
+    return DownloadAsync(destData, src, 0, byteSize);
+  }
+
+  GpuAwaitable ComputeStream::DownloadAsync(void *destData, GpuBuffer &src, size_t srcOffset, size_t byteSize) {
+    requireNotCapturing();
+    flushStaging(src);
+
+    std::shared_ptr<internal::ReadbackCopy> copy;
+    internal::HostMemoryRegistry::Location pinned;
+    if (byteSize > 0 && m_context->m_hostMemory->Find(destData, byteSize, pinned)) {
+      m_backendStream->ResourceCopyBuffer(pinned.buffer, pinned.offset, src.GetBackendBuffer(), srcOffset, byteSize);
+    } else {
+      copy = m_backendStream->ResourceDownload(destData, src.GetBackendBuffer(), srcOffset, byteSize);
+    }
+
+    GpuAwaitable awaitable = SubmitAsync();
+    awaitable.m_copy = std::move(copy);
+    return awaitable;
+  }
+}
+
+#endif
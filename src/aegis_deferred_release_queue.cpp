@@ -0,0 +1,126 @@
+#include "internal/deferred_release_queue.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace aegis::internal {
+  DeferredReleaseQueue::~DeferredReleaseQueue() {
+    Drain();
+  }
+
+  void DeferredReleaseQueue::AddStream(IComputeStream *stream) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streams.push_back(stream);
+  }
+
+  void DeferredReleaseQueue::ReleaseStream(std::unique_ptr<IComputeStream> stream, StreamDeleter deleter) {
+    IComputeStream* releasedStream = stream.get();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      std::erase(m_streams, releasedStream);
+    }
+    enqueue(std::make_unique<StreamHolder>(std::move(stream), std::move(deleter)), releasedStream);
+  }
+
+  void DeferredReleaseQueue::enqueue(std::unique_ptr<IHolder> holder, IComputeStream *releasedStream) {
+    std::vector<Entry> ready;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      Entry entry{std::move(holder), {}, releasedStream};
+      if (releasedStream) {
+        // A stream only has to finish its own work, recorded work that was
+        // never submitted is dropped with it
+        const uint64_t submitted = releasedStream->GetSubmittedFenceValue();
+        if (releasedStream->GetCompletedFenceValue() < submitted) {
+          entry.waits.emplace_back(releasedStream, submitted);
+        }
+      } else {
+        // We don't know which streams use the object, so wait for all of them
+        for (IComputeStream* stream : m_streams) {
+          const uint64_t recorded = stream->GetRecordedFenceValue();
+          if (stream->GetCompletedFenceValue() < recorded) {
+            entry.waits.emplace_back(stream, recorded);
+          }
+        }
+        // Released streams may still run work that uses it too
+        for (const Entry& pending : m_entries) {
+          if (pending.stream && !pending.waits.empty()) {
+            entry.waits.emplace_back(pending.stream, pending.stream->GetSubmittedFenceValue());
+          }
+        }
+      }
+
+      m_entries.push_back(std::move(entry));
+      takeReadyLocked(ready);
+    }
+    // Destructors run outside the lock, a stream's may call back into us
+  }
+
+  void DeferredReleaseQueue::Collect() {
+    std::vector<Entry> ready;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    takeReadyLocked(ready);
+  }
+
+  void DeferredReleaseQueue::takeReadyLocked(std::vector<Entry> &ready) {
+    if (m_entries.empty()) {
+      return;
+    }
+
+    // Fences are queried once per stream, not once per entry
+    std::vector<std::pair<IComputeStream*, uint64_t>> completed;
+    auto completedValue = [&completed](IComputeStream* stream) {
+      auto it = std::find_if(completed.begin(), completed.end(), [stream](const auto& c) { return c.first == stream; });
+      if (it == completed.end()) {
+        completed.emplace_back(stream, stream->GetCompletedFenceValue());
+        return completed.back().second;
+      }
+      return it->second;
+    };
+
+    bool droppedWaits = true;
+    while (droppedWaits) {
+      droppedWaits = false;
+      for (auto& entry : m_entries) {
+        std::erase_if(entry.waits, [&](const auto& wait) { return completedValue(wait.first) >= wait.second; });
+      }
+
+      auto firstReady = std::stable_partition(m_entries.begin(), m_entries.end(), [](const Entry& entry) { return !entry.waits.empty(); });
+      for (auto it = firstReady; it != m_entries.end(); ++it) {
+        if (!it->stream) {
+          continue;
+        }
+        // A released stream's destructor waits for all of its work, so
+        // nothing has to wait for the stream itself anymore
+        IComputeStream* stream = it->stream;
+        for (auto pending = m_entries.begin(); pending != firstReady; ++pending) {
+          droppedWaits |= std::erase_if(pending->waits, [stream](const auto& wait) { return wait.first == stream; }) > 0;
+        }
+      }
+      std::move(firstReady, m_entries.end(), std::back_inserter(ready));
+      m_entries.erase(firstReady, m_entries.end());
+    }
+  }
+
+  void DeferredReleaseQueue::Drain() {
+    std::vector<Entry> entries;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      entries.swap(m_entries);
+    }
+
+    // Stream destructors wait for their work, after that nothing is in use
+    for (auto& entry : entries) {
+      if (entry.stream) {
+        entry.holder.reset();
+      }
+    }
+    entries.clear();
+  }
+
+  size_t DeferredReleaseQueue::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+  }
+}
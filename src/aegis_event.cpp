@@ -1,8 +1,33 @@
 #include "aegis/event.h"
+#include "aegis/context.h"
 #include "backend.h"
+#include "internal/async_buffer_pool.h"
+#include "internal/deferred_release_queue.h"
 
 namespace aegis {
   ComputeEvent::ComputeEvent(ComputeContext *context, std::unique_ptr<internal::IComputeEvent> backendEvent) : m_context(context), m_backendEvent(std::move(backendEvent)) {}
 
-  ComputeEvent::~ComputeEvent() = default;
+  ComputeEvent::~ComputeEvent() {
+    m_context->m_asyncPool->ForgetEvent(m_backendEvent.get());
+    m_context->m_deferredReleases->Release(std::move(m_backendEvent));
+  }
+
+  bool ComputeEvent::IsComplete() const {
+    return m_backendEvent->IsComplete();
+  }
+
+  void ComputeEvent::HostWait() {
+    internal::IComputeEvent* event = m_backendEvent.get();
+    m_context->m_backend->WaitForEvents(&event, 1, true, internal::kInfiniteTimeout);
+    m_context->m_deferredReleases->Collect();
+  }
+
+  bool ComputeEvent::HostWait(std::chrono::milliseconds timeout) {
+    internal::IComputeEvent* event = m_backendEvent.get();
+    if (m_context->m_backend->WaitForEvents(&event, 1, true, internal::ToTimeoutMs(timeout)) != 0) {
+      return false;
+    }
+    m_context->m_deferredReleases->Collect();
+    return true;
+  }
 }
\ No newline at end of file
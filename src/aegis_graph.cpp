@@ -0,0 +1,48 @@
+#include "aegis/graph.h"
+#include "aegis/buffer.h"
+#include "aegis/context.h"
+#include "backend.h"
+#include "internal/deferred_release_queue.h"
+
+#include <stdexcept>
+
+namespace aegis {
+  ComputeGraph::ComputeGraph(ComputeContext *context, std::unique_ptr<internal::IComputeGraph> backendGraph,
+                             std::vector<std::vector<GpuBuffer*>> buffers) :
+      m_context(context), m_backendGraph(std::move(backendGraph)), m_buffers(std::move(buffers)) {}
+
+  ComputeGraph::~ComputeGraph() {
+    m_context->m_deferredReleases->Release(std::move(m_backendGraph));
+  }
+
+  size_t ComputeGraph::GetNodeCount() const {
+    return m_backendGraph->GetNodes().size();
+  }
+
+  void ComputeGraph::SetBuffer(size_t node, uint32_t slot, GpuBuffer &buffer) {
+    setBuffer(node, slot, buffer, 0, buffer.GetSizeInBytes());
+  }
+
+  void ComputeGraph::SetBuffer(size_t node, uint32_t slot, const BufferView &view) {
+    if (!view.buffer) {
+      throw std::runtime_error("Cannot bind an empty BufferView.");
+    }
+    setBuffer(node, slot, *view.buffer, view.offset, view.size);
+  }
+
+  void ComputeGraph::setBuffer(size_t node, uint32_t slot, GpuBuffer &buffer, size_t offset, size_t byteSize) {
+    m_backendGraph->SetBuffer(node, slot, buffer.GetBackendBuffer(), offset, byteSize);
+
+    // The backend threw if the slot isn't there, so the binding exists
+    const auto& bindings = m_backendGraph->GetNodes()[node].bindings;
+    for (size_t i = 0; i < bindings.size(); ++i) {
+      if (bindings[i].slot == slot) {
+        m_buffers[node][i] = &buffer;
+      }
+    }
+  }
+
+  void ComputeGraph::SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    m_backendGraph->SetDispatchSize(node, threadGroupsX, threadGroupsY, threadGroupsZ);
+  }
+}
@@ -0,0 +1,55 @@
+#include "internal/host_memory_registry.h"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace aegis::internal {
+  void HostMemoryRegistry::Add(const void *base, size_t byteSize, std::unique_ptr<IGpuBuffer> buffer, bool isImported) {
+    const auto address = reinterpret_cast<uintptr_t>(base);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Ranges are disjoint, so only the neighbours can overlap
+    auto next = m_ranges.lower_bound(address);
+    if (next != m_ranges.end() && next->first < address + byteSize) {
+      throw std::runtime_error("Host memory range is already registered.");
+    }
+    if (next != m_ranges.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second.byteSize > address) {
+        throw std::runtime_error("Host memory range is already registered.");
+      }
+    }
+
+    m_ranges.emplace_hint(next, address, Entry{byteSize, std::move(buffer), isImported});
+  }
+
+  std::unique_ptr<IGpuBuffer> HostMemoryRegistry::Remove(const void *base, bool isImported) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_ranges.find(reinterpret_cast<uintptr_t>(base));
+    if (it == m_ranges.end() || it->second.isImported != isImported) {
+      return nullptr;
+    }
+    auto buffer = std::move(it->second.buffer);
+    m_ranges.erase(it);
+    return buffer;
+  }
+
+  bool HostMemoryRegistry::Find(const void *pointer, size_t byteSize, Location &location) const {
+    const auto address = reinterpret_cast<uintptr_t>(pointer);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_ranges.upper_bound(address);
+    if (it == m_ranges.begin()) {
+      return false;
+    }
+    --it;
+
+    const size_t offset = address - it->first;
+    if (offset > it->second.byteSize || byteSize > it->second.byteSize - offset) {
+      return false;
+    }
+    location = {it->second.buffer.get(), offset};
+    return true;
+  }
+}
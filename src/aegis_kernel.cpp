@@ -1,7 +1,62 @@
 #include "aegis/kernel.h"
+#include "aegis/context.h"
 #include "backend.h"
+#include "internal/deferred_release_queue.h"
+
+#include <chrono>
+#include <stdexcept>
 
 namespace aegis {
   ComputeKernel::ComputeKernel(ComputeContext *context, std::unique_ptr<internal::IComputeKernel> backendKernel) : m_context(context), m_backendKernel(std::move(backendKernel)) { }
-  ComputeKernel::~ComputeKernel() = default;
-}
\ No newline at end of file
+  ComputeKernel::~ComputeKernel() {
+    // The compile task writes m_backendKernel
+    if (m_compiled.valid()) {
+      m_compiled.wait();
+    }
+    m_context->m_deferredReleases->Release(std::move(m_backendKernel));
+  }
+
+  bool ComputeKernel::IsReady() const {
+    return !m_compiled.valid() || m_compiled.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  void ComputeKernel::Wait() const {
+    if (m_compiled.valid()) {
+      m_compiled.get(); // Rethrows the compile error
+    }
+  }
+
+  internal::IComputeKernel *ComputeKernel::GetBackendKernel() const {
+    Wait();
+    return m_backendKernel.get();
+  }
+
+  KernelVariants::KernelVariants(ComputeContext *context, std::string hlslFilePath, std::string entryPoint, KernelCompileOptions options) :
+      m_context(context), m_hlslFilePath(std::move(hlslFilePath)), m_entryPoint(std::move(entryPoint)), m_options(std::move(options)) {}
+
+  KernelVariants::~KernelVariants() = default;
+
+  ComputeKernel &KernelVariants::Get(const KernelDefines &defines) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_variants.find(defines);
+      if (it != m_variants.end()) {
+        return *it->second;
+      }
+    }
+
+    auto kernel = m_context->CreateKernel(m_hlslFilePath, m_entryPoint, defines, m_options);
+    if (!kernel) {
+      throw std::runtime_error("Failed to compile a variant of " + m_hlslFilePath);
+    }
+
+    // Another thread may have compiled the same variant meanwhile, the first one is kept
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return *m_variants.try_emplace(defines, std::move(kernel)).first->second;
+  }
+
+  size_t KernelVariants::GetVariantCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_variants.size();
+  }
+}
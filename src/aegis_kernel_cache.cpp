@@ -0,0 +1,241 @@
+#include "internal/kernel_cache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace aegis::internal {
+  namespace {
+    constexpr uint32_t kEntryMagic = 0x4b474541; // "AEGK"
+    constexpr uint32_t kEntryVersion = 2;
+
+    std::filesystem::path toPath(const std::string& utf8) {
+      return std::filesystem::path(std::u8string(utf8.begin(), utf8.end()));
+    }
+
+    /**
+     * @brief Appends plain values and sized blobs to an entry.
+     */
+    class EntryWriter {
+    public:
+      template<typename T>
+      void Write(T value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+      }
+
+      void WriteBlob(const void* data, size_t byteSize) {
+        Write<uint64_t>(byteSize);
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        m_data.insert(m_data.end(), bytes, bytes + byteSize);
+      }
+
+      const std::vector<uint8_t>& GetData() const { return m_data; }
+
+    private:
+      std::vector<uint8_t> m_data;
+    };
+
+    /**
+     * @brief Reads an entry back, failing instead of reading past the end.
+     */
+    class EntryReader {
+    public:
+      explicit EntryReader(const std::vector<uint8_t>& data) : m_data(data), m_offset(0) {}
+
+      template<typename T>
+      bool Read(T& value) {
+        if (m_data.size() - m_offset < sizeof(T)) {
+          return false;
+        }
+        std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+      }
+
+      template<typename Container>
+      bool ReadBlob(Container& blob) {
+        uint64_t byteSize = 0;
+        if (!Read(byteSize) || m_data.size() - m_offset < byteSize) {
+          return false;
+        }
+        blob.assign(m_data.begin() + m_offset, m_data.begin() + m_offset + byteSize);
+        m_offset += byteSize;
+        return true;
+      }
+
+      bool IsAtEnd() const { return m_offset == m_data.size(); }
+
+    private:
+      const std::vector<uint8_t>& m_data;
+      size_t m_offset;
+    };
+  }
+
+  uint64_t HashBytes(const void *data, size_t byteSize, uint64_t seed) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < byteSize; ++i) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  std::string HashToString(uint64_t hash) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; --i) {
+      text[i] = kDigits[hash & 0xf];
+      hash >>= 4;
+    }
+    return text;
+  }
+
+  KernelCache::KernelCache(std::string directory) : m_directory(std::move(directory)) {
+    if (m_directory.empty()) {
+      return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(toPath(m_directory), error);
+    if (!std::filesystem::is_directory(toPath(m_directory), error)) {
+      m_directory.clear();
+    }
+  }
+
+  std::optional<std::vector<uint8_t>> KernelCache::ReadFile(const std::string &name) const {
+    if (!IsEnabled()) {
+      return std::nullopt;
+    }
+    std::ifstream file(toPath(m_directory) / toPath(name), std::ios::binary);
+    if (!file.is_open()) {
+      return std::nullopt;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+      return std::nullopt;
+    }
+    return data;
+  }
+
+  void KernelCache::WriteFile(const std::string &name, const void *data, size_t byteSize) const {
+    if (!IsEnabled()) {
+      return;
+    }
+
+    // Another thread or process may write the same entry, every writer gets its own temporary
+    const uint64_t unique = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                            static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    const std::filesystem::path path = toPath(m_directory) / toPath(name);
+    std::filesystem::path temporary = path;
+    temporary += "." + HashToString(unique) + ".tmp";
+
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(static_cast<const char*>(data), static_cast<std::streamsize>(byteSize));
+      if (!file) {
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(temporary, error);
+        return;
+      }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      std::filesystem::remove(temporary, error);
+    }
+  }
+
+  std::optional<CachedKernel> KernelCache::Load(const std::string &key) const {
+    auto data = ReadFile(HashToString(HashBytes(key.data(), key.size())) + ".kernel");
+    if (!data) {
+      return std::nullopt;
+    }
+
+    EntryReader reader(*data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    std::string storedKey;
+    if (!reader.Read(magic) || !reader.Read(version) || magic != kEntryMagic || version != kEntryVersion ||
+        !reader.ReadBlob(storedKey) || storedKey != key) {
+      return std::nullopt; // Another format, or a hash collision
+    }
+
+    CachedKernel kernel;
+    uint32_t includeCount = 0;
+    if (!reader.Read(includeCount)) {
+      return std::nullopt;
+    }
+    for (uint32_t i = 0; i < includeCount; ++i) {
+      KernelDependency include;
+      if (!reader.ReadBlob(include.path) || !reader.Read(include.contentHash)) {
+        return std::nullopt;
+      }
+      kernel.includes.push_back(std::move(include));
+    }
+    uint32_t constantCount = 0;
+    if (!reader.ReadBlob(kernel.bytecode) || !reader.ReadBlob(kernel.layout) || !reader.Read(constantCount)) {
+      return std::nullopt;
+    }
+    for (uint32_t i = 0; i < constantCount; ++i) {
+      KernelConstants constants;
+      uint8_t isRootConstants = 0;
+      if (!reader.Read(constants.slot) || !reader.Read(constants.byteSize) ||
+          !reader.Read(constants.rootParameterIndex) || !reader.Read(isRootConstants)) {
+        return std::nullopt;
+      }
+      constants.isRootConstants = isRootConstants != 0;
+      kernel.constants.push_back(constants);
+    }
+    if (!reader.IsAtEnd()) {
+      return std::nullopt;
+    }
+
+    // The key only covers the source file itself
+    for (const KernelDependency& include : kernel.includes) {
+      std::ifstream file(toPath(include.path), std::ios::binary);
+      if (!file.is_open()) {
+        return std::nullopt;
+      }
+      std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      if (HashBytes(content.data(), content.size()) != include.contentHash) {
+        return std::nullopt;
+      }
+    }
+    return kernel;
+  }
+
+  void KernelCache::Store(const std::string &key, const CachedKernel &kernel) const {
+    if (!IsEnabled()) {
+      return;
+    }
+
+    EntryWriter writer;
+    writer.Write(kEntryMagic);
+    writer.Write(kEntryVersion);
+    writer.WriteBlob(key.data(), key.size());
+    writer.Write(static_cast<uint32_t>(kernel.includes.size()));
+    for (const KernelDependency& include : kernel.includes) {
+      writer.WriteBlob(include.path.data(), include.path.size());
+      writer.Write(include.contentHash);
+    }
+    writer.WriteBlob(kernel.bytecode.data(), kernel.bytecode.size());
+    writer.WriteBlob(kernel.layout.data(), kernel.layout.size());
+    writer.Write(static_cast<uint32_t>(kernel.constants.size()));
+    for (const KernelConstants& constants : kernel.constants) {
+      writer.Write(constants.slot);
+      writer.Write(constants.byteSize);
+      writer.Write(constants.rootParameterIndex);
+      writer.Write<uint8_t>(constants.isRootConstants);
+    }
+
+    const auto& data = writer.GetData();
+    WriteFile(HashToString(HashBytes(key.data(), key.size())) + ".kernel", data.data(), data.size());
+  }
+}
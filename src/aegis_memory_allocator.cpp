@@ -0,0 +1,129 @@
+#include "internal/memory_allocator.h"
+
+#include <algorithm>
+
+namespace aegis::internal {
+  namespace {
+    size_t alignUp(size_t value, size_t alignment) {
+      return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    float fragmentation(size_t freeBytes, size_t largestFreeRange) {
+      return freeBytes > 0 ? 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes) : 0.0f;
+    }
+  }
+
+  MemoryAllocator::MemoryAllocator(HeapFactory createHeap, size_t blockSize, size_t granularity) :
+      m_createHeap(std::move(createHeap)), m_blockSize(alignUp(std::max(blockSize, granularity), granularity)),
+      m_granularity(granularity), m_dedicatedCount(0) {}
+
+  MemoryAllocator::~MemoryAllocator() = default;
+
+  MemoryAllocator::Allocation MemoryAllocator::Allocate(size_t byteSize, size_t alignment) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto place = [](Block* block, const TlsfAllocator::Allocation& range) {
+      Allocation allocation;
+      allocation.heap = block->heap.get();
+      allocation.offset = range.offset;
+      allocation.size = range.size;
+      allocation.block = block;
+      allocation.range = range;
+      return allocation;
+    };
+
+    // Big buffers would fragment the shared heaps, give them their own
+    const size_t size = alignUp(std::max<size_t>(byteSize, 1), m_granularity);
+    if (size > m_blockSize / 2) {
+      auto heap = m_createHeap(size);
+      if (!heap) {
+        return {};
+      }
+      auto block = std::make_unique<Block>(Block{std::move(heap), std::make_unique<TlsfAllocator>(size, m_granularity), true});
+      auto range = block->allocator->Allocate(size, m_granularity); // Heaps start aligned
+      m_blocks.push_back(std::move(block));
+      m_dedicatedCount++;
+      return place(m_blocks.back().get(), range);
+    }
+
+    for (auto& block : m_blocks) {
+      if (block->dedicated) {
+        continue;
+      }
+      auto range = block->allocator->Allocate(byteSize, alignment);
+      if (range.IsValid()) {
+        return place(block.get(), range);
+      }
+    }
+
+    auto heap = m_createHeap(m_blockSize);
+    if (!heap) {
+      return {};
+    }
+    m_blocks.push_back(std::make_unique<Block>(Block{std::move(heap), std::make_unique<TlsfAllocator>(m_blockSize, m_granularity), false}));
+    Block* block = m_blocks.back().get();
+    auto range = block->allocator->Allocate(byteSize, alignment);
+    if (!range.IsValid()) {
+      return {}; // Alignment bigger than a block; the empty heap stays as the spare
+    }
+    return place(block, range);
+  }
+
+  void MemoryAllocator::Free(Allocation &allocation) {
+    if (!allocation) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Block* block = static_cast<Block*>(allocation.block);
+    block->allocator->Free(allocation.range);
+    allocation = Allocation{};
+
+    if (!block->allocator->IsEmpty()) {
+      return;
+    }
+
+    // Keep one empty regular heap as a spare, release everything else
+    const bool keepAsSpare = !block->dedicated &&
+        std::none_of(m_blocks.begin(), m_blocks.end(), [block](const auto& other) {
+          return other.get() != block && !other->dedicated && other->allocator->IsEmpty();
+        });
+    if (!keepAsSpare) {
+      m_blocks.erase(std::find_if(m_blocks.begin(), m_blocks.end(),
+                                  [block](const auto& other) { return other.get() == block; }));
+    }
+  }
+
+  MemoryStats MemoryAllocator::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    MemoryStats stats;
+    stats.blockSize = m_blockSize;
+    stats.dedicatedCount = m_dedicatedCount;
+    for (const auto& block : m_blocks) {
+      stats.heapCount++;
+      stats.reservedBytes += block->allocator->GetCapacity();
+      stats.usedBytes += block->allocator->GetUsedBytes();
+      stats.allocationCount += block->allocator->GetAllocationCount();
+      stats.freeRangeCount += block->allocator->GetFreeRangeCount();
+      stats.largestFreeRange = std::max(stats.largestFreeRange, block->allocator->GetLargestFreeRange());
+    }
+    stats.fragmentation = fragmentation(stats.reservedBytes - stats.usedBytes, stats.largestFreeRange);
+    return stats;
+  }
+
+  MemoryStats CombineMemoryStats(const MemoryStats &a, const MemoryStats &b) {
+    MemoryStats stats;
+    stats.blockSize = std::max(a.blockSize, b.blockSize);
+    stats.heapCount = a.heapCount + b.heapCount;
+    stats.reservedBytes = a.reservedBytes + b.reservedBytes;
+    stats.usedBytes = a.usedBytes + b.usedBytes;
+    stats.allocationCount = a.allocationCount + b.allocationCount;
+    stats.freeRangeCount = a.freeRangeCount + b.freeRangeCount;
+    stats.dedicatedCount = a.dedicatedCount + b.dedicatedCount;
+    stats.largestFreeRange = std::max(a.largestFreeRange, b.largestFreeRange);
+    stats.fragmentation = fragmentation(stats.reservedBytes - stats.usedBytes, stats.largestFreeRange);
+    return stats;
+  }
+}
@@ -0,0 +1,181 @@
+#include "internal/staging_ring.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace aegis::internal {
+  namespace {
+    size_t alignUp(size_t value, size_t alignment) {
+      return (value + alignment - 1) & ~(alignment - 1);
+    }
+  }
+
+  RingAllocator::RingAllocator(size_t capacity) :
+      m_capacity(capacity), m_head(0), m_tail(0), m_used(0), m_openBytes(0) {}
+
+  size_t RingAllocator::Allocate(size_t byteSize, size_t alignment) {
+    if (m_used == 0) {
+      m_head = m_tail = 0; // Empty, start over at the beginning
+    }
+
+    const size_t aligned = alignUp(m_head, alignment);
+    size_t offset = kInvalidOffset;
+    size_t consumed = 0;
+
+    if (m_head >= m_tail && m_used < m_capacity) {
+      // Free space is [head, capacity) and [0, tail)
+      if (aligned + byteSize <= m_capacity) {
+        offset = aligned;
+        consumed = aligned - m_head + byteSize;
+      } else if (byteSize <= m_tail) {
+        offset = 0;
+        consumed = m_capacity - m_head + byteSize; // The end of the ring is wasted
+      }
+    } else if (m_head < m_tail) {
+      // Free space is [head, tail)
+      if (aligned + byteSize <= m_tail) {
+        offset = aligned;
+        consumed = aligned - m_head + byteSize;
+      }
+    }
+
+    if (offset == kInvalidOffset) {
+      return kInvalidOffset;
+    }
+
+    m_head = offset + byteSize;
+    m_used += consumed;
+    m_openBytes += consumed;
+    return offset;
+  }
+
+  void RingAllocator::Close(uint64_t fenceValue) {
+    if (m_openBytes == 0) {
+      return;
+    }
+    m_ranges.push_back({fenceValue, m_head, m_openBytes});
+    m_openBytes = 0;
+  }
+
+  void RingAllocator::Reclaim(uint64_t completedValue) {
+    while (!m_ranges.empty() && m_ranges.front().fenceValue <= completedValue) {
+      m_tail = m_ranges.front().end;
+      m_used -= m_ranges.front().byteCount;
+      m_ranges.pop_front();
+    }
+  }
+
+  StagingRing::StagingRing(IComputeBackend *backend, GpuMemoryType type, size_t capacity, WaitFunction waitForFence) :
+      m_backend(backend), m_type(type), m_capacity(std::max<size_t>(capacity, 1)),
+      m_maxCapacity(std::max(kMaxCapacity, capacity)), m_waitForFence(std::move(waitForFence)),
+      m_mappedPtr(nullptr), m_allocator(m_capacity),
+      m_retiredBytes(0), m_stats{} {
+    if (type == GpuMemoryType::DEVICE_LOCAL) {
+      throw std::runtime_error("Staging memory must be UPLOAD or READBACK.");
+    }
+  }
+
+  void StagingRing::retire(std::unique_ptr<IGpuBuffer> buffer) {
+    m_retiredBytes += buffer->GetSizeInBytes();
+    m_openRetired.push_back(std::move(buffer));
+  }
+
+  void StagingRing::updateHighWater() {
+    m_stats.highWaterBytes = std::max(m_stats.highWaterBytes, m_allocator.GetUsedBytes() + m_retiredBytes);
+  }
+
+  StagingRing::Allocation StagingRing::allocateDedicated(size_t byteSize) {
+    auto buffer = m_backend->CreateBuffer(byteSize, m_type);
+    Allocation allocation = {buffer.get(), 0, buffer->Map()};
+    retire(std::move(buffer));
+
+    m_stats.dedicatedCount++;
+    updateHighWater();
+    return allocation;
+  }
+
+  StagingRing::Allocation StagingRing::Allocate(size_t byteSize, size_t alignment) {
+    byteSize = std::max<size_t>(byteSize, 1);
+    m_stats.allocationCount++;
+
+    // Big requests would just thrash the ring
+    if (byteSize > m_capacity / 4 && m_capacity >= m_maxCapacity) {
+      return allocateDedicated(byteSize);
+    }
+
+    size_t offset = m_buffer ? m_allocator.Allocate(byteSize, alignment) : RingAllocator::kInvalidOffset;
+
+    if (offset == RingAllocator::kInvalidOffset && m_buffer && m_capacity >= m_maxCapacity) {
+      // Replacing the ring by one of the same size would only pile up
+      // buffers while the GPU is behind
+      offset = waitForSpace(byteSize, alignment);
+      if (offset == RingAllocator::kInvalidOffset) {
+        return allocateDedicated(byteSize);
+      }
+    } else if (offset == RingAllocator::kInvalidOffset) {
+      // Out of space (or first use). Grow, keeping the old ring alive for
+      // the GPU work that still uses it.
+      size_t newCapacity = m_capacity;
+      if (m_buffer) {
+        newCapacity = std::min(m_capacity * 2, m_maxCapacity);
+        retire(std::move(m_buffer));
+        m_stats.growCount++;
+      }
+      while (newCapacity < byteSize * 4 && newCapacity < m_maxCapacity) {
+        newCapacity = std::min(newCapacity * 2, m_maxCapacity);
+      }
+      m_capacity = newCapacity;
+      if (byteSize > newCapacity / 4) {
+        return allocateDedicated(byteSize);
+      }
+
+      m_buffer = m_backend->CreateBuffer(newCapacity, m_type);
+      m_mappedPtr = static_cast<uint8_t*>(m_buffer->Map());
+      m_allocator = RingAllocator(newCapacity);
+
+      offset = m_allocator.Allocate(byteSize, alignment);
+    }
+
+    updateHighWater();
+    return {m_buffer.get(), offset, m_mappedPtr + offset};
+  }
+
+  size_t StagingRing::waitForSpace(size_t byteSize, size_t alignment) {
+    if (!m_waitForFence) {
+      return RingAllocator::kInvalidOffset;
+    }
+
+    size_t offset = RingAllocator::kInvalidOffset;
+    while (offset == RingAllocator::kInvalidOffset && m_allocator.HasClosedRanges()) {
+      const uint64_t fenceValue = m_allocator.GetOldestFenceValue();
+      m_waitForFence(fenceValue);
+      m_stats.waitCount++;
+      Reclaim(fenceValue);
+      offset = m_allocator.Allocate(byteSize, alignment);
+    }
+    return offset;
+  }
+
+  void StagingRing::Close(uint64_t fenceValue) {
+    m_allocator.Close(fenceValue);
+    for (auto& buffer : m_openRetired) {
+      m_retired.push_back({fenceValue, std::move(buffer)});
+    }
+    m_openRetired.clear();
+  }
+
+  void StagingRing::Reclaim(uint64_t completedValue) {
+    m_allocator.Reclaim(completedValue);
+    while (!m_retired.empty() && m_retired.front().fenceValue <= completedValue) {
+      m_retiredBytes -= m_retired.front().buffer->GetSizeInBytes();
+      m_retired.pop_front();
+    }
+  }
+
+  StagingPoolStats StagingRing::GetStats() const {
+    StagingPoolStats stats = m_stats;
+    stats.capacity = m_buffer ? m_capacity : 0;
+    stats.bytesInUse = m_allocator.GetUsedBytes() + m_retiredBytes;
+    return stats;
+  }
+}
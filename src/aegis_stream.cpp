@@ -1,35 +1,178 @@
 #include "aegis/buffer.h"
 #include "aegis/event.h"
+#include "aegis/graph.h"
 #include "aegis/kernel.h"
 #include "aegis/stream.h"
+#include "aegis/context.h"
 #include "backend.h"
+#include "internal/async_buffer_pool.h"
+#include "internal/captured_graph.h"
+#include "internal/host_memory_registry.h"
+#include "internal/deferred_release_queue.h"
+#include "internal/completion_worker.h"
+#include "internal/readback_copy.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility> // for std::exchange
 
 namespace aegis {
-  ComputeStream::ComputeStream(ComputeContext *context, std::unique_ptr<internal::IComputeStream> backendStream) : m_context(context), m_backendStream(std::move(backendStream)) {}
+  ComputeStream::ComputeStream(ComputeContext *context, std::unique_ptr<internal::IComputeStream> backendStream, StreamType type) :
+      m_context(context), m_backendStream(std::move(backendStream)), m_type(type),
+      m_callbackQueue(context->m_completionWorker->CreateQueue()) {}
+
+  ComputeStream::~ComputeStream() {
+    // The backend stream is destroyed once its submitted work is done,
+    // after that everything freed on it is reusable
+    auto* pool = m_context->m_asyncPool.get();
+    m_context->m_deferredReleases->ReleaseStream(std::move(m_backendStream), [pool](std::unique_ptr<internal::IComputeStream> stream) {
+      auto* released = stream.get();
+      pool->RetireStream(released);
+      stream.reset();
+      pool->ForgetStream(released);
+    });
+  }
 
-  ComputeStream::~ComputeStream() = default;
+  void ComputeStream::requireCompute() const {
+    if (m_type == StreamType::COPY) {
+      throw std::runtime_error("COPY streams cannot run kernels.");
+    }
+  }
+
+  void ComputeStream::requireNotCapturing() const {
+    if (m_capture) {
+      throw std::runtime_error("Only SetKernel(), SetBuffer() and RecordDispatch() can be captured.");
+    }
+  }
 
   void ComputeStream::SetKernel(ComputeKernel &kernel) {
-    m_backendStream->SetKernel(kernel.GetBackendKernel());
+    requireCompute();
+    // A kernel still compiling is bound at the next dispatch. The backend
+    // needs its root signature before any buffer, so those wait as well.
+    m_pendingKernel = &kernel;
+    if (kernel.IsReady()) {
+      bindPendingKernel();
+    }
+  }
+
+  void ComputeStream::bindPendingKernel() {
+    if (!m_pendingKernel) {
+      return;
+    }
+    internal::IComputeKernel* kernel = std::exchange(m_pendingKernel, nullptr)->GetBackendKernel();
+    if (m_capture) {
+      m_capture->kernel = kernel;
+      return;
+    }
+    m_backendStream->SetKernel(kernel);
+    for (const internal::GraphBinding& binding : m_pendingBindings) {
+      m_backendStream->SetBuffer(binding.slot, binding.buffer, binding.offset, binding.byteSize, binding.access);
+    }
+    m_pendingBindings.clear();
+    for (const auto& [slot, data] : m_pendingConstants) {
+      m_backendStream->SetConstants(slot, data.data(), data.size());
+    }
+    m_pendingConstants.clear();
   }
 
   void ComputeStream::RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    requireCompute();
+    bindPendingKernel();
+    if (m_capture) {
+      if (!m_capture->kernel) {
+        throw std::runtime_error("No kernel set before dispatch.");
+      }
+      if (m_capture->kernel->HasConstants()) {
+        // Replays would read whatever constants the replaying stream has, if any
+        throw std::runtime_error("Kernels with cbuffers cannot be captured.");
+      }
+      m_capture->nodes.push_back({m_capture->kernel, m_capture->bindings, {threadGroupsX, threadGroupsY, threadGroupsZ}});
+      m_capture->nodeBuffers.push_back(m_capture->buffers);
+      return;
+    }
     m_backendStream->RecordDispatch(threadGroupsX, threadGroupsY, threadGroupsZ);
   }
 
+  void ComputeStream::flushStaging(GpuBuffer &buffer) {
+    if (buffer.m_stagingBuffer && buffer.m_stagingDirty.exchange(false)) {
+      m_backendStream->ResourceCopyBuffer(buffer.GetBackendBuffer(), 0, buffer.m_stagingBuffer.get(), 0, buffer.GetSizeInBytes());
+    }
+  }
+
   void ComputeStream::ResourceCopyBuffer(GpuBuffer &dest, GpuBuffer &src) {
-    m_backendStream->ResourceCopyBuffer(dest.GetBackendBuffer(), src.GetBackendBuffer());
+    if (dest.GetSizeInBytes() != src.GetSizeInBytes()) {
+      throw std::runtime_error("Whole-buffer copies need buffers of the same size.");
+    }
+    ResourceCopyBuffer(dest, 0, src, 0, dest.GetSizeInBytes());
+  }
+
+  void ComputeStream::ResourceCopyBuffer(GpuBuffer &dest, size_t destOffset, GpuBuffer &src, size_t srcOffset, size_t byteSize) {
+    requireNotCapturing();
+    flushStaging(dest);
+    flushStaging(src);
+    m_backendStream->ResourceCopyBuffer(dest.GetBackendBuffer(), destOffset, src.GetBackendBuffer(), srcOffset, byteSize);
   }
 
   void ComputeStream::ResourceUpload(GpuBuffer &dest, const void *srcData, size_t byteSize) {
-    m_backendStream->ResourceUpload(dest.GetBackendBuffer(), srcData, byteSize);
+    ResourceUpload(dest, 0, srcData, byteSize);
+  }
+
+  void ComputeStream::ResourceUpload(GpuBuffer &dest, size_t destOffset, const void *srcData, size_t byteSize) {
+    requireNotCapturing();
+    flushStaging(dest);
+
+    // Pinned memory is GPU-visible, skip the staging copy
+    internal::HostMemoryRegistry::Location pinned;
+    if (byteSize > 0 && m_context->m_hostMemory->Find(srcData, byteSize, pinned)) {
+      m_backendStream->ResourceCopyBuffer(dest.GetBackendBuffer(), destOffset, pinned.buffer, pinned.offset, byteSize);
+      return;
+    }
+    m_backendStream->ResourceUpload(dest.GetBackendBuffer(), destOffset, srcData, byteSize);
   }
 
   void ComputeStream::ResourceDownload(void *destData, GpuBuffer &src, size_t byteSize) {
-    m_backendStream->ResourceDownload(destData, src.GetBackendBuffer(), byteSize);
+    ResourceDownload(destData, src, 0, byteSize);
+  }
+
+  void ComputeStream::ResourceDownload(void *destData, GpuBuffer &src, size_t srcOffset, size_t byteSize) {
+    requireNotCapturing();
+    flushStaging(src);
+
+    internal::HostMemoryRegistry::Location pinned;
+    if (byteSize > 0 && m_context->m_hostMemory->Find(destData, byteSize, pinned)) {
+      m_backendStream->ResourceCopyBuffer(pinned.buffer, pinned.offset, src.GetBackendBuffer(), srcOffset, byteSize);
+      return;
+    }
+    m_backendStream->ResourceDownload(destData, src.GetBackendBuffer(), srcOffset, byteSize);
+  }
+
+  std::future<void> ComputeStream::ResourceDownloadAsync(void *destData, GpuBuffer &src, size_t byteSize) {
+    return ResourceDownloadAsync(destData, src, 0, byteSize);
+  }
+
+  std::future<void> ComputeStream::ResourceDownloadAsync(void *destData, GpuBuffer &src, size_t srcOffset, size_t byteSize) {
+    requireNotCapturing();
+    flushStaging(src);
+
+    std::shared_ptr<internal::ReadbackCopy> copy;
+    internal::HostMemoryRegistry::Location pinned;
+    if (byteSize > 0 && m_context->m_hostMemory->Find(destData, byteSize, pinned)) {
+      m_backendStream->ResourceCopyBuffer(pinned.buffer, pinned.offset, src.GetBackendBuffer(), srcOffset, byteSize);
+    } else {
+      copy = m_backendStream->ResourceDownload(destData, src.GetBackendBuffer(), srcOffset, byteSize);
+    }
+
+    // std::function needs a copyable callable, so the promise is shared
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    EnqueueHostCallback([copy = std::move(copy), promise] {
+      if (copy) copy->Finish();
+      promise->set_value();
+    });
+    return future;
   }
 
-  void ComputeStream::SetBuffer(uint32_t slot, GpuBuffer &buffer) {
+  void ComputeStream::SetBuffer(uint32_t slot, GpuBuffer &buffer, BufferAccess access) {
     // Note: We're not setting the kernel here, just the buffer.
     // The D3D12Stream implementation will need to handle this.
     // Our 'RecordDispatch' also sets the kernel, which is simple
@@ -37,23 +180,163 @@ namespace aegis {
     //   stream.SetKernel(kernel);
     //   stream.SetBuffer(0, bufferA);
     //   stream.RecordDispatch(1,1,1);
-    m_backendStream->SetBuffer(slot, buffer.GetBackendBuffer());
+    requireCompute();
+    if (m_capture) {
+      captureBuffer(slot, buffer, 0, buffer.GetSizeInBytes(), access);
+      return;
+    }
+    flushStaging(buffer);
+    if (m_pendingKernel) {
+      m_pendingBindings.push_back({slot, buffer.GetBackendBuffer(), 0, buffer.GetSizeInBytes(), access});
+      return;
+    }
+    m_backendStream->SetBuffer(slot, buffer.GetBackendBuffer(), 0, buffer.GetSizeInBytes(), access);
+  }
+
+  void ComputeStream::SetBuffer(uint32_t slot, const BufferView &view, BufferAccess access) {
+    if (!view.buffer) {
+      throw std::runtime_error("Cannot bind an empty BufferView.");
+    }
+    requireCompute();
+    if (m_capture) {
+      captureBuffer(slot, *view.buffer, view.offset, view.size, access);
+      return;
+    }
+    flushStaging(*view.buffer);
+    if (m_pendingKernel) {
+      m_pendingBindings.push_back({slot, view.buffer->GetBackendBuffer(), view.offset, view.size, access});
+      return;
+    }
+    m_backendStream->SetBuffer(slot, view.buffer->GetBackendBuffer(), view.offset, view.size, access);
+  }
+
+  void ComputeStream::SetConstants(uint32_t slot, const void *data, size_t byteSize) {
+    requireCompute();
+    requireNotCapturing();
+    if (m_pendingKernel) {
+      const auto* bytes = static_cast<const uint8_t*>(data);
+      m_pendingConstants.emplace_back(slot, std::vector<uint8_t>(bytes, bytes + byteSize));
+      return;
+    }
+    m_backendStream->SetConstants(slot, data, byteSize);
+  }
+
+  void ComputeStream::captureBuffer(uint32_t slot, GpuBuffer &buffer, size_t offset, size_t byteSize, BufferAccess access) {
+    internal::CheckBufferRange(buffer.GetBackendBuffer(), offset, byteSize, "Bound range is outside the buffer.");
+
+    // Kept sorted by slot, a rebind replaces the binding
+    auto& bindings = m_capture->bindings;
+    auto it = std::lower_bound(bindings.begin(), bindings.end(), slot,
+                               [](const internal::GraphBinding& binding, uint32_t s) { return binding.slot < s; });
+    const size_t index = it - bindings.begin();
+    const internal::GraphBinding binding{slot, buffer.GetBackendBuffer(), offset, byteSize, access};
+    if (it != bindings.end() && it->slot == slot) {
+      *it = binding;
+      m_capture->buffers[index] = &buffer;
+    } else {
+      bindings.insert(it, binding);
+      m_capture->buffers.insert(m_capture->buffers.begin() + index, &buffer);
+    }
+  }
+
+  void ComputeStream::BeginCapture() {
+    requireCompute();
+    if (m_capture) {
+      throw std::runtime_error("The stream is already capturing.");
+    }
+    m_capture = std::make_unique<internal::GraphCapture>();
+    // A capture starts without a kernel, like a new stream
+    m_pendingKernel = nullptr;
+    m_pendingBindings.clear();
+    m_pendingConstants.clear();
+  }
+
+  std::unique_ptr<ComputeGraph> ComputeStream::EndCapture() {
+    if (!m_capture) {
+      throw std::runtime_error("EndCapture() without BeginCapture().");
+    }
+    std::unique_ptr<internal::GraphCapture> capture = std::move(m_capture);
+    m_pendingKernel = nullptr;
+    auto backendGraph = m_context->m_backend->CreateGraph(std::move(capture->nodes));
+    return std::unique_ptr<ComputeGraph>(new ComputeGraph(m_context, std::move(backendGraph), std::move(capture->nodeBuffers)));
+  }
+
+  void ComputeStream::RecordGraph(ComputeGraph &graph) {
+    requireCompute();
+    requireNotCapturing();
+    if (graph.m_context != m_context) {
+      throw std::runtime_error("The graph belongs to another context.");
+    }
+
+    for (auto& buffers : graph.m_buffers) {
+      for (GpuBuffer* buffer : buffers) {
+        flushStaging(*buffer);
+      }
+    }
+    m_backendStream->RecordGraph(graph.GetBackendGraph());
   }
 
   void ComputeStream::Submit() {
     m_backendStream->Submit();
+    m_context->m_deferredReleases->Collect();
   }
 
   void ComputeStream::HostWait() {
-    m_backendStream->HostWait();
+    m_backendStream->HostWait(internal::kInfiniteTimeout);
+    m_context->m_deferredReleases->Collect();
+  }
+
+  bool ComputeStream::HostWait(std::chrono::milliseconds timeout) {
+    if (!m_backendStream->HostWait(internal::ToTimeoutMs(timeout))) {
+      return false;
+    }
+    m_context->m_deferredReleases->Collect();
+    return true;
+  }
+
+  void ComputeStream::EnqueueHostCallback(std::function<void()> callback) {
+    requireNotCapturing();
+    // Events are just a fence value, so one per callback costs nothing
+    auto event = m_context->m_backend->CreateEvent();
+    m_backendStream->RecordEvent(event.get());
+    m_context->m_completionWorker->Enqueue(m_callbackQueue, std::move(event), std::move(callback));
   }
 
   void ComputeStream::StreamWait(ComputeEvent &event) {
+    requireNotCapturing();
     m_backendStream->StreamWait(event.GetBackendEvent());
+    m_context->m_asyncPool->OnStreamWait(m_backendStream.get(), event.GetBackendEvent());
   }
 
   void ComputeStream::RecordEvent(ComputeEvent &event) {
+    requireNotCapturing();
     m_backendStream->RecordEvent(event.GetBackendEvent());
+    m_context->m_asyncPool->OnRecordEvent(m_backendStream.get(), event.GetBackendEvent());
+  }
+
+  StagingStats ComputeStream::GetStagingStats() const {
+    return m_backendStream->GetStagingStats();
+  }
+
+  BarrierStats ComputeStream::GetBarrierStats() const {
+    return m_backendStream->GetBarrierStats();
+  }
+
+  std::unique_ptr<GpuBuffer> ComputeStream::AllocAsync(size_t byteSize) {
+    requireNotCapturing();
+    auto backendBuffer = m_context->m_asyncPool->Allocate(m_backendStream.get(), byteSize);
+    return std::unique_ptr<GpuBuffer>(new GpuBuffer(m_context, std::move(backendBuffer), true));
+  }
+
+  void ComputeStream::FreeAsync(std::unique_ptr<GpuBuffer> buffer) {
+    requireNotCapturing();
+    if (!buffer) {
+      return;
+    }
+    if (!buffer->m_isPooled || buffer->m_context != m_context) {
+      throw std::runtime_error("FreeAsync() needs a buffer from AllocAsync() on the same context.");
+    }
+    m_context->m_asyncPool->Free(m_backendStream.get(), std::move(buffer->m_backendBuffer));
   }
 
 }
\ No newline at end of file
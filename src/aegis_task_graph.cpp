@@ -0,0 +1,301 @@
+#include "aegis/task_graph.h"
+#include "aegis/context.h"
+#include "aegis/event.h"
+#include "aegis/kernel.h"
+#include "backend.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace aegis {
+  namespace {
+    /**
+     * @brief A set of task indices, one bit each.
+     */
+    class TaskSet {
+    public:
+      explicit TaskSet(size_t count) : m_words((count + 63) / 64, 0) {}
+
+      bool Contains(size_t task) const { return (m_words[task / 64] >> (task % 64)) & 1; }
+      void Insert(size_t task) { m_words[task / 64] |= uint64_t(1) << (task % 64); }
+      void InsertAll(const TaskSet& other) {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+          m_words[i] |= other.m_words[i];
+        }
+      }
+
+    private:
+      std::vector<uint64_t> m_words;
+    };
+
+    bool Overlaps(size_t offsetA, size_t sizeA, size_t offsetB, size_t sizeB) {
+      return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+    }
+  }
+
+  TaskGraph::TaskGraph(ComputeContext *context, const TaskGraphDesc &desc) :
+      m_context(context), m_desc(desc), m_isScheduled(false) {
+    m_desc.maxStreams = std::max<uint32_t>(m_desc.maxStreams, 1);
+    m_desc.stream.type = StreamType::COMPUTE;
+  }
+
+  TaskGraph::~TaskGraph() = default;
+
+  TaskGraph::TaskId TaskGraph::AddDispatch(ComputeKernel &kernel, std::vector<TaskBuffer> buffers,
+                                           uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    Task task = {};
+    task.type = TaskType::DISPATCH;
+    task.kernel = &kernel;
+    task.threadGroups[0] = threadGroupsX;
+    task.threadGroups[1] = threadGroupsY;
+    task.threadGroups[2] = threadGroupsZ;
+    for (const TaskBuffer& buffer : buffers) {
+      if (!buffer.view.buffer) {
+        throw std::runtime_error("Cannot bind an empty BufferView.");
+      }
+      task.accesses.push_back({buffer.view.buffer, buffer.view.offset, buffer.view.size, buffer.access != BufferAccess::READ});
+    }
+    task.buffers = std::move(buffers);
+    return addTask(std::move(task));
+  }
+
+  TaskGraph::TaskId TaskGraph::AddCopy(GpuBuffer &dest, GpuBuffer &src) {
+    if (dest.GetSizeInBytes() != src.GetSizeInBytes()) {
+      throw std::runtime_error("Whole-buffer copies need buffers of the same size.");
+    }
+    return AddCopy(dest, 0, src, 0, dest.GetSizeInBytes());
+  }
+
+  TaskGraph::TaskId TaskGraph::AddCopy(GpuBuffer &dest, size_t destOffset, GpuBuffer &src, size_t srcOffset, size_t byteSize) {
+    Task task = {};
+    task.type = TaskType::COPY;
+    task.dest = dest.View(destOffset, byteSize);
+    task.src = src.View(srcOffset, byteSize);
+    task.accesses.push_back({&dest, destOffset, byteSize, true});
+    task.accesses.push_back({&src, srcOffset, byteSize, false});
+    return addTask(std::move(task));
+  }
+
+  TaskGraph::TaskId TaskGraph::AddUpload(GpuBuffer &dest, const void *srcData, size_t byteSize) {
+    Task task = {};
+    task.type = TaskType::UPLOAD;
+    task.dest = dest.View(0, byteSize);
+    task.hostSrc = srcData;
+    task.accesses.push_back({&dest, 0, byteSize, true});
+    return addTask(std::move(task));
+  }
+
+  TaskGraph::TaskId TaskGraph::AddDownload(void *destData, GpuBuffer &src, size_t byteSize) {
+    Task task = {};
+    task.type = TaskType::DOWNLOAD;
+    task.src = src.View(0, byteSize);
+    task.hostDest = destData;
+    task.accesses.push_back({&src, 0, byteSize, false});
+    return addTask(std::move(task));
+  }
+
+  TaskGraph::TaskId TaskGraph::addTask(Task task) {
+    m_tasks.push_back(std::move(task));
+    m_isScheduled = false;
+    return m_tasks.size() - 1;
+  }
+
+  void TaskGraph::schedule() {
+    const size_t taskCount = m_tasks.size();
+
+    // 1. Two tasks depend on each other if their ranges overlap and one writes
+    std::vector<std::vector<TaskId>> dependencies(taskCount);
+    std::unordered_map<GpuBuffer*, std::vector<std::pair<TaskId, const Access*>>> history;
+    for (TaskId task = 0; task < taskCount; ++task) {
+      auto& deps = dependencies[task];
+      for (const Access& access : m_tasks[task].accesses) {
+        for (const auto& [earlier, earlierAccess] : history[access.buffer]) {
+          if ((access.writes || earlierAccess->writes) &&
+              Overlaps(access.offset, access.size, earlierAccess->offset, earlierAccess->size)) {
+            deps.push_back(earlier);
+          }
+        }
+      }
+      for (const Access& access : m_tasks[task].accesses) {
+        history[access.buffer].emplace_back(task, &access);
+      }
+
+      std::sort(deps.begin(), deps.end(), std::greater<>());
+      deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+    }
+
+    // 2. Drop the dependencies implied by others. Going from the latest
+    // dependency down, every one a later one already depends on is implied.
+    std::vector<TaskSet> ancestors(taskCount, TaskSet(taskCount));
+    size_t dependencyCount = 0;
+    for (TaskId task = 0; task < taskCount; ++task) {
+      auto& deps = dependencies[task];
+      std::erase_if(deps, [&](TaskId dep) {
+        if (ancestors[task].Contains(dep)) {
+          return true;
+        }
+        ancestors[task].InsertAll(ancestors[dep]);
+        ancestors[task].Insert(dep);
+        return false;
+      });
+      dependencyCount += deps.size();
+    }
+
+    // 3. Assign streams and waits. Every stream keeps a vector clock: for
+    // each stream, the latest task on it that is known to be done before
+    // the stream's next task. A dependency the clock already covers needs
+    // no wait.
+    const uint32_t maxStreams = m_desc.maxStreams;
+    std::vector<int64_t> tails(maxStreams, -1);
+    std::vector<std::vector<int64_t>> streamClocks(maxStreams, std::vector<int64_t>(maxStreams, -1));
+    std::vector<std::vector<int64_t>> taskClocks(taskCount);
+    uint32_t streamCount = 0;
+    size_t waitCount = 0;
+
+    for (TaskId task = 0; task < taskCount; ++task) {
+      Task& t = m_tasks[task];
+      const auto& deps = dependencies[task];
+
+      // Continue a chain, else take a stream that is done with everything
+      // before this task anyway, else start a new branch
+      int64_t chosen = -1;
+      for (TaskId dep : deps) {
+        if (tails[m_tasks[dep].stream] == static_cast<int64_t>(dep)) {
+          chosen = m_tasks[dep].stream;
+          break;
+        }
+      }
+      for (uint32_t s = 0; chosen < 0 && s < streamCount; ++s) {
+        if (ancestors[task].Contains(static_cast<size_t>(tails[s]))) {
+          chosen = s;
+        }
+      }
+      if (chosen < 0 && streamCount < maxStreams) {
+        chosen = streamCount++;
+      }
+      if (chosen < 0) {
+        // Every stream is busy with unrelated work, queue behind the oldest
+        chosen = std::min_element(tails.begin(), tails.end()) - tails.begin();
+      }
+
+      const uint32_t stream = static_cast<uint32_t>(chosen);
+      auto& clock = streamClocks[stream];
+      t.stream = stream;
+      t.waits.clear();
+      for (TaskId dep : deps) {
+        const uint32_t depStream = m_tasks[dep].stream;
+        if (depStream == stream || clock[depStream] >= static_cast<int64_t>(dep)) {
+          continue;
+        }
+        t.waits.push_back(dep);
+        for (uint32_t s = 0; s < maxStreams; ++s) {
+          clock[s] = std::max(clock[s], taskClocks[dep][s]);
+        }
+      }
+      waitCount += t.waits.size();
+
+      clock[stream] = static_cast<int64_t>(task);
+      taskClocks[task] = clock;
+      tails[stream] = static_cast<int64_t>(task);
+    }
+
+    // Events are only recorded after tasks that something waits for
+    std::vector<bool> waitedFor(taskCount, false);
+    for (const Task& t : m_tasks) {
+      for (TaskId dep : t.waits) {
+        waitedFor[dep] = true;
+      }
+    }
+    for (TaskId task = 0; task < taskCount; ++task) {
+      if (!waitedFor[task]) {
+        m_tasks[task].event.reset();
+      } else if (!m_tasks[task].event) {
+        m_tasks[task].event = m_context->CreateEvent();
+      }
+    }
+
+    while (m_streams.size() < streamCount) {
+      m_streams.push_back(m_context->CreateStream(m_desc.stream));
+      m_tailEvents.push_back(m_context->CreateEvent());
+      m_hasTail.push_back(false);
+    }
+
+    m_stats = {taskCount, dependencyCount, streamCount, waitCount};
+    m_isScheduled = true;
+  }
+
+  void TaskGraph::recordTask(Task &task) {
+    ComputeStream& stream = *m_streams[task.stream];
+    switch (task.type) {
+      case TaskType::DISPATCH:
+        stream.SetKernel(*task.kernel);
+        for (const TaskBuffer& buffer : task.buffers) {
+          stream.SetBuffer(buffer.slot, buffer.view, buffer.access);
+        }
+        stream.RecordDispatch(task.threadGroups[0], task.threadGroups[1], task.threadGroups[2]);
+        break;
+      case TaskType::COPY:
+        stream.ResourceCopyBuffer(*task.dest.buffer, task.dest.offset, *task.src.buffer, task.src.offset, task.dest.size);
+        break;
+      case TaskType::UPLOAD:
+        stream.ResourceUpload(*task.dest.buffer, task.dest.offset, task.hostSrc, task.dest.size);
+        break;
+      case TaskType::DOWNLOAD:
+        stream.ResourceDownload(task.hostDest, *task.src.buffer, task.src.offset, task.src.size);
+        break;
+    }
+  }
+
+  void TaskGraph::Execute() {
+    if (!m_isScheduled) {
+      schedule();
+    }
+
+    std::vector<bool> started(m_streams.size(), false);
+    for (Task& task : m_tasks) {
+      ComputeStream& stream = *m_streams[task.stream];
+
+      if (!started[task.stream]) {
+        // Order this run after the previous one, whose ends are submitted
+        started[task.stream] = true;
+        for (size_t other = 0; other < m_streams.size(); ++other) {
+          if (other != task.stream && m_hasTail[other]) {
+            stream.StreamWait(*m_tailEvents[other]);
+          }
+        }
+      }
+
+      for (TaskId dep : task.waits) {
+        // Streams can share a hardware queue, which runs nothing while it
+        // waits, so a signal must be submitted before any wait for it. Doing
+        // it here submits every stream after the streams it waits on.
+        ComputeEvent& event = *m_tasks[dep].event;
+        ComputeStream& signaling = *m_streams[m_tasks[dep].stream];
+        if (event.GetBackendEvent()->GetFenceValue() > signaling.GetBackendStream()->GetSubmittedFenceValue()) {
+          signaling.Submit();
+        }
+        stream.StreamWait(event);
+      }
+
+      recordTask(task);
+      if (task.event) {
+        stream.RecordEvent(*task.event);
+      }
+    }
+
+    for (size_t s = 0; s < m_streams.size(); ++s) {
+      m_hasTail[s] = started[s];
+      if (started[s]) {
+        m_streams[s]->RecordEvent(*m_tailEvents[s]);
+        m_streams[s]->Submit();
+      }
+    }
+  }
+
+  void TaskGraph::HostWait() {
+    for (auto& stream : m_streams) {
+      stream->HostWait();
+    }
+  }
+}
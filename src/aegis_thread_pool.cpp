@@ -0,0 +1,160 @@
+#include "internal/thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace aegis::internal {
+  namespace {
+    // Which pool/worker the current thread belongs to, so nested Submit()
+    // calls go to the local deque.
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local uint32_t t_workerIndex = 0;
+  }
+
+  ThreadPool::ThreadPool(uint32_t threadCount) : m_queuedTasks(0), m_nextQueue(0), m_stopping(false) {
+    if (threadCount == 0) {
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_queues.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+      m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+      m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+      m_stopping = true;
+    }
+    m_sleepCondition.notify_all();
+
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  void ThreadPool::Submit(std::function<void()> task) {
+    uint32_t index = (t_pool == this)
+        ? t_workerIndex
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(m_queues.size());
+
+    {
+      // Taking the lock orders the increment against a worker deciding to sleep
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+      m_queuedTasks.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+      m_queues[index]->tasks.push_front(std::move(task));
+    }
+    m_sleepCondition.notify_one();
+  }
+
+  bool ThreadPool::tryTakeTask(uint32_t index, std::function<void()>& outTask) {
+    const auto queueCount = static_cast<uint32_t>(m_queues.size());
+
+    {
+      auto& own = *m_queues[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        outTask = std::move(own.tasks.front());
+        own.tasks.pop_front();
+        m_queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+      }
+    }
+
+    for (uint32_t offset = 1; offset < queueCount; ++offset) {
+      auto& victim = *m_queues[(index + offset) % queueCount];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        outTask = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        m_queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void ThreadPool::workerLoop(uint32_t index) {
+    t_pool = this;
+    t_workerIndex = index;
+
+    std::function<void()> task;
+    while (true) {
+      if (tryTakeTask(index, task)) {
+        task();
+        task = nullptr;
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(m_sleepMutex);
+      m_sleepCondition.wait(lock, [this] {
+        return m_stopping || m_queuedTasks.load(std::memory_order_acquire) > 0;
+      });
+      if (m_stopping && m_queuedTasks.load(std::memory_order_acquire) == 0) {
+        return;
+      }
+    }
+  }
+
+  void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+      return;
+    }
+    if (count == 1) {
+      body(0);
+      return;
+    }
+
+    // A few chunks per worker leaves room for stealing to balance uneven groups
+    const size_t chunkCount = std::min(count, static_cast<size_t>(m_queues.size()) * 4);
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    std::atomic<size_t> remaining(chunkCount);
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+      const size_t begin = chunk * chunkSize;
+      const size_t end = std::min(count, begin + chunkSize);
+
+      Submit([&, begin, end] {
+        try {
+          for (size_t i = begin; i < end; ++i) {
+            body(i);
+          }
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!firstError) firstError = std::current_exception();
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+      });
+    }
+
+    // Help out instead of blocking
+    const uint32_t helperIndex = (t_pool == this) ? t_workerIndex : 0;
+    std::function<void()> task;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+      if (tryTakeTask(helperIndex, task)) {
+        task();
+        task = nullptr;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+
+    if (firstError) {
+      std::rethrow_exception(firstError);
+    }
+  }
+}
@@ -0,0 +1,242 @@
+#include "internal/tlsf_allocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace aegis::internal {
+  namespace {
+    size_t alignUp(size_t value, size_t alignment) {
+      return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    uint32_t log2Floor(size_t value) {
+      return static_cast<uint32_t>(std::bit_width(value) - 1);
+    }
+  }
+
+  TlsfAllocator::TlsfAllocator(size_t capacity, size_t granularity) :
+      m_capacity(capacity), m_granularity(granularity), m_granularityLog2(0),
+      m_firstLevelBitmap(0), m_secondLevelBitmap{}, m_freeLists{},
+      m_usedBytes(0), m_allocationCount(0), m_freeRangeCount(0) {
+    if (granularity == 0 || !std::has_single_bit(granularity)) {
+      throw std::runtime_error("Allocator granularity must be a power of two.");
+    }
+    if (capacity == 0 || capacity % granularity != 0) {
+      throw std::runtime_error("Allocator capacity must be a non-zero multiple of the granularity.");
+    }
+    m_granularityLog2 = log2Floor(granularity);
+
+    Block* block = newBlock();
+    *block = Block{0, capacity, nullptr, nullptr, nullptr, nullptr, true};
+    insertFree(block);
+  }
+
+  void TlsfAllocator::mapping(size_t units, uint32_t &firstLevel, uint32_t &secondLevel) {
+    if (units < kSecondLevelCount) {
+      // Small sizes get one exact class per granule
+      firstLevel = 0;
+      secondLevel = static_cast<uint32_t>(units);
+    } else {
+      const uint32_t msb = log2Floor(units);
+      firstLevel = msb - kSecondLevelLog2 + 1;
+      secondLevel = static_cast<uint32_t>(units >> (msb - kSecondLevelLog2)) - kSecondLevelCount;
+    }
+  }
+
+  TlsfAllocator::Block* TlsfAllocator::findFree(size_t size) const {
+    size_t units = size >> m_granularityLog2;
+
+    // Round up to the next class boundary so that any block in the class
+    // we land on is big enough
+    size_t rounded = units;
+    if (rounded >= kSecondLevelCount) {
+      rounded += (size_t{1} << (log2Floor(rounded) - kSecondLevelLog2)) - 1;
+    }
+
+    uint32_t firstLevel, secondLevel;
+    mapping(rounded, firstLevel, secondLevel);
+
+    if (firstLevel < kFirstLevelCount) {
+      uint32_t secondLevelMap = m_secondLevelBitmap[firstLevel] & (~0u << secondLevel);
+      if (!secondLevelMap) {
+        const uint64_t firstLevelMap = firstLevel + 1 < kFirstLevelCount
+            ? m_firstLevelBitmap & (~uint64_t{0} << (firstLevel + 1))
+            : 0;
+        if (firstLevelMap) {
+          firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+          secondLevelMap = m_secondLevelBitmap[firstLevel];
+        }
+      }
+      if (secondLevelMap) {
+        secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+        return m_freeLists[firstLevel][secondLevel];
+      }
+    }
+
+    // Nothing in the bigger classes; the exact class may still hold a block
+    // that fits, it's just not guaranteed to
+    mapping(units, firstLevel, secondLevel);
+    for (Block* block = m_freeLists[firstLevel][secondLevel]; block; block = block->nextFree) {
+      if (block->size >= size) {
+        return block;
+      }
+    }
+    return nullptr;
+  }
+
+  void TlsfAllocator::insertFree(Block *block) {
+    uint32_t firstLevel, secondLevel;
+    mapping(block->size >> m_granularityLog2, firstLevel, secondLevel);
+
+    Block*& head = m_freeLists[firstLevel][secondLevel];
+    block->isFree = true;
+    block->prevFree = nullptr;
+    block->nextFree = head;
+    if (head) {
+      head->prevFree = block;
+    }
+    head = block;
+
+    m_firstLevelBitmap |= uint64_t{1} << firstLevel;
+    m_secondLevelBitmap[firstLevel] |= 1u << secondLevel;
+    m_freeRangeCount++;
+  }
+
+  void TlsfAllocator::removeFree(Block *block) {
+    uint32_t firstLevel, secondLevel;
+    mapping(block->size >> m_granularityLog2, firstLevel, secondLevel);
+
+    if (block->prevFree) {
+      block->prevFree->nextFree = block->nextFree;
+    } else {
+      m_freeLists[firstLevel][secondLevel] = block->nextFree;
+    }
+    if (block->nextFree) {
+      block->nextFree->prevFree = block->prevFree;
+    }
+
+    if (!m_freeLists[firstLevel][secondLevel]) {
+      m_secondLevelBitmap[firstLevel] &= ~(1u << secondLevel);
+      if (!m_secondLevelBitmap[firstLevel]) {
+        m_firstLevelBitmap &= ~(uint64_t{1} << firstLevel);
+      }
+    }
+
+    block->isFree = false;
+    block->prevFree = block->nextFree = nullptr;
+    m_freeRangeCount--;
+  }
+
+  void TlsfAllocator::split(Block *block, size_t size) {
+    Block* rest = newBlock();
+    *rest = Block{block->offset + size, block->size - size, block, block->nextPhysical, nullptr, nullptr, false};
+    if (block->nextPhysical) {
+      block->nextPhysical->prevPhysical = rest;
+    }
+    block->nextPhysical = rest;
+    block->size = size;
+    insertFree(rest);
+  }
+
+  TlsfAllocator::Block* TlsfAllocator::newBlock() {
+    if (!m_unusedBlocks.empty()) {
+      Block* block = m_unusedBlocks.back();
+      m_unusedBlocks.pop_back();
+      return block;
+    }
+    return &m_blockStorage.emplace_back();
+  }
+
+  void TlsfAllocator::deleteBlock(Block *block) {
+    m_unusedBlocks.push_back(block);
+  }
+
+  TlsfAllocator::Allocation TlsfAllocator::Allocate(size_t byteSize, size_t alignment) {
+    if (alignment == 0 || !std::has_single_bit(alignment)) {
+      throw std::runtime_error("Allocation alignment must be a power of two.");
+    }
+    alignment = std::max(alignment, m_granularity);
+
+    const size_t size = alignUp(std::max<size_t>(byteSize, 1), m_granularity);
+    const size_t padding = alignment - m_granularity; // Worst case to reach an aligned offset
+    if (size > m_capacity || size + padding > m_capacity) {
+      return {};
+    }
+
+    Block* block = findFree(size + padding);
+    if (!block) {
+      return {};
+    }
+    removeFree(block);
+
+    // Give the bytes in front of the aligned offset back as a free block.
+    // The block in front of 'block' is in use (free neighbours are always
+    // merged), so this doesn't break the invariant.
+    const size_t gap = alignUp(block->offset, alignment) - block->offset;
+    if (gap > 0) {
+      split(block, gap);
+      Block* aligned = block->nextPhysical;
+      removeFree(aligned);
+      insertFree(block);
+      block = aligned;
+    }
+
+    if (block->size > size) {
+      split(block, size);
+    }
+
+    m_usedBytes += block->size;
+    m_allocationCount++;
+    return {block->offset, block->size, block};
+  }
+
+  void TlsfAllocator::Free(const Allocation &allocation) {
+    if (!allocation.IsValid()) {
+      return;
+    }
+
+    Block* block = static_cast<Block*>(allocation.handle);
+    m_usedBytes -= block->size;
+    m_allocationCount--;
+
+    if (Block* prev = block->prevPhysical; prev && prev->isFree) {
+      removeFree(prev);
+      prev->size += block->size;
+      prev->nextPhysical = block->nextPhysical;
+      if (block->nextPhysical) {
+        block->nextPhysical->prevPhysical = prev;
+      }
+      deleteBlock(block);
+      block = prev;
+    }
+
+    if (Block* next = block->nextPhysical; next && next->isFree) {
+      removeFree(next);
+      block->size += next->size;
+      block->nextPhysical = next->nextPhysical;
+      if (next->nextPhysical) {
+        next->nextPhysical->prevPhysical = block;
+      }
+      deleteBlock(next);
+    }
+
+    insertFree(block);
+  }
+
+  size_t TlsfAllocator::GetLargestFreeRange() const {
+    if (!m_firstLevelBitmap) {
+      return 0;
+    }
+
+    // The largest range is somewhere in the highest non-empty class
+    const uint32_t firstLevel = static_cast<uint32_t>(63 - std::countl_zero(m_firstLevelBitmap));
+    const uint32_t secondLevel = static_cast<uint32_t>(31 - std::countl_zero(m_secondLevelBitmap[firstLevel]));
+
+    size_t largest = 0;
+    for (Block* block = m_freeLists[firstLevel][secondLevel]; block; block = block->nextFree) {
+      largest = std::max(largest, block->size);
+    }
+    return largest;
+  }
+}
@@ -0,0 +1,178 @@
+#include "cpu_backend.h"
+
+#if defined(AEGIS_ENABLE_CPU)
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+
+#include "cpu_buffer.h"
+#include "cpu_event.h"
+#include "cpu_kernel.h"
+#include "cpu_stream.h"
+
+namespace aegis::internal {
+  namespace {
+    // Cache-line granularity keeps neighbouring buffers from false sharing
+    constexpr size_t kHeapGranularity = 64;
+
+    /**
+     * @brief A heap made of host memory.
+     */
+    class HostHeap : public IMemoryHeap {
+    public:
+      explicit HostHeap(size_t byteSize) :
+          m_data(static_cast<std::byte*>(::operator new(byteSize, std::align_val_t{kHeapGranularity}))) {}
+      ~HostHeap() override { ::operator delete(m_data, std::align_val_t{kHeapGranularity}); }
+
+      std::byte* GetData() const { return m_data; }
+
+    private:
+      std::byte* m_data;
+    };
+  }
+
+  std::unique_ptr<CpuBackend> CpuBackend::Create(const ContextDesc& desc) {
+    return std::unique_ptr<CpuBackend>(new CpuBackend(desc));
+  }
+
+  CpuBackend::CpuBackend(const ContextDesc& desc) :
+      m_threadPool(desc.cpuThreadCount),
+      m_deviceLocalAllocator([](size_t byteSize) { return std::make_unique<HostHeap>(byteSize); },
+                             desc.memoryBlockSize, kHeapGranularity) {}
+
+  std::byte* CpuBackend::GetHeapData(IMemoryHeap* heap) {
+    return static_cast<HostHeap*>(heap)->GetData();
+  }
+
+  CpuBackend::~CpuBackend() {
+    WaitForIdle();
+  }
+
+  std::unique_ptr<IComputeStream> CpuBackend::CreateStream(const StreamDesc& desc) {
+    return std::make_unique<CpuStream>(this, desc);
+  }
+
+  std::unique_ptr<IComputeEvent> CpuBackend::CreateEvent() {
+    return std::make_unique<CpuEvent>(this);
+  }
+
+  std::unique_ptr<IGpuBuffer> CpuBackend::CreateBuffer(size_t byteSize, GpuMemoryType type) {
+    return std::make_unique<CpuBuffer>(this, byteSize, type);
+  }
+
+  std::unique_ptr<IGpuBuffer> CpuBackend::ImportHostMemory(void* hostPointer, size_t byteSize) {
+    // Every "GPU" copy here is a memcpy(), so any memory works
+    return std::make_unique<CpuBuffer>(this, hostPointer, byteSize);
+  }
+
+  std::unique_ptr<IComputeKernel> CpuBackend::CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                           const KernelDefines&, const KernelCompileOptions&) {
+    throw std::runtime_error("The CPU backend cannot run HLSL kernels (" + hlslFilePath + ", " + entryPoint +
+                             "), use ComputeContext::CreateHostKernel()");
+  }
+
+  std::unique_ptr<IComputeKernel> CpuBackend::CreateKernelFromSource(const std::string&, const std::string& sourceName,
+                                                                     const std::string& entryPoint, const KernelDefines& defines,
+                                                                     const KernelCompileOptions& options) {
+    return CreateKernel(sourceName, entryPoint, defines, options);
+  }
+
+  std::unique_ptr<IComputeKernel> CpuBackend::CreateKernelFromBytecode(const KernelBytecode& bytecode) {
+    throw std::runtime_error("The CPU backend cannot run compiled kernels (" + std::string(bytecode.entryPoint) +
+                             "), use ComputeContext::CreateHostKernel()");
+  }
+
+  std::unique_ptr<IComputeKernel> CpuBackend::CreateHostKernel(const HostKernelDesc& desc) {
+    if (!desc.function) {
+      throw std::runtime_error("Host kernel has no function.");
+    }
+    if (desc.numThreads.x == 0 || desc.numThreads.y == 0 || desc.numThreads.z == 0) {
+      throw std::runtime_error("Host kernel thread group size must be non-zero.");
+    }
+    return std::make_unique<CpuKernel>(this, desc);
+  }
+
+  MemoryStats CpuBackend::GetMemoryStats() const {
+    return m_deviceLocalAllocator.GetStats();
+  }
+
+  DeviceCapabilities CpuBackend::GetCapabilities() const {
+    DeviceCapabilities caps;
+    caps.unifiedMemory = true;
+    caps.deviceHostVisibleMemory = true; // All "device" memory is plain host memory
+    return caps;
+  }
+
+  void CpuBackend::WaitForIdle() {
+    std::lock_guard<std::mutex> lock(m_streamsMutex);
+    for (auto* stream : m_streams) {
+      stream->WaitForSubmitted();
+    }
+  }
+
+  size_t CpuBackend::WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) {
+    std::vector<std::shared_ptr<HostFence>> fences(count);
+    std::vector<uint64_t> values(count);
+    for (size_t i = 0; i < count; ++i) {
+      std::tie(fences[i], values[i]) = static_cast<CpuEvent*>(events[i])->Get();
+      if (!fences[i] && !waitAll) {
+        return i;
+      }
+    }
+
+    const bool infinite = timeoutMs == kInfiniteTimeout;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    if (waitAll) {
+      for (size_t i = 0; i < count; ++i) {
+        if (!fences[i]) continue;
+        if (infinite) {
+          fences[i]->Wait(values[i]);
+          continue;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (!fences[i]->Wait(values[i], std::max(remaining, std::chrono::milliseconds(0)))) {
+          return count;
+        }
+      }
+      return 0;
+    }
+
+    std::vector<HostFence*> rawFences(count);
+    for (size_t i = 0; i < count; ++i) {
+      rawFences[i] = fences[i].get();
+    }
+    return HostFence::WaitAny(rawFences.data(), values.data(), count,
+                              infinite ? std::chrono::milliseconds::max() : std::chrono::milliseconds(timeoutMs));
+  }
+
+  std::unique_ptr<IComputeEvent> CpuBackend::CreateHostEvent() {
+    auto event = std::make_unique<CpuEvent>(this);
+    event->Set(std::make_shared<HostFence>(), 1);
+    return event;
+  }
+
+  void CpuBackend::SignalHostEvent(IComputeEvent *event) {
+    auto [fence, value] = static_cast<CpuEvent*>(event)->Get();
+    fence->Signal(value);
+  }
+
+  void CpuBackend::ResetHostEvent(IComputeEvent *event) {
+    static_cast<CpuEvent*>(event)->Advance();
+  }
+
+  void CpuBackend::RegisterStream(CpuStream* stream) {
+    std::lock_guard<std::mutex> lock(m_streamsMutex);
+    m_streams.push_back(stream);
+  }
+
+  void CpuBackend::UnregisterStream(CpuStream* stream) {
+    std::lock_guard<std::mutex> lock(m_streamsMutex);
+    m_streams.erase(std::remove(m_streams.begin(), m_streams.end(), stream), m_streams.end());
+  }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "cpu_buffer.h"
+
+#if defined(AEGIS_ENABLE_CPU)
+#include <cstring>
+#include <new>
+
+namespace aegis::internal {
+  namespace {
+    // Cache-line alignment keeps neighbouring buffers from false sharing
+    constexpr std::align_val_t kBufferAlignment{64};
+  }
+
+  CpuBuffer::CpuBuffer(CpuBackend *backend, size_t byteSize, GpuMemoryType type) : m_backend(backend), m_data(nullptr), m_byteSize(byteSize), m_memoryType(type), m_ownsData(true) {
+    if (type == GpuMemoryType::DEVICE_LOCAL || type == GpuMemoryType::DEVICE_HOST_VISIBLE) {
+      m_allocation = backend->GetDeviceLocalAllocator().Allocate(m_byteSize, static_cast<size_t>(kBufferAlignment));
+      if (!m_allocation) {
+        throw std::bad_alloc();
+      }
+      m_data = CpuBackend::GetHeapData(m_allocation.heap) + m_allocation.offset;
+    } else {
+      m_data = static_cast<std::byte*>(::operator new(m_byteSize > 0 ? m_byteSize : 1, kBufferAlignment));
+    }
+    std::memset(m_data, 0, m_byteSize);
+  }
+
+  CpuBuffer::CpuBuffer(CpuBackend *backend, void *hostPointer, size_t byteSize) :
+      m_backend(backend), m_data(static_cast<std::byte*>(hostPointer)), m_byteSize(byteSize),
+      m_memoryType(GpuMemoryType::HOST), m_ownsData(false) {}
+
+  CpuBuffer::~CpuBuffer() {
+    if (m_allocation) {
+      m_backend->GetDeviceLocalAllocator().Free(m_allocation);
+    } else if (m_ownsData) {
+      ::operator delete(m_data, kBufferAlignment);
+    }
+  }
+
+  size_t CpuBuffer::GetSizeInBytes() const {
+    return m_byteSize;
+  }
+
+  void *CpuBuffer::Map() {
+    return m_data;
+  }
+
+  void CpuBuffer::Unmap() {}
+}
+
+#endif
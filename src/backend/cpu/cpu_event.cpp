@@ -0,0 +1,44 @@
+#include "cpu_event.h"
+
+#if defined(AEGIS_ENABLE_CPU)
+
+namespace aegis::internal {
+  CpuEvent::CpuEvent(CpuBackend *backend) : m_backend(backend), m_value(0) {}
+
+  CpuEvent::~CpuEvent() {}
+
+  void CpuEvent::Set(std::shared_ptr<HostFence> fence, uint64_t value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fence = std::move(fence);
+    m_value = value;
+  }
+
+  std::pair<std::shared_ptr<HostFence>, uint64_t> CpuEvent::Get() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_fence, m_value};
+  }
+
+  void CpuEvent::Advance() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_value++;
+  }
+
+  bool CpuEvent::IsComplete() const {
+    auto [fence, value] = Get();
+    return !fence || fence->GetCompletedValue() >= value;
+  }
+
+  uint64_t CpuEvent::GetFenceValue() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_value;
+  }
+
+  std::unique_ptr<IComputeEvent> CpuEvent::Clone() const {
+    auto clone = std::make_unique<CpuEvent>(m_backend);
+    auto [fence, value] = Get();
+    clone->Set(std::move(fence), value);
+    return clone;
+  }
+}
+
+#endif
@@ -0,0 +1,11 @@
+#include "cpu_kernel.h"
+
+#if defined(AEGIS_ENABLE_CPU)
+
+namespace aegis::internal {
+  CpuKernel::CpuKernel(CpuBackend *backend, const HostKernelDesc &desc) : m_backend(backend), m_function(desc.function), m_numThreads(desc.numThreads) {}
+
+  CpuKernel::~CpuKernel() {}
+}
+
+#endif
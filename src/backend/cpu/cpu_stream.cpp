@@ -0,0 +1,282 @@
+#include "cpu_stream.h"
+#include "cpu_buffer.h"
+#include "cpu_kernel.h"
+#include "cpu_event.h"
+
+#if defined(AEGIS_ENABLE_CPU)
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace aegis::internal {
+  CpuStream::CpuStream(CpuBackend *backend, const StreamDesc& desc) :
+      m_backend(backend), m_currentKernel(nullptr), m_stopping(false),
+      m_fence(std::make_shared<HostFence>()), m_fenceValue(1), m_submittedValue(0), m_recordedValue(0),
+      m_maxInFlight(std::max<uint32_t>(desc.maxInFlightSubmissions, 1)) {
+    m_worker = std::thread(&CpuStream::workerLoop, this);
+    m_backend->RegisterStream(this);
+  }
+
+  CpuStream::~CpuStream() {
+    m_backend->UnregisterStream(this);
+    {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_stopping = true;
+    }
+    m_queueCondition.notify_one();
+    m_worker.join(); // Drains everything that was submitted
+  }
+
+  void CpuStream::workerLoop() {
+    while (true) {
+      Batch batch;
+      {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        m_queueCondition.wait(lock, [this] { return m_stopping || !m_submitted.empty(); });
+        if (m_submitted.empty()) {
+          return; // Stopping and nothing left to run
+        }
+        batch = std::move(m_submitted.front());
+        m_submitted.pop_front();
+      }
+
+      try {
+        for (auto& command : batch.commands) {
+          command();
+        }
+      } catch (...) {
+        // The rest of the batch is skipped, like a GPU device removal would,
+        // but the fence still advances so waiters don't hang.
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        if (!m_error) m_error = std::current_exception();
+      }
+
+      m_fence->Signal(batch.fenceValue);
+    }
+  }
+
+  void CpuStream::executeDispatch(const CpuKernel *kernel,
+                                  const std::vector<void *> &buffers,
+                                  const std::vector<size_t> &bufferSizes,
+                                  const std::vector<ConstantBlock> &constants,
+                                  uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    const HostKernelFunction& function = kernel->GetFunction();
+    const HostUint3 numThreads = kernel->GetNumThreads();
+
+    std::vector<const void*> constantData(constants.size(), nullptr);
+    std::vector<size_t> constantSizes(constants.size(), 0);
+    for (size_t i = 0; i < constants.size(); ++i) {
+      if (constants[i]) {
+        constantData[i] = constants[i]->data();
+        constantSizes[i] = constants[i]->size();
+      }
+    }
+
+    const size_t groupCount = static_cast<size_t>(threadGroupsX) * threadGroupsY * threadGroupsZ;
+
+    m_backend->GetThreadPool().ParallelFor(groupCount, [&](size_t groupIndex) {
+      HostThreadContext ctx = {};
+      ctx.buffers = buffers.data();
+      ctx.bufferSizes = bufferSizes.data();
+      ctx.bufferCount = static_cast<uint32_t>(buffers.size());
+      ctx.constants = constantData.data();
+      ctx.constantSizes = constantSizes.data();
+      ctx.constantCount = static_cast<uint32_t>(constantData.size());
+
+      ctx.groupID.x = static_cast<uint32_t>(groupIndex % threadGroupsX);
+      ctx.groupID.y = static_cast<uint32_t>((groupIndex / threadGroupsX) % threadGroupsY);
+      ctx.groupID.z = static_cast<uint32_t>(groupIndex / (static_cast<size_t>(threadGroupsX) * threadGroupsY));
+
+      for (uint32_t z = 0; z < numThreads.z; ++z) {
+        for (uint32_t y = 0; y < numThreads.y; ++y) {
+          for (uint32_t x = 0; x < numThreads.x; ++x) {
+            ctx.groupThreadID = {x, y, z};
+            ctx.dispatchThreadID = {
+              ctx.groupID.x * numThreads.x + x,
+              ctx.groupID.y * numThreads.y + y,
+              ctx.groupID.z * numThreads.z + z
+            };
+            function(ctx);
+          }
+        }
+      }
+    });
+  }
+
+  void CpuStream::SetKernel(IComputeKernel *kernel) {
+    m_currentKernel = static_cast<CpuKernel*>(kernel);
+  }
+
+  void CpuStream::SetBuffer(uint32_t slot, IGpuBuffer *buffer, size_t offset, size_t byteSize, BufferAccess) {
+    CheckBufferRange(buffer, offset, byteSize, "Bound range is outside the buffer.");
+    if (slot >= m_boundBuffers.size()) {
+      m_boundBuffers.resize(slot + 1);
+    }
+    m_boundBuffers[slot] = {static_cast<CpuBuffer*>(buffer), offset, byteSize};
+  }
+
+  void CpuStream::SetConstants(uint32_t slot, const void *data, size_t byteSize) {
+    // A new block rather than an update, dispatches recorded before keep theirs
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    if (slot >= m_boundConstants.size()) {
+      m_boundConstants.resize(slot + 1);
+    }
+    m_boundConstants[slot] = std::make_shared<const std::vector<uint8_t>>(bytes, bytes + byteSize);
+  }
+
+  void CpuStream::RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    if (!m_currentKernel) {
+      throw std::runtime_error("No kernel set before dispatch.");
+    }
+    if (threadGroupsX == 0 || threadGroupsY == 0 || threadGroupsZ == 0) {
+      return;
+    }
+
+    // Snapshot the bindings, later SetBuffer() calls must not affect this dispatch
+    std::vector<void*> buffers(m_boundBuffers.size(), nullptr);
+    std::vector<size_t> bufferSizes(m_boundBuffers.size(), 0);
+    for (size_t i = 0; i < m_boundBuffers.size(); ++i) {
+      if (const BoundBuffer& bound = m_boundBuffers[i]; bound.buffer) {
+        buffers[i] = bound.buffer->GetData() + bound.offset;
+        bufferSizes[i] = bound.byteSize;
+      }
+    }
+
+    const CpuKernel* kernel = m_currentKernel;
+    record([this, kernel, buffers = std::move(buffers), bufferSizes = std::move(bufferSizes), constants = m_boundConstants,
+                              threadGroupsX, threadGroupsY, threadGroupsZ] {
+      executeDispatch(kernel, buffers, bufferSizes, constants, threadGroupsX, threadGroupsY, threadGroupsZ);
+    });
+  }
+
+  void CpuStream::ResourceCopyBuffer(IGpuBuffer *dest, size_t destOffset, IGpuBuffer *src, size_t srcOffset, size_t byteSize) {
+    CpuBuffer* cpuDest = static_cast<CpuBuffer*>(dest);
+    CpuBuffer* cpuSrc = static_cast<CpuBuffer*>(src);
+    CheckBufferRange(cpuDest, destOffset, byteSize, "Copy destination range is outside the buffer.");
+    CheckBufferRange(cpuSrc, srcOffset, byteSize, "Copy source range is outside the buffer.");
+    if (cpuDest == cpuSrc && destOffset < srcOffset + byteSize && srcOffset < destOffset + byteSize) {
+      throw std::runtime_error("Copy source and destination ranges overlap.");
+    }
+
+    record([cpuDest, destOffset, cpuSrc, srcOffset, byteSize] {
+      std::memcpy(cpuDest->GetData() + destOffset, cpuSrc->GetData() + srcOffset, byteSize);
+    });
+  }
+
+  void CpuStream::ResourceUpload(IGpuBuffer *dest, size_t destOffset, const void *srcData, size_t byteSize) {
+    CpuBuffer* cpuDest = static_cast<CpuBuffer*>(dest);
+    CheckBufferRange(cpuDest, destOffset, byteSize, "Upload range is outside the destination buffer.");
+
+    // Like the GPU backends, the source data is captured at record time
+    const auto* bytes = static_cast<const std::byte*>(srcData);
+    std::vector<std::byte> staging(bytes, bytes + byteSize);
+
+    record([cpuDest, destOffset, staging = std::move(staging)] {
+      std::memcpy(cpuDest->GetData() + destOffset, staging.data(), staging.size());
+    });
+  }
+
+  std::shared_ptr<ReadbackCopy> CpuStream::ResourceDownload(const void *destData, IGpuBuffer *src, size_t srcOffset, size_t byteSize) {
+    CpuBuffer* cpuSrc = static_cast<CpuBuffer*>(src);
+    CheckBufferRange(cpuSrc, srcOffset, byteSize, "Download range is outside the source buffer.");
+
+    void* dest = const_cast<void*>(destData);
+    record([dest, cpuSrc, srcOffset, byteSize] {
+      std::memcpy(dest, cpuSrc->GetData() + srcOffset, byteSize);
+    });
+    return nullptr; // The worker copies straight into dest
+  }
+
+  void CpuStream::record(Command command) {
+    m_recording.push_back(std::move(command));
+    // Submit() signals the next value, which covers everything recorded so far
+    m_recordedValue = m_fenceValue;
+  }
+
+  void CpuStream::Submit() {
+    if (m_recording.empty()) {
+      return;
+    }
+
+    const uint64_t fenceValue = m_fenceValue++;
+    {
+      std::lock_guard<std::mutex> lock(m_queueMutex);
+      m_submitted.push_back(Batch{std::move(m_recording), fenceValue});
+    }
+    m_queueCondition.notify_one();
+
+    m_recording.clear();
+    m_submittedValue = fenceValue;
+    m_recordedValue = fenceValue;
+
+    // Bound how far the recording thread runs ahead of the worker
+    m_inFlightValues.push_back(fenceValue);
+    if (m_inFlightValues.size() > m_maxInFlight) {
+      m_fence->Wait(m_inFlightValues.front());
+      m_inFlightValues.pop_front();
+    }
+  }
+
+  uint64_t CpuStream::GetRecordedFenceValue() const {
+    return m_recordedValue;
+  }
+
+  uint64_t CpuStream::GetSubmittedFenceValue() const {
+    return m_submittedValue;
+  }
+
+  uint64_t CpuStream::GetCompletedFenceValue() const {
+    return m_fence->GetCompletedValue();
+  }
+
+  void CpuStream::WaitForSubmitted() {
+    m_fence->Wait(m_submittedValue);
+  }
+
+  bool CpuStream::HostWait(uint32_t timeoutMs) {
+    if (timeoutMs == kInfiniteTimeout) {
+      WaitForSubmitted();
+    } else if (!m_fence->Wait(m_submittedValue, std::chrono::milliseconds(timeoutMs))) {
+      return false;
+    }
+
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock(m_errorMutex);
+      std::swap(error, m_error);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return true;
+  }
+
+  void CpuStream::StreamWait(IComputeEvent *event) {
+    auto [fence, valueToWaitFor] = static_cast<CpuEvent*>(event)->Get();
+    if (!fence || fence == m_fence) {
+      return; // Never recorded, or recorded earlier on this stream
+    }
+
+    record([fence, valueToWaitFor] {
+      fence->Wait(valueToWaitFor);
+    });
+  }
+
+  void CpuStream::RecordEvent(IComputeEvent *event) {
+    CpuEvent* cpuEvent = static_cast<CpuEvent*>(event);
+    if (m_recording.empty()) {
+      // Nothing new since the last Submit(), whose value already marks this point
+      cpuEvent->Set(m_fence, m_submittedValue);
+      return;
+    }
+
+    const uint64_t valueToSignal = m_fenceValue++;
+    record([fence = m_fence.get(), valueToSignal] {
+      fence->Signal(valueToSignal);
+    });
+    cpuEvent->Set(m_fence, valueToSignal);
+  }
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "d3d12_backend.h"
 
 #if defined(AEGIS_ENABLE_D3D12)
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
@@ -13,27 +14,98 @@
 
 #include "d3d12_buffer.h"
 #include "d3d12_event.h"
+#include "d3d12_graph.h"
 #include "d3d12_kernel.h"
 #include "d3d12_stream.h"
 
 namespace aegis::internal {
-  std::unique_ptr<D3D12Backend> D3D12Backend::Create() {
-    auto backend = std::unique_ptr<D3D12Backend>(new D3D12Backend());
+  namespace {
+    /**
+     * @brief The DXC objects of one thread. A compiler instance must not
+     * run two compiles at once, so every compiling thread gets its own.
+     */
+    struct DxcInstances {
+      ComPtr<IDxcUtils> utils;
+      ComPtr<IDxcCompiler3> compiler;
+      ComPtr<IDxcIncludeHandler> includeHandler;
+    };
+
+    DxcInstances& threadDxcInstances() {
+      thread_local DxcInstances instances;
+      if (!instances.includeHandler) {
+        ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&instances.utils)));
+        ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instances.compiler)));
+        ThrowIfFailed(instances.utils->CreateDefaultIncludeHandler(&instances.includeHandler));
+      }
+      return instances;
+    }
+
+    /**
+     * @brief Waits on several fences at once, see WaitForFence().
+     * @return false if the timeout expired first.
+     */
+    bool waitForFences(ID3D12Device5* device, ID3D12Fence* const* fences, const UINT64* values, UINT count,
+                       D3D12_MULTIPLE_FENCE_WAIT_FLAGS flags, uint32_t timeoutMs) {
+      if (timeoutMs == kInfiniteTimeout) {
+        // Without an event handle this blocks until the fences get there
+        ThrowIfFailed(device->SetEventOnMultipleFenceCompletion(fences, values, count, flags, nullptr));
+        return true;
+      }
+
+      HANDLE event = _CreateEvent(nullptr, FALSE, FALSE, nullptr);
+      if (event == nullptr) {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+      }
+      const HRESULT hr = device->SetEventOnMultipleFenceCompletion(fences, values, count, flags, event);
+      const DWORD result = SUCCEEDED(hr) ? WaitForSingleObject(event, timeoutMs) : WAIT_FAILED;
+      CloseHandle(event);
+      ThrowIfFailed(hr);
+      return result == WAIT_OBJECT_0;
+    }
+  }
+
+  bool WaitForFence(ID3D12Fence* fence, UINT64 value, uint32_t timeoutMs) {
+    if (fence->GetCompletedValue() >= value) {
+      return true;
+    }
+    if (timeoutMs == kInfiniteTimeout) {
+      ThrowIfFailed(fence->SetEventOnCompletion(value, nullptr));
+      return true;
+    }
+    if (timeoutMs == 0) {
+      return false;
+    }
+
+    HANDLE event = _CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (event == nullptr) {
+      ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+    const HRESULT hr = fence->SetEventOnCompletion(value, event);
+    const DWORD result = SUCCEEDED(hr) ? WaitForSingleObject(event, timeoutMs) : WAIT_FAILED;
+    CloseHandle(event);
+    ThrowIfFailed(hr);
+    return result == WAIT_OBJECT_0;
+  }
+
+  std::unique_ptr<D3D12Backend> D3D12Backend::Create(const ContextDesc& desc) {
+    auto backend = std::unique_ptr<D3D12Backend>(new D3D12Backend(desc));
     if (!backend->Initialize()) {
       return nullptr;
     }
     return backend;
   }
 
-  D3D12Backend::D3D12Backend() : m_masterFenceValue(0), m_fenceEvent(nullptr) {}
+  D3D12Backend::D3D12Backend(const ContextDesc& desc) :
+      m_kernelCache(std::make_unique<KernelCache>(desc.kernelCacheDirectory)), m_pipelineLibraryDirty(false),
+      m_memoryBlockSize(desc.memoryBlockSize), m_deviceHostVisibleHeap{},
+      m_maxQueuesPerPool(std::max<uint32_t>(desc.maxHardwareQueues, 1)) {}
 
   D3D12Backend::~D3D12Backend() {
-    /*if (m_masterCommandQueue) {
-      // Wait for all final commands to finish before releasing resources
-      WaitForIdle();
-    }*/
-    if (m_fenceEvent) {
-      CloseHandle(m_fenceEvent);
+    if (m_pipelineLibrary && m_pipelineLibraryDirty) {
+      std::vector<uint8_t> data(m_pipelineLibrary->GetSerializedSize());
+      if (SUCCEEDED(m_pipelineLibrary->Serialize(data.data(), data.size()))) {
+        m_kernelCache->WriteFile(m_pipelineLibraryName, data.data(), data.size());
+      }
     }
   }
 
@@ -61,23 +133,31 @@ namespace aegis::internal {
           D3D_FEATURE_LEVEL_12_0,
           IID_PPV_ARGS(&m_device)
       ));
+      queryCapabilities(hardwareAdapter.Get());
 
-      /*D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-      queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-      queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-      ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_masterCommandQueue)));*/
+      // Buffers in a DEFAULT heap are placed resources carved out of big heaps
+      // instead of committed resources with an implicit heap each
+      ID3D12Device5* device = m_device.Get();
+      m_deviceLocalAllocator = std::make_unique<MemoryAllocator>(
+          [device](size_t byteSize) -> std::unique_ptr<IMemoryHeap> {
+            D3D12_HEAP_DESC heapDesc = {};
+            heapDesc.SizeInBytes = byteSize;
+            heapDesc.Properties = D3D12_HEAP_PROPERTIES{D3D12_HEAP_TYPE_DEFAULT, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
+            heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+            heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
 
-      ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_masterFence)));
-      m_masterFenceValue = 1;
+            ComPtr<ID3D12Heap> heap;
+            if (FAILED(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)))) {
+              return nullptr;
+            }
+            return std::make_unique<D3D12Heap>(std::move(heap));
+          },
+          m_memoryBlockSize,
+          D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
 
-      m_fenceEvent = _CreateEvent(nullptr, FALSE, FALSE, nullptr);
-      if (m_fenceEvent == nullptr) {
-        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-      }
+      threadDxcInstances(); // Fails here if dxcompiler can't be loaded
 
-      ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_dxcUtils)));
-      ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_dxcCompiler)));
-      ThrowIfFailed(m_dxcUtils->CreateDefaultIncludeHandler(&m_dxcIncludeHandler));
+      openKernelCache(hardwareAdapter.Get());
     } catch (const std::runtime_error& e) {
       // TODO: log error
       return false;
@@ -108,21 +188,209 @@ namespace aegis::internal {
     return false;
   }
 
-  std::unique_ptr<IComputeStream> D3D12Backend::CreateStream() {
-    return std::make_unique<D3D12Stream>(this);
+  void D3D12Backend::queryCapabilities(IDXGIAdapter1 *adapter) {
+    DXGI_ADAPTER_DESC1 adapterDesc;
+    adapter->GetDesc1(&adapterDesc);
+
+    // Every D3D12 device has COPY queues, backed by the DMA engines
+    m_capabilities.dedicatedCopyQueue = true;
+
+    D3D12_FEATURE_DATA_ARCHITECTURE1 architecture = {};
+    if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE1, &architecture, sizeof(architecture)))) {
+      architecture = {};
+    }
+
+    if (architecture.UMA) {
+      // Integrated GPUs: "device" memory is system memory, so an L0 heap is
+      // as fast for the GPU and directly CPU-writable
+      m_deviceHostVisibleHeap = D3D12_HEAP_PROPERTIES{
+          D3D12_HEAP_TYPE_CUSTOM,
+          architecture.CacheCoherentUMA ? D3D12_CPU_PAGE_PROPERTY_WRITE_BACK : D3D12_CPU_PAGE_PROPERTY_WRITE_COMBINE,
+          D3D12_MEMORY_POOL_L0, 0, 0};
+      m_capabilities.unifiedMemory = true;
+      m_capabilities.deviceHostVisibleMemory = true;
+      m_capabilities.deviceHostVisibleBytes = adapterDesc.SharedSystemMemory;
+      return;
+    }
+
+#if defined(__ID3D12Device13_INTERFACE_DEFINED__) // SDKs that know GPU upload heaps
+    // Discrete GPUs with resizable BAR expose all of VRAM to the CPU
+    D3D12_FEATURE_DATA_D3D12_OPTIONS16 options16 = {};
+    if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS16, &options16, sizeof(options16))) &&
+        options16.GPUUploadHeapSupported) {
+      m_deviceHostVisibleHeap = D3D12_HEAP_PROPERTIES{D3D12_HEAP_TYPE_GPU_UPLOAD, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
+      m_capabilities.deviceHostVisibleMemory = true;
+      m_capabilities.deviceHostVisibleBytes = adapterDesc.DedicatedVideoMemory;
+    }
+#endif
+  }
+
+  IDxcCompiler3 *D3D12Backend::GetCompiler() {
+    return threadDxcInstances().compiler.Get();
+  }
+
+  IDxcUtils *D3D12Backend::GetUtils() {
+    return threadDxcInstances().utils.Get();
+  }
+
+  IDxcIncludeHandler *D3D12Backend::GetIncludeHandler() {
+    return threadDxcInstances().includeHandler.Get();
+  }
+
+  void D3D12Backend::openKernelCache(IDXGIAdapter1 *adapter) {
+    if (!m_kernelCache->IsEnabled()) {
+      return;
+    }
+
+    // Bytecode depends on the compiler, PSOs and root signatures on the
+    // adapter and its driver
+    std::string identity = "dxc";
+    ComPtr<IDxcVersionInfo> versionInfo;
+    if (SUCCEEDED(GetCompiler()->QueryInterface(IID_PPV_ARGS(&versionInfo)))) {
+      UINT32 major = 0, minor = 0;
+      versionInfo->GetVersion(&major, &minor);
+      identity += " " + std::to_string(major) + "." + std::to_string(minor);
+    }
+    ComPtr<IDxcVersionInfo2> commitInfo;
+    if (SUCCEEDED(GetCompiler()->QueryInterface(IID_PPV_ARGS(&commitInfo)))) {
+      UINT32 commitCount = 0;
+      char* commitHash = nullptr;
+      if (SUCCEEDED(commitInfo->GetCommitInfo(&commitCount, &commitHash))) {
+        identity += std::string("+") + (commitHash ? commitHash : "") + "." + std::to_string(commitCount);
+        CoTaskMemFree(commitHash);
+      }
+    }
+
+    DXGI_ADAPTER_DESC1 adapterDesc;
+    adapter->GetDesc1(&adapterDesc);
+    LARGE_INTEGER driverVersion = {};
+    adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+    const std::string adapterIdentity = std::to_string(adapterDesc.VendorId) + ":" + std::to_string(adapterDesc.DeviceId) + ":" +
+                                        std::to_string(adapterDesc.SubSysId) + ":" + std::to_string(adapterDesc.Revision) +
+                                        " driver " + std::to_string(driverVersion.QuadPart);
+    m_kernelCacheIdentity = identity + " " + adapterIdentity;
+
+    // A library from another driver or a corrupt file fails to open, start an empty one then
+    m_pipelineLibraryName = "pipelines-" + HashToString(HashBytes(adapterIdentity.data(), adapterIdentity.size())) + ".bin";
+    if (auto data = m_kernelCache->ReadFile(m_pipelineLibraryName)) {
+      m_pipelineLibraryData = std::move(*data);
+      if (FAILED(m_device->CreatePipelineLibrary(m_pipelineLibraryData.data(), m_pipelineLibraryData.size(),
+                                                 IID_PPV_ARGS(&m_pipelineLibrary)))) {
+        m_pipelineLibrary = nullptr;
+        m_pipelineLibraryData.clear();
+      }
+    }
+    if (!m_pipelineLibrary && FAILED(m_device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_pipelineLibrary)))) {
+      m_pipelineLibrary = nullptr; // Not supported (e.g., some debugging layers), PSOs are just not cached
+    }
+  }
+
+  ComPtr<ID3D12PipelineState> D3D12Backend::CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc,
+                                                                        const std::wstring &name) {
+    ComPtr<ID3D12PipelineState> pso;
+    if (m_pipelineLibrary) {
+      std::lock_guard<std::mutex> lock(m_pipelineLibraryMutex);
+      if (SUCCEEDED(m_pipelineLibrary->LoadComputePipeline(name.c_str(), &desc, IID_PPV_ARGS(&pso)))) {
+        return pso;
+      }
+    }
+
+    // The driver compiles here, other threads can keep using the library
+    ThrowIfFailed(m_device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+
+    if (m_pipelineLibrary) {
+      // Fails if another thread stored the same name first, which is fine
+      std::lock_guard<std::mutex> lock(m_pipelineLibraryMutex);
+      if (SUCCEEDED(m_pipelineLibrary->StorePipeline(name.c_str(), pso.Get()))) {
+        m_pipelineLibraryDirty = true;
+      }
+    }
+    return pso;
+  }
+
+  ComPtr<ID3D12CommandQueue> D3D12Backend::AcquireQueue(D3D12_COMMAND_LIST_TYPE type, StreamPriority priority) {
+    std::lock_guard<std::mutex> lock(m_queuesMutex);
+
+    PooledQueue* leastUsed = nullptr;
+    uint32_t poolSize = 0;
+    for (auto& pooled : m_queues) {
+      if (pooled.type != type || pooled.priority != priority) {
+        continue;
+      }
+      ++poolSize;
+      if (!leastUsed || pooled.streamCount < leastUsed->streamCount) {
+        leastUsed = &pooled;
+      }
+    }
+
+    if (!leastUsed || (leastUsed->streamCount > 0 && poolSize < m_maxQueuesPerPool)) {
+      D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+      queueDesc.Type = type;
+      queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+      switch (priority) {
+        case StreamPriority::HIGH: queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_HIGH; break;
+        case StreamPriority::REALTIME: queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_GLOBAL_REALTIME; break;
+        default: queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL; break;
+      }
+
+      ComPtr<ID3D12CommandQueue> queue;
+      HRESULT hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue));
+      if (FAILED(hr) && priority == StreamPriority::REALTIME) {
+        // Realtime queues need SeIncreaseBasePriorityPrivilege
+        queueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_HIGH;
+        hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue));
+      }
+      ThrowIfFailed(hr);
+
+      ComPtr<ID3D12Fence> idleFence;
+      ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&idleFence)));
+
+      m_queues.push_back({std::move(queue), type, priority, 0, std::move(idleFence), 0});
+      leastUsed = &m_queues.back();
+    }
+
+    leastUsed->streamCount++;
+    return leastUsed->queue;
+  }
+
+  void D3D12Backend::ReleaseQueue(ID3D12CommandQueue *queue) {
+    std::lock_guard<std::mutex> lock(m_queuesMutex);
+    for (auto& pooled : m_queues) {
+      if (pooled.queue.Get() == queue) {
+        pooled.streamCount--;
+        return;
+      }
+    }
+  }
+
+  std::unique_ptr<IComputeStream> D3D12Backend::CreateStream(const StreamDesc& desc) {
+    return std::make_unique<D3D12Stream>(this, desc);
   }
 
   std::unique_ptr<IComputeEvent> D3D12Backend::CreateEvent() {
     return std::make_unique<D3D12Event>(this);
   }
 
+  std::unique_ptr<IComputeGraph> D3D12Backend::CreateGraph(std::vector<GraphNode> nodes) {
+    return std::make_unique<D3D12Graph>(this, std::move(nodes));
+  }
+
   std::unique_ptr<IGpuBuffer> D3D12Backend::CreateBuffer(size_t byteSize, GpuMemoryType type) {
     return std::make_unique<D3D12Buffer>(this, byteSize, type);
   }
 
-  std::unique_ptr<IComputeKernel> D3D12Backend::CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint) {
+  std::unique_ptr<IGpuBuffer> D3D12Backend::ImportHostMemory(void* hostPointer, size_t byteSize) {
+    try {
+      return std::make_unique<D3D12Buffer>(this, hostPointer, byteSize);
+    } catch (const std::runtime_error&) {
+      return nullptr; // Not VirtualAlloc()'d memory, or no driver support
+    }
+  }
+
+  std::unique_ptr<IComputeKernel> D3D12Backend::CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                             const KernelDefines& defines, const KernelCompileOptions& options) {
     //try {
-      return D3D12Kernel::Create(this, hlslFilePath, entryPoint);
+      return D3D12Kernel::Create(this, hlslFilePath, entryPoint, defines, options);
     //} catch (const std::exception& e) {
       //std::cout << e.what() << std::endl;
       // TODO: log this error like "shader compilation failed".
@@ -130,19 +398,97 @@ namespace aegis::internal {
     //}
   }
 
+  std::unique_ptr<IComputeKernel> D3D12Backend::CreateKernelFromSource(const std::string& hlslSource, const std::string& sourceName,
+                                                                       const std::string& entryPoint, const KernelDefines& defines,
+                                                                       const KernelCompileOptions& options) {
+    return D3D12Kernel::CreateFromSource(this, hlslSource, sourceName, entryPoint, defines, options);
+  }
+
+  std::unique_ptr<IComputeKernel> D3D12Backend::CreateKernelFromBytecode(const KernelBytecode& bytecode) {
+    if (!bytecode.dxil || bytecode.dxilSize == 0) {
+      throw std::runtime_error("Kernel bytecode has no DXIL for the D3D12 backend.");
+    }
+    return D3D12Kernel::CreateFromBytecode(this, bytecode);
+  }
+
+  MemoryStats D3D12Backend::GetMemoryStats() const {
+    return m_deviceLocalAllocator ? m_deviceLocalAllocator->GetStats() : MemoryStats{};
+  }
+
   void D3D12Backend::WaitForIdle() {
-    // Stop the world
-    /*std::lock_guard<std::mutex> queueLock(m_queueMutex);
-    std::lock_guard<std::mutex> lock(m_fenceMutex);
-
-    const UINT64 fenceValueToSignal = m_masterFenceValue;
-    ThrowIfFailed(m_masterCommandQueue->Signal(m_masterFence.Get(), fenceValueToSignal));
-    m_masterFenceValue++;
-
-    if (m_masterFence->GetCompletedValue() < fenceValueToSignal) {
-      ThrowIfFailed(m_masterFence->SetEventOnCompletion(fenceValueToSignal, m_fenceEvent));
-      WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
-    }*/
+    // Stop the world: mark the end of every queue, then wait for all the marks at once
+    std::vector<ID3D12Fence*> fences;
+    std::vector<UINT64> values;
+    {
+      std::lock_guard<std::mutex> lock(m_queuesMutex);
+      for (auto& pooled : m_queues) {
+        const UINT64 value = ++pooled.idleFenceValue;
+        ThrowIfFailed(pooled.queue->Signal(pooled.idleFence.Get(), value));
+        fences.push_back(pooled.idleFence.Get());
+        values.push_back(value);
+      }
+    }
+    if (fences.empty()) {
+      return;
+    }
+
+    waitForFences(m_device.Get(), fences.data(), values.data(), static_cast<UINT>(fences.size()),
+                  D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL, kInfiniteTimeout);
+  }
+
+  size_t D3D12Backend::WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) {
+    std::vector<ComPtr<ID3D12Fence>> fences; // Keeps the fences alive
+    std::vector<ID3D12Fence*> rawFences;
+    std::vector<UINT64> values;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < count; ++i) {
+      auto [fence, value] = static_cast<D3D12Event*>(events[i])->Get();
+      if (!fence) {
+        if (!waitAll) return i;
+        continue;
+      }
+      rawFences.push_back(fence.Get());
+      values.push_back(value);
+      indices.push_back(i);
+      fences.push_back(std::move(fence));
+    }
+    if (rawFences.empty()) {
+      return 0;
+    }
+
+    const bool reached = waitForFences(m_device.Get(), rawFences.data(), values.data(), static_cast<UINT>(rawFences.size()),
+                                       waitAll ? D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL : D3D12_MULTIPLE_FENCE_WAIT_FLAG_ANY,
+                                       timeoutMs);
+    if (!reached) {
+      return count;
+    }
+    if (waitAll) {
+      return 0;
+    }
+    for (size_t i = 0; i < rawFences.size(); ++i) {
+      if (rawFences[i]->GetCompletedValue() >= values[i]) {
+        return indices[i];
+      }
+    }
+    return indices.front(); // Unreachable, the wait returned
+  }
+
+  std::unique_ptr<IComputeEvent> D3D12Backend::CreateHostEvent() {
+    ComPtr<ID3D12Fence> fence;
+    ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+
+    auto event = std::make_unique<D3D12Event>(this);
+    event->Set(std::move(fence), 1);
+    return event;
+  }
+
+  void D3D12Backend::SignalHostEvent(IComputeEvent *event) {
+    auto [fence, value] = static_cast<D3D12Event*>(event)->Get();
+    ThrowIfFailed(fence->Signal(value));
+  }
+
+  void D3D12Backend::ResetHostEvent(IComputeEvent *event) {
+    static_cast<D3D12Event*>(event)->Advance();
   }
 }
 
@@ -11,6 +11,10 @@ namespace aegis::internal {
         return D3D12_HEAP_PROPERTIES{D3D12_HEAP_TYPE_UPLOAD, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
       case GpuMemoryType::READBACK:
         return D3D12_HEAP_PROPERTIES{D3D12_HEAP_TYPE_READBACK, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
+      case GpuMemoryType::HOST:
+        // Like READBACK (cached system memory), but without the fixed
+        // COPY_DEST state, so it can be a copy source too
+        return D3D12_HEAP_PROPERTIES{D3D12_HEAP_TYPE_CUSTOM, D3D12_CPU_PAGE_PROPERTY_WRITE_BACK, D3D12_MEMORY_POOL_L0, 0, 0};
       // case GpuMemoryType::DEVICE_LOCAL:
       default:
         return D3D12_HEAP_PROPERTIES{D3D12_HEAP_TYPE_DEFAULT, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
@@ -29,15 +33,11 @@ namespace aegis::internal {
     }
   }
 
-  D3D12Buffer::D3D12Buffer(D3D12Backend *backend, size_t byteSize, GpuMemoryType type) : m_backend(backend), m_byteSize(byteSize), m_mappedPtr(nullptr), m_memoryType(type) {
-    auto device = backend->GetDevice();
-    auto heapProps = GetHeapProperties(type);
-    m_currentState = GetInitialState(type);
-
+  D3D12_RESOURCE_DESC GetBufferDesc(size_t byteSize, D3D12_RESOURCE_FLAGS flags) {
     D3D12_RESOURCE_DESC bufferDesc = {};
     bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
     bufferDesc.Alignment = 0;
-    bufferDesc.Width = m_byteSize;
+    bufferDesc.Width = byteSize;
     bufferDesc.Height = 1;
     bufferDesc.DepthOrArraySize = 1;
     bufferDesc.MipLevels = 1;
@@ -45,16 +45,68 @@ namespace aegis::internal {
     bufferDesc.SampleDesc.Count = 1;
     bufferDesc.SampleDesc.Quality = 0;
     bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    bufferDesc.Flags = flags;
+    return bufferDesc;
+  }
+
+  D3D12Buffer::D3D12Buffer(D3D12Backend *backend, size_t byteSize, GpuMemoryType type) : m_backend(backend), m_byteSize(byteSize), m_mappedPtr(nullptr), m_memoryType(type), m_hostPointer(nullptr) {
+    auto device = backend->GetDevice();
+    auto heapProps = type == GpuMemoryType::DEVICE_HOST_VISIBLE ? backend->GetDeviceHostVisibleHeapProperties() : GetHeapProperties(type);
+    m_currentState = GetInitialState(type);
+
+    const bool isDeviceMemory = type == GpuMemoryType::DEVICE_LOCAL || type == GpuMemoryType::DEVICE_HOST_VISIBLE;
+    const D3D12_RESOURCE_DESC bufferDesc = GetBufferDesc(m_byteSize,
+        isDeviceMemory ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE);
 
     if (type == GpuMemoryType::DEVICE_LOCAL) {
-      bufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+      // Placed resources start with undefined contents, unlike committed ones
+      const D3D12_RESOURCE_ALLOCATION_INFO allocInfo = device->GetResourceAllocationInfo(0, 1, &bufferDesc);
+      m_allocation = backend->GetDeviceLocalAllocator().Allocate(allocInfo.SizeInBytes, allocInfo.Alignment);
+      if (!m_allocation) {
+        throw std::runtime_error("Failed to allocate a D3D12 heap.");
+      }
+
+      HRESULT hr = device->CreatePlacedResource(
+          static_cast<D3D12Heap*>(m_allocation.heap)->GetHeap(),
+          m_allocation.offset,
+          &bufferDesc,
+          m_currentState,
+          nullptr,
+          IID_PPV_ARGS(&m_resource)
+      );
+      if (FAILED(hr)) {
+        backend->GetDeviceLocalAllocator().Free(m_allocation);
+        ThrowIfFailed(hr);
+      }
     } else {
-      bufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+      ThrowIfFailed(device->CreateCommittedResource(
+          &heapProps,
+          D3D12_HEAP_FLAG_NONE,
+          &bufferDesc,
+          m_currentState,
+          nullptr,
+          IID_PPV_ARGS(&m_resource)
+      ));
+    }
+  }
+
+  D3D12Buffer::D3D12Buffer(D3D12Backend *backend, void *hostPointer, size_t byteSize) :
+      m_backend(backend), m_byteSize(byteSize), m_mappedPtr(nullptr), m_memoryType(GpuMemoryType::HOST),
+      m_currentState(D3D12_RESOURCE_STATE_COMMON), m_hostPointer(hostPointer) {
+    auto device = backend->GetDevice();
+
+    // The heap wraps the whole VirtualAlloc() region the pointer starts
+    ThrowIfFailed(device->OpenExistingHeapFromAddress(hostPointer, IID_PPV_ARGS(&m_importedHeap)));
+    const D3D12_HEAP_DESC heapDesc = m_importedHeap->GetDesc();
+    if (heapDesc.SizeInBytes < byteSize) {
+      throw std::runtime_error("Imported host memory is smaller than requested.");
     }
 
-    ThrowIfFailed(device->CreateCommittedResource(
-        &heapProps,
-        D3D12_HEAP_FLAG_NONE,
+    const D3D12_RESOURCE_DESC bufferDesc = GetBufferDesc(m_byteSize,
+        (heapDesc.Flags & D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER) ? D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER : D3D12_RESOURCE_FLAG_NONE);
+    ThrowIfFailed(device->CreatePlacedResource(
+        m_importedHeap.Get(),
+        0,
         &bufferDesc,
         m_currentState,
         nullptr,
@@ -66,6 +118,9 @@ namespace aegis::internal {
     if (m_mappedPtr) {
       Unmap();
     }
+    // The placed resource has to go before its range can be reused
+    m_resource.Reset();
+    m_backend->GetDeviceLocalAllocator().Free(m_allocation);
   }
 
   size_t D3D12Buffer::GetSizeInBytes() const {
@@ -73,11 +128,14 @@ namespace aegis::internal {
   }
 
   void *D3D12Buffer::Map() {
+    if (m_hostPointer) {
+      return m_hostPointer; // Imported memory is the user's own
+    }
     if (m_mappedPtr) {
       return m_mappedPtr;
     }
     D3D12_RANGE readRange{0, 0};
-    if (m_memoryType == GpuMemoryType::READBACK) {
+    if (m_memoryType == GpuMemoryType::READBACK || m_memoryType == GpuMemoryType::HOST) {
       readRange.End = m_byteSize;
     }
 
@@ -86,8 +144,12 @@ namespace aegis::internal {
   }
 
   void D3D12Buffer::Unmap() {
+    if (m_hostPointer || !m_mappedPtr) {
+      return;
+    }
     D3D12_RANGE writeRange{0, 0};
-    if (m_memoryType == GpuMemoryType::UPLOAD) {
+    if (m_memoryType == GpuMemoryType::UPLOAD || m_memoryType == GpuMemoryType::HOST ||
+        m_memoryType == GpuMemoryType::DEVICE_HOST_VISIBLE) {
       writeRange.End = m_byteSize;
     }
 
@@ -4,16 +4,48 @@
 #include <stdexcept>
 
 namespace aegis::internal {
-   D3D12Event::D3D12Event(D3D12Backend *backend) : m_backend(backend), m_fenceValue(0) {
-     auto device = backend->GetDevice();
-     ThrowIfFailed(device->CreateFence(
-        0, // Initial value
-        D3D12_FENCE_FLAG_NONE,
-        IID_PPV_ARGS(&m_fence)
-    ));
-   }
+   D3D12Event::D3D12Event(D3D12Backend *backend) : m_backend(backend), m_value(0) {}
 
    D3D12Event::~D3D12Event() {  }
+
+   void D3D12Event::Set(ComPtr<ID3D12Fence> fence, UINT64 value, std::shared_ptr<SubmissionTimeline> submission) {
+     std::lock_guard<std::mutex> lock(m_mutex);
+     m_fence = std::move(fence);
+     m_value = value;
+     m_submission = std::move(submission);
+   }
+
+   std::pair<ComPtr<ID3D12Fence>, UINT64> D3D12Event::Get() const {
+     std::lock_guard<std::mutex> lock(m_mutex);
+     return {m_fence, m_value};
+   }
+
+   std::shared_ptr<SubmissionTimeline> D3D12Event::GetSubmission() const {
+     std::lock_guard<std::mutex> lock(m_mutex);
+     return m_submission;
+   }
+
+   void D3D12Event::Advance() {
+     std::lock_guard<std::mutex> lock(m_mutex);
+     m_value++;
+   }
+
+   bool D3D12Event::IsComplete() const {
+     auto [fence, value] = Get();
+     return !fence || fence->GetCompletedValue() >= value;
+   }
+
+   uint64_t D3D12Event::GetFenceValue() const {
+     std::lock_guard<std::mutex> lock(m_mutex);
+     return m_value;
+   }
+
+   std::unique_ptr<IComputeEvent> D3D12Event::Clone() const {
+     auto clone = std::make_unique<D3D12Event>(m_backend);
+     auto [fence, value] = Get();
+     clone->Set(std::move(fence), value, GetSubmission());
+     return clone;
+   }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "d3d12_graph.h"
+#include "d3d12_buffer.h"
+#include "d3d12_kernel.h"
+
+#if defined(AEGIS_ENABLE_D3D12)
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace aegis::internal {
+  namespace {
+    constexpr size_t kRootViewAlignment = 4; // Root UAV addresses must be DWORD aligned
+    constexpr size_t kArgumentAlignment = 8; // Keeps the addresses in the argument buffer 8-byte aligned
+  }
+
+  D3D12Graph::D3D12Graph(D3D12Backend *backend, std::vector<GraphNode> nodes) :
+      CapturedGraph(std::move(nodes)), m_backend(backend), m_argumentsDirty(true), m_currentRecording(SIZE_MAX) {
+    // Nodes with the same root signature and slots share a command signature
+    struct Layout {
+      ID3D12RootSignature* rootSignature;
+      std::vector<uint32_t> slots;
+      ComPtr<ID3D12CommandSignature> signature;
+    };
+    std::vector<Layout> layouts;
+
+    size_t argumentSize = 0;
+    for (const GraphNode& node : m_nodes) {
+      std::vector<uint32_t> slots;
+      for (const GraphBinding& binding : node.bindings) {
+        if (binding.offset % kRootViewAlignment != 0) {
+          throw std::runtime_error("Bound range offset is not 4-byte aligned.");
+        }
+        slots.push_back(binding.slot);
+      }
+
+      ID3D12RootSignature* rootSignature = static_cast<D3D12Kernel*>(node.kernel)->GetRootSignature();
+      const size_t stride = slots.size() * sizeof(D3D12_GPU_VIRTUAL_ADDRESS) + sizeof(D3D12_DISPATCH_ARGUMENTS);
+
+      auto layout = std::find_if(layouts.begin(), layouts.end(), [&](const Layout& l) {
+        return l.rootSignature == rootSignature && l.slots == slots;
+      });
+      if (layout == layouts.end()) {
+        // The root UAVs first, the dispatch must be the last argument
+        std::vector<D3D12_INDIRECT_ARGUMENT_DESC> arguments(slots.size() + 1);
+        for (size_t i = 0; i < slots.size(); ++i) {
+          arguments[i].Type = D3D12_INDIRECT_ARGUMENT_TYPE_UNORDERED_ACCESS_VIEW;
+          arguments[i].UnorderedAccessView.RootParameterIndex = slots[i];
+        }
+        arguments.back().Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+
+        D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+        signatureDesc.ByteStride = static_cast<UINT>(stride);
+        signatureDesc.NumArgumentDescs = static_cast<UINT>(arguments.size());
+        signatureDesc.pArgumentDescs = arguments.data();
+
+        ComPtr<ID3D12CommandSignature> signature;
+        ThrowIfFailed(m_backend->GetDevice()->CreateCommandSignature(&signatureDesc, rootSignature, IID_PPV_ARGS(&signature)));
+        layouts.push_back({rootSignature, std::move(slots), std::move(signature)});
+        layout = std::prev(layouts.end());
+      }
+      m_signatures.push_back(layout->signature);
+
+      argumentSize = (argumentSize + kArgumentAlignment - 1) / kArgumentAlignment * kArgumentAlignment;
+      m_argumentOffsets.push_back(argumentSize);
+      argumentSize += stride;
+    }
+
+    m_arguments.resize(argumentSize);
+    for (size_t node = 0; node < m_nodes.size(); ++node) {
+      for (size_t i = 0; i < m_nodes[node].bindings.size(); ++i) {
+        writeAddress(node, i);
+      }
+      writeDispatch(node);
+    }
+    if (argumentSize > 0) {
+      m_argumentBuffer = m_backend->CreateBuffer(argumentSize, GpuMemoryType::DEVICE_LOCAL);
+    }
+
+    updateBarriers();
+  }
+
+  D3D12Buffer *D3D12Graph::GetArgumentBuffer() const {
+    return static_cast<D3D12Buffer*>(m_argumentBuffer.get());
+  }
+
+  void D3D12Graph::SetBuffer(size_t node, uint32_t slot, IGpuBuffer *buffer, size_t offset, size_t byteSize) {
+    if (offset % kRootViewAlignment != 0) {
+      throw std::runtime_error("Bound range offset is not 4-byte aligned.");
+    }
+    CapturedGraph::SetBuffer(node, slot, buffer, offset, byteSize);
+
+    const GraphBinding& binding = findBinding(node, slot);
+    writeAddress(node, &binding - m_nodes[node].bindings.data());
+    m_argumentsDirty = true;
+
+    // A new buffer may add or remove a hazard
+    if (updateBarriers()) {
+      m_currentRecording = SIZE_MAX;
+    }
+  }
+
+  void D3D12Graph::SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    CapturedGraph::SetDispatchSize(node, threadGroupsX, threadGroupsY, threadGroupsZ);
+    writeDispatch(node);
+    m_argumentsDirty = true;
+  }
+
+  const std::vector<uint8_t> *D3D12Graph::TakeDirtyArguments() {
+    if (!m_argumentsDirty) {
+      return nullptr;
+    }
+    m_argumentsDirty = false;
+    return &m_arguments;
+  }
+
+  void D3D12Graph::writeAddress(size_t node, size_t bindingIndex) {
+    const GraphBinding& binding = m_nodes[node].bindings[bindingIndex];
+    const D3D12_GPU_VIRTUAL_ADDRESS address = static_cast<D3D12Buffer*>(binding.buffer)->GetGpuVirtualAddress() + binding.offset;
+    std::memcpy(m_arguments.data() + m_argumentOffsets[node] + bindingIndex * sizeof(address), &address, sizeof(address));
+  }
+
+  void D3D12Graph::writeDispatch(size_t node) {
+    const GraphNode& n = m_nodes[node];
+    const D3D12_DISPATCH_ARGUMENTS dispatch = {n.threadGroups[0], n.threadGroups[1], n.threadGroups[2]};
+    std::memcpy(m_arguments.data() + m_argumentOffsets[node] + n.bindings.size() * sizeof(D3D12_GPU_VIRTUAL_ADDRESS),
+                &dispatch, sizeof(dispatch));
+  }
+
+  bool D3D12Graph::updateBarriers() {
+    // A node that overlaps a range an earlier node used, with either of
+    // them writing, is a hazard. A UAV barrier covers everything before
+    // it, nodes between two barriers run unordered.
+    auto conflicts = [](const GraphBinding& a, const GraphBinding& b) {
+      return a.buffer == b.buffer && a.offset < b.offset + b.byteSize && b.offset < a.offset + a.byteSize &&
+             (a.access != BufferAccess::READ || b.access != BufferAccess::READ);
+    };
+
+    std::vector<bool> barrierBefore(m_nodes.size(), false);
+    std::vector<GraphBinding> touched;
+    for (size_t node = 0; node < m_nodes.size(); ++node) {
+      const auto& bindings = m_nodes[node].bindings;
+      const bool hazard = node == 0 || std::any_of(bindings.begin(), bindings.end(), [&](const GraphBinding& b) {
+        return std::any_of(touched.begin(), touched.end(), [&](const GraphBinding& t) { return conflicts(b, t); });
+      });
+      if (hazard) {
+        // The first node is ordered after whatever the stream ran before
+        barrierBefore[node] = true;
+        touched.clear();
+      }
+      touched.insert(touched.end(), bindings.begin(), bindings.end());
+    }
+
+    const bool changed = barrierBefore != m_barrierBefore;
+    m_barrierBefore = std::move(barrierBefore);
+    return changed;
+  }
+
+  ID3D12GraphicsCommandList *D3D12Graph::AcquireCommandList(ID3D12Fence *fence, UINT64 fenceValue) {
+    if (m_currentRecording == SIZE_MAX) {
+      record();
+    }
+    Recording& recording = m_recordings[m_currentRecording];
+    recording.fence = fence;
+    recording.fenceValue = fenceValue;
+    return recording.commandList.Get();
+  }
+
+  void D3D12Graph::record() {
+    // Replays may still run an older recording, which must not be reset
+    auto isFree = [](const Recording& r) { return !r.fence || r.fence->GetCompletedValue() >= r.fenceValue; };
+    auto target = std::find_if(m_recordings.begin(), m_recordings.end(), isFree);
+    if (target == m_recordings.end()) {
+      Recording recording = {nullptr, nullptr, nullptr, 0};
+      auto device = m_backend->GetDevice();
+      ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&recording.allocator)));
+      ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, recording.allocator.Get(), nullptr, IID_PPV_ARGS(&recording.commandList)));
+      ThrowIfFailed(recording.commandList->Close());
+      m_recordings.push_back(std::move(recording));
+      target = std::prev(m_recordings.end());
+    }
+
+    ThrowIfFailed(target->allocator->Reset());
+    ThrowIfFailed(target->commandList->Reset(target->allocator.Get(), nullptr));
+    target->fence = nullptr;
+
+    ID3D12GraphicsCommandList4* list = target->commandList.Get();
+    ID3D12Resource* arguments = GetArgumentBuffer()->GetResource();
+    D3D12Kernel* currentKernel = nullptr;
+    for (size_t node = 0; node < m_nodes.size(); ++node) {
+      if (m_barrierBefore[node]) {
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        barrier.UAV.pResource = nullptr; // All UAV accesses
+        list->ResourceBarrier(1, &barrier);
+      }
+
+      D3D12Kernel* kernel = static_cast<D3D12Kernel*>(m_nodes[node].kernel);
+      if (kernel != currentKernel) {
+        list->SetPipelineState(kernel->GetPipelineState());
+        list->SetComputeRootSignature(kernel->GetRootSignature());
+        currentKernel = kernel;
+      }
+      list->ExecuteIndirect(m_signatures[node].Get(), 1, arguments, m_argumentOffsets[node], nullptr, 0);
+    }
+    ThrowIfFailed(list->Close());
+
+    m_currentRecording = target - m_recordings.begin();
+  }
+}
+
+#endif
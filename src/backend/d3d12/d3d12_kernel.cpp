@@ -2,29 +2,179 @@
 
 #if defined(AEGIS_ENABLE_D3D12)
 #include <d3d12shader.h> // For reflection
+#include <algorithm>
 #include <stdexcept>
 #include <fstream>
+#include <optional>
 #include <vector>
 
 namespace aegis::internal {
+  namespace {
+    constexpr UINT kMaxRootSignatureDwords = 64;
+    constexpr UINT kMaxRootConstantBytes = 64; // Larger cbuffers are cheaper as a root CBV
+    constexpr UINT kRootDescriptorDwords = 2;
+
+    std::string ToUtf8(LPCWSTR text) {
+      const int size = WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+      if (size <= 1) {
+        return {};
+      }
+      std::string utf8(size - 1, '\0');
+      WideCharToMultiByte(CP_UTF8, 0, text, -1, utf8.data(), size, nullptr, nullptr);
+      return utf8;
+    }
+
+    /**
+     * @brief Passes includes on to the backend's handler and records which
+     * files the compiler read, for the kernel cache.
+     * @note Lives on the stack for one Compile() call, so it isn't reference counted.
+     */
+    class RecordingIncludeHandler : public IDxcIncludeHandler {
+    public:
+      explicit RecordingIncludeHandler(IDxcIncludeHandler* handler) : m_handler(handler) {}
+
+      HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override {
+        const HRESULT hr = m_handler->LoadSource(pFilename, ppIncludeSource);
+        if (SUCCEEDED(hr) && *ppIncludeSource) {
+          m_includes.push_back({ToUtf8(pFilename), HashBytes((*ppIncludeSource)->GetBufferPointer(), (*ppIncludeSource)->GetBufferSize())});
+        }
+        return hr;
+      }
+
+      HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+        if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown)) {
+          *ppvObject = static_cast<IDxcIncludeHandler*>(this);
+          return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+      }
+      ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+      ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+      std::vector<KernelDependency> TakeIncludes() { return std::move(m_includes); }
+
+    private:
+      IDxcIncludeHandler* m_handler;
+      std::vector<KernelDependency> m_includes;
+    };
+  }
+
    D3D12Kernel::D3D12Kernel(D3D12Backend *backend, ComPtr<ID3D12RootSignature> rootSig,
-                           ComPtr<ID3D12PipelineState> pso) : m_backend(backend), m_rootSignature(std::move(rootSig)), m_pipelineState(std::move(pso)) {}
+                           ComPtr<ID3D12PipelineState> pso, std::vector<KernelConstants> constants) :
+       m_backend(backend), m_rootSignature(std::move(rootSig)), m_pipelineState(std::move(pso)), m_constants(std::move(constants)) {}
 
    D3D12Kernel::~D3D12Kernel() {}
 
-  std::unique_ptr<D3D12Kernel> D3D12Kernel::Create(D3D12Backend *backend, const std::string &hlslFilePath,
-                                                    const std::string &entryPoint) {
-     auto device = backend->GetDevice();
-     auto compiler = backend->GetCompiler();
-     auto utils = backend->GetUtils();
-     auto includeHandler = backend->GetIncludeHandler();
+   const KernelConstants *D3D12Kernel::FindConstants(uint32_t slot) const {
+     for (const KernelConstants& constants : m_constants) {
+       if (constants.slot == slot) {
+         return &constants;
+       }
+     }
+     return nullptr;
+   }
 
+  std::unique_ptr<D3D12Kernel> D3D12Kernel::Create(D3D12Backend *backend, const std::string &hlslFilePath,
+                                                    const std::string &entryPoint, const KernelDefines &defines,
+                                                    const KernelCompileOptions &options) {
      std::ifstream shaderFile(hlslFilePath, std::ios::binary);
      if (!shaderFile.is_open()) {
        throw std::runtime_error("Failed to open HLSL file: " + hlslFilePath);
      }
      std::string hlslCode((std::istreambuf_iterator<char>(shaderFile)), std::istreambuf_iterator<char>()); // TODO: check size and reserve string
 
+     return CreateFromSource(backend, hlslCode, hlslFilePath, entryPoint, defines, options);
+   }
+
+   std::unique_ptr<D3D12Kernel> D3D12Kernel::CreateFromSource(D3D12Backend *backend, const std::string &hlslCode,
+                                                              const std::string &sourceName, const std::string &entryPoint,
+                                                              const KernelDefines &defines, const KernelCompileOptions &options) {
+     KernelCompileOptions compileOptions = options;
+#if defined(_DEBUG)
+     compileOptions.debugInfo = true;
+#endif
+     std::wstring wFilePath(sourceName.begin(), sourceName.end()); // TODO: use MultiByteToWideChar
+     const std::vector<std::wstring> compileArguments = GetCompileArguments(entryPoint, defines, compileOptions);
+
+     std::vector<LPCWSTR> arguments;
+     arguments.push_back(wFilePath.c_str());
+     for (const std::wstring& argument : compileArguments) {
+       arguments.push_back(argument.c_str());
+     }
+
+     // Everything the output depends on that is known before compiling,
+     // the includes are checked by the cache
+     std::string cacheKey = "source " + sourceName + " " + HashToString(HashBytes(hlslCode.data(), hlslCode.size())) +
+                            "\nentry " + entryPoint + "\nargs";
+     for (LPCWSTR argument : arguments) {
+       cacheKey += " " + ToUtf8(argument);
+     }
+     cacheKey += "\n" + backend->GetKernelCacheIdentity();
+
+     std::optional<CachedKernel> compiled = backend->GetKernelCache().Load(cacheKey);
+     if (!compiled) {
+       compiled = compile(backend, hlslCode, arguments);
+       backend->GetKernelCache().Store(cacheKey, *compiled);
+     }
+
+     return createFromCompiled(backend, compiled->bytecode.data(), compiled->bytecode.size(), compiled->layout,
+                               std::move(compiled->constants));
+   }
+
+   std::unique_ptr<D3D12Kernel> D3D12Kernel::CreateFromBytecode(D3D12Backend *backend, const KernelBytecode &bytecode) {
+     // The reflection part if it was split off, otherwise the DXIL container holds it
+     DxcBuffer reflectionBuffer;
+     reflectionBuffer.Ptr = bytecode.dxilReflection ? bytecode.dxilReflection : bytecode.dxil;
+     reflectionBuffer.Size = bytecode.dxilReflection ? bytecode.dxilReflectionSize : bytecode.dxilSize;
+     reflectionBuffer.Encoding = 0;
+
+     ComPtr<ID3D12ShaderReflection> reflection;
+     ThrowIfFailed(backend->GetUtils()->CreateReflection(
+       &reflectionBuffer,
+       IID_PPV_ARGS(&reflection)
+     ));
+
+     std::vector<KernelConstants> constants;
+     const std::vector<uint8_t> layout = serializeRootSignature(reflection.Get(), constants);
+     return createFromCompiled(backend, bytecode.dxil, bytecode.dxilSize, layout, std::move(constants));
+   }
+
+   std::unique_ptr<D3D12Kernel> D3D12Kernel::createFromCompiled(D3D12Backend *backend, const void *bytecode, size_t bytecodeSize,
+                                                                const std::vector<uint8_t> &layout,
+                                                                std::vector<KernelConstants> constants) {
+     auto device = backend->GetDevice();
+
+     ComPtr<ID3D12RootSignature> rootSignature;
+     ThrowIfFailed(device->CreateRootSignature(
+         0,
+         layout.data(),
+         layout.size(),
+         IID_PPV_ARGS(&rootSignature)
+     ));
+
+     D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+     psoDesc.pRootSignature = rootSignature.Get();
+     psoDesc.CS.pShaderBytecode = bytecode;
+     psoDesc.CS.BytecodeLength = bytecodeSize;
+     psoDesc.NodeMask = 0;
+     psoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+
+     // Named after what the driver compiles, so a changed include gets a new entry
+     const std::string psoName = HashToString(HashBytes(bytecode, bytecodeSize, HashBytes(layout.data(), layout.size())));
+     ComPtr<ID3D12PipelineState> pso = backend->CreateComputePipelineState(psoDesc, std::wstring(psoName.begin(), psoName.end()));
+
+     // Return the new kernel
+     return std::unique_ptr<D3D12Kernel>(
+         new D3D12Kernel(backend, std::move(rootSignature), std::move(pso), std::move(constants))
+     );
+   }
+
+   CachedKernel D3D12Kernel::compile(D3D12Backend *backend, const std::string &hlslCode, const std::vector<LPCWSTR> &arguments) {
+     auto compiler = backend->GetCompiler();
+     auto utils = backend->GetUtils();
+     RecordingIncludeHandler includeHandler(backend->GetIncludeHandler());
+
      ComPtr<IDxcBlobEncoding> sourceBlob;
      ThrowIfFailed(utils->CreateBlob(
         hlslCode.c_str(),
@@ -33,20 +183,6 @@ namespace aegis::internal {
         &sourceBlob
      ));
 
-     std::wstring wEntryPoint(entryPoint.begin(), entryPoint.end()); // TODO: use MultiByteToWideChar
-     std::wstring wFilePath(hlslFilePath.begin(), hlslFilePath.end());
-
-     std::vector<LPCWSTR> arguments;
-     arguments.push_back(wFilePath.c_str());
-     arguments.push_back(L"-E"); // Entry point
-     arguments.push_back(wEntryPoint.c_str());
-     arguments.push_back(L"-T"); // Target profile
-     arguments.push_back(L"cs_6_0"); // Compute Shader Model 6.0
-#if defined(_DEBUG)
-     arguments.push_back(DXC_ARG_DEBUG); // Enable debug info
-#endif
-     arguments.push_back(DXC_ARG_PACK_MATRIX_ROW_MAJOR);
-
      DxcBuffer sourceBuffer;
      sourceBuffer.Ptr = sourceBlob->GetBufferPointer();
      sourceBuffer.Size = sourceBlob->GetBufferSize();
@@ -57,7 +193,7 @@ namespace aegis::internal {
        &sourceBuffer,
        arguments.data(),
        static_cast<UINT32>(arguments.size()),
-       includeHandler,
+       &includeHandler,
        IID_PPV_ARGS(&compileResult)
      ));
 
@@ -89,10 +225,21 @@ namespace aegis::internal {
        IID_PPV_ARGS(&reflection)
      ));
 
+     CachedKernel kernel;
+     kernel.includes = includeHandler.TakeIncludes();
+     const auto* bytecode = static_cast<const uint8_t*>(shaderBytecode->GetBufferPointer());
+     kernel.bytecode.assign(bytecode, bytecode + shaderBytecode->GetBufferSize());
+     kernel.layout = serializeRootSignature(reflection.Get(), kernel.constants);
+     return kernel;
+   }
+
+   std::vector<uint8_t> D3D12Kernel::serializeRootSignature(ID3D12ShaderReflection *reflection,
+                                                            std::vector<KernelConstants> &constants) {
      D3D12_SHADER_DESC shaderDesc;
      reflection->GetDesc(&shaderDesc);
 
      std::vector<D3D12_ROOT_PARAMETER1> rootParameters;
+     std::vector<D3D12_SHADER_INPUT_BIND_DESC> constantBuffers;
 
      for (UINT i = 0; i < shaderDesc.BoundResources; ++i) {
        D3D12_SHADER_INPUT_BIND_DESC bindDesc;
@@ -120,8 +267,45 @@ namespace aegis::internal {
          param.Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE;
 
          rootParameters[bindDesc.BindPoint] = param;
+       } else if (bindDesc.Type == D3D_SIT_CBUFFER) {
+         constantBuffers.push_back(bindDesc);
        }
-       // TODO: Add support for CBVs (D3D12_ROOT_PARAMETER_TYPE_CBV) etc.
+     }
+
+     // The cbuffers go after the UAVs, which keep root parameter index == u# register.
+     // Start from all root CBVs, then turn the small ones into root constants while they fit.
+     UINT rootSize = static_cast<UINT>(constantBuffers.size()) * kRootDescriptorDwords;
+     for (const D3D12_ROOT_PARAMETER1& param : rootParameters) {
+       rootSize += param.ParameterType == D3D12_ROOT_PARAMETER_TYPE_UAV ? kRootDescriptorDwords : 1; // Holes are empty tables
+     }
+     std::sort(constantBuffers.begin(), constantBuffers.end(), [](const auto& a, const auto& b) { return a.BindPoint < b.BindPoint; });
+
+     constants.clear();
+     for (const D3D12_SHADER_INPUT_BIND_DESC& bindDesc : constantBuffers) {
+       D3D12_SHADER_BUFFER_DESC bufferDesc;
+       ThrowIfFailed(reflection->GetConstantBufferByName(bindDesc.Name)->GetDesc(&bufferDesc));
+       const UINT values = bufferDesc.Size / 4;
+
+       D3D12_ROOT_PARAMETER1 param = {};
+       param.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+       const bool isRootConstants = bufferDesc.Size <= kMaxRootConstantBytes &&
+                                    rootSize - kRootDescriptorDwords + values <= kMaxRootSignatureDwords;
+       if (isRootConstants) {
+         rootSize = rootSize - kRootDescriptorDwords + values;
+         param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+         param.Constants.ShaderRegister = bindDesc.BindPoint;
+         param.Constants.RegisterSpace = bindDesc.Space;
+         param.Constants.Num32BitValues = values;
+       } else {
+         // The constant ring doesn't change a block once it is recorded
+         param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+         param.Descriptor.ShaderRegister = bindDesc.BindPoint;
+         param.Descriptor.RegisterSpace = bindDesc.Space;
+         param.Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+       }
+
+       constants.push_back({bindDesc.BindPoint, bufferDesc.Size, static_cast<uint32_t>(rootParameters.size()), isRootConstants});
+       rootParameters.push_back(param);
      }
 
      D3D12_VERSIONED_ROOT_SIGNATURE_DESC rootSigDesc = {};
@@ -144,28 +328,8 @@ namespace aegis::internal {
        throw std::runtime_error("Root Signature serialization failed:" + msg);
      }
 
-     ComPtr<ID3D12RootSignature> rootSignature;
-     ThrowIfFailed(device->CreateRootSignature(
-         0,
-         signatureBlob->GetBufferPointer(),
-         signatureBlob->GetBufferSize(),
-         IID_PPV_ARGS(&rootSignature)
-     ));
-
-     D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
-     psoDesc.pRootSignature = rootSignature.Get();
-     psoDesc.CS.pShaderBytecode = shaderBytecode->GetBufferPointer();
-     psoDesc.CS.BytecodeLength = shaderBytecode->GetBufferSize();
-     psoDesc.NodeMask = 0;
-     psoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-
-     ComPtr<ID3D12PipelineState> pso;
-     ThrowIfFailed(device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
-
-     // Return the new kernel
-     return std::unique_ptr<D3D12Kernel>(
-         new D3D12Kernel(backend, std::move(rootSignature), std::move(pso))
-     );
+     const auto* layout = static_cast<const uint8_t*>(signatureBlob->GetBufferPointer());
+     return std::vector<uint8_t>(layout, layout + signatureBlob->GetBufferSize());
    }
 }
 #endif
\ No newline at end of file
@@ -2,89 +2,350 @@
 #include "d3d12_buffer.h"
 #include "d3d12_kernel.h"
 #include "d3d12_event.h"
+#include "d3d12_graph.h"
 
 #if defined(AEGIS_ENABLE_D3D12)
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 namespace aegis::internal {
-  D3D12Stream::D3D12Stream(D3D12Backend *backend) :
-      m_backend(backend), m_fenceValue(0), m_currentKernel(nullptr), m_isListOpen(false) {
+  namespace {
+    // CopyBufferRegion() has no alignment rules for buffers, this just
+    // keeps the staging memcpy()s aligned.
+    constexpr size_t kUploadAlignment = 16;
+    constexpr size_t kReadbackAlignment = 16;
+    constexpr size_t kRootViewAlignment = 4; // Root UAV addresses must be DWORD aligned
+    constexpr size_t kConstantRingSize = 64 * 1024; // 256 blocks of 256 bytes per submission before it grows
+    constexpr size_t kMaxRootConstantBytes = 64; // D3D12Kernel makes larger cbuffers root CBVs
+
+    D3D12_RESOURCE_BARRIER TransitionBarrier(ID3D12Resource* resource, D3D12_RESOURCE_STATES before,
+                                             D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER_FLAGS flags) {
+      D3D12_RESOURCE_BARRIER barrier = {};
+      barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+      barrier.Flags = flags;
+      barrier.Transition.pResource = resource;
+      barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+      barrier.Transition.StateBefore = before;
+      barrier.Transition.StateAfter = after;
+      return barrier;
+    }
+  }
+
+  D3D12Stream::D3D12Stream(D3D12Backend *backend, const StreamDesc& desc) :
+      m_backend(backend),
+      m_listType(desc.type == StreamType::COPY ? D3D12_COMMAND_LIST_TYPE_COPY : D3D12_COMMAND_LIST_TYPE_DIRECT),
+      m_currentAllocator(0), m_maxInFlight(std::max<uint32_t>(desc.maxInFlightSubmissions, 1)),
+      m_fenceValue(0), m_recordedFenceValue(0), m_currentKernel(nullptr), m_isListOpen(false), m_hasOnlyWaits(false),
+      m_uploadRing(backend, GpuMemoryType::UPLOAD, desc.uploadRingSize, [this](uint64_t value) { waitForFence(value); }),
+      m_constantRing(backend, GpuMemoryType::UPLOAD, kConstantRingSize, [this](uint64_t value) { waitForFence(value); }),
+      m_readbackArena(backend, GpuMemoryType::READBACK, desc.readbackArenaSize,
+                      [this](uint64_t value) { waitForFence(value); finishReadbacks(value); }) {
     auto device = m_backend->GetDevice();
 
-    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
+    // One allocator per submission in flight plus the one being recorded;
+    // they're created as the pipeline fills up
+    m_commandAllocators.reserve(m_maxInFlight + 1);
+    m_commandAllocators.push_back({nullptr, 0});
+    ThrowIfFailed(device->CreateCommandAllocator(m_listType, IID_PPV_ARGS(&m_commandAllocators[0].allocator)));
 
-    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    ThrowIfFailed(device->CreateCommandList(0, m_listType, m_commandAllocators[0].allocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
     m_commandList->Close();
 
-    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-    ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_queue)));
-
     ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
     m_fenceValue = 1;
 
-    m_fenceEvent = _CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (m_fenceEvent == nullptr) {
-      ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-    }
+    m_submission = std::make_shared<SubmissionTimeline>();
+
+    // Acquired last, nothing releases it if the constructor throws
+    m_queue = m_backend->AcquireQueue(m_listType, desc.priority);
   }
 
   D3D12Stream::~D3D12Stream() {
-    CloseHandle(m_fenceEvent);
+    // The staging memory must outlive the copies that use it
+    waitForFence(m_fenceValue - 1);
+    m_backend->ReleaseQueue(m_queue.Get());
+  }
+
+  void D3D12Stream::waitForFence(UINT64 value) {
+    // Without an event handle this blocks until the fence gets there,
+    // which saves every stream a Win32 event
+    WaitForFence(m_fence.Get(), value, kInfiniteTimeout);
+  }
+
+  ID3D12CommandAllocator* D3D12Stream::acquireCommandAllocator() {
+    const UINT64 completed = m_fence->GetCompletedValue();
+
+    // The oldest submission is the first one to finish
+    size_t oldest = 0;
+    for (size_t i = 0; i < m_commandAllocators.size(); ++i) {
+      if (m_commandAllocators[i].fenceValue < m_commandAllocators[oldest].fenceValue) {
+        oldest = i;
+      }
+    }
+
+    if (m_commandAllocators[oldest].fenceValue > completed && m_commandAllocators.size() <= m_maxInFlight) {
+      m_commandAllocators.push_back({nullptr, 0});
+      ThrowIfFailed(m_backend->GetDevice()->CreateCommandAllocator(m_listType, IID_PPV_ARGS(&m_commandAllocators.back().allocator)));
+      oldest = m_commandAllocators.size() - 1;
+    } else {
+      // Only reachable if Submit() didn't throttle, but an allocator must
+      // never be reset while the GPU executes its commands
+      waitForFence(m_commandAllocators[oldest].fenceValue);
+    }
+
+    m_currentAllocator = oldest;
+    ID3D12CommandAllocator* allocator = m_commandAllocators[oldest].allocator.Get();
+    ThrowIfFailed(allocator->Reset());
+    return allocator;
   }
 
   void D3D12Stream::resetCommandList() {
+    m_hasOnlyWaits = false;
     if (!m_isListOpen) {
-      ThrowIfFailed(m_commandAllocator->Reset());
-      ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
+      // The list itself can be reset as soon as it's submitted, only its
+      // allocator has to wait for the GPU
+      ThrowIfFailed(m_commandList->Reset(acquireCommandAllocator(), nullptr));
       m_isListOpen = true;
+      m_recordedFenceValue = m_fenceValue;
     }
   }
 
   void D3D12Stream::transitionBarrier(D3D12Buffer *buffer, D3D12_RESOURCE_STATES newState) {
-    if (buffer->GetCurrentState() != newState) {
-      D3D12_RESOURCE_BARRIER barrier = {};
-      barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-      barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-      barrier.Transition.pResource = buffer->GetResource();
-      barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-      barrier.Transition.StateBefore = buffer->GetCurrentState();
-      barrier.Transition.StateAfter = newState;
+    // UPLOAD and READBACK heaps have a fixed state (GENERIC_READ, COPY_DEST)
+    const GpuMemoryType type = buffer->GetMemoryType();
+    if (type == GpuMemoryType::UPLOAD || type == GpuMemoryType::READBACK) {
+      return;
+    }
 
-      m_pendingBarriers.push_back(barrier);
+    if (m_listType == D3D12_COMMAND_LIST_TYPE_COPY) {
+      // Buffers decay to COMMON after every ExecuteCommandLists() and copy
+      // queues promote them from there implicitly, so only a buffer's second
+      // state in one list needs a barrier. Its tracked state belongs to the
+      // compute streams and is left alone.
+      auto [it, isFirstUse] = m_copyListStates.try_emplace(buffer, newState);
+      if (!isFirstUse && it->second != newState) {
+        m_pendingBarriers.push_back(TransitionBarrier(buffer->GetResource(), it->second, newState, D3D12_RESOURCE_BARRIER_FLAG_NONE));
+        m_barrierStats.transitionCount++;
+        it->second = newState;
+      }
+      return;
+    }
+
+    // This command is the next use, a split transition has to end here
+    std::erase(m_returnCandidates, buffer);
+    if (auto split = m_splitBarriers.find(buffer); split != m_splitBarriers.end()) {
+      m_pendingBarriers.push_back(TransitionBarrier(buffer->GetResource(), split->second, buffer->GetCurrentState(),
+                                                    D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+      m_splitBarriers.erase(split);
+    }
+
+    if (buffer->GetCurrentState() != newState) {
+      if (buffer->GetCurrentState() == D3D12_RESOURCE_STATE_UNORDERED_ACCESS) {
+        // The transition orders the dispatches before it, like a UAV barrier
+        std::erase_if(m_uavAccesses, [buffer](const UavAccess& a) { return a.buffer == buffer; });
+      }
+      m_pendingBarriers.push_back(TransitionBarrier(buffer->GetResource(), buffer->GetCurrentState(), newState,
+                                                    D3D12_RESOURCE_BARRIER_FLAG_NONE));
+      m_barrierStats.transitionCount++;
       buffer->SetCurrentState(newState);
     }
   }
 
+  void D3D12Stream::addReturnCandidate(D3D12Buffer *buffer, bool wasUnorderedAccess) {
+    // Buffers usually go back to dispatches after a copy. Beginning that
+    // transition as soon as a command doesn't use the buffer lets the GPU
+    // overlap it with the commands until the next use.
+    const GpuMemoryType type = buffer->GetMemoryType();
+    if (m_listType == D3D12_COMMAND_LIST_TYPE_COPY || !wasUnorderedAccess ||
+        type == GpuMemoryType::UPLOAD || type == GpuMemoryType::READBACK) {
+      return;
+    }
+    if (std::find(m_returnCandidates.begin(), m_returnCandidates.end(), buffer) == m_returnCandidates.end()) {
+      m_returnCandidates.push_back(buffer);
+    }
+  }
+
   void D3D12Stream::flushBarriers() {
+    // Whatever is left wasn't used by the command these barriers are for
+    for (D3D12Buffer* buffer : m_returnCandidates) {
+      m_pendingBarriers.push_back(TransitionBarrier(buffer->GetResource(), buffer->GetCurrentState(),
+                                                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+      m_splitBarriers.emplace(buffer, buffer->GetCurrentState());
+      buffer->SetCurrentState(D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+      m_barrierStats.transitionCount++;
+      m_barrierStats.splitTransitionCount++;
+    }
+    m_returnCandidates.clear();
+
     if (!m_pendingBarriers.empty()) {
       m_commandList->ResourceBarrier(static_cast<UINT>(m_pendingBarriers.size()), m_pendingBarriers.data());
       m_pendingBarriers.clear();
+      m_barrierStats.batchCount++;
     }
   }
 
+  void D3D12Stream::endSplitBarriers() {
+    // Nothing follows in this list to overlap with
+    m_returnCandidates.clear();
+    for (const auto& [buffer, stateBefore] : m_splitBarriers) {
+      m_pendingBarriers.push_back(TransitionBarrier(buffer->GetResource(), stateBefore, buffer->GetCurrentState(),
+                                                    D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+    }
+    m_splitBarriers.clear();
+  }
+
+  void D3D12Stream::addUavBarriers() {
+    std::vector<D3D12Buffer*> barriers;
+    for (const UavAccess& binding : m_uavBindings) {
+      if (!binding.buffer) {
+        continue;
+      }
+
+      bool isHazard = false;
+      bool isShared = false;
+      for (const UavAccess& earlier : m_uavAccesses) {
+        if (earlier.buffer != binding.buffer ||
+            binding.offset >= earlier.offset + earlier.byteSize || earlier.offset >= binding.offset + binding.byteSize) {
+          continue;
+        }
+        if (earlier.access != BufferAccess::READ || binding.access != BufferAccess::READ) {
+          isHazard = true;
+          break;
+        }
+        isShared = true;
+      }
+
+      if (isHazard) {
+        if (std::find(barriers.begin(), barriers.end(), binding.buffer) == barriers.end()) {
+          barriers.push_back(binding.buffer);
+        }
+      } else if (isShared) {
+        m_barrierStats.elidedUavBarrierCount++;
+      }
+    }
+
+    for (D3D12Buffer* buffer : barriers) {
+      D3D12_RESOURCE_BARRIER barrier = {};
+      barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+      barrier.UAV.pResource = buffer->GetResource();
+      m_pendingBarriers.push_back(barrier);
+      m_barrierStats.uavBarrierCount++;
+
+      std::erase_if(m_uavAccesses, [buffer](const UavAccess& a) { return a.buffer == buffer; });
+    }
+  }
+
+  void D3D12Stream::flushUploads() {
+    if (m_pendingUploads.empty()) {
+      return;
+    }
+
+    std::vector<bool> wasUnorderedAccess;
+    for (const auto& upload : m_pendingUploads) {
+      wasUnorderedAccess.push_back(upload.dest->GetCurrentState() == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+      transitionBarrier(upload.dest, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+    flushBarriers();
+
+    for (const auto& upload : m_pendingUploads) {
+      // The ring lives in an UPLOAD heap, which stays in GENERIC_READ
+      D3D12Buffer* staging = static_cast<D3D12Buffer*>(upload.staging);
+      m_commandList->CopyBufferRegion(upload.dest->GetResource(), upload.destOffset,
+                                      staging->GetResource(), upload.stagingOffset,
+                                      upload.byteSize);
+    }
+    for (size_t i = 0; i < m_pendingUploads.size(); ++i) {
+      addReturnCandidate(m_pendingUploads[i].dest, wasUnorderedAccess[i]);
+    }
+    m_pendingUploads.clear();
+  }
+
   void D3D12Stream::SetKernel(IComputeKernel *kernel) {
     resetCommandList();
 
-    m_currentKernel = static_cast<D3D12Kernel*>(kernel);
+    D3D12Kernel* d3dKernel = static_cast<D3D12Kernel*>(kernel);
+    if (!m_currentKernel || m_currentKernel->GetRootSignature() != d3dKernel->GetRootSignature()) {
+      m_uavBindings.clear(); // A new root signature drops the root arguments
+      m_constantBindings.clear();
+    }
+
+    m_currentKernel = d3dKernel;
     m_commandList->SetPipelineState(m_currentKernel->GetPipelineState());
     m_commandList->SetComputeRootSignature(m_currentKernel->GetRootSignature());
   }
 
-  void D3D12Stream::SetBuffer(uint32_t slot, IGpuBuffer *buffer) {
+  void D3D12Stream::SetBuffer(uint32_t slot, IGpuBuffer *buffer, size_t offset, size_t byteSize, BufferAccess access) {
     // This is a MASSIVE simplification.
     // For prod the library needs to manage descriptor heaps.
     // We assumes the root signature just has UAVs directly in the root parameters
     D3D12Buffer* d3dBuffer = static_cast<D3D12Buffer*>(buffer);
+    CheckBufferRange(d3dBuffer, offset, byteSize, "Bound range is outside the buffer.");
+    if (offset % kRootViewAlignment != 0) {
+      throw std::runtime_error("Bound range offset is not 4-byte aligned.");
+    }
 
+    flushUploads();
     transitionBarrier(d3dBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
     // TODO: take care of this
     m_commandList->SetComputeRootUnorderedAccessView(
         slot,
-        d3dBuffer->GetGpuVirtualAddress()
+        d3dBuffer->GetGpuVirtualAddress() + offset
     );
+
+    if (slot >= m_uavBindings.size()) {
+      m_uavBindings.resize(slot + 1, {nullptr, 0, 0, BufferAccess::READ});
+    }
+    m_uavBindings[slot] = {d3dBuffer, offset, byteSize, access};
+  }
+
+  void D3D12Stream::SetConstants(uint32_t slot, const void *data, size_t byteSize) {
+    resetCommandList();
+    if (!m_currentKernel) {
+      throw std::runtime_error("No kernel set before SetConstants().");
+    }
+    const KernelConstants* constants = m_currentKernel->FindConstants(slot);
+    if (!constants) {
+      throw std::runtime_error("The kernel has no cbuffer at register b" + std::to_string(slot) + ".");
+    }
+    if (byteSize > constants->byteSize) {
+      throw std::runtime_error("Constants are larger than the cbuffer.");
+    }
+
+    if (constants->isRootConstants) {
+      if (byteSize % 4 != 0) {
+        throw std::runtime_error("Root constants must be a multiple of 4 bytes.");
+      }
+      // The rest of the cbuffer reads zeros, as on the other paths
+      uint32_t values[kMaxRootConstantBytes / 4] = {};
+      std::memcpy(values, data, byteSize);
+      m_commandList->SetComputeRoot32BitConstants(constants->rootParameterIndex, constants->byteSize / 4, values, 0);
+      setConstantBinding({constants->rootParameterIndex, std::vector<uint32_t>(values, values + constants->byteSize / 4), 0});
+      return;
+    }
+
+    // The shader may read the whole cbuffer, so the block covers it. Upload
+    // memory is readable as constants as it is, no copy or barrier needed.
+    m_constantRing.Reclaim(m_fence->GetCompletedValue());
+    auto block = m_constantRing.Allocate(constants->byteSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    std::memcpy(block.cpuAddress, data, byteSize);
+    std::memset(static_cast<uint8_t*>(block.cpuAddress) + byteSize, 0, constants->byteSize - byteSize);
+    const D3D12_GPU_VIRTUAL_ADDRESS address = static_cast<D3D12Buffer*>(block.buffer)->GetGpuVirtualAddress() + block.offset;
+    m_commandList->SetComputeRootConstantBufferView(constants->rootParameterIndex, address);
+    setConstantBinding({constants->rootParameterIndex, {}, address});
+  }
+
+  void D3D12Stream::setConstantBinding(ConstantBinding binding) {
+    auto existing = std::ranges::find_if(m_constantBindings, [&binding](const ConstantBinding& b) {
+      return b.rootParameterIndex == binding.rootParameterIndex;
+    });
+    if (existing == m_constantBindings.end()) {
+      m_constantBindings.push_back(std::move(binding));
+    } else {
+      *existing = std::move(binding);
+    }
   }
 
   void D3D12Stream::RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
@@ -93,21 +354,103 @@ namespace aegis::internal {
       throw std::runtime_error("No kernel set before dispatch.");
     }
 
+    flushUploads();
+    for (const UavAccess& binding : m_uavBindings) {
+      if (binding.buffer) {
+        // A copy since SetBuffer() may have moved it out of UNORDERED_ACCESS
+        transitionBarrier(binding.buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+      }
+    }
+    addUavBarriers();
     flushBarriers();
 
     m_commandList->Dispatch(threadGroupsX, threadGroupsY, threadGroupsZ);
+
+    for (const UavAccess& binding : m_uavBindings) {
+      if (binding.buffer) {
+        m_uavAccesses.push_back(binding);
+      }
+    }
   }
 
-  void D3D12Stream::ResourceCopyBuffer(IGpuBuffer *dest, IGpuBuffer *src) {
+  void D3D12Stream::RecordGraph(IComputeGraph *graph) {
+    D3D12Graph* d3dGraph = static_cast<D3D12Graph*>(graph);
+    if (d3dGraph->GetNodes().empty()) {
+      return;
+    }
+
     resetCommandList();
+    flushUploads();
+
+    D3D12Buffer* arguments = d3dGraph->GetArgumentBuffer();
+    if (const std::vector<uint8_t>* bytes = d3dGraph->TakeDirtyArguments()) {
+      // Ordered after earlier replays on the queue, which read the old arguments
+      m_uploadRing.Reclaim(m_fence->GetCompletedValue());
+      auto staging = m_uploadRing.Allocate(bytes->size(), kUploadAlignment);
+      memcpy(staging.cpuAddress, bytes->data(), bytes->size());
+
+      transitionBarrier(arguments, D3D12_RESOURCE_STATE_COPY_DEST);
+      flushBarriers();
+      D3D12Buffer* d3dStaging = static_cast<D3D12Buffer*>(staging.buffer);
+      m_commandList->CopyBufferRegion(arguments->GetResource(), 0, d3dStaging->GetResource(), staging.offset, bytes->size());
+    }
+
+    // The baked list has no transitions, everything must be ready when it starts
+    transitionBarrier(arguments, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    for (const GraphNode& node : d3dGraph->GetNodes()) {
+      for (const GraphBinding& binding : node.bindings) {
+        transitionBarrier(static_cast<D3D12Buffer*>(binding.buffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+      }
+    }
+    endSplitBarriers();
+    flushBarriers();
+
+    // The queue runs lists in order, so executing what was recorded so far
+    // followed by the graph puts the graph at this point of the stream.
+    // The next Submit() signals the fence after both.
+    ID3D12CommandList* const ppCommandLists[] = {m_commandList.Get(), d3dGraph->AcquireCommandList(m_fence.Get(), m_fenceValue)};
+    flushWaits();
+    ThrowIfFailed(m_commandList->Close());
+    m_queue->ExecuteCommandLists(2, ppCommandLists);
+
+    // The allocator is only free once that Submit() is done, keep appending to it
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_currentAllocator].allocator.Get(), nullptr));
+    m_currentKernel = nullptr;
+    m_uavBindings.clear();
+    m_constantBindings.clear();
+    m_uavAccesses.clear(); // Ordered by the list boundary
+  }
+
+  void D3D12Stream::ResourceCopyBuffer(IGpuBuffer *dest, size_t destOffset, IGpuBuffer *src, size_t srcOffset, size_t byteSize) {
     D3D12Buffer* d3dDest = static_cast<D3D12Buffer*>(dest);
     D3D12Buffer* d3dSrc = static_cast<D3D12Buffer*>(src);
+    CheckBufferRange(d3dDest, destOffset, byteSize, "Copy destination range is outside the buffer.");
+    CheckBufferRange(d3dSrc, srcOffset, byteSize, "Copy source range is outside the buffer.");
+    if (d3dDest == d3dSrc) {
+      throw std::runtime_error("D3D12 cannot copy within one buffer.");
+    }
+    if (byteSize == 0) {
+      return;
+    }
+
+    resetCommandList();
 
+    flushUploads();
+    const bool wasDestUnorderedAccess = d3dDest->GetCurrentState() == D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    const bool wasSrcUnorderedAccess = d3dSrc->GetCurrentState() == D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
     transitionBarrier(d3dDest, D3D12_RESOURCE_STATE_COPY_DEST);
     transitionBarrier(d3dSrc, D3D12_RESOURCE_STATE_COPY_SOURCE);
     flushBarriers();
 
-    m_commandList->CopyResource(d3dDest->GetResource(), d3dSrc->GetResource());
+    const bool isWholeResource = destOffset == 0 && srcOffset == 0 &&
+                                 byteSize == d3dDest->GetSizeInBytes() && byteSize == d3dSrc->GetSizeInBytes();
+    if (isWholeResource) {
+      m_commandList->CopyResource(d3dDest->GetResource(), d3dSrc->GetResource());
+    } else {
+      m_commandList->CopyBufferRegion(d3dDest->GetResource(), destOffset, d3dSrc->GetResource(), srcOffset, byteSize);
+    }
+    addReturnCandidate(d3dDest, wasDestUnorderedAccess);
+    addReturnCandidate(d3dSrc, wasSrcUnorderedAccess);
   }
 
   void D3D12Stream::Submit() {
@@ -115,10 +458,17 @@ namespace aegis::internal {
       return;
     }
 
+    flushUploads();
+    endSplitBarriers();
     flushBarriers();
+    flushWaits();
 
     ThrowIfFailed(m_commandList->Close());
     m_isListOpen = false;
+    m_copyListStates.clear();
+    m_uavBindings.clear();
+    m_constantBindings.clear();
+    m_uavAccesses.clear(); // Lists on one queue don't overlap
 
     ID3D12CommandList* const ppCommandLists[] = { m_commandList.Get() };
 
@@ -127,72 +477,216 @@ namespace aegis::internal {
     queue->ExecuteCommandLists(1, ppCommandLists);
 
     ThrowIfFailed(queue->Signal(m_fence.Get(), m_fenceValue));
-  }
+    m_submission->Submitted(m_fenceValue);
+    m_commandAllocators[m_currentAllocator].fenceValue = m_fenceValue;
+
+    // Every submission gets its own fence value so staging memory can be
+    // recycled as soon as the submission that used it is done
+    m_uploadRing.Close(m_fenceValue);
+    m_constantRing.Close(m_fenceValue);
+    m_readbackArena.Close(m_fenceValue);
+    for (auto& readback : m_pendingReadbacks) {
+      if (readback.fenceValue == 0) {
+        readback.fenceValue = m_fenceValue;
+      }
+    }
+    m_fenceValue++;
+    m_recordedFenceValue = m_fenceValue - 1;
 
-  void D3D12Stream::HostWait() {
-    if (m_fence->GetCompletedValue() < m_fenceValue) {
-      ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValue, m_fenceEvent));
-      WaitForSingleObject(m_fenceEvent, INFINITE);
+    // Bound how far the CPU runs ahead of the GPU
+    if (m_fenceValue - 1 > m_maxInFlight) {
+      waitForFence(m_fenceValue - 1 - m_maxInFlight);
     }
+  }
 
-    m_fenceValue++;
+  uint64_t D3D12Stream::GetRecordedFenceValue() const {
+    return m_recordedFenceValue;
+  }
 
-    while (!m_pendingReadbacks.empty()) {
-      auto readback = m_pendingReadbacks.front();
-      m_pendingReadbacks.pop();
+  uint64_t D3D12Stream::GetSubmittedFenceValue() const {
+    return m_fenceValue - 1;
+  }
+
+  uint64_t D3D12Stream::GetCompletedFenceValue() const {
+    return m_fence->GetCompletedValue();
+  }
 
-      void* pGpuData = readback.readbackBuffer->Map();
-      memcpy(const_cast<void *>(readback.cpuDestination), pGpuData, readback.byteSize);
-      readback.readbackBuffer->Unmap();
+  bool D3D12Stream::HostWait(uint32_t timeoutMs) {
+    if (!WaitForFence(m_fence.Get(), m_fenceValue - 1, timeoutMs)) {
+      return false;
     }
 
-    m_inFlightResources.clear();
+    // The arena is persistently mapped, so this is just a memcpy per download.
+    // Downloads recorded after the last Submit() stay queued.
+    finishReadbacks(m_fenceValue - 1);
+
+    const UINT64 completed = m_fence->GetCompletedValue();
+    m_uploadRing.Reclaim(completed);
+    m_constantRing.Reclaim(completed);
+    m_readbackArena.Reclaim(completed);
+    return true;
+  }
+
+  StagingStats D3D12Stream::GetStagingStats() const {
+    return {m_uploadRing.GetStats(), m_readbackArena.GetStats()};
+  }
+
+  BarrierStats D3D12Stream::GetBarrierStats() const {
+    return m_barrierStats;
   }
 
   void D3D12Stream::StreamWait(IComputeEvent *event) {
     D3D12Event* d3dEvent = static_cast<D3D12Event*>(event);
-    ID3D12Fence* fence = d3dEvent->GetFence();
+    auto [fence, valueToWaitFor] = d3dEvent->Get();
+    if (!fence || fence.Get() == m_fence.Get()) {
+      return; // Never recorded, or recorded earlier on this stream
+    }
 
-    UINT64 valueToWaitFor = d3dEvent->m_fenceValue.load();
+    // A queue waits between lists, so the work recorded so far goes to the
+    // queue first instead of stalling behind the wait. The wait goes ahead
+    // of the next list, in submission order with the lists of every stream
+    // sharing this queue.
+    if (m_isListOpen && !m_hasOnlyWaits) {
+      splitCommandList();
+    }
+    resetCommandList();
+    m_hasOnlyWaits = true;
+    auto pending = std::ranges::find_if(m_pendingWaits, [&fence](const PendingWait& wait) { return wait.fence == fence; });
+    if (pending == m_pendingWaits.end()) {
+      m_pendingWaits.push_back({std::move(fence), valueToWaitFor, d3dEvent->GetSubmission()});
+    } else {
+      pending->value = std::max(pending->value, valueToWaitFor);
+    }
+  }
 
-    ThrowIfFailed(m_queue->Wait(fence, valueToWaitFor));
+  void D3D12Stream::flushWaits() {
+    // A wait for a value that isn't on a queue yet could end up in front
+    // of its own signal, if the signaling stream shares this queue
+    for (const PendingWait& wait : m_pendingWaits) {
+      if (wait.submission) {
+        wait.submission->WaitSubmitted(wait.value);
+      }
+    }
+    for (const PendingWait& wait : m_pendingWaits) {
+      ThrowIfFailed(m_queue->Wait(wait.fence.Get(), wait.value));
+    }
+    m_pendingWaits.clear();
   }
 
-  void D3D12Stream::RecordEvent(IComputeEvent *event) {
-    D3D12Event* d3dEvent = static_cast<D3D12Event*>(event);
-    ID3D12Fence* fence = d3dEvent->GetFence();
+  void D3D12Stream::splitCommandList() {
+    flushUploads();
+    endSplitBarriers();
+    flushBarriers();
+    flushWaits();
 
-    UINT64 valueToSignal = ++(d3dEvent->m_fenceValue);
+    ThrowIfFailed(m_commandList->Close());
+    ID3D12CommandList* const ppCommandLists[] = { m_commandList.Get() };
+    m_queue->ExecuteCommandLists(1, ppCommandLists);
+    m_copyListStates.clear();
+    m_uavAccesses.clear(); // Lists on one queue don't overlap
 
-    ThrowIfFailed(m_queue->Signal(fence, valueToSignal));
+    // The allocator is only free once the next Submit() is done, keep appending to it
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_currentAllocator].allocator.Get(), nullptr));
+    if (!m_currentKernel) {
+      return;
+    }
+    m_commandList->SetPipelineState(m_currentKernel->GetPipelineState());
+    m_commandList->SetComputeRootSignature(m_currentKernel->GetRootSignature());
+    for (size_t slot = 0; slot < m_uavBindings.size(); ++slot) {
+      const UavAccess& binding = m_uavBindings[slot];
+      if (binding.buffer) {
+        m_commandList->SetComputeRootUnorderedAccessView(static_cast<UINT>(slot), binding.buffer->GetGpuVirtualAddress() + binding.offset);
+      }
+    }
+    for (const ConstantBinding& binding : m_constantBindings) {
+      if (binding.values.empty()) {
+        m_commandList->SetComputeRootConstantBufferView(binding.rootParameterIndex, binding.address);
+      } else {
+        m_commandList->SetComputeRoot32BitConstants(binding.rootParameterIndex, static_cast<UINT>(binding.values.size()), binding.values.data(), 0);
+      }
+    }
   }
 
-  // TODO: Add a pool of upload/readback buffers.
-  void D3D12Stream::ResourceUpload(IGpuBuffer *dest, const void *srcData, size_t byteSize) {
-    // A temp upload buffer
-    auto tempUploadBuffer = m_backend->CreateBuffer(byteSize, GpuMemoryType::UPLOAD);
-    D3D12Buffer* d3dUploadBuffer = static_cast<D3D12Buffer*>(tempUploadBuffer.get());
+  void D3D12Stream::RecordEvent(IComputeEvent *event) {
+    // A command list can't signal halfway through, so the event is reached
+    // with the submission that closes the open list
+    m_submission->Recorded();
+    static_cast<D3D12Event*>(event)->Set(m_fence, GetRecordedFenceValue(), m_submission);
+  }
+
+  void D3D12Stream::ResourceUpload(IGpuBuffer *dest, size_t destOffset, const void *srcData, size_t byteSize) {
+    D3D12Buffer* d3dDest = static_cast<D3D12Buffer*>(dest);
+    CheckBufferRange(d3dDest, destOffset, byteSize, "Upload range is outside the destination buffer.");
+    if (byteSize == 0) {
+      return;
+    }
+
+    resetCommandList();
 
-    void* pData = d3dUploadBuffer->Map();
-    memcpy(pData, srcData, byteSize);
-    d3dUploadBuffer->Unmap();
+    // Overlapping copies into the same buffer must not share a barrier batch,
+    // disjoint ranges (e.g., tensors packed into one buffer) can
+    auto overlaps = [d3dDest, destOffset, byteSize](const PendingUpload& upload) {
+      return upload.dest == d3dDest &&
+             destOffset < upload.destOffset + upload.byteSize && upload.destOffset < destOffset + byteSize;
+    };
+    if (std::any_of(m_pendingUploads.begin(), m_pendingUploads.end(), overlaps)) {
+      flushUploads();
+    }
 
-    ResourceCopyBuffer(dest, d3dUploadBuffer);
+    m_uploadRing.Reclaim(m_fence->GetCompletedValue());
+    auto staging = m_uploadRing.Allocate(byteSize, kUploadAlignment);
+    memcpy(staging.cpuAddress, srcData, byteSize);
 
-    m_inFlightResources.push_back(std::move(tempUploadBuffer));
-    // TODO: Need to keep tempUploadBuffer alive until the copy is done.
+    // The copy itself is recorded lazily so back-to-back uploads share one barrier batch
+    m_pendingUploads.push_back({d3dDest, destOffset, staging.buffer, staging.offset, byteSize});
   }
 
-  void D3D12Stream::ResourceDownload(const void *destData, IGpuBuffer *src, size_t byteSize) {
-    // A temp upload readback
-    auto tempReadbackBuffer = m_backend->CreateBuffer(byteSize, GpuMemoryType::READBACK);
-    D3D12Buffer* d3dReadbackBuffer = static_cast<D3D12Buffer*>(tempReadbackBuffer.get());
+  std::shared_ptr<ReadbackCopy> D3D12Stream::ResourceDownload(const void *destData, IGpuBuffer *src, size_t srcOffset, size_t byteSize) {
+    D3D12Buffer* d3dSrc = static_cast<D3D12Buffer*>(src);
+    CheckBufferRange(d3dSrc, srcOffset, byteSize, "Download range is outside the source buffer.");
+    if (byteSize == 0) {
+      return nullptr;
+    }
 
-    ResourceCopyBuffer(d3dReadbackBuffer, src);
+    resetCommandList();
+    flushUploads();
+    collectReadbacks();
 
-    m_pendingReadbacks.push({tempReadbackBuffer.get(), destData, byteSize});
+    // Readback heaps stay in COPY_DEST, only the source needs a transition
+    auto staging = m_readbackArena.Allocate(byteSize, kReadbackAlignment);
+    const bool wasUnorderedAccess = d3dSrc->GetCurrentState() == D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    transitionBarrier(d3dSrc, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    flushBarriers();
 
-    m_inFlightResources.push_back(std::move(tempReadbackBuffer));
+    D3D12Buffer* d3dStaging = static_cast<D3D12Buffer*>(staging.buffer);
+    m_commandList->CopyBufferRegion(d3dStaging->GetResource(), staging.offset,
+                                    d3dSrc->GetResource(), srcOffset, byteSize);
+    addReturnCandidate(d3dSrc, wasUnorderedAccess);
+
+    auto copy = std::make_shared<ReadbackCopy>(staging.cpuAddress, const_cast<void*>(destData), byteSize);
+    m_pendingReadbacks.push_back({copy, 0});
+    return copy;
+  }
+
+  void D3D12Stream::collectReadbacks() {
+    while (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().copy->IsDone()) {
+      m_pendingReadbacks.pop_front();
+    }
+
+    // Staging memory of downloads nobody copied out yet must stay
+    UINT64 reclaimable = m_fence->GetCompletedValue();
+    if (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().fenceValue != 0) {
+      reclaimable = std::min(reclaimable, m_pendingReadbacks.front().fenceValue - 1);
+    }
+    m_readbackArena.Reclaim(reclaimable);
+  }
+
+  void D3D12Stream::finishReadbacks(UINT64 fenceValue) {
+    while (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().fenceValue != 0 &&
+           m_pendingReadbacks.front().fenceValue <= fenceValue) {
+      m_pendingReadbacks.front().copy->Finish();
+      m_pendingReadbacks.pop_front();
+    }
   }
 
 }
@@ -0,0 +1,282 @@
+#include "spirv_reflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace aegis::internal {
+  namespace {
+    constexpr uint32_t kSpirvMagic = 0x07230203;
+    constexpr size_t kHeaderWords = 5;
+
+    // Opcodes
+    constexpr uint32_t OpExecutionMode = 16;
+    constexpr uint32_t OpTypeBool = 20;
+    constexpr uint32_t OpTypeInt = 21;
+    constexpr uint32_t OpTypeFloat = 22;
+    constexpr uint32_t OpTypeVector = 23;
+    constexpr uint32_t OpTypeMatrix = 24;
+    constexpr uint32_t OpTypeArray = 28;
+    constexpr uint32_t OpTypeStruct = 30;
+    constexpr uint32_t OpTypePointer = 32;
+    constexpr uint32_t OpConstant = 43;
+    constexpr uint32_t OpVariable = 59;
+    constexpr uint32_t OpDecorate = 71;
+    constexpr uint32_t OpMemberDecorate = 72;
+
+    // Decorations
+    constexpr uint32_t DecorationBlock = 2;
+    constexpr uint32_t DecorationBufferBlock = 3;
+    constexpr uint32_t DecorationRowMajor = 4;
+    constexpr uint32_t DecorationArrayStride = 6;
+    constexpr uint32_t DecorationMatrixStride = 7;
+    constexpr uint32_t DecorationBinding = 33;
+    constexpr uint32_t DecorationDescriptorSet = 34;
+    constexpr uint32_t DecorationOffset = 35;
+
+    // Storage classes
+    constexpr uint32_t StorageClassUniformConstant = 0;
+    constexpr uint32_t StorageClassUniform = 2;
+    constexpr uint32_t StorageClassStorageBuffer = 12;
+
+    // Execution modes
+    constexpr uint32_t ExecutionModeLocalSize = 17;
+
+    struct IdInfo {
+      bool hasBinding = false;
+      bool hasSet = false;
+      bool isBlock = false;
+      bool isBufferBlock = false;
+      uint32_t binding = 0;
+      uint32_t set = 0;
+      uint32_t arrayStride = 0;
+    };
+
+    struct MemberInfo {
+      uint32_t offset = 0;
+      uint32_t matrixStride = 0;
+      bool isRowMajor = false;
+    };
+
+    struct Type {
+      uint32_t opcode;
+      std::vector<uint32_t> operands; // After the result id
+    };
+
+    /**
+     * @brief What's needed to size a uniform block.
+     */
+    struct TypeTable {
+      std::unordered_map<uint32_t, Type> types;
+      std::unordered_map<uint32_t, std::vector<MemberInfo>> members; // Struct type -> per member
+      std::unordered_map<uint32_t, uint32_t> constants; // Low word of scalar OpConstants
+      const std::unordered_map<uint32_t, IdInfo>* decorations;
+    };
+
+    struct Variable {
+      uint32_t id;
+      uint32_t pointerType;
+      uint32_t storageClass;
+    };
+
+    const Type& FindType(const TypeTable& table, uint32_t id) {
+      auto type = table.types.find(id);
+      if (type == table.types.end()) {
+        throw std::runtime_error("Malformed SPIR-V module.");
+      }
+      return type->second;
+    }
+
+    /**
+     * @brief The bytes a type takes in a uniform block, per its decorations.
+     * @param member The decorations of the struct member of this type, if it is one.
+     */
+    size_t GetBlockTypeSize(const TypeTable& table, uint32_t id, const MemberInfo* member) {
+      const Type& type = FindType(table, id);
+      const std::vector<uint32_t>& operands = type.operands;
+      switch (type.opcode) {
+        case OpTypeBool:
+          return 4; // HLSL bools are 32 bits in a cbuffer
+        case OpTypeInt:
+        case OpTypeFloat:
+          return operands.at(0) / 8;
+        case OpTypeVector:
+          return operands.at(1) * GetBlockTypeSize(table, operands.at(0), nullptr);
+        case OpTypeMatrix: {
+          const uint32_t columns = operands.at(1);
+          if (!member || member->matrixStride == 0) {
+            return columns * GetBlockTypeSize(table, operands.at(0), nullptr);
+          }
+          // With RowMajor the stride steps from one row to the next
+          const uint32_t rows = FindType(table, operands.at(0)).operands.at(1);
+          return size_t(member->matrixStride) * (member->isRowMajor ? rows : columns);
+        }
+        case OpTypeArray: {
+          auto length = table.constants.find(operands.at(1));
+          if (length == table.constants.end()) {
+            throw std::runtime_error("Unsupported array length in a uniform block.");
+          }
+          auto decoration = table.decorations->find(id);
+          const size_t stride = decoration != table.decorations->end() && decoration->second.arrayStride != 0
+                                    ? decoration->second.arrayStride
+                                    : GetBlockTypeSize(table, operands.at(0), member);
+          return length->second * stride;
+        }
+        case OpTypeStruct: {
+          auto members = table.members.find(id);
+          size_t size = 0;
+          for (size_t i = 0; i < operands.size(); ++i) {
+            const MemberInfo* info = members != table.members.end() && i < members->second.size() ? &members->second[i] : nullptr;
+            size = std::max(size, (info ? info->offset : 0) + GetBlockTypeSize(table, operands[i], info));
+          }
+          return size;
+        }
+        default:
+          throw std::runtime_error("Unsupported type in a uniform block.");
+      }
+    }
+  }
+
+  SpirvReflection ReflectSpirv(const uint32_t* code, size_t byteSize) {
+    const size_t wordCount = byteSize / sizeof(uint32_t);
+    if (wordCount < kHeaderWords || code[0] != kSpirvMagic) {
+      throw std::runtime_error("Not a SPIR-V module.");
+    }
+
+    SpirvReflection reflection;
+
+    std::unordered_map<uint32_t, IdInfo> decorations;
+    std::unordered_map<uint32_t, uint32_t> pointerPointee; // pointer type -> pointee type
+    std::vector<Variable> variables;
+    TypeTable typeTable;
+    typeTable.decorations = &decorations;
+
+    size_t offset = kHeaderWords;
+    while (offset < wordCount) {
+      const uint32_t instruction = code[offset];
+      const uint32_t opcode = instruction & 0xFFFF;
+      const uint32_t length = instruction >> 16;
+      if (length == 0 || offset + length > wordCount) {
+        throw std::runtime_error("Malformed SPIR-V module.");
+      }
+      const uint32_t* operands = code + offset + 1;
+
+      switch (opcode) {
+        case OpDecorate: {
+          IdInfo& info = decorations[operands[0]];
+          const uint32_t decoration = operands[1];
+          if (decoration == DecorationBinding && length >= 4) {
+            info.hasBinding = true;
+            info.binding = operands[2];
+          } else if (decoration == DecorationDescriptorSet && length >= 4) {
+            info.hasSet = true;
+            info.set = operands[2];
+          } else if (decoration == DecorationBlock) {
+            info.isBlock = true;
+          } else if (decoration == DecorationBufferBlock) {
+            info.isBufferBlock = true;
+          } else if (decoration == DecorationArrayStride && length >= 4) {
+            info.arrayStride = operands[2];
+          }
+          break;
+        }
+        case OpMemberDecorate: {
+          if (length < 4) {
+            break;
+          }
+          std::vector<MemberInfo>& members = typeTable.members[operands[0]];
+          if (members.size() <= operands[1]) {
+            members.resize(operands[1] + 1);
+          }
+          MemberInfo& member = members[operands[1]];
+          const uint32_t decoration = operands[2];
+          if (decoration == DecorationOffset && length >= 5) {
+            member.offset = operands[3];
+          } else if (decoration == DecorationMatrixStride && length >= 5) {
+            member.matrixStride = operands[3];
+          } else if (decoration == DecorationRowMajor) {
+            member.isRowMajor = true;
+          }
+          break;
+        }
+        case OpTypeBool:
+        case OpTypeInt:
+        case OpTypeFloat:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeArray:
+        case OpTypeStruct:
+          if (length >= 2) {
+            typeTable.types[operands[0]] = {opcode, std::vector<uint32_t>(operands + 1, operands + length - 1)};
+          }
+          break;
+        case OpConstant:
+          if (length >= 4) {
+            typeTable.constants[operands[1]] = operands[2];
+          }
+          break;
+        case OpTypePointer:
+          if (length >= 4) {
+            pointerPointee[operands[0]] = operands[2];
+          }
+          break;
+        case OpVariable:
+          if (length >= 4) {
+            variables.push_back({operands[1], operands[0], operands[2]});
+          }
+          break;
+        case OpExecutionMode:
+          if (operands[1] == ExecutionModeLocalSize && length >= 6) {
+            reflection.localSize[0] = operands[2];
+            reflection.localSize[1] = operands[3];
+            reflection.localSize[2] = operands[4];
+          }
+          break;
+        default:
+          break;
+      }
+
+      offset += length;
+    }
+
+    for (const auto& variable : variables) {
+      auto decoration = decorations.find(variable.id);
+      if (decoration == decorations.end() || !decoration->second.hasBinding) {
+        continue; // Not a descriptor (e.g., a groupshared or private variable)
+      }
+
+      SpirvBinding binding = {};
+      binding.set = decoration->second.hasSet ? decoration->second.set : 0;
+      binding.binding = decoration->second.binding;
+
+      const uint32_t pointee = pointerPointee.count(variable.pointerType) ? pointerPointee[variable.pointerType] : 0;
+      const IdInfo& typeInfo = decorations[pointee];
+
+      if (variable.storageClass == StorageClassStorageBuffer) {
+        binding.kind = SpirvResourceKind::STORAGE_BUFFER;
+      } else if (variable.storageClass == StorageClassUniform) {
+        // Before SPIR-V 1.3, storage buffers were Uniform + BufferBlock
+        binding.kind = typeInfo.isBufferBlock ? SpirvResourceKind::STORAGE_BUFFER : SpirvResourceKind::UNIFORM_BUFFER;
+        if (binding.kind == SpirvResourceKind::UNIFORM_BUFFER) {
+          // Rounded up to 16 bytes like D3D12 reflects cbuffers, so the
+          // same padded constant structs fit on both backends
+          binding.blockSize = (GetBlockTypeSize(typeTable, pointee, nullptr) + 15) & ~size_t(15);
+        }
+      } else if (variable.storageClass == StorageClassUniformConstant) {
+        throw std::runtime_error("Unsupported shader resource at binding " + std::to_string(binding.binding) +
+                                 ": only buffers can be bound.");
+      } else {
+        continue;
+      }
+
+      reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const SpirvBinding& a, const SpirvBinding& b) {
+      return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    return reflection;
+  }
+}
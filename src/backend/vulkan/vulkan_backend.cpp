@@ -0,0 +1,508 @@
+#include "vulkan_backend.h"
+
+#if defined(AEGIS_ENABLE_VULKAN)
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "vulkan_buffer.h"
+#include "vulkan_event.h"
+#include "vulkan_kernel.h"
+#include "vulkan_stream.h"
+
+namespace aegis::internal {
+  namespace {
+    /**
+     * @brief The DXC objects of one thread. A compiler instance must not
+     * run two compiles at once, so every compiling thread gets its own.
+     */
+    struct DxcInstances {
+      DxcPtr<IDxcUtils> utils;
+      DxcPtr<IDxcCompiler3> compiler;
+      DxcPtr<IDxcIncludeHandler> includeHandler;
+    };
+
+    DxcInstances& threadDxcInstances() {
+      thread_local DxcInstances instances;
+      if (!instances.includeHandler) {
+        DxcThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, __uuidof(IDxcUtils), instances.utils.PutVoid()));
+        DxcThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler3), instances.compiler.PutVoid()));
+        DxcThrowIfFailed(instances.utils->CreateDefaultIncludeHandler(instances.includeHandler.ReleaseAndGetAddressOf()));
+      }
+      return instances;
+    }
+
+    int deviceTypeRank(VkPhysicalDeviceType type) {
+      switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 4;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return 1; // lavapipe, swiftshader
+        default: return 0;
+      }
+    }
+
+    // Suballocations are multiples of this; buffer alignment requirements
+    // are rarely above it
+    constexpr size_t kMemoryGranularity = 256;
+  }
+
+  std::unique_ptr<VulkanBackend> VulkanBackend::Create(const ContextDesc& desc) {
+    auto backend = std::unique_ptr<VulkanBackend>(new VulkanBackend(desc));
+    backend->Initialize();
+    return backend;
+  }
+
+  VulkanBackend::VulkanBackend(const ContextDesc& desc) :
+      m_instance(VK_NULL_HANDLE), m_physicalDevice(VK_NULL_HANDLE), m_deviceProperties{}, m_memoryProperties{},
+      m_device(VK_NULL_HANDLE), m_queueFamilyIndex(0), m_transferQueueFamilyIndex(0),
+      m_hostPointerAlignment(0), m_getMemoryHostPointerProperties(nullptr),
+      m_maxQueuesPerPool(std::max<uint32_t>(desc.maxHardwareQueues, 1)), m_memoryBlockSize(desc.memoryBlockSize) {}
+
+  VulkanBackend::~VulkanBackend() {
+    if (m_device) {
+      vkDeviceWaitIdle(m_device);
+      m_deviceLocalAllocators.clear(); // Frees the memory blocks
+      vkDestroyDevice(m_device, nullptr);
+    }
+    if (m_instance) {
+      vkDestroyInstance(m_instance, nullptr);
+    }
+  }
+
+  void VulkanBackend::Initialize() {
+    VkApplicationInfo appInfo = {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Aegis";
+    appInfo.pEngineName = "Aegis";
+    appInfo.apiVersion = VK_API_VERSION_1_2;
+
+    std::vector<const char*> layers;
+#if defined(_DEBUG)
+    uint32_t layerCount = 0;
+    vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+    std::vector<VkLayerProperties> availableLayers(layerCount);
+    vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+    for (const auto& layer : availableLayers) {
+      if (std::strcmp(layer.layerName, "VK_LAYER_KHRONOS_validation") == 0) {
+        layers.push_back("VK_LAYER_KHRONOS_validation");
+      }
+    }
+#endif
+
+    VkInstanceCreateInfo instanceInfo = {};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    instanceInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+    instanceInfo.ppEnabledLayerNames = layers.data();
+
+    if (vkCreateInstance(&instanceInfo, nullptr, &m_instance) != VK_SUCCESS) {
+      m_instance = VK_NULL_HANDLE;
+      throw std::runtime_error("No Vulkan 1.2 loader or driver found.");
+    }
+
+    if (!selectPhysicalDevice()) {
+      throw std::runtime_error("No Vulkan 1.2 device with a compute queue and timeline semaphores found.");
+    }
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, families.data());
+
+    // Compute queues: a HIGH pool (if there are two queues or more), then
+    // a NORMAL one. Transfer queues all get the same priority.
+    const uint32_t computeQueueCount = families[m_queueFamilyIndex].queueCount;
+    const uint32_t highQueueCount = std::min(m_maxQueuesPerPool, computeQueueCount / 2);
+    const uint32_t normalQueueCount = std::min(m_maxQueuesPerPool, computeQueueCount - highQueueCount);
+    std::vector<float> computePriorities(highQueueCount, 1.0f);
+    computePriorities.resize(highQueueCount + normalQueueCount, 0.5f);
+
+    std::vector<float> transferPriorities;
+    if (HasTransferQueue()) {
+      transferPriorities.resize(std::min(m_maxQueuesPerPool, families[m_transferQueueFamilyIndex].queueCount), 0.5f);
+    }
+
+    std::vector<VkDeviceQueueCreateInfo> queueInfos;
+    for (const auto& [family, priorities] : {std::pair{m_queueFamilyIndex, &computePriorities},
+                                             std::pair{m_transferQueueFamilyIndex, &transferPriorities}}) {
+      if (priorities->empty()) {
+        continue; // No transfer-only family
+      }
+      VkDeviceQueueCreateInfo queueInfo = {};
+      queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+      queueInfo.queueFamilyIndex = family;
+      queueInfo.queueCount = static_cast<uint32_t>(priorities->size());
+      queueInfo.pQueuePriorities = priorities->data();
+      queueInfos.push_back(queueInfo);
+    }
+
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+
+    // Host pointer import is optional, without it pinned memory is allocated by us
+    std::vector<const char*> extensions;
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    for (const auto& extension : availableExtensions) {
+      if (std::strcmp(extension.extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0) {
+        extensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+      }
+    }
+
+    VkDeviceCreateInfo deviceInfo = {};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = &features12;
+    deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
+    deviceInfo.pQueueCreateInfos = queueInfos.data();
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    deviceInfo.ppEnabledExtensionNames = extensions.data();
+
+    VkThrowIfFailed(vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device));
+    for (const auto& queueInfo : queueInfos) {
+      for (uint32_t i = 0; i < queueInfo.queueCount; ++i) {
+        auto pooled = std::make_unique<VulkanQueue>();
+        vkGetDeviceQueue(m_device, queueInfo.queueFamilyIndex, i, &pooled->queue);
+        pooled->familyIndex = queueInfo.queueFamilyIndex;
+        if (queueInfo.queueFamilyIndex != m_queueFamilyIndex) {
+          pooled->type = StreamType::COPY;
+        } else if (i < highQueueCount) {
+          pooled->priority = StreamPriority::HIGH;
+        }
+        m_queues.push_back(std::move(pooled));
+      }
+    }
+
+    if (!extensions.empty()) {
+      VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = {};
+      hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+      VkPhysicalDeviceProperties2 properties = {};
+      properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      properties.pNext = &hostProperties;
+      vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties);
+
+      m_getMemoryHostPointerProperties = reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+          vkGetDeviceProcAddr(m_device, "vkGetMemoryHostPointerPropertiesEXT"));
+      if (m_getMemoryHostPointerProperties) {
+        m_hostPointerAlignment = static_cast<size_t>(hostProperties.minImportedHostPointerAlignment);
+      }
+    }
+
+    threadDxcInstances(); // Throws here if dxcompiler can't be loaded
+  }
+
+  IDxcCompiler3 *VulkanBackend::GetCompiler() {
+    return threadDxcInstances().compiler.Get();
+  }
+
+  IDxcUtils *VulkanBackend::GetUtils() {
+    return threadDxcInstances().utils.Get();
+  }
+
+  IDxcIncludeHandler *VulkanBackend::GetIncludeHandler() {
+    return threadDxcInstances().includeHandler.Get();
+  }
+
+  bool VulkanBackend::selectPhysicalDevice() {
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+
+    int bestRank = -1;
+    for (auto device : devices) {
+      VkPhysicalDeviceProperties props;
+      vkGetPhysicalDeviceProperties(device, &props);
+      if (props.apiVersion < VK_API_VERSION_1_2) {
+        continue;
+      }
+
+      VkPhysicalDeviceVulkan12Features features12 = {};
+      features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+      VkPhysicalDeviceFeatures2 features = {};
+      features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      features.pNext = &features12;
+      vkGetPhysicalDeviceFeatures2(device, &features);
+      if (!features12.timelineSemaphore) {
+        continue;
+      }
+
+      uint32_t familyCount = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+      std::vector<VkQueueFamilyProperties> families(familyCount);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+      for (uint32_t i = 0; i < familyCount; ++i) {
+        if (!(families[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+          continue;
+        }
+
+        const int rank = deviceTypeRank(props.deviceType);
+        if (rank > bestRank) {
+          bestRank = rank;
+          m_physicalDevice = device;
+          m_deviceProperties = props;
+          m_queueFamilyIndex = i;
+        }
+        break;
+      }
+    }
+
+    if (!m_physicalDevice) {
+      return false;
+    }
+
+    // A transfer-only family is the copy engine. Without one, COPY streams
+    // submit to the compute queue.
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, families.data());
+
+    m_transferQueueFamilyIndex = m_queueFamilyIndex;
+    for (uint32_t i = 0; i < familyCount; ++i) {
+      const VkQueueFlags flags = families[i].queueFlags;
+      if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+        m_transferQueueFamilyIndex = i;
+        break;
+      }
+    }
+
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+    queryCapabilities();
+    return true;
+  }
+
+  void VulkanBackend::queryCapabilities() {
+    m_capabilities.unifiedMemory = m_deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+                                   m_deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+    m_capabilities.dedicatedCopyQueue = HasTransferQueue();
+
+    // Resizable BAR and UMA devices have a host-visible type in the big
+    // device-local heap, others often a 256 MiB window of it
+    const VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i) {
+      const VkMemoryType& type = m_memoryProperties.memoryTypes[i];
+      if ((type.propertyFlags & wanted) == wanted) {
+        m_capabilities.deviceHostVisibleMemory = true;
+        m_capabilities.deviceHostVisibleBytes = std::max(
+            m_capabilities.deviceHostVisibleBytes,
+            static_cast<size_t>(m_memoryProperties.memoryHeaps[type.heapIndex].size));
+      }
+    }
+  }
+
+  uint32_t VulkanBackend::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+    for (VkMemoryPropertyFlags wanted : {required | preferred, required}) {
+      for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i) {
+        if ((typeBits & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+          return i;
+        }
+      }
+    }
+    throw std::runtime_error("No suitable Vulkan memory type found.");
+  }
+
+  VkResult VulkanBackend::GetMemoryHostPointerProperties(const void *hostPointer, VkMemoryHostPointerPropertiesEXT *properties) const {
+    if (!m_getMemoryHostPointerProperties) {
+      return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+    return m_getMemoryHostPointerProperties(m_device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, hostPointer, properties);
+  }
+
+  MemoryAllocator& VulkanBackend::GetDeviceLocalAllocator(uint32_t memoryTypeIndex) {
+    std::lock_guard<std::mutex> lock(m_allocatorsMutex);
+
+    auto& allocator = m_deviceLocalAllocators[memoryTypeIndex];
+    if (!allocator) {
+      VkDevice device = m_device;
+      allocator = std::make_unique<MemoryAllocator>(
+          [device, memoryTypeIndex](size_t byteSize) -> std::unique_ptr<IMemoryHeap> {
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = byteSize;
+            allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+              return nullptr;
+            }
+            return std::make_unique<VulkanHeap>(device, memory);
+          },
+          m_memoryBlockSize,
+          kMemoryGranularity);
+    }
+    return *allocator;
+  }
+
+  MemoryStats VulkanBackend::GetMemoryStats() const {
+    std::lock_guard<std::mutex> lock(m_allocatorsMutex);
+
+    MemoryStats stats;
+    stats.blockSize = m_memoryBlockSize;
+    for (const auto& [index, allocator] : m_deviceLocalAllocators) {
+      stats = CombineMemoryStats(stats, allocator->GetStats());
+    }
+    return stats;
+  }
+
+  VulkanQueue* VulkanBackend::AcquireQueue(StreamType type, StreamPriority priority) {
+    const StreamType poolType = type == StreamType::COPY && HasTransferQueue() ? StreamType::COPY : StreamType::COMPUTE;
+    const StreamPriority poolPriority = poolType == StreamType::COMPUTE && priority != StreamPriority::NORMAL ? StreamPriority::HIGH : StreamPriority::NORMAL;
+
+    std::lock_guard<std::mutex> lock(m_queuesMutex);
+
+    // Falls back to any compute queue if the device has no HIGH pool
+    VulkanQueue* leastUsed = nullptr;
+    for (bool anyPriority : {false, true}) {
+      for (auto& pooled : m_queues) {
+        if (pooled->type != poolType || (!anyPriority && pooled->priority != poolPriority)) {
+          continue;
+        }
+        if (!leastUsed || pooled->streamCount < leastUsed->streamCount) {
+          leastUsed = pooled.get();
+        }
+      }
+      if (leastUsed) {
+        break;
+      }
+    }
+
+    leastUsed->streamCount++;
+    return leastUsed;
+  }
+
+  void VulkanBackend::ReleaseQueue(VulkanQueue *queue) {
+    std::lock_guard<std::mutex> lock(m_queuesMutex);
+    queue->streamCount--;
+  }
+
+  void VulkanBackend::SubmitToQueue(VulkanQueue *queue, uint32_t submitCount, const VkSubmitInfo *submits) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    VkThrowIfFailed(vkQueueSubmit(queue->queue, submitCount, submits, VK_NULL_HANDLE));
+  }
+
+  std::unique_ptr<IComputeStream> VulkanBackend::CreateStream(const StreamDesc& desc) {
+    return std::make_unique<VulkanStream>(this, desc);
+  }
+
+  std::unique_ptr<IComputeEvent> VulkanBackend::CreateEvent() {
+    return std::make_unique<VulkanEvent>(this);
+  }
+
+  std::unique_ptr<IGpuBuffer> VulkanBackend::CreateBuffer(size_t byteSize, GpuMemoryType type) {
+    return std::make_unique<VulkanBuffer>(this, byteSize, type);
+  }
+
+  std::unique_ptr<IGpuBuffer> VulkanBackend::ImportHostMemory(void *hostPointer, size_t byteSize) {
+    const size_t alignment = m_hostPointerAlignment;
+    if (alignment == 0 || byteSize == 0 ||
+        reinterpret_cast<uintptr_t>(hostPointer) % alignment != 0 || byteSize % alignment != 0) {
+      return nullptr;
+    }
+    try {
+      return std::make_unique<VulkanBuffer>(this, hostPointer, byteSize);
+    } catch (const std::runtime_error&) {
+      return nullptr;
+    }
+  }
+
+  std::unique_ptr<IComputeKernel> VulkanBackend::CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                              const KernelDefines& defines, const KernelCompileOptions& options) {
+    return VulkanKernel::Create(this, hlslFilePath, entryPoint, defines, options);
+  }
+
+  std::unique_ptr<IComputeKernel> VulkanBackend::CreateKernelFromSource(const std::string& hlslSource, const std::string& sourceName,
+                                                                        const std::string& entryPoint, const KernelDefines& defines,
+                                                                        const KernelCompileOptions& options) {
+    return VulkanKernel::CreateFromSource(this, hlslSource, sourceName, entryPoint, defines, options);
+  }
+
+  std::unique_ptr<IComputeKernel> VulkanBackend::CreateKernelFromBytecode(const KernelBytecode& bytecode) {
+    if (!bytecode.spirv || bytecode.spirvSize == 0) {
+      throw std::runtime_error("Kernel bytecode has no SPIR-V for the Vulkan backend.");
+    }
+    return VulkanKernel::CreateFromSpirv(this, static_cast<const uint32_t*>(bytecode.spirv), bytecode.spirvSize, bytecode.entryPoint);
+  }
+
+  void VulkanBackend::WaitForIdle() {
+    // Stop the world: one device wait, which needs every queue locked
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(m_queues.size());
+    for (auto& pooled : m_queues) {
+      locks.emplace_back(pooled->mutex);
+    }
+    VkThrowIfFailed(vkDeviceWaitIdle(m_device));
+  }
+
+  size_t VulkanBackend::WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) {
+    std::vector<std::shared_ptr<VulkanTimeline>> timelines; // Keeps the semaphores alive
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < count; ++i) {
+      auto [timeline, value] = static_cast<VulkanEvent*>(events[i])->Get();
+      if (!timeline) {
+        if (!waitAll) return i;
+        continue;
+      }
+      semaphores.push_back(timeline->GetSemaphore());
+      values.push_back(value);
+      indices.push_back(i);
+      timelines.push_back(std::move(timeline));
+    }
+    if (semaphores.empty()) {
+      return 0;
+    }
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.flags = waitAll ? 0 : VK_SEMAPHORE_WAIT_ANY_BIT;
+    waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+    waitInfo.pSemaphores = semaphores.data();
+    waitInfo.pValues = values.data();
+    const uint64_t timeoutNs = timeoutMs == kInfiniteTimeout ? std::numeric_limits<uint64_t>::max() : uint64_t(timeoutMs) * 1000000;
+    const VkResult result = vkWaitSemaphores(m_device, &waitInfo, timeoutNs);
+    if (result == VK_TIMEOUT) {
+      return count;
+    }
+    VkThrowIfFailed(result);
+
+    if (waitAll) {
+      return 0;
+    }
+    for (size_t i = 0; i < timelines.size(); ++i) {
+      if (timelines[i]->GetCompletedValue() >= values[i]) {
+        return indices[i];
+      }
+    }
+    return indices.front(); // Unreachable, the wait returned
+  }
+
+  std::unique_ptr<IComputeEvent> VulkanBackend::CreateHostEvent() {
+    auto event = std::make_unique<VulkanEvent>(this);
+    event->Set(std::make_shared<VulkanTimeline>(m_device, 0), 1);
+    return event;
+  }
+
+  void VulkanBackend::SignalHostEvent(IComputeEvent *event) {
+    auto [timeline, value] = static_cast<VulkanEvent*>(event)->Get();
+    // Signaled again before ResetHostEvent() when callbacks pile up, but
+    // a timeline may only be signaled to a greater value
+    if (timeline->GetCompletedValue() < value) {
+      timeline->Signal(value);
+    }
+  }
+
+  void VulkanBackend::ResetHostEvent(IComputeEvent *event) {
+    static_cast<VulkanEvent*>(event)->Advance();
+  }
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "vulkan_buffer.h"
+
+#if defined(AEGIS_ENABLE_VULKAN)
+
+#include <stdexcept>
+
+namespace aegis::internal {
+  namespace {
+    VkMemoryPropertyFlags GetRequiredMemoryProperties(GpuMemoryType type) {
+      switch (type) {
+        case GpuMemoryType::UPLOAD:
+        case GpuMemoryType::READBACK:
+        case GpuMemoryType::HOST:
+          return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        case GpuMemoryType::DEVICE_HOST_VISIBLE:
+          return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        // case GpuMemoryType::DEVICE_LOCAL:
+        default:
+          return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+      }
+    }
+
+    VkMemoryPropertyFlags GetPreferredMemoryProperties(GpuMemoryType type) {
+      switch (type) {
+        case GpuMemoryType::READBACK:
+        case GpuMemoryType::HOST:
+          return VK_MEMORY_PROPERTY_HOST_CACHED_BIT; // CPU reads from uncached memory are very slow
+        default:
+          return 0;
+      }
+    }
+
+    /**
+     * @brief Lets COPY streams on the transfer queue use the buffer without
+     * queue family ownership transfers.
+     * @param families Storage for the family indices, must outlive bufferInfo.
+     */
+    void SetSharingMode(VulkanBackend* backend, VkBufferCreateInfo& bufferInfo, uint32_t (&families)[2]) {
+      if (!backend->HasTransferQueue()) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        return;
+      }
+      families[0] = backend->GetQueueFamilyIndex();
+      families[1] = backend->GetTransferQueueFamilyIndex();
+      bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      bufferInfo.queueFamilyIndexCount = 2;
+      bufferInfo.pQueueFamilyIndices = families;
+    }
+  }
+
+  VulkanBuffer::VulkanBuffer(VulkanBackend *backend, size_t byteSize, GpuMemoryType type) :
+      m_backend(backend), m_buffer(VK_NULL_HANDLE), m_memory(VK_NULL_HANDLE), m_memoryTypeIndex(0), m_byteSize(byteSize), m_mappedPtr(nullptr), m_memoryType(type), m_hostPointer(nullptr) {
+    auto device = backend->GetDevice();
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_byteSize > 0 ? m_byteSize : 4; // Vulkan rejects empty buffers
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    uint32_t families[2];
+    SetSharingMode(backend, bufferInfo, families);
+
+    VkThrowIfFailed(vkCreateBuffer(device, &bufferInfo, nullptr, &m_buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, m_buffer, &requirements);
+
+    m_memoryTypeIndex = backend->FindMemoryType(
+        requirements.memoryTypeBits,
+        GetRequiredMemoryProperties(type),
+        GetPreferredMemoryProperties(type));
+
+    if (type == GpuMemoryType::DEVICE_LOCAL) {
+      auto& allocator = backend->GetDeviceLocalAllocator(m_memoryTypeIndex);
+      m_allocation = allocator.Allocate(requirements.size, requirements.alignment);
+      if (!m_allocation) {
+        vkDestroyBuffer(device, m_buffer, nullptr);
+        throw std::runtime_error("Out of device memory.");
+      }
+
+      auto heap = static_cast<VulkanHeap*>(m_allocation.heap);
+      VkResult result = vkBindBufferMemory(device, m_buffer, heap->GetMemory(), m_allocation.offset);
+      if (result != VK_SUCCESS) {
+        vkDestroyBuffer(device, m_buffer, nullptr);
+        allocator.Free(m_allocation);
+        VkThrowIfFailed(result);
+      }
+      return;
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = m_memoryTypeIndex;
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &m_memory);
+    if (result != VK_SUCCESS) {
+      vkDestroyBuffer(device, m_buffer, nullptr);
+      VkThrowIfFailed(result);
+    }
+
+    VkThrowIfFailed(vkBindBufferMemory(device, m_buffer, m_memory, 0));
+  }
+
+  VulkanBuffer::VulkanBuffer(VulkanBackend *backend, void *hostPointer, size_t byteSize) :
+      m_backend(backend), m_buffer(VK_NULL_HANDLE), m_memory(VK_NULL_HANDLE), m_memoryTypeIndex(0), m_byteSize(byteSize), m_mappedPtr(nullptr),
+      m_memoryType(GpuMemoryType::HOST), m_hostPointer(hostPointer) {
+    auto device = backend->GetDevice();
+
+    VkExternalMemoryBufferCreateInfo externalInfo = {};
+    externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext = &externalInfo;
+    bufferInfo.size = m_byteSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    uint32_t families[2];
+    SetSharingMode(backend, bufferInfo, families);
+
+    VkThrowIfFailed(vkCreateBuffer(device, &bufferInfo, nullptr, &m_buffer));
+
+    try {
+      VkMemoryRequirements requirements;
+      vkGetBufferMemoryRequirements(device, m_buffer, &requirements);
+      if (requirements.size > m_byteSize) {
+        throw std::runtime_error("Host memory is too small for the imported buffer.");
+      }
+
+      VkMemoryHostPointerPropertiesEXT pointerProperties = {};
+      pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+      VkThrowIfFailed(backend->GetMemoryHostPointerProperties(hostPointer, &pointerProperties));
+
+      m_memoryTypeIndex = backend->FindMemoryType(
+          requirements.memoryTypeBits & pointerProperties.memoryTypeBits,
+          GetRequiredMemoryProperties(m_memoryType),
+          GetPreferredMemoryProperties(m_memoryType));
+
+      VkImportMemoryHostPointerInfoEXT importInfo = {};
+      importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+      importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+      importInfo.pHostPointer = hostPointer;
+
+      VkMemoryAllocateInfo allocInfo = {};
+      allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+      allocInfo.pNext = &importInfo;
+      allocInfo.allocationSize = m_byteSize;
+      allocInfo.memoryTypeIndex = m_memoryTypeIndex;
+
+      VkThrowIfFailed(vkAllocateMemory(device, &allocInfo, nullptr, &m_memory));
+      VkThrowIfFailed(vkBindBufferMemory(device, m_buffer, m_memory, 0));
+    } catch (...) {
+      if (m_memory) {
+        vkFreeMemory(device, m_memory, nullptr);
+      }
+      vkDestroyBuffer(device, m_buffer, nullptr);
+      throw;
+    }
+  }
+
+  VulkanBuffer::~VulkanBuffer() {
+    auto device = m_backend->GetDevice();
+    if (m_mappedPtr) {
+      Unmap();
+    }
+    vkDestroyBuffer(device, m_buffer, nullptr);
+    if (m_allocation) {
+      m_backend->GetDeviceLocalAllocator(m_memoryTypeIndex).Free(m_allocation);
+    }
+    if (m_memory) {
+      vkFreeMemory(device, m_memory, nullptr);
+    }
+  }
+
+  size_t VulkanBuffer::GetSizeInBytes() const {
+    return m_byteSize;
+  }
+
+  void *VulkanBuffer::Map() {
+    if (m_hostPointer) {
+      return m_hostPointer; // Imported memory is the user's own
+    }
+    if (m_mappedPtr) {
+      return m_mappedPtr;
+    }
+    if (m_memoryType == GpuMemoryType::DEVICE_LOCAL) {
+      throw std::runtime_error("DEVICE_LOCAL buffers cannot be mapped.");
+    }
+
+    VkThrowIfFailed(vkMapMemory(m_backend->GetDevice(), m_memory, 0, VK_WHOLE_SIZE, 0, &m_mappedPtr));
+    return m_mappedPtr;
+  }
+
+  void VulkanBuffer::Unmap() {
+    if (!m_mappedPtr) {
+      return;
+    }
+    // The memory is HOST_COHERENT, so no flush/invalidate is needed
+    vkUnmapMemory(m_backend->GetDevice(), m_memory);
+    m_mappedPtr = nullptr;
+  }
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "vulkan_event.h"
+
+#if defined(AEGIS_ENABLE_VULKAN)
+#include <limits>
+#include <stdexcept>
+
+namespace aegis::internal {
+  VulkanTimeline::VulkanTimeline(VkDevice device, uint64_t initialValue) : m_device(device), m_semaphore(VK_NULL_HANDLE) {
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VkThrowIfFailed(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore));
+  }
+
+  VulkanTimeline::~VulkanTimeline() {
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+  }
+
+  uint64_t VulkanTimeline::GetCompletedValue() const {
+    uint64_t value = 0;
+    VkThrowIfFailed(vkGetSemaphoreCounterValue(m_device, m_semaphore, &value));
+    return value;
+  }
+
+  void VulkanTimeline::Wait(uint64_t value) const {
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    VkThrowIfFailed(vkWaitSemaphores(m_device, &waitInfo, std::numeric_limits<uint64_t>::max()));
+  }
+
+  bool VulkanTimeline::Wait(uint64_t value, uint32_t timeoutMs) const {
+    if (timeoutMs == kInfiniteTimeout) {
+      Wait(value);
+      return true;
+    }
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    const VkResult result = vkWaitSemaphores(m_device, &waitInfo, uint64_t(timeoutMs) * 1000000);
+    if (result == VK_TIMEOUT) {
+      return false;
+    }
+    VkThrowIfFailed(result);
+    return true;
+  }
+
+  void VulkanTimeline::Signal(uint64_t value) {
+    VkSemaphoreSignalInfo signalInfo = {};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    signalInfo.semaphore = m_semaphore;
+    signalInfo.value = value;
+    VkThrowIfFailed(vkSignalSemaphore(m_device, &signalInfo));
+  }
+
+  VulkanEvent::VulkanEvent(VulkanBackend *backend) : m_backend(backend), m_value(0) {}
+
+  VulkanEvent::~VulkanEvent() {}
+
+  void VulkanEvent::Set(std::shared_ptr<VulkanTimeline> timeline, uint64_t value, std::shared_ptr<SubmissionTimeline> submission) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timeline = std::move(timeline);
+    m_value = value;
+    m_submission = std::move(submission);
+  }
+
+  std::pair<std::shared_ptr<VulkanTimeline>, uint64_t> VulkanEvent::Get() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_timeline, m_value};
+  }
+
+  std::shared_ptr<SubmissionTimeline> VulkanEvent::GetSubmission() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_submission;
+  }
+
+  void VulkanEvent::Advance() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_value++;
+  }
+
+  bool VulkanEvent::IsComplete() const {
+    auto [timeline, value] = Get();
+    return !timeline || timeline->GetCompletedValue() >= value;
+  }
+
+  uint64_t VulkanEvent::GetFenceValue() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_value;
+  }
+
+  std::unique_ptr<IComputeEvent> VulkanEvent::Clone() const {
+    auto clone = std::make_unique<VulkanEvent>(m_backend);
+    auto [fence, value] = Get();
+    clone->Set(std::move(fence), value, GetSubmission());
+    return clone;
+  }
+}
+
+#endif
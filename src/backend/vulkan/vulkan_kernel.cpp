@@ -0,0 +1,176 @@
+#include "vulkan_kernel.h"
+
+#if defined(AEGIS_ENABLE_VULKAN)
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <vector>
+
+namespace aegis::internal {
+  namespace {
+    VkDescriptorType ToDescriptorType(SpirvResourceKind kind) {
+      switch (kind) {
+        case SpirvResourceKind::UNIFORM_BUFFER: return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        // case SpirvResourceKind::STORAGE_BUFFER:
+        default: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      }
+    }
+  }
+
+  VulkanKernel::VulkanKernel(VulkanBackend *backend, std::vector<SpirvBinding> bindings) :
+      m_backend(backend), m_descriptorSetLayout(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE),
+      m_pipeline(VK_NULL_HANDLE), m_bindings(std::move(bindings)) {}
+
+  VulkanKernel::~VulkanKernel() {
+    auto device = m_backend->GetDevice();
+    vkDestroyPipeline(device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+  }
+
+  const SpirvBinding *VulkanKernel::FindConstants(uint32_t slot) const {
+    for (const SpirvBinding& binding : m_bindings) {
+      if (binding.kind == SpirvResourceKind::UNIFORM_BUFFER && binding.binding == kConstantBindingShift + slot) {
+        return &binding;
+      }
+    }
+    return nullptr;
+  }
+
+  bool VulkanKernel::HasConstants() const {
+    return std::any_of(m_bindings.begin(), m_bindings.end(), [](const SpirvBinding& binding) {
+      return binding.kind == SpirvResourceKind::UNIFORM_BUFFER;
+    });
+  }
+
+  std::unique_ptr<VulkanKernel> VulkanKernel::Create(VulkanBackend *backend, const std::string &hlslFilePath,
+                                                      const std::string &entryPoint, const KernelDefines &defines,
+                                                      const KernelCompileOptions &options) {
+    std::ifstream shaderFile(hlslFilePath, std::ios::binary);
+    if (!shaderFile.is_open()) {
+      throw std::runtime_error("Failed to open HLSL file: " + hlslFilePath);
+    }
+    std::string hlslCode((std::istreambuf_iterator<char>(shaderFile)), std::istreambuf_iterator<char>());
+
+    return CreateFromSource(backend, hlslCode, hlslFilePath, entryPoint, defines, options);
+  }
+
+  std::unique_ptr<VulkanKernel> VulkanKernel::CreateFromSource(VulkanBackend *backend, const std::string &hlslCode,
+                                                                const std::string &sourceName, const std::string &entryPoint,
+                                                                const KernelDefines &defines, const KernelCompileOptions &options) {
+    auto compiler = backend->GetCompiler();
+    auto includeHandler = backend->GetIncludeHandler();
+
+    std::wstring wFilePath(sourceName.begin(), sourceName.end());
+    const std::vector<std::wstring> compileArguments = GetCompileArguments(entryPoint, defines, options);
+
+    std::vector<LPCWSTR> arguments;
+    arguments.push_back(wFilePath.c_str());
+    for (const std::wstring& argument : compileArguments) {
+      arguments.push_back(argument.c_str());
+    }
+    arguments.push_back(L"-spirv"); // Emit SPIR-V instead of DXIL
+    arguments.push_back(L"-fspv-target-env=vulkan1.2");
+    // b0 and u0 would both be binding 0, SetBuffer() and SetConstants() have separate slots
+    const std::wstring constantShift = std::to_wstring(kConstantBindingShift);
+    arguments.push_back(L"-fvk-b-shift");
+    arguments.push_back(constantShift.c_str());
+    arguments.push_back(L"0");
+
+    DxcBuffer sourceBuffer;
+    sourceBuffer.Ptr = hlslCode.data();
+    sourceBuffer.Size = hlslCode.size();
+    sourceBuffer.Encoding = DXC_CP_UTF8;
+
+    DxcPtr<IDxcResult> compileResult;
+    DxcThrowIfFailed(compiler->Compile(
+      &sourceBuffer,
+      arguments.data(),
+      static_cast<UINT32>(arguments.size()),
+      includeHandler,
+      __uuidof(IDxcResult),
+      compileResult.PutVoid()
+    ));
+
+    HRESULT compileStatus = S_OK;
+    DxcThrowIfFailed(compileResult->GetStatus(&compileStatus));
+    if (FAILED(compileStatus)) {
+      DxcPtr<IDxcBlobUtf8> errors;
+      compileResult->GetOutput(DXC_OUT_ERRORS, __uuidof(IDxcBlobUtf8), errors.PutVoid(), nullptr);
+      std::string errStr = errors ? std::string(errors->GetStringPointer(), errors->GetStringLength()) : "Unknown DXC compile error";
+      throw std::runtime_error("Shader compilation failed: " + errStr);
+    }
+
+    DxcPtr<IDxcBlob> spirv;
+    DxcThrowIfFailed(compileResult->GetOutput(DXC_OUT_OBJECT, __uuidof(IDxcBlob), spirv.PutVoid(), nullptr));
+
+    return CreateFromSpirv(backend, static_cast<const uint32_t*>(spirv->GetBufferPointer()), spirv->GetBufferSize(),
+                           entryPoint);
+  }
+
+  std::unique_ptr<VulkanKernel> VulkanKernel::CreateFromSpirv(VulkanBackend *backend, const uint32_t *spirvCode,
+                                                               size_t spirvSize, const std::string &entryPoint) {
+    auto device = backend->GetDevice();
+
+    SpirvReflection reflection = ReflectSpirv(spirvCode, spirvSize);
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    for (const auto& binding : reflection.bindings) {
+      if (binding.set != 0) {
+        // SetBuffer(slot) only addresses space0
+        throw std::runtime_error("Only register space 0 is supported (binding " +
+                                 std::to_string(binding.binding) + " is in space " + std::to_string(binding.set) + ")");
+      }
+
+      if (binding.kind == SpirvResourceKind::UNIFORM_BUFFER && binding.binding < kConstantBindingShift) {
+        throw std::runtime_error("cbuffer binding " + std::to_string(binding.binding) +
+                                 " is below the constant range, compile with -fvk-b-shift " +
+                                 std::to_string(kConstantBindingShift) + " 0.");
+      }
+
+      VkDescriptorSetLayoutBinding layoutBinding = {};
+      layoutBinding.binding = binding.binding;
+      layoutBinding.descriptorType = ToDescriptorType(binding.kind);
+      layoutBinding.descriptorCount = 1;
+      layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+      layoutBindings.push_back(layoutBinding);
+    }
+
+    auto kernel = std::unique_ptr<VulkanKernel>(new VulkanKernel(backend, std::move(reflection.bindings)));
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    setLayoutInfo.pBindings = layoutBindings.data();
+    VkThrowIfFailed(vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &kernel->m_descriptorSetLayout));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &kernel->m_descriptorSetLayout;
+    VkThrowIfFailed(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &kernel->m_pipelineLayout));
+
+    VkShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = spirvSize;
+    moduleInfo.pCode = spirvCode;
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkThrowIfFailed(vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule));
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = entryPoint.c_str(); // DXC keeps the HLSL entry point name
+    pipelineInfo.layout = kernel->m_pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &kernel->m_pipeline);
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+    VkThrowIfFailed(result);
+
+    return kernel;
+  }
+}
+#endif
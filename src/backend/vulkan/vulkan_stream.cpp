@@ -0,0 +1,596 @@
+#include "vulkan_stream.h"
+#include "vulkan_buffer.h"
+#include "vulkan_kernel.h"
+#include "vulkan_event.h"
+
+#if defined(AEGIS_ENABLE_VULKAN)
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace aegis::internal {
+  namespace {
+    constexpr uint32_t kDescriptorPoolMaxSets = 256;
+    constexpr uint32_t kDescriptorPoolStorageBuffers = 1024;
+    constexpr uint32_t kDescriptorPoolUniformBuffers = 256;
+
+    // vkCmdCopyBuffer() has no alignment rules, this just keeps the
+    // staging memcpy()s aligned.
+    constexpr size_t kUploadAlignment = 16;
+    constexpr size_t kReadbackAlignment = 16;
+    constexpr size_t kConstantRingSize = 64 * 1024;
+    constexpr size_t kConstantBlockAlignment = 16; // Keeps the block memcpy()s aligned
+  }
+
+  VulkanStream::VulkanStream(VulkanBackend *backend, const StreamDesc& desc) :
+      m_backend(backend), m_type(desc.type), m_queue(nullptr), m_commandPool(VK_NULL_HANDLE), m_fenceValue(1), m_submittedValue(0), m_recordedValue(0),
+      m_maxInFlight(std::max<uint32_t>(desc.maxInFlightSubmissions, 1)), m_currentKernel(nullptr),
+      m_hasPriorWork(false), m_recordingResources{}, m_currentDescriptorPool(VK_NULL_HANDLE),
+      m_uploadRing(backend, GpuMemoryType::UPLOAD, desc.uploadRingSize, [this](uint64_t value) { m_timeline->Wait(value); }),
+      m_constantRing(backend, GpuMemoryType::UPLOAD, kConstantRingSize, [this](uint64_t value) { m_timeline->Wait(value); }),
+      m_readbackArena(backend, GpuMemoryType::READBACK, desc.readbackArenaSize,
+                      [this](uint64_t value) { m_timeline->Wait(value); finishReadbacks(value); }) {
+    auto device = m_backend->GetDevice();
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_type == StreamType::COPY ? m_backend->GetTransferQueueFamilyIndex()
+                                                           : m_backend->GetQueueFamilyIndex();
+    VkThrowIfFailed(vkCreateCommandPool(device, &poolInfo, nullptr, &m_commandPool));
+
+    m_timeline = std::make_shared<VulkanTimeline>(device, 0);
+    m_submission = std::make_shared<SubmissionTimeline>();
+
+    // Acquired last, nothing releases it if the constructor throws
+    m_queue = m_backend->AcquireQueue(m_type, desc.priority);
+  }
+
+  VulkanStream::~VulkanStream() {
+    // Let the GPU finish with everything this stream owns
+    m_timeline->Wait(m_submittedValue);
+    reclaimCompleted();
+
+    auto device = m_backend->GetDevice();
+    if (m_currentDescriptorPool) {
+      m_freeDescriptorPools.push_back(m_currentDescriptorPool);
+    }
+    for (auto pool : m_recordingResources.descriptorPools) {
+      m_freeDescriptorPools.push_back(pool);
+    }
+    for (auto pool : m_freeDescriptorPools) {
+      vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    vkDestroyCommandPool(device, m_commandPool, nullptr); // Frees every command buffer
+    m_backend->ReleaseQueue(m_queue);
+  }
+
+  void VulkanStream::reclaimCompleted() {
+    const uint64_t completed = m_timeline->GetCompletedValue();
+    auto device = m_backend->GetDevice();
+
+    while (!m_inFlight.empty() && m_inFlight.front().fenceValue <= completed) {
+      auto& submission = m_inFlight.front();
+      for (auto commandBuffer : submission.commandBuffers) {
+        vkResetCommandBuffer(commandBuffer, 0);
+        m_freeCommandBuffers.push_back(commandBuffer);
+      }
+      for (auto pool : submission.descriptorPools) {
+        vkResetDescriptorPool(device, pool, 0);
+        m_freeDescriptorPools.push_back(pool);
+      }
+      m_inFlight.pop_front();
+    }
+    m_uploadRing.Reclaim(completed);
+    m_constantRing.Reclaim(completed);
+  }
+
+  void VulkanStream::beginCommands() {
+    if (m_currentSegment.commandBuffer) {
+      return;
+    }
+
+    reclaimCompleted();
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!m_freeCommandBuffers.empty()) {
+      commandBuffer = m_freeCommandBuffers.back();
+      m_freeCommandBuffers.pop_back();
+    } else {
+      VkCommandBufferAllocateInfo allocInfo = {};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.commandPool = m_commandPool;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocInfo.commandBufferCount = 1;
+      VkThrowIfFailed(vkAllocateCommandBuffers(m_backend->GetDevice(), &allocInfo, &commandBuffer));
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkThrowIfFailed(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    m_currentSegment.commandBuffer = commandBuffer;
+    m_recordingResources.commandBuffers.push_back(commandBuffer);
+    m_recordedValue = m_fenceValue;
+  }
+
+  void VulkanStream::closeSegment() {
+    flushUploads();
+
+    if (m_currentSegment.commandBuffer) {
+      VkThrowIfFailed(vkEndCommandBuffer(m_currentSegment.commandBuffer));
+    }
+
+    const bool isEmpty = !m_currentSegment.commandBuffer &&
+                         m_currentSegment.waitTimelines.empty() &&
+                         m_currentSegment.signalTimelines.empty();
+    if (!isEmpty) {
+      m_closedSegments.push_back(std::move(m_currentSegment));
+    }
+    m_currentSegment = Segment{};
+  }
+
+  void VulkanStream::memoryBarrier(VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    beginCommands();
+
+    // Earlier commands of this stream may live in an earlier command buffer
+    // or submission; pipeline barriers cover everything before them in
+    // queue submission order, so one barrier is enough either way.
+    if (!m_hasPriorWork) {
+      m_hasPriorWork = true;
+      return;
+    }
+
+    // Transfer-only queues have no shader stages to wait for
+    const bool isCopy = m_type == StreamType::COPY;
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = isCopy ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(
+        m_currentSegment.commandBuffer,
+        isCopy ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        dstStage,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+  }
+
+  void VulkanStream::flushUploads() {
+    if (m_pendingUploads.empty()) {
+      return;
+    }
+
+    memoryBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    for (const auto& upload : m_pendingUploads) {
+      VkBufferCopy region = {};
+      region.srcOffset = upload.stagingOffset;
+      region.dstOffset = upload.destOffset;
+      region.size = upload.byteSize;
+      vkCmdCopyBuffer(m_currentSegment.commandBuffer,
+                      static_cast<VulkanBuffer*>(upload.staging)->GetBuffer(),
+                      upload.dest->GetBuffer(), 1, &region);
+    }
+    m_pendingUploads.clear();
+  }
+
+  VkDescriptorSet VulkanStream::allocateDescriptorSet(VkDescriptorSetLayout layout) {
+    auto device = m_backend->GetDevice();
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      if (!m_currentDescriptorPool) {
+        if (!m_freeDescriptorPools.empty()) {
+          m_currentDescriptorPool = m_freeDescriptorPools.back();
+          m_freeDescriptorPools.pop_back();
+        } else {
+          VkDescriptorPoolSize poolSizes[] = {
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, kDescriptorPoolStorageBuffers},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, kDescriptorPoolUniformBuffers},
+          };
+          VkDescriptorPoolCreateInfo poolInfo = {};
+          poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+          poolInfo.maxSets = kDescriptorPoolMaxSets;
+          poolInfo.poolSizeCount = 2;
+          poolInfo.pPoolSizes = poolSizes;
+          VkThrowIfFailed(vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_currentDescriptorPool));
+        }
+        m_recordingResources.descriptorPools.push_back(m_currentDescriptorPool);
+      }
+
+      VkDescriptorSetAllocateInfo allocInfo = {};
+      allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+      allocInfo.descriptorPool = m_currentDescriptorPool;
+      allocInfo.descriptorSetCount = 1;
+      allocInfo.pSetLayouts = &layout;
+
+      VkDescriptorSet set = VK_NULL_HANDLE;
+      VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+      if (result == VK_SUCCESS) {
+        return set;
+      }
+      if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+        VkThrowIfFailed(result);
+      }
+      m_currentDescriptorPool = VK_NULL_HANDLE; // Full, move on to another pool
+    }
+    throw std::runtime_error("Failed to allocate a descriptor set.");
+  }
+
+  void VulkanStream::SetKernel(IComputeKernel *kernel) {
+    m_currentKernel = static_cast<VulkanKernel*>(kernel);
+  }
+
+  void VulkanStream::SetBuffer(uint32_t slot, IGpuBuffer *buffer, size_t offset, size_t byteSize, BufferAccess access) {
+    CheckBufferRange(buffer, offset, byteSize, "Bound range is outside the buffer.");
+    if (slot >= m_boundBuffers.size()) {
+      m_boundBuffers.resize(slot + 1);
+    }
+    m_boundBuffers[slot] = {static_cast<VulkanBuffer*>(buffer), offset, byteSize};
+  }
+
+  void VulkanStream::SetConstants(uint32_t slot, const void *data, size_t byteSize) {
+    if (!m_currentKernel) {
+      throw std::runtime_error("No kernel set before SetConstants().");
+    }
+    const SpirvBinding* constants = m_currentKernel->FindConstants(slot);
+    if (!constants) {
+      throw std::runtime_error("The kernel has no cbuffer at register b" + std::to_string(slot) + ".");
+    }
+    if (byteSize > constants->blockSize) {
+      throw std::runtime_error("Constants are larger than the cbuffer.");
+    }
+
+    // Without push constant annotations in the HLSL every cbuffer is a
+    // uniform buffer. The shader may read the whole block, so it covers it.
+    // Upload memory is host coherent, the submit makes the write visible.
+    const size_t blockSize = constants->blockSize;
+    const size_t alignment = std::max<size_t>(m_backend->GetDeviceProperties().limits.minUniformBufferOffsetAlignment,
+                                              kConstantBlockAlignment);
+    m_constantRing.Reclaim(m_timeline->GetCompletedValue());
+    auto block = m_constantRing.Allocate(blockSize, alignment);
+    std::memcpy(block.cpuAddress, data, byteSize);
+    std::memset(static_cast<uint8_t*>(block.cpuAddress) + byteSize, 0, blockSize - byteSize);
+
+    if (slot >= m_boundConstants.size()) {
+      m_boundConstants.resize(slot + 1);
+    }
+    m_boundConstants[slot] = {static_cast<VulkanBuffer*>(block.buffer), block.offset, blockSize};
+  }
+
+  void VulkanStream::RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) {
+    if (!m_currentKernel) {
+      throw std::runtime_error("No kernel set before dispatch.");
+    }
+
+    const auto& bindings = m_currentKernel->GetBindings();
+    std::vector<VkDescriptorBufferInfo> bufferInfos(bindings.size());
+    std::vector<VkWriteDescriptorSet> writes(bindings.size());
+
+    VkDescriptorSet set = allocateDescriptorSet(m_currentKernel->GetDescriptorSetLayout());
+    const VkPhysicalDeviceLimits& limits = m_backend->GetDeviceProperties().limits;
+
+    for (size_t i = 0; i < bindings.size(); ++i) {
+      // cbuffers are shifted past the u# registers, see kConstantBindingShift
+      const bool isUniform = bindings[i].kind == SpirvResourceKind::UNIFORM_BUFFER;
+      const uint32_t slot = isUniform ? bindings[i].binding - kConstantBindingShift : bindings[i].binding;
+      const std::vector<BoundBuffer>& table = isUniform ? m_boundConstants : m_boundBuffers;
+      if (slot >= table.size() || !table[slot].buffer) {
+        throw std::runtime_error(isUniform ? "No constants set for register b" + std::to_string(slot) + " before dispatch."
+                                           : "No buffer bound to slot " + std::to_string(slot) + " before dispatch.");
+      }
+
+      const BoundBuffer& bound = table[slot];
+      const VkDeviceSize offsetAlignment = isUniform ? limits.minUniformBufferOffsetAlignment
+                                                     : limits.minStorageBufferOffsetAlignment;
+      if (bound.offset % offsetAlignment != 0) {
+        throw std::runtime_error("Buffer bound to slot " + std::to_string(slot) + " has a misaligned offset.");
+      }
+
+      bufferInfos[i].buffer = bound.buffer->GetBuffer();
+      bufferInfos[i].offset = bound.offset;
+      bufferInfos[i].range = bound.byteSize > 0 ? bound.byteSize : VK_WHOLE_SIZE;
+
+      writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet = set;
+      writes[i].dstBinding = bindings[i].binding;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType = isUniform ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(m_backend->GetDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    flushUploads();
+    memoryBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    auto commandBuffer = m_currentSegment.commandBuffer;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_currentKernel->GetPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_currentKernel->GetPipelineLayout(),
+                            0, 1, &set, 0, nullptr);
+    vkCmdDispatch(commandBuffer, threadGroupsX, threadGroupsY, threadGroupsZ);
+  }
+
+  void VulkanStream::ResourceCopyBuffer(IGpuBuffer *dest, size_t destOffset, IGpuBuffer *src, size_t srcOffset, size_t byteSize) {
+    VulkanBuffer* vkDest = static_cast<VulkanBuffer*>(dest);
+    VulkanBuffer* vkSrc = static_cast<VulkanBuffer*>(src);
+    CheckBufferRange(vkDest, destOffset, byteSize, "Copy destination range is outside the buffer.");
+    CheckBufferRange(vkSrc, srcOffset, byteSize, "Copy source range is outside the buffer.");
+    if (vkDest == vkSrc && destOffset < srcOffset + byteSize && srcOffset < destOffset + byteSize) {
+      throw std::runtime_error("Copy source and destination ranges overlap.");
+    }
+    if (byteSize == 0) {
+      return;
+    }
+
+    flushUploads();
+    memoryBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    VkBufferCopy region = {};
+    region.srcOffset = srcOffset;
+    region.dstOffset = destOffset;
+    region.size = byteSize;
+    vkCmdCopyBuffer(m_currentSegment.commandBuffer, vkSrc->GetBuffer(), vkDest->GetBuffer(), 1, &region);
+
+    if (vkDest->GetMemoryType() == GpuMemoryType::HOST) {
+      // Pinned host memory is read by the CPU once the submission completes
+      VkMemoryBarrier barrier = {};
+      barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+      vkCmdPipelineBarrier(m_currentSegment.commandBuffer,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                           1, &barrier, 0, nullptr, 0, nullptr);
+    }
+  }
+
+  void VulkanStream::ResourceUpload(IGpuBuffer *dest, size_t destOffset, const void *srcData, size_t byteSize) {
+    VulkanBuffer* vkDest = static_cast<VulkanBuffer*>(dest);
+    CheckBufferRange(vkDest, destOffset, byteSize, "Upload range is outside the destination buffer.");
+    if (byteSize == 0) {
+      return;
+    }
+
+    // Overlapping copies into the same buffer must be separated by a barrier,
+    // disjoint ranges (e.g., tensors packed into one buffer) can share one
+    auto overlaps = [vkDest, destOffset, byteSize](const PendingUpload& upload) {
+      return upload.dest == vkDest &&
+             destOffset < upload.destOffset + upload.byteSize && upload.destOffset < destOffset + byteSize;
+    };
+    if (std::any_of(m_pendingUploads.begin(), m_pendingUploads.end(), overlaps)) {
+      flushUploads();
+    }
+
+    m_uploadRing.Reclaim(m_timeline->GetCompletedValue());
+    auto staging = m_uploadRing.Allocate(byteSize, kUploadAlignment);
+    std::memcpy(staging.cpuAddress, srcData, byteSize);
+
+    // The copy itself is recorded lazily so back-to-back uploads share one barrier
+    m_pendingUploads.push_back({vkDest, destOffset, staging.buffer, staging.offset, byteSize});
+    m_recordedValue = m_fenceValue;
+  }
+
+  std::shared_ptr<ReadbackCopy> VulkanStream::ResourceDownload(const void *destData, IGpuBuffer *src, size_t srcOffset, size_t byteSize) {
+    VulkanBuffer* vkSrc = static_cast<VulkanBuffer*>(src);
+    CheckBufferRange(vkSrc, srcOffset, byteSize, "Download range is outside the source buffer.");
+    if (byteSize == 0) {
+      return nullptr;
+    }
+
+    flushUploads();
+    collectReadbacks();
+    memoryBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    auto staging = m_readbackArena.Allocate(byteSize, kReadbackAlignment);
+
+    VkBufferCopy region = {};
+    region.srcOffset = srcOffset;
+    region.dstOffset = staging.offset;
+    region.size = byteSize;
+    vkCmdCopyBuffer(m_currentSegment.commandBuffer, vkSrc->GetBuffer(),
+                    static_cast<VulkanBuffer*>(staging.buffer)->GetBuffer(), 1, &region);
+
+    // Make the copy visible to the host once the submission completes
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(m_currentSegment.commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    auto copy = std::make_shared<ReadbackCopy>(staging.cpuAddress, const_cast<void*>(destData), byteSize);
+    m_pendingReadbacks.push_back({copy, 0});
+    return copy;
+  }
+
+  void VulkanStream::collectReadbacks() {
+    while (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().copy->IsDone()) {
+      m_pendingReadbacks.pop_front();
+    }
+
+    // Staging memory of downloads nobody copied out yet must stay
+    uint64_t reclaimable = m_timeline->GetCompletedValue();
+    if (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().fenceValue != 0) {
+      reclaimable = std::min(reclaimable, m_pendingReadbacks.front().fenceValue - 1);
+    }
+    m_readbackArena.Reclaim(reclaimable);
+  }
+
+  void VulkanStream::finishReadbacks(uint64_t fenceValue) {
+    while (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().fenceValue != 0 &&
+           m_pendingReadbacks.front().fenceValue <= fenceValue) {
+      m_pendingReadbacks.front().copy->Finish();
+      m_pendingReadbacks.pop_front();
+    }
+  }
+
+
+  void VulkanStream::Submit() {
+    closeSegment();
+    if (m_closedSegments.empty()) {
+      return;
+    }
+
+    // A wait for a value that isn't on a queue yet could end up in front
+    // of its own signal, if the signaling stream shares this queue
+    for (const Segment& segment : m_closedSegments) {
+      for (size_t i = 0; i < segment.waitSubmissions.size(); ++i) {
+        if (segment.waitSubmissions[i]) {
+          segment.waitSubmissions[i]->WaitSubmitted(segment.waitValues[i]);
+        }
+      }
+    }
+
+    // The stream timeline is signaled once everything before it is done. A
+    // trailing RecordEvent() already signals it, so that gets its own segment.
+    const uint64_t fenceValue = m_fenceValue++;
+    if (!m_closedSegments.back().signalTimelines.empty() &&
+        m_closedSegments.back().signalTimelines.back() == m_timeline) {
+      m_closedSegments.emplace_back();
+    }
+    m_closedSegments.back().signalTimelines.push_back(m_timeline);
+    m_closedSegments.back().signalValues.push_back(fenceValue);
+
+    const size_t segmentCount = m_closedSegments.size();
+    std::vector<VkSubmitInfo> submits(segmentCount);
+    std::vector<VkTimelineSemaphoreSubmitInfo> timelineInfos(segmentCount);
+    std::vector<std::vector<VkSemaphore>> waitSemaphores(segmentCount);
+    std::vector<std::vector<VkPipelineStageFlags>> waitStages(segmentCount);
+    std::vector<std::vector<VkSemaphore>> signalSemaphores(segmentCount);
+
+    for (size_t i = 0; i < segmentCount; ++i) {
+      Segment& segment = m_closedSegments[i];
+
+      for (auto& timeline : segment.waitTimelines) {
+        waitSemaphores[i].push_back(timeline->GetSemaphore());
+        waitStages[i].push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        m_recordingResources.timelines.push_back(timeline);
+      }
+      for (auto& timeline : segment.signalTimelines) {
+        signalSemaphores[i].push_back(timeline->GetSemaphore());
+        m_recordingResources.timelines.push_back(timeline);
+      }
+
+      timelineInfos[i].sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+      timelineInfos[i].waitSemaphoreValueCount = static_cast<uint32_t>(segment.waitValues.size());
+      timelineInfos[i].pWaitSemaphoreValues = segment.waitValues.data();
+      timelineInfos[i].signalSemaphoreValueCount = static_cast<uint32_t>(segment.signalValues.size());
+      timelineInfos[i].pSignalSemaphoreValues = segment.signalValues.data();
+
+      submits[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submits[i].pNext = &timelineInfos[i];
+      submits[i].waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores[i].size());
+      submits[i].pWaitSemaphores = waitSemaphores[i].data();
+      submits[i].pWaitDstStageMask = waitStages[i].data();
+      submits[i].commandBufferCount = segment.commandBuffer ? 1 : 0;
+      submits[i].pCommandBuffers = segment.commandBuffer ? &segment.commandBuffer : nullptr;
+      submits[i].signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores[i].size());
+      submits[i].pSignalSemaphores = signalSemaphores[i].data();
+    }
+
+    m_backend->SubmitToQueue(m_queue, static_cast<uint32_t>(segmentCount), submits.data());
+    m_closedSegments.clear();
+
+    // Descriptor pools can't be shared with the next submission, they get
+    // reset as a whole once this one completes
+    m_currentDescriptorPool = VK_NULL_HANDLE;
+
+    m_uploadRing.Close(fenceValue);
+    m_constantRing.Close(fenceValue);
+    m_readbackArena.Close(fenceValue);
+    m_recordingResources.fenceValue = fenceValue;
+    m_inFlight.push_back(std::move(m_recordingResources));
+    m_recordingResources = InFlightSubmission{};
+
+    for (auto& readback : m_pendingReadbacks) {
+      if (readback.fenceValue == 0) {
+        readback.fenceValue = fenceValue;
+      }
+    }
+
+    m_submittedValue = fenceValue;
+    m_recordedValue = fenceValue;
+    m_submission->Submitted(fenceValue);
+
+    // Bound how far the CPU runs ahead of the GPU (and how many command
+    // buffers and descriptor pools are held)
+    reclaimCompleted();
+    if (m_inFlight.size() > m_maxInFlight) {
+      m_timeline->Wait(m_inFlight[m_inFlight.size() - 1 - m_maxInFlight].fenceValue);
+    }
+  }
+
+  uint64_t VulkanStream::GetRecordedFenceValue() const {
+    // Submit() signals the next value, which covers everything recorded so far
+    return m_recordedValue;
+  }
+
+  uint64_t VulkanStream::GetSubmittedFenceValue() const {
+    return m_submittedValue;
+  }
+
+  uint64_t VulkanStream::GetCompletedFenceValue() const {
+    return m_timeline->GetCompletedValue();
+  }
+
+  bool VulkanStream::HostWait(uint32_t timeoutMs) {
+    if (!m_timeline->Wait(m_submittedValue, timeoutMs)) {
+      return false;
+    }
+
+    finishReadbacks(m_submittedValue);
+
+    reclaimCompleted();
+    m_readbackArena.Reclaim(m_timeline->GetCompletedValue());
+    return true;
+  }
+
+  StagingStats VulkanStream::GetStagingStats() const {
+    return {m_uploadRing.GetStats(), m_readbackArena.GetStats()};
+  }
+
+  void VulkanStream::StreamWait(IComputeEvent *event) {
+    VulkanEvent* vkEvent = static_cast<VulkanEvent*>(event);
+    auto [timeline, valueToWaitFor] = vkEvent->Get();
+    if (!timeline || timeline == m_timeline) {
+      return; // Never recorded, or recorded earlier on this stream
+    }
+
+    flushUploads();
+
+    // Waits apply before a segment's commands, so start a new segment
+    if (m_currentSegment.commandBuffer || !m_currentSegment.signalTimelines.empty()) {
+      closeSegment();
+    }
+    m_currentSegment.waitTimelines.push_back(std::move(timeline));
+    m_currentSegment.waitValues.push_back(valueToWaitFor);
+    m_currentSegment.waitSubmissions.push_back(vkEvent->GetSubmission());
+    m_recordedValue = m_fenceValue;
+  }
+
+  void VulkanStream::RecordEvent(IComputeEvent *event) {
+    VulkanEvent* vkEvent = static_cast<VulkanEvent*>(event);
+    m_submission->Recorded();
+    if (GetRecordedFenceValue() == m_submittedValue) {
+      // Nothing new since the last Submit(), whose value already marks this point
+      vkEvent->Set(m_timeline, m_submittedValue, m_submission);
+      return;
+    }
+
+    const uint64_t valueToSignal = m_fenceValue++;
+
+    // Signals apply after a segment's commands, so end the segment here
+    m_currentSegment.signalTimelines.push_back(m_timeline);
+    m_currentSegment.signalValues.push_back(valueToSignal);
+    closeSegment();
+    m_recordedValue = m_fenceValue;
+    vkEvent->Set(m_timeline, valueToSignal, m_submission);
+  }
+}
+
+#endif
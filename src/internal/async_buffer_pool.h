@@ -0,0 +1,129 @@
+/**
+ * @file async_buffer_pool.h
+ * @brief Stream-ordered pool behind ComputeStream::AllocAsync()/FreeAsync()
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief Recycles DEVICE_LOCAL buffers in stream order.
+   *
+   * A freed buffer is tagged with the stream it was freed on, that
+   * stream's fence value at the time and a per-stream tick. It can be
+   * handed out again:
+   * - right away to the same stream (later work is ordered after the free),
+   * - to a stream that waited on an event recorded after the free,
+   * - to any stream once the freeing stream's fence passed the tagged value.
+   *
+   * Buffers are matched by exact size, so the returned IGpuBuffer always
+   * reports the requested size. Freed buffers above the release threshold
+   * are destroyed as soon as the GPU is done with them.
+   *
+   * @note All methods are thread-safe.
+   */
+  class AsyncBufferPool {
+  public:
+    /**
+     * @param backend The backend that creates the buffers.
+     * @param releaseThreshold Cached bytes to keep around before releasing buffers.
+     */
+    AsyncBufferPool(IComputeBackend* backend, size_t releaseThreshold);
+    ~AsyncBufferPool();
+
+    AsyncBufferPool(const AsyncBufferPool&) = delete;
+    AsyncBufferPool& operator=(const AsyncBufferPool&) = delete;
+
+    /**
+     * @brief Gets a buffer usable by 'stream', reusing a freed one if possible.
+     */
+    std::unique_ptr<IGpuBuffer> Allocate(IComputeStream* stream, size_t byteSize);
+
+    /**
+     * @brief Returns a buffer to the pool after the work recorded so far on 'stream'.
+     */
+    void Free(IComputeStream* stream, std::unique_ptr<IGpuBuffer> buffer);
+
+    /**
+     * @brief Accounts for a pooled buffer that was destroyed instead of freed.
+     */
+    void Discard(size_t byteSize);
+
+    /**
+     * @brief Remembers which frees an event recorded on 'stream' covers.
+     */
+    void OnRecordEvent(IComputeStream* stream, IComputeEvent* event);
+
+    /**
+     * @brief Makes the frees covered by 'event' reusable by 'stream'.
+     */
+    void OnStreamWait(IComputeStream* stream, IComputeEvent* event);
+
+    /**
+     * @brief Forgets an event that is being destroyed.
+     */
+    void ForgetEvent(IComputeEvent* event);
+
+    /**
+     * @brief Stops querying a stream that is about to be destroyed.
+     * @note Call ForgetStream() once its destructor returned.
+     */
+    void RetireStream(IComputeStream* stream);
+
+    /**
+     * @brief Marks everything freed on a destroyed stream as reusable.
+     */
+    void ForgetStream(IComputeStream* stream);
+
+    /**
+     * @brief Destroys cached buffers the GPU is done with until at most
+     * 'bytesToKeep' bytes are cached.
+     * @return The number of bytes released.
+     */
+    size_t Trim(size_t bytesToKeep);
+
+    AsyncPoolStats GetStats() const;
+
+  private:
+    struct CachedBuffer {
+      std::unique_ptr<IGpuBuffer> buffer;
+      IComputeStream* stream; // nullptr once the stream is destroyed
+      uint64_t tick;
+      uint64_t fenceValue;
+    };
+
+    struct StreamState {
+      uint64_t tick = 0; // Bumped by every Free() on the stream
+      std::unordered_map<IComputeStream*, uint64_t> waitedTicks; // Per other stream, the highest tick waited for
+      bool retiring = false;
+    };
+
+    struct EventState {
+      IComputeStream* stream;
+      uint64_t tick;
+    };
+
+    bool isComplete(const CachedBuffer& cached) const;
+    bool isReadyFor(const CachedBuffer& cached, IComputeStream* stream) const;
+    size_t trimLocked(size_t bytesToKeep, std::vector<std::unique_ptr<IGpuBuffer>>& released);
+
+    IComputeBackend* m_backend;
+    size_t m_releaseThreshold;
+
+    mutable std::mutex m_mutex; // Protects everything below
+    std::multimap<size_t, CachedBuffer> m_cached; // Oldest first within a size
+    std::unordered_map<IComputeStream*, StreamState> m_streams;
+    std::unordered_map<IComputeEvent*, EventState> m_events;
+    AsyncPoolStats m_stats;
+  };
+}
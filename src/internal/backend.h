@@ -5,7 +5,16 @@
 
 #pragma once
 #include <string>
+#include <algorithm> // for std::min
+#include <chrono>
+#include <cstdint>
 #include <memory> // for std::unique_ptr
+#include <stdexcept>
+#include <vector>
+
+#include "aegis/context.h" // for ContextDesc, MemoryStats
+#include "aegis/host_kernel.h"
+#include "aegis/stream.h" // for StreamDesc, StagingStats
 
 // Public facing types
 class ComputeBackend;
@@ -22,6 +31,7 @@ namespace internal {
   class IGpuBuffer;
   class IComputeKernel;
   class IComputeEvent;
+  class ReadbackCopy;
 
   /**
    * @brief Defines the types of memory for a GPU buffer
@@ -33,18 +43,62 @@ namespace internal {
     /** @brief CPU-visible memory. For uploading data (CPU-to-GPU). */
     UPLOAD,
     /** @brief CPU-visible memory. For reading data back (GPU-to-CPU). */
-    READBACK
+    READBACK,
+    /** @brief Pinned, CPU-cached host memory the GPU copies to and from directly. */
+    HOST,
+    /**
+     * @brief Device memory the CPU can map and write (ReBAR, UMA).
+     * @note Only created when GetCapabilities().deviceHostVisibleMemory is set.
+     */
+    DEVICE_HOST_VISIBLE
   };
 
+  /**
+   * @brief The timeout that makes a host wait block until it's done.
+   */
+  constexpr uint32_t kInfiniteTimeout = UINT32_MAX;
+
+  /**
+   * @brief Converts a public timeout to milliseconds for the backends.
+   * @note Negative timeouts only poll, anything too long waits forever.
+   */
+  inline uint32_t ToTimeoutMs(std::chrono::milliseconds timeout) {
+    if (timeout.count() <= 0) return 0;
+    if (timeout.count() >= kInfiniteTimeout) return kInfiniteTimeout;
+    return static_cast<uint32_t>(timeout.count());
+  }
+
   /**
    * @brief Interface for a GPU compute event.
-   * @note This is a backend-specific implementation of a synchronization
-   * primitive (e.g., ID3DD12Fence or VkFence).
+   * @note Events own no GPU object. RecordEvent() points one at a value of
+   * the recording stream's timeline fence (ID3D12Fence or timeline
+   * VkSemaphore), so they are cheap to create.
    * It is created by the IComputeBackend and used by an IComputeStream.
    */
   class IComputeEvent {
   public:
     virtual ~IComputeEvent() = default;
+
+    /**
+     * @brief Checks, without blocking, whether the GPU reached the event.
+     * @note Events that were never recorded count as reached. May be
+     * called from any thread.
+     */
+    virtual bool IsComplete() const = 0;
+
+    /**
+     * @brief Gets the value of the recording stream's fence the event was
+     * last recorded at (0 if it never was).
+     * @note The event is submitted once that stream's GetSubmittedFenceValue()
+     * reaches it.
+     */
+    virtual uint64_t GetFenceValue() const = 0;
+
+    /**
+     * @brief Creates an event at the same point, which recording this one
+     * again doesn't move.
+     */
+    virtual std::unique_ptr<IComputeEvent> Clone() const = 0;
   };
 
   /**
@@ -56,6 +110,12 @@ namespace internal {
   class IComputeKernel {
   public:
     virtual ~IComputeKernel() = default;
+
+    /**
+     * @brief Checks whether the kernel reads cbuffers, which graphs can't capture.
+     * @note Host kernels declare none, they read whatever the stream set.
+     */
+    virtual bool HasConstants() const { return false; }
   };
 
   /**
@@ -92,6 +152,100 @@ namespace internal {
     virtual void Unmap() = 0;
   };
 
+  /**
+   * @brief Throws if [offset, offset + byteSize) isn't inside 'buffer'.
+   * @param message The exception message.
+   */
+  inline void CheckBufferRange(const IGpuBuffer* buffer, size_t offset, size_t byteSize, const char* message) {
+    const size_t bufferSize = buffer->GetSizeInBytes();
+    if (offset > bufferSize || byteSize > bufferSize - offset) {
+      throw std::runtime_error(message);
+    }
+  }
+
+  /**
+   * @brief The DXC arguments both backends compile kernels with: entry
+   * point, target profile, optimization, row-major matrices, includes and
+   * defines. The backends add the source name and their output format.
+   */
+  inline std::vector<std::wstring> GetCompileArguments(const std::string& entryPoint, const KernelDefines& defines,
+                                                       const KernelCompileOptions& options) {
+    auto widen = [](const std::string& text) { return std::wstring(text.begin(), text.end()); }; // TODO: use MultiByteToWideChar
+
+    std::vector<std::wstring> arguments = {
+      L"-E", widen(entryPoint),
+      L"-T", widen("cs_" + options.shaderModel),
+      L"-O" + std::to_wstring(std::min(options.optimizationLevel, 3u)),
+      L"-Zpr", // Row-major matrices
+    };
+    if (options.debugInfo) {
+      arguments.push_back(L"-Zi");
+    }
+    if (options.enable16BitTypes) {
+      arguments.push_back(L"-enable-16bit-types");
+    }
+    for (const std::string& directory : options.includeDirectories) {
+      arguments.push_back(L"-I");
+      arguments.push_back(widen(directory));
+    }
+    for (const auto& [name, value] : defines) {
+      arguments.push_back(L"-D");
+      arguments.push_back(widen(value.empty() ? name : name + "=" + value));
+    }
+    return arguments;
+  }
+
+  /**
+   * @brief A buffer range bound to a slot of a captured dispatch.
+   */
+  struct GraphBinding {
+    uint32_t slot;
+    IGpuBuffer* buffer;
+    size_t offset;
+    size_t byteSize;
+    BufferAccess access; // As captured, rebinding keeps it
+  };
+
+  /**
+   * @brief A captured dispatch: the kernel, every slot bound at the time,
+   * and the grid size.
+   */
+  struct GraphNode {
+    IComputeKernel* kernel;
+    std::vector<GraphBinding> bindings; // Sorted by slot
+    uint32_t threadGroups[3];
+  };
+
+  /**
+   * @brief Interface for a captured sequence of dispatches that streams
+   * replay with RecordGraph().
+   * @note It is created by the IComputeBackend from the captured nodes.
+   * The nodes keep their kernels and slots, only what a dispatch reads
+   * (buffers, grid sizes) can change.
+   */
+  class IComputeGraph {
+  public:
+    virtual ~IComputeGraph() = default;
+
+    /**
+     * @brief Gets the captured dispatches, in recording order.
+     */
+    virtual const std::vector<GraphNode>& GetNodes() const = 0;
+
+    /**
+     * @brief Binds another buffer range to a slot the node was captured with.
+     * @note Takes effect at the next RecordGraph(), replays recorded before
+     * are not affected.
+     */
+    virtual void SetBuffer(size_t node, uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize) = 0;
+
+    /**
+     * @brief Changes the grid size of a node.
+     * @note Takes effect at the next RecordGraph().
+     */
+    virtual void SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) = 0;
+  };
+
   /**
    * @brief Interface for a compute command stream (or queue).
    * @note This is the workhorse of the library. It wraps a command list
@@ -113,13 +267,16 @@ namespace internal {
     virtual void RecordDispatch(uint32_t threadGroupX, uint32_t threadGroupY, uint32_t threadGroupZ) = 0;
 
     /**
-     * @brief Records a command to copy data from one GPU buffer to another.
+     * @brief Records a command to copy a byte range from one GPU buffer to another.
      * @note The D3D12 implementation must transition the 'dest' buffer
      * to the COPY_DEST state and 'src' to the COPY_SOURCE state.
      * @param dest The destination GPU buffer.
+     * @param destOffset The byte offset to write at in 'dest'.
      * @param src The source GPU buffer.
+     * @param srcOffset The byte offset to read from in 'src'.
+     * @param byteSize The number of bytes to copy.
      */
-    virtual void ResourceCopyBuffer(IGpuBuffer* dest, IGpuBuffer* src) = 0;
+    virtual void ResourceCopyBuffer(IGpuBuffer* dest, size_t destOffset, IGpuBuffer* src, size_t srcOffset, size_t byteSize) = 0;
 
     /**
      * @brief Records a command to upload data from the CPU to GPU buffer.
@@ -128,22 +285,28 @@ namespace internal {
      * This function will sub-allocate from that pool, copy the
      * srcData into it, and record a GPU copy command.
      * @param dest The destination (DEVICE_LOCAL) buffer.
+     * @param destOffset The byte offset to write at in 'dest'.
      * @param srcData A pointer to the CPU data to upload.
      * @param byteSize The size of the data to upload.
      */
-    virtual void ResourceUpload(IGpuBuffer* dest, const void* srcData, size_t byteSize) = 0;
+    virtual void ResourceUpload(IGpuBuffer* dest, size_t destOffset, const void* srcData, size_t byteSize) = 0;
 
     /**
      * @brief Records a command to download data from a GPU buffer to the CPU.
      * @note This is a high-level convenience function. The backend
      * implementation MUST manage an internal readback buffer pool.
      * This function will record a GPU copy to the readback buffer.
-     * The data will NOT be available until HostWait() is called.
+     * The data will NOT be available until HostWait() is called, or until
+     * the returned copy is finished.
      * @param destData A pointer to the CPU memory to receive the data.
      * @param src The source (DEVICE_LOCAL) buffer.
+     * @param srcOffset The byte offset to read from in 'src'.
      * @param byteSize The size of the data to download.
+     * @return The copy out of staging memory, which any thread may Finish()
+     * once the stream passed this point. nullptr if the data lands in
+     * destData by then anyway (nothing is staged).
      */
-    virtual void ResourceDownload(const void* destData, IGpuBuffer* src, size_t byteSize) = 0;
+    virtual std::shared_ptr<ReadbackCopy> ResourceDownload(const void* destData, IGpuBuffer* src, size_t srcOffset, size_t byteSize) = 0;
 
     /**
      * @brief Binds a compute kernel to the stream for the next dispatch.
@@ -161,8 +324,32 @@ namespace internal {
      * This binding must be persistent until a new kernel is set.
      * @param slot The register slot (e.g., u0, u1, t0...).
      * @param buffer The buffer to bind.
+     * @param offset The first byte the kernel sees.
+     * @param byteSize The size of the range the kernel sees.
+     * @param access How the kernel uses the range, for hazard tracking.
+     */
+    virtual void SetBuffer(uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize, BufferAccess access) = 0;
+
+    /**
+     * @brief Sets the values of a cbuffer, copied right away.
+     * @note D3D12 writes root constants or a root CBV of the current
+     * kernel's root signature, so a kernel must be set and another root
+     * signature drops them. The other backends keep them per slot.
+     * @param slot The register slot (b0, b1...).
+     * @param data The values, in cbuffer layout.
+     * @param byteSize The size of the data.
+     */
+    virtual void SetConstants(uint32_t slot, const void* data, size_t byteSize) = 0;
+
+    /**
+     * @brief Records a replay of every dispatch in a graph.
+     * @note Backends without pre-recorded graphs keep the default, which
+     * replays the nodes through SetKernel(), SetBuffer() and
+     * RecordDispatch(). The kernel and buffer bindings are undefined
+     * afterwards.
+     * @param graph A graph from this stream's backend.
      */
-    virtual void SetBuffer(uint32_t slot, IGpuBuffer* buffer) = 0;
+    virtual void RecordGraph(IComputeGraph* graph);
 
     /**
      * @brief Submits all recorded commands to the GPU for execution.
@@ -175,10 +362,12 @@ namespace internal {
     /**
      * @brief Blocks the C++ thread until all work in *this stream* is finished.
      * @note This function MUST also handle processing any pending readbacks
-     * from RecordDownload() calls. After this function returns,
+     * from RecordDownload() calls. After this function returns true,
      * the CPU pointers from RecordDownload should be filled.
+     * @param timeoutMs How long to wait at most, kInfiniteTimeout for no limit.
+     * @return false if the timeout expired first; nothing is processed then.
      */
-    virtual void HostWait() = 0;
+    virtual bool HostWait(uint32_t timeoutMs) = 0;
 
     /**
      * @brief Records a command for this stream to wait for an event.
@@ -197,6 +386,38 @@ namespace internal {
      * @param event The event to signal.
      */
     virtual void RecordEvent(IComputeEvent* event) = 0;
+
+    /**
+     * @brief Gets the usage counters of the stream's upload/readback pools.
+     * @note Backends without staging memory keep the default (all zeros).
+     */
+    virtual StagingStats GetStagingStats() const { return {}; }
+
+    /**
+     * @brief Gets the barrier counters of the stream.
+     * @note Backends without per-buffer hazard tracking keep the default (all zeros).
+     */
+    virtual BarrierStats GetBarrierStats() const { return {}; }
+
+    /**
+     * @brief Gets the fence value that marks the end of the work recorded so far.
+     * @note That's the value the next Submit() will signal if anything was
+     * recorded since the last one, otherwise the last signaled value.
+     * Safe to call from any thread, objects may be released on a thread
+     * other than the one recording.
+     */
+    virtual uint64_t GetRecordedFenceValue() const = 0;
+
+    /**
+     * @brief Gets the fence value the last Submit() signals (0 before the first one).
+     */
+    virtual uint64_t GetSubmittedFenceValue() const = 0;
+
+    /**
+     * @brief Gets the highest fence value the stream's GPU work has reached.
+     * @note May be called from any thread.
+     */
+    virtual uint64_t GetCompletedFenceValue() const = 0;
   };
 
   /**
@@ -214,13 +435,13 @@ namespace internal {
      * @note The D3D12 implementation must create an ID3D12CommandQueue
      * (or reuse one), an ID3D12CommandAllocator, and an
      * ID3D12GraphicsCommandList.
+     * @param desc Initial sizes of the stream's staging pools.
      * @return std::unique_ptr<IComputeStream> The new stream object.
      */
-    virtual std::unique_ptr<IComputeStream> CreateStream() = 0;
+    virtual std::unique_ptr<IComputeStream> CreateStream(const StreamDesc& desc) = 0;
 
     /**
      * @brief Creates a new compute event.
-     * @note The D3D12 implementation must create an ID3D12Fence.
      * @return std::unique_ptr<IComputeEvent> The new event object.
      */
     virtual std::unique_ptr<IComputeEvent> CreateEvent() = 0;
@@ -246,15 +467,106 @@ namespace internal {
      * The returned kernel object will wrap both the PSO and Root Signature.
      * @param hlslFilePath Path to the .hlsl shader file.
      * @param entryPoint The name of the [shader("compute")] function (e.g., "main_cs").
+     * @param defines Preprocessor defines, see GetCompileArguments().
+     * @param options Compiler options, see GetCompileArguments().
      * @return std::unique_ptr<IComputeKernel> The new kernel object.
      */
-    virtual std::unique_ptr<IComputeKernel> CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint) = 0;
+    virtual std::unique_ptr<IComputeKernel> CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                         const KernelDefines& defines, const KernelCompileOptions& options) = 0;
+
+    /**
+     * @brief Compiles HLSL source from memory and creates a compute kernel.
+     * @param hlslSource The shader source.
+     * @param sourceName The file name passed to the compiler, for errors and includes.
+     * @param entryPoint The name of the [shader("compute")] function.
+     */
+    virtual std::unique_ptr<IComputeKernel> CreateKernelFromSource(const std::string& hlslSource, const std::string& sourceName,
+                                                                   const std::string& entryPoint, const KernelDefines& defines,
+                                                                   const KernelCompileOptions& options) = 0;
+
+    /**
+     * @brief Creates a compute kernel from precompiled bytecode.
+     * @note Throws if the backend's format (DXIL, SPIR-V) is missing.
+     */
+    virtual std::unique_ptr<IComputeKernel> CreateKernelFromBytecode(const KernelBytecode& bytecode) = 0;
+
+    /**
+     * @brief Creates a compute kernel from a C++ callable.
+     * @note Only backends that execute on the host (the CPU backend)
+     * support this. GPU backends keep the default, which returns nullptr.
+     * @param desc The kernel function and its thread group size.
+     * @return std::unique_ptr<IComputeKernel> The new kernel object, or nullptr.
+     */
+    virtual std::unique_ptr<IComputeKernel> CreateHostKernel(const HostKernelDesc&) { return nullptr; }
+
+    /**
+     * @brief Creates a graph from captured dispatches.
+     * @note The D3D12 implementation bakes them into a command list that
+     * reads its root arguments and grid sizes from an argument buffer.
+     * Other backends keep the default, a CapturedGraph that streams replay
+     * call by call.
+     * @param nodes The captured dispatches, in recording order.
+     * @return std::unique_ptr<IComputeGraph> The new graph object.
+     */
+    virtual std::unique_ptr<IComputeGraph> CreateGraph(std::vector<GraphNode> nodes);
+
+    /**
+     * @brief Wraps existing host memory in a HOST buffer without copying it.
+     * @note The D3D12 implementation uses OpenExistingHeapFromAddress(),
+     * Vulkan needs VK_EXT_external_memory_host. Backends that can't import
+     * keep the default, which returns nullptr.
+     * @param hostPointer The memory to wrap (usually page-aligned).
+     * @param byteSize The size of the memory.
+     * @return std::unique_ptr<IGpuBuffer> The buffer, or nullptr if the memory can't be imported.
+     */
+    virtual std::unique_ptr<IGpuBuffer> ImportHostMemory(void*, size_t) { return nullptr; }
+
+    /**
+     * @brief Gets usage counters of the heaps DEVICE_LOCAL buffers are placed in.
+     */
+    virtual MemoryStats GetMemoryStats() const { return {}; }
+
+    /**
+     * @brief Reports optional hardware features.
+     */
+    virtual DeviceCapabilities GetCapabilities() const { return {}; }
 
     /**
      * @brief Blocks the C++ thread until ALL streams are idle.
      * @note This is a "stop the world" synchronization.
      */
     virtual void WaitForIdle() = 0;
+
+    /**
+     * @brief Blocks the C++ thread until all (or any) of the events are reached.
+     * @note Events that were never recorded count as reached.
+     * @param events The events to wait on.
+     * @param count The number of events, at least one.
+     * @param waitAll True to wait for every event, false for the first one.
+     * @param timeoutMs How long to wait at most, kInfiniteTimeout for no limit.
+     * @return The index of a reached event (0 when waitAll is set), or
+     * 'count' if the timeout expired first.
+     */
+    virtual size_t WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) = 0;
+
+    /**
+     * @brief Creates an event on a fence of its own that only the CPU signals.
+     * @note Used to wake a thread blocked in WaitForEvents() on GPU events.
+     * @return An event that is reached by the next SignalHostEvent().
+     */
+    virtual std::unique_ptr<IComputeEvent> CreateHostEvent() = 0;
+
+    /**
+     * @brief Reaches a host event. May be called from any thread.
+     * @param event An event from CreateHostEvent().
+     */
+    virtual void SignalHostEvent(IComputeEvent* event) = 0;
+
+    /**
+     * @brief Arms a reached host event again for the next SignalHostEvent().
+     * @param event An event from CreateHostEvent().
+     */
+    virtual void ResetHostEvent(IComputeEvent* event) = 0;
   };
 
 };
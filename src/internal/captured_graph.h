@@ -0,0 +1,50 @@
+/**
+ * @file captured_graph.h
+ * @brief The dispatches recorded between BeginCapture() and EndCapture()
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief A graph that only holds its nodes.
+   *
+   * This is all backends without pre-recorded graphs need: the default
+   * IComputeStream::RecordGraph() replays the nodes call by call. Backends
+   * that bake them derive from it and update their baked state on top.
+   */
+  class CapturedGraph : public IComputeGraph {
+  public:
+    explicit CapturedGraph(std::vector<GraphNode> nodes) : m_nodes(std::move(nodes)) {}
+
+    const std::vector<GraphNode>& GetNodes() const override { return m_nodes; }
+    void SetBuffer(size_t node, uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize) override;
+    void SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) override;
+
+  protected:
+    /**
+     * @brief Finds the binding of 'slot' in a node.
+     * @note Throws if the node doesn't exist or wasn't captured with the slot.
+     */
+    GraphBinding& findBinding(size_t node, uint32_t slot);
+
+    std::vector<GraphNode> m_nodes;
+  };
+
+  /**
+   * @brief What a stream records while it captures.
+   */
+  struct GraphCapture {
+    IComputeKernel* kernel = nullptr;
+    std::vector<GraphBinding> bindings; // Sorted by slot, like GraphNode::bindings
+    std::vector<GpuBuffer*> buffers; // The GpuBuffer of each binding
+    std::vector<GraphNode> nodes;
+    std::vector<std::vector<GpuBuffer*>> nodeBuffers; // The buffers of each node, for ComputeGraph
+  };
+}
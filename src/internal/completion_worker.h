@@ -0,0 +1,78 @@
+/**
+ * @file completion_worker.h
+ * @brief Runs host callbacks once the GPU reaches points in streams
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace aegis::internal {
+  /**
+   * @brief A background thread that runs callbacks as events are reached.
+   *
+   * Callbacks are kept in queues (one per stream) that complete in order,
+   * so the thread only waits on the oldest event of each queue, plus a
+   * host event that wakes it when new callbacks arrive. All waits are a
+   * single WaitForEvents() call; nothing is polled. The thread starts with
+   * the first callback.
+   *
+   * @note All methods are thread-safe.
+   */
+  class CompletionWorker {
+  public:
+    /**
+     * @param backend The backend whose events the callbacks wait on.
+     */
+    explicit CompletionWorker(IComputeBackend* backend);
+
+    /**
+     * @brief Stops the thread. Callbacks whose event was reached still
+     * run, the others are dropped.
+     * @note Call after the backend went idle, or callbacks are lost.
+     */
+    ~CompletionWorker();
+
+    CompletionWorker(const CompletionWorker&) = delete;
+    CompletionWorker& operator=(const CompletionWorker&) = delete;
+
+    /**
+     * @brief Gets a new queue id for Enqueue().
+     */
+    uint64_t CreateQueue();
+
+    /**
+     * @brief Runs 'callback' on the worker thread once 'event' is reached.
+     * @param queue Callbacks of the same queue run in the order they were
+     * enqueued, and their events must be reached in that order too.
+     * @param event An event recorded on a stream, owned from now on.
+     * @param callback Must not throw.
+     */
+    void Enqueue(uint64_t queue, std::unique_ptr<IComputeEvent> event, std::function<void()> callback);
+
+  private:
+    struct Pending {
+      std::unique_ptr<IComputeEvent> event;
+      std::function<void()> callback;
+    };
+
+    void workerLoop();
+
+    IComputeBackend* m_backend;
+    std::unique_ptr<IComputeEvent> m_wakeEvent; // Host event, signaled by Enqueue() and the destructor
+
+    std::mutex m_mutex; // Protects everything below
+    std::unordered_map<uint64_t, std::deque<Pending>> m_queues;
+    uint64_t m_nextQueue;
+    bool m_stopping;
+    std::thread m_thread;
+  };
+}
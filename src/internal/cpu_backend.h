@@ -0,0 +1,89 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_CPU)
+
+#include "backend.h"
+#include "memory_allocator.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <string>
+#include <memory> // for std::unique_ptr
+#include <mutex>
+#include <vector>
+
+namespace aegis::internal {
+  class CpuStream;
+
+  /**
+   * @brief The CPU implementation of the compute backend interface.
+   *
+   * This backend runs host kernels (C++ callables) instead of HLSL. It owns
+   * the work-stealing thread pool that every stream dispatches its thread
+   * groups onto, and keeps track of the live streams for WaitForIdle().
+   */
+  class CpuBackend : public IComputeBackend {
+  public:
+    ~CpuBackend() override;
+
+    /**
+     * @brief Creates and initializes the CPU backend.
+     * @param desc The context options (worker count, memory block size).
+     * @return A unique_ptr to the new backend.
+     */
+    static std::unique_ptr<CpuBackend> Create(const ContextDesc& desc);
+
+    std::unique_ptr<IComputeStream> CreateStream(const StreamDesc& desc) override;
+    std::unique_ptr<IComputeEvent> CreateEvent() override;
+    std::unique_ptr<IGpuBuffer> CreateBuffer(size_t byteSize, GpuMemoryType type) override;
+    std::unique_ptr<IGpuBuffer> ImportHostMemory(void* hostPointer, size_t byteSize) override;
+    std::unique_ptr<IComputeKernel> CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                 const KernelDefines& defines, const KernelCompileOptions& options) override;
+    std::unique_ptr<IComputeKernel> CreateKernelFromSource(const std::string& hlslSource, const std::string& sourceName,
+                                                           const std::string& entryPoint, const KernelDefines& defines,
+                                                           const KernelCompileOptions& options) override;
+    std::unique_ptr<IComputeKernel> CreateKernelFromBytecode(const KernelBytecode& bytecode) override;
+    std::unique_ptr<IComputeKernel> CreateHostKernel(const HostKernelDesc& desc) override;
+
+    MemoryStats GetMemoryStats() const override;
+    DeviceCapabilities GetCapabilities() const override;
+
+    void WaitForIdle() override;
+    size_t WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) override;
+    std::unique_ptr<IComputeEvent> CreateHostEvent() override;
+    void SignalHostEvent(IComputeEvent* event) override;
+    void ResetHostEvent(IComputeEvent* event) override;
+
+    ThreadPool& GetThreadPool() { return m_threadPool; }
+
+    /**
+     * @brief Gets the allocator DEVICE_LOCAL buffers are placed with.
+     * @note The heaps are plain host memory, which makes this backend the
+     * reference for the allocator the GPU backends use.
+     */
+    MemoryAllocator& GetDeviceLocalAllocator() { return m_deviceLocalAllocator; }
+
+    /**
+     * @brief Gets the start of a heap created by the device local allocator.
+     */
+    static std::byte* GetHeapData(IMemoryHeap* heap);
+
+    /** @brief Called by CpuStream's constructor/destructor to keep m_streams current. */
+    void RegisterStream(CpuStream* stream);
+    void UnregisterStream(CpuStream* stream);
+
+  private:
+    /**
+     * @brief Private constructor. Use CpuBackend::Create().
+     */
+    explicit CpuBackend(const ContextDesc& desc);
+
+    ThreadPool m_threadPool;
+    MemoryAllocator m_deviceLocalAllocator;
+
+    std::mutex m_streamsMutex; // Protects m_streams
+    std::vector<CpuStream*> m_streams;
+  };
+}
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_CPU)
+
+#include "backend.h"
+#include "cpu_backend.h" // for CpuBackend
+
+#include <cstddef>
+
+namespace aegis::internal {
+  /**
+   * @brief The CPU implementation of a GPU buffer.
+   *
+   * Every memory type is plain, cache-line aligned host memory, so Map()
+   * is free and all memory types are CPU-accessible. DEVICE_LOCAL and
+   * DEVICE_HOST_VISIBLE buffers are placed in the backend's heaps, the
+   * others get their own allocation.
+   */
+  class CpuBuffer : public IGpuBuffer {
+  public:
+    /**
+     * @brief Creates a new zero-initialized CpuBuffer.
+     * @param backend The CpuBackend that owns this buffer.
+     * @param byteSize The size of the buffer to create.
+     * @param type The GpuMemoryType (only kept for bookkeeping).
+     */
+    CpuBuffer(CpuBackend* backend, size_t byteSize, GpuMemoryType type);
+
+    /**
+     * @brief Wraps caller-owned memory as a HOST buffer.
+     * @param backend The CpuBackend that owns this buffer.
+     * @param hostPointer The memory to use. It isn't copied, cleared or freed.
+     * @param byteSize The size of the memory.
+     */
+    CpuBuffer(CpuBackend* backend, void* hostPointer, size_t byteSize);
+
+    ~CpuBuffer() override;
+
+    size_t GetSizeInBytes() const override;
+    void* Map() override;
+    void Unmap() override;
+
+    /**
+     * @brief Gets the buffer memory directly.
+     */
+    std::byte* GetData() { return m_data; }
+
+  private:
+    CpuBackend* m_backend;
+    std::byte* m_data;
+    size_t m_byteSize;
+    GpuMemoryType m_memoryType;
+    MemoryAllocator::Allocation m_allocation; // Only for DEVICE_LOCAL/DEVICE_HOST_VISIBLE
+    bool m_ownsData; // false for imported memory
+  };
+}
+
+#endif
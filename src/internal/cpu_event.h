@@ -0,0 +1,57 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_CPU)
+
+#include "backend.h"
+#include "cpu_backend.h" // for CpuBackend
+#include "host_fence.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace aegis::internal {
+  /**
+   * @brief The CPU implementation of a compute event.
+   *
+   * An event owns nothing: RecordEvent() points it at a value of the
+   * recording stream's HostFence, so creating one is free.
+   */
+  class CpuEvent : public IComputeEvent {
+  public:
+    /**
+     * @param backend The CpuBackend that owns this event.
+     */
+    explicit CpuEvent(CpuBackend* backend);
+    ~CpuEvent() override;
+
+    /**
+     * @brief Points the event at a stream fence value.
+     */
+    void Set(std::shared_ptr<HostFence> fence, uint64_t value);
+
+    /**
+     * @brief Gets the fence and value the event was last recorded at.
+     * @return A null fence if the event was never recorded.
+     */
+    std::pair<std::shared_ptr<HostFence>, uint64_t> Get() const;
+
+    /**
+     * @brief Points the event at the next value of its fence.
+     */
+    void Advance();
+
+    bool IsComplete() const override;
+    uint64_t GetFenceValue() const override;
+    std::unique_ptr<IComputeEvent> Clone() const override;
+
+  private:
+    CpuBackend* m_backend;
+    mutable std::mutex m_mutex; // Protects m_fence and m_value, recording and waiting threads differ
+    std::shared_ptr<HostFence> m_fence;
+    uint64_t m_value;
+  };
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_CPU)
+
+#include "backend.h"
+#include "cpu_backend.h" // for CpuBackend
+
+namespace aegis::internal {
+  /**
+   * @brief The CPU implementation of a compute kernel.
+   *
+   * This is just the host kernel function plus its thread group size.
+   */
+  class CpuKernel : public IComputeKernel {
+  public:
+    /**
+     * @param backend The CpuBackend that owns this kernel.
+     * @param desc The kernel function and its thread group size.
+     */
+    CpuKernel(CpuBackend* backend, const HostKernelDesc& desc);
+    ~CpuKernel() override;
+
+    const HostKernelFunction& GetFunction() const { return m_function; }
+    const HostUint3& GetNumThreads() const { return m_numThreads; }
+
+  private:
+    CpuBackend* m_backend;
+    HostKernelFunction m_function;
+    HostUint3 m_numThreads;
+  };
+}
+
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_CPU)
+
+#include "backend.h"
+#include "cpu_backend.h"
+#include "host_fence.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aegis::internal {
+  class CpuBuffer;
+  class CpuKernel;
+
+  /**
+   * @brief The CPU implementation of a compute stream.
+   *
+   * Recording appends commands to a host "command list". Submit() hands the
+   * list to the stream's own worker thread, which executes the batches in
+   * order and signals the stream fence after each one, so the stream is
+   * really asynchronous to the recording thread. Dispatches fan their thread
+   * groups out onto the backend's work-stealing thread pool.
+   *
+   * Events are points on the stream fence: RecordEvent() reserves a value
+   * and records a command that signals it.
+   */
+  class CpuStream : public IComputeStream {
+  public:
+    CpuStream(CpuBackend* backend, const StreamDesc& desc);
+    ~CpuStream() override;
+
+    void RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) override;
+    void ResourceCopyBuffer(IGpuBuffer* dest, size_t destOffset, IGpuBuffer* src, size_t srcOffset, size_t byteSize) override;
+    void ResourceUpload(IGpuBuffer* dest, size_t destOffset, const void* srcData, size_t byteSize) override;
+    std::shared_ptr<ReadbackCopy> ResourceDownload(const void* destData, IGpuBuffer* src, size_t srcOffset, size_t byteSize) override;
+    void SetKernel(IComputeKernel* kernel) override;
+    void SetBuffer(uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize, BufferAccess access) override;
+    void SetConstants(uint32_t slot, const void* data, size_t byteSize) override;
+
+    void Submit() override;
+    bool HostWait(uint32_t timeoutMs) override;
+    void StreamWait(IComputeEvent* event) override;
+    void RecordEvent(IComputeEvent* event) override;
+
+    uint64_t GetRecordedFenceValue() const override;
+    uint64_t GetSubmittedFenceValue() const override;
+    uint64_t GetCompletedFenceValue() const override;
+
+    /**
+     * @brief Blocks until every batch submitted so far has executed.
+     * @note Unlike HostWait(), this doesn't rethrow kernel exceptions.
+     * Used by CpuBackend::WaitForIdle().
+     */
+    void WaitForSubmitted();
+
+  private:
+    using Command = std::function<void()>;
+    using ConstantBlock = std::shared_ptr<const std::vector<uint8_t>>; // Shared by the dispatches recorded with it
+
+    struct BoundBuffer {
+      CpuBuffer* buffer = nullptr;
+      size_t offset = 0;
+      size_t byteSize = 0;
+    };
+
+    struct Batch {
+      std::vector<Command> commands;
+      uint64_t fenceValue;
+    };
+
+    /**
+     * @brief The worker thread body: executes submitted batches in order.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Appends a command to the recording and publishes the recorded fence value.
+     */
+    void record(Command command);
+
+    /**
+     * @brief Runs every thread group of a dispatch on the thread pool.
+     */
+    void executeDispatch(const CpuKernel* kernel,
+                         const std::vector<void*>& buffers,
+                         const std::vector<size_t>& bufferSizes,
+                         const std::vector<ConstantBlock>& constants,
+                         uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ);
+
+    CpuBackend* m_backend;
+
+    // Recording state (only touched by the recording thread)
+    std::vector<Command> m_recording;
+    CpuKernel* m_currentKernel;
+    std::vector<BoundBuffer> m_boundBuffers;
+    std::vector<ConstantBlock> m_boundConstants; // Per slot, nullptr if unset
+
+    // Submission queue, shared with the worker thread
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<Batch> m_submitted;
+    bool m_stopping;
+
+    std::shared_ptr<HostFence> m_fence; // Shared with the events recorded on this stream
+    uint64_t m_fenceValue; // The next value to reserve, recording thread only
+    std::atomic<uint64_t> m_submittedValue; // The value the last Submit() signals
+    std::atomic<uint64_t> m_recordedValue; // GetRecordedFenceValue(), read when other threads release objects
+    std::deque<uint64_t> m_inFlightValues; // The values of submissions that may still run
+    uint32_t m_maxInFlight;
+
+    std::mutex m_errorMutex; // Protects m_error
+    std::exception_ptr m_error;
+
+    std::thread m_worker;
+  };
+}
+
+#endif
@@ -3,6 +3,8 @@
 #if defined(AEGIS_ENABLE_D3D12)
 
 #include "backend.h"
+#include "kernel_cache.h"
+#include "memory_allocator.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <d3d12.h>
@@ -22,17 +24,39 @@
 #include <string>
 #include <memory> // for std::unique_ptr
 #include <mutex>
+#include <vector>
 
 #define ThrowIfFailed(hr) if(FAILED(hr)) { throw std::runtime_error(std::string("D3D12 HRESULT failed: ") + #hr); }
 
 using Microsoft::WRL::ComPtr;
 
 namespace aegis::internal {
+  /**
+   * @brief Blocks until 'fence' reaches 'value' or the timeout expires.
+   * @note Infinite waits need no Win32 event, timed ones use a temporary one.
+   * @return false if the timeout expired first.
+   */
+  bool WaitForFence(ID3D12Fence* fence, UINT64 value, uint32_t timeoutMs);
+
+  /**
+   * @brief An ID3D12Heap that DEVICE_LOCAL buffers are placed in.
+   */
+  class D3D12Heap : public IMemoryHeap {
+  public:
+    explicit D3D12Heap(ComPtr<ID3D12Heap> heap) : m_heap(std::move(heap)) {}
+
+    ID3D12Heap* GetHeap() const { return m_heap.Get(); }
+
+  private:
+    ComPtr<ID3D12Heap> m_heap;
+  };
+
   /**
    * @brief The D3D12 implementation of the compute backend interface.
    *
    * This class is the "master" D3D12 object. It owns the logical device,
-   * the master command queue, and the factories for all other D3D12 objects.
+   * the pool of command queues streams submit to, and the factories for
+   * all other D3D12 objects.
    */
   class D3D12Backend: public IComputeBackend {
   public:
@@ -40,33 +64,99 @@ namespace aegis::internal {
 
     /**
      * @brief Creates and initializes the D3D12 backend.
+     * @param desc The context options (memory block size).
      * @return A unique_ptr to the new backend, or nullptr if D3D12
      * initialization fails.
      */
-    static std::unique_ptr<D3D12Backend> Create();
+    static std::unique_ptr<D3D12Backend> Create(const ContextDesc& desc);
 
-    std::unique_ptr<IComputeStream> CreateStream() override;
+    std::unique_ptr<IComputeStream> CreateStream(const StreamDesc& desc) override;
     std::unique_ptr<IComputeEvent> CreateEvent() override;
     std::unique_ptr<IGpuBuffer> CreateBuffer(size_t byteSize, GpuMemoryType type) override;
-    std::unique_ptr<IComputeKernel> CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint) override;
+    std::unique_ptr<IGpuBuffer> ImportHostMemory(void* hostPointer, size_t byteSize) override;
+    std::unique_ptr<IComputeKernel> CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                 const KernelDefines& defines, const KernelCompileOptions& options) override;
+    std::unique_ptr<IComputeKernel> CreateKernelFromSource(const std::string& hlslSource, const std::string& sourceName,
+                                                           const std::string& entryPoint, const KernelDefines& defines,
+                                                           const KernelCompileOptions& options) override;
+    std::unique_ptr<IComputeKernel> CreateKernelFromBytecode(const KernelBytecode& bytecode) override;
+    std::unique_ptr<IComputeGraph> CreateGraph(std::vector<GraphNode> nodes) override;
+
+    MemoryStats GetMemoryStats() const override;
+    DeviceCapabilities GetCapabilities() const override { return m_capabilities; }
 
     void WaitForIdle() override;
+    size_t WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) override;
+    std::unique_ptr<IComputeEvent> CreateHostEvent() override;
+    void SignalHostEvent(IComputeEvent* event) override;
+    void ResetHostEvent(IComputeEvent* event) override;
 
     // I will make those public so other backend classes can use them (D3D12Stream, etc.)
     ID3D12Device5* GetDevice() { return m_device.Get(); }
-    //ID3D12CommandQueue* GetMasterQueue() { return m_masterCommandQueue.Get(); }
-    IDxcCompiler3* GetCompiler() { return m_dxcCompiler.Get(); }
-    IDxcUtils* GetUtils() { return m_dxcUtils.Get(); }
-    IDxcIncludeHandler* GetIncludeHandler() { return m_dxcIncludeHandler.Get(); }
 
-    /** @brief Provides thread-safe access to the master command queue. */
-    //std::mutex& GetQueueMutex() { return m_queueMutex; }
+    /**
+     * @brief Get the DXC objects of the calling thread, created on first use.
+     * @note Kernels compile on several threads at once (CreateKernels()),
+     * which can't share one compiler.
+     */
+    IDxcCompiler3* GetCompiler();
+    IDxcUtils* GetUtils();
+    IDxcIncludeHandler* GetIncludeHandler();
+
+    /**
+     * @brief Gets the allocator DEVICE_LOCAL buffers are placed with.
+     * @note Its heaps are D3D12Heaps (DEFAULT heap type, buffers only).
+     */
+    MemoryAllocator& GetDeviceLocalAllocator() { return *m_deviceLocalAllocator; }
+
+    /**
+     * @brief Gets the on-disk cache kernels are looked up in before compiling.
+     * @note Disabled unless ContextDesc::kernelCacheDirectory is set.
+     */
+    const KernelCache& GetKernelCache() const { return *m_kernelCache; }
+
+    /**
+     * @brief Gets the part of every kernel cache key that describes the
+     * compiler, the adapter and its driver.
+     */
+    const std::string& GetKernelCacheIdentity() const { return m_kernelCacheIdentity; }
+
+    /**
+     * @brief Creates a compute PSO through the pipeline library of the
+     * kernel cache, which skips the driver's compilation on a hit.
+     * @param name A name unique to the PSO's bytecode and root signature.
+     * @note Thread-safe. Without a cache this is CreateComputePipelineState().
+     */
+    ComPtr<ID3D12PipelineState> CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const std::wstring& name);
+
+    /**
+     * @brief Gets the heap DEVICE_HOST_VISIBLE buffers are committed in:
+     * a GPU upload heap with resizable BAR, an L0 custom heap on UMA parts.
+     */
+    const D3D12_HEAP_PROPERTIES& GetDeviceHostVisibleHeapProperties() const { return m_deviceHostVisibleHeap; }
+
+    /**
+     * @brief Gets a command queue for a new stream.
+     *
+     * Queues are pooled per list type and priority. A queue without streams
+     * is reused, a new one is created while the pool is smaller than
+     * ContextDesc::maxHardwareQueues, otherwise the stream shares the queue
+     * with the fewest streams.
+     *
+     * @note Pair with ReleaseQueue() when the stream is destroyed.
+     */
+    ComPtr<ID3D12CommandQueue> AcquireQueue(D3D12_COMMAND_LIST_TYPE type, StreamPriority priority);
+
+    /**
+     * @brief Returns a queue from AcquireQueue() to the pool.
+     */
+    void ReleaseQueue(ID3D12CommandQueue* queue);
 
   private:
     /**
      * @brief Private constructor. Use D3D12Backend::Create().
      */
-    D3D12Backend();
+    explicit D3D12Backend(const ContextDesc& desc);
 
     /**
      * @brief The real initialization logic.
@@ -79,23 +169,52 @@ namespace aegis::internal {
      */
     static bool GetHardwareAdapter(ComPtr<IDXGIFactory4> factory, ComPtr<IDXGIAdapter1>& outAdapter);
 
+    /**
+     * @brief Fills m_capabilities and m_deviceHostVisibleHeap.
+     */
+    void queryCapabilities(IDXGIAdapter1* adapter);
+
+    /**
+     * @brief Builds m_kernelCacheIdentity and opens the pipeline library.
+     */
+    void openKernelCache(IDXGIAdapter1* adapter);
+
+    /**
+     * @brief A command queue and the number of streams submitting to it.
+     */
+    struct PooledQueue {
+      ComPtr<ID3D12CommandQueue> queue;
+      D3D12_COMMAND_LIST_TYPE type;
+      StreamPriority priority;
+      uint32_t streamCount;
+      ComPtr<ID3D12Fence> idleFence; // Signaled by WaitForIdle()
+      UINT64 idleFenceValue;
+    };
+
     // Core D3D12 Objects
     ComPtr<IDXGIFactory4> m_dxgiFactory;
     ComPtr<ID3D12Device5> m_device;
-    //ComPtr<ID3D12CommandQueue> m_masterCommandQueue;
-
-    // DXC (Compiler) Objects
-    ComPtr<IDxcUtils> m_dxcUtils;
-    ComPtr<IDxcCompiler3> m_dxcCompiler;
-    ComPtr<IDxcIncludeHandler> m_dxcIncludeHandler;
-
-    // Synchronization
-    ComPtr<ID3D12Fence> m_masterFence;
-    UINT64 m_masterFenceValue;
-    HANDLE m_fenceEvent;
 
-    std::mutex m_fenceMutex; // Protects m_masterFence and m_masterFenceValue
-    // std::mutex m_queueMutex; // Protects m_masterCommandQueue submission
+    // Kernel cache
+    std::unique_ptr<KernelCache> m_kernelCache;
+    std::string m_kernelCacheIdentity;
+    std::string m_pipelineLibraryName; // File of m_pipelineLibrary in the cache directory
+    std::vector<uint8_t> m_pipelineLibraryData; // Must outlive m_pipelineLibrary
+    std::mutex m_pipelineLibraryMutex; // Protects m_pipelineLibrary and m_pipelineLibraryDirty
+    ComPtr<ID3D12PipelineLibrary> m_pipelineLibrary; // nullptr without a cache
+    bool m_pipelineLibraryDirty; // Saved by the destructor
+
+    // Placed resource heaps
+    size_t m_memoryBlockSize;
+    std::unique_ptr<MemoryAllocator> m_deviceLocalAllocator;
+
+    DeviceCapabilities m_capabilities;
+    D3D12_HEAP_PROPERTIES m_deviceHostVisibleHeap;
+
+    // Command queues shared by the streams
+    uint32_t m_maxQueuesPerPool;
+    std::mutex m_queuesMutex; // Protects m_queues
+    std::vector<PooledQueue> m_queues; // Only grows, streams hold on to the queues
   };
 }
 
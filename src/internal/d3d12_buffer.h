@@ -15,7 +15,9 @@ namespace aegis::internal {
    * @brief The D3D12 implementation of a GPU buffer.
    *
    * This class wraps an ID3D12Resource and manages its lifetime,
-   * state, and CPU mapping.
+   * state, and CPU mapping. DEVICE_LOCAL buffers are placed resources in
+   * one of the backend's heaps, UPLOAD/READBACK/HOST buffers are committed
+   * and imported host memory is placed in a heap opened from its address.
    */
   class D3D12Buffer : public IGpuBuffer {
   public:
@@ -27,6 +29,16 @@ namespace aegis::internal {
      */
     D3D12Buffer(D3D12Backend* backend, size_t byteSize, GpuMemoryType type);
 
+    /**
+     * @brief Wraps existing host memory as a HOST buffer.
+     * @note Throws if the memory can't be opened as a heap (it has to
+     * come from VirtualAlloc() or similar).
+     * @param backend The D3D12Backend that will create this resource.
+     * @param hostPointer The start of the memory.
+     * @param byteSize The size of the buffer to create.
+     */
+    D3D12Buffer(D3D12Backend* backend, void* hostPointer, size_t byteSize);
+
     ~D3D12Buffer() override;
 
     size_t GetSizeInBytes() const override;
@@ -57,15 +69,21 @@ namespace aegis::internal {
      */
     void SetCurrentState(D3D12_RESOURCE_STATES newState) { m_currentState = newState; }
 
+    GpuMemoryType GetMemoryType() const { return m_memoryType; }
+
   private:
     D3D12Backend* m_backend;
     ComPtr<ID3D12Resource> m_resource;
     size_t m_byteSize;
     void* m_mappedPtr;
     GpuMemoryType m_memoryType;
+    MemoryAllocator::Allocation m_allocation; // Only for DEVICE_LOCAL
 
     /** The last known state of this resource. */
     D3D12_RESOURCE_STATES m_currentState;
+
+    ComPtr<ID3D12Heap> m_importedHeap; // Only for imported host memory
+    void* m_hostPointer; // Only for imported host memory
   };
 }
 
@@ -4,10 +4,13 @@
 
 #include "backend.h"
 #include "d3d12_backend.h" // for D3D12Backend
+#include "submission_timeline.h"
 #include <d3d12.h>
 #include <wrl/client.h>
 #include <cstdint>
-#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 using Microsoft::WRL::ComPtr;
 
@@ -15,25 +18,49 @@ namespace aegis::internal {
   /**
    * @brief The D3D12 implementation of a compute event.
    *
-   * This class wraps an ID3D12Fence, which is the D3D12
-   * synchronization primitive.
+   * An event owns no ID3D12Fence: RecordEvent() points it at a value of
+   * the recording stream's fence, so creating one is free.
    */
   class D3D12Event : public IComputeEvent {
   public:
     /**
-     * @brief Creates a new D3D12Event (a fence).
-     * @param backend The D3D12Backend that will create this resource.
+     * @brief Creates a new, unrecorded D3D12Event.
+     * @param backend The D3D12Backend that owns this event.
      */
     D3D12Event(D3D12Backend* backend);
     virtual ~D3D12Event();
 
-    ID3D12Fence* GetFence() { return m_fence.Get(); }
-  private:
-    friend class D3D12Stream;
+    /**
+     * @brief Points the event at a stream fence value.
+     * @param submission What the stream submitted, nullptr for fences the CPU signals.
+     */
+    void Set(ComPtr<ID3D12Fence> fence, UINT64 value, std::shared_ptr<SubmissionTimeline> submission = nullptr);
 
+    /**
+     * @brief Gets the fence and value the event was last recorded at.
+     * @return A null fence if the event was never recorded.
+     */
+    std::pair<ComPtr<ID3D12Fence>, UINT64> Get() const;
+
+    /**
+     * @brief Gets what the recording stream submitted, nullptr for host events.
+     */
+    std::shared_ptr<SubmissionTimeline> GetSubmission() const;
+
+    /**
+     * @brief Points the event at the next value of its fence.
+     */
+    void Advance();
+
+    bool IsComplete() const override;
+    uint64_t GetFenceValue() const override;
+    std::unique_ptr<IComputeEvent> Clone() const override;
+  private:
     D3D12Backend* m_backend;
+    mutable std::mutex m_mutex; // Protects m_fence, m_value and m_submission
     ComPtr<ID3D12Fence> m_fence;
-    std::atomic<UINT64> m_fenceValue;
+    UINT64 m_value;
+    std::shared_ptr<SubmissionTimeline> m_submission;
   };
 }
 
@@ -0,0 +1,104 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_D3D12)
+
+#include "captured_graph.h"
+#include "d3d12_backend.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+namespace aegis::internal {
+  class D3D12Buffer;
+
+  /**
+   * @brief The D3D12 implementation of a compute graph.
+   *
+   * The dispatches are baked into a command list of their own, one
+   * ExecuteIndirect() per node. The root UAVs and the grid size of every
+   * node come from an argument buffer, so rebinding a buffer or resizing a
+   * dispatch only rewrites a few bytes of it, which the next replay
+   * uploads. UAV barriers go where a node reads or writes a range an
+   * earlier node wrote, or writes one it read, since the last barrier; the
+   * list is only recorded again if a rebind moves them.
+   */
+  class D3D12Graph : public CapturedGraph {
+  public:
+    D3D12Graph(D3D12Backend* backend, std::vector<GraphNode> nodes);
+
+    void SetBuffer(size_t node, uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize) override;
+    void SetDispatchSize(size_t node, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) override;
+
+    /**
+     * @brief Gets the buffer ExecuteIndirect() reads the arguments from.
+     */
+    D3D12Buffer* GetArgumentBuffer() const;
+
+    /**
+     * @brief Gets the arguments to upload before the next replay.
+     * @return The argument bytes, or nullptr if the buffer is up to date.
+     * @note Clears the flag, the caller must record the upload.
+     */
+    const std::vector<uint8_t>* TakeDirtyArguments();
+
+    /**
+     * @brief Gets the baked command list for a replay, recording it first
+     * if the barriers changed.
+     * @param fence The fence of the stream that executes it.
+     * @param fenceValue The value 'fence' reaches once the replay is done.
+     */
+    ID3D12GraphicsCommandList* AcquireCommandList(ID3D12Fence* fence, UINT64 fenceValue);
+
+  private:
+    /**
+     * @brief A recording of the command list and the replay that last used it.
+     */
+    struct Recording {
+      ComPtr<ID3D12CommandAllocator> allocator;
+      ComPtr<ID3D12GraphicsCommandList4> commandList;
+      ComPtr<ID3D12Fence> fence; // nullptr if never executed
+      UINT64 fenceValue;
+    };
+
+    /**
+     * @brief Decides which nodes need a UAV barrier before them.
+     * @return true if that differs from the barriers of the current recording.
+     */
+    bool updateBarriers();
+
+    /**
+     * @brief Records the nodes into a recording no replay uses anymore.
+     */
+    void record();
+
+    /**
+     * @brief Writes the root UAV address of one binding into m_arguments.
+     */
+    void writeAddress(size_t node, size_t bindingIndex);
+
+    /**
+     * @brief Writes the grid size of a node into m_arguments.
+     */
+    void writeDispatch(size_t node);
+
+    D3D12Backend* m_backend;
+
+    std::vector<ComPtr<ID3D12CommandSignature>> m_signatures; // Per node, shared between equal layouts
+    std::vector<size_t> m_argumentOffsets; // Per node
+    std::vector<uint8_t> m_arguments;
+    std::unique_ptr<IGpuBuffer> m_argumentBuffer; // DEVICE_LOCAL, nullptr for an empty graph
+    bool m_argumentsDirty;
+
+    std::vector<bool> m_barrierBefore; // Per node
+    std::vector<Recording> m_recordings;
+    size_t m_currentRecording; // Index into m_recordings, or SIZE_MAX if stale
+  };
+}
+
+#endif
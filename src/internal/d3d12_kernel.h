@@ -5,8 +5,10 @@
 #include "backend.h"
 #include "d3d12_backend.h" // for D3D12Backend
 #include <d3d12.h>
+#include <d3d12shader.h> // for ID3D12ShaderReflection
 #include <wrl/client.h>
 #include <string>
+#include <vector>
 
 using Microsoft::WRL::ComPtr;
 
@@ -27,31 +29,95 @@ namespace aegis::internal {
      *
      * This function handles loading the HLSL file, compiling it with DXC,
      * reflecting the parameters to build a root signature, and finally
-     * creating the pipeline state object.
+     * creating the pipeline state object. With a kernel cache, the
+     * bytecode and root signature come from there if nothing changed, and
+     * the PSO from its pipeline library.
      *
      * @param backend The D3D12Backend that will own this kernel.
      * @param hlslFilePath Path to the .hlsl shader file.
      * @param entryPoint The name of the [shader("compute")] function.
+     * @param defines Preprocessor defines, part of the cache key.
+     * @param options Compiler options, see GetCompileArguments().
      * @return A unique_ptr to the new kernel, or throws an exception on failure.
      */
     static std::unique_ptr<D3D12Kernel> Create(
         D3D12Backend* backend,
         const std::string& hlslFilePath,
-        const std::string& entryPoint);
+        const std::string& entryPoint,
+        const KernelDefines& defines,
+        const KernelCompileOptions& options);
+
+    /**
+     * @brief Compiles HLSL source from memory, see Create().
+     * @param sourceName The file name DXC reports errors and resolves includes with.
+     */
+    static std::unique_ptr<D3D12Kernel> CreateFromSource(
+        D3D12Backend* backend,
+        const std::string& hlslCode,
+        const std::string& sourceName,
+        const std::string& entryPoint,
+        const KernelDefines& defines,
+        const KernelCompileOptions& options);
+
+    /**
+     * @brief Creates the kernel from DXIL compiled ahead of time. Only the
+     * root signature is built, from the bytecode's reflection.
+     */
+    static std::unique_ptr<D3D12Kernel> CreateFromBytecode(
+        D3D12Backend* backend,
+        const KernelBytecode& bytecode);
 
     ID3D12RootSignature* GetRootSignature() { return m_rootSignature.Get(); }
     ID3D12PipelineState* GetPipelineState() { return m_pipelineState.Get(); }
+
+    /**
+     * @brief Finds the root parameter of the cbuffer at register b<slot>.
+     * @return The binding, or nullptr if the kernel has no such cbuffer.
+     */
+    const KernelConstants* FindConstants(uint32_t slot) const;
+
+    bool HasConstants() const override { return !m_constants.empty(); }
   private:
+    /**
+     * @brief Compiles the source and builds the root signature from its reflection.
+     * @param arguments The DXC arguments, starting with the file name.
+     * @return The bytecode, the serialized root signature and the includes
+     * the compiler read.
+     */
+    static CachedKernel compile(D3D12Backend* backend, const std::string& hlslCode, const std::vector<LPCWSTR>& arguments);
+
+    /**
+     * @brief Builds the root signature from the reflected bindings and
+     * serializes it.
+     *
+     * Root parameter i is the root UAV of register u#i. The cbuffers come
+     * after them, as root constants if they are at most 64 bytes and fit
+     * in the 64 DWORDs of the root signature, else as root CBVs.
+     *
+     * @param constants Receives where each cbuffer went.
+     */
+    static std::vector<uint8_t> serializeRootSignature(ID3D12ShaderReflection* reflection,
+                                                       std::vector<KernelConstants>& constants);
+
+    /**
+     * @brief Creates the root signature and the PSO (through the pipeline library).
+     */
+    static std::unique_ptr<D3D12Kernel> createFromCompiled(D3D12Backend* backend, const void* bytecode, size_t bytecodeSize,
+                                                           const std::vector<uint8_t>& layout,
+                                                           std::vector<KernelConstants> constants);
+
     /**
      * @brief Private constructor. Use D3D12Kernel::Create().
      */
     D3D12Kernel(D3D12Backend* backend,
                  ComPtr<ID3D12RootSignature> rootSig,
-                 ComPtr<ID3D12PipelineState> pso);
+                 ComPtr<ID3D12PipelineState> pso,
+                 std::vector<KernelConstants> constants);
 
     D3D12Backend* m_backend;
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12PipelineState> m_pipelineState;
+    std::vector<KernelConstants> m_constants;
   };
 }
 
@@ -4,13 +4,19 @@
 
 #include "backend.h"
 #include "d3d12_backend.h"
+#include "staging_ring.h"
+#include "readback_copy.h"
+#include "submission_timeline.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <d3d12.h>
 #include <wrl/client.h>
+#include <atomic>
 #include <vector>
 #include <mutex>
-#include <queue>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 
 using Microsoft::WRL::ComPtr;
 
@@ -22,52 +28,85 @@ namespace aegis::internal {
    * @brief Holds information for a pending GPU-to-CPU data transfer.
    */
   struct PendingReadback {
-    IGpuBuffer* readbackBuffer;
-    const void* cpuDestination;
-    size_t      byteSize;
+    std::shared_ptr<ReadbackCopy> copy; // Also held by ResourceDownloadAsync()'s callback
+    UINT64 fenceValue; // 0 until the copy is submitted
+  };
+
+  /**
+   * @brief An upload that has been written to the staging ring but whose
+   * copy hasn't been recorded yet.
+   */
+  struct PendingUpload {
+    D3D12Buffer* dest;
+    size_t       destOffset;
+    IGpuBuffer*  staging;
+    size_t       stagingOffset;
+    size_t       byteSize;
   };
 
   /**
    * @brief The D3D12 implementation of a compute stream.
    *
-   * This class wraps an ID3D12GraphicsCommandList, ID3D12CommandAllocator,
-   * and an ID3D12Fence for stream-specific synchronization.
+   * This class wraps an ID3D12GraphicsCommandList, a ring of
+   * ID3D12CommandAllocators (one per submission in flight) and an
+   * ID3D12Fence for stream-specific synchronization. COMPUTE streams use
+   * DIRECT command lists, COPY streams COPY ones on a copy queue.
    *
    * Tt's responsible for:
    * 1. Recording commands.
-   * 2. Managing resource barriers.
-   * 3. Submitting to the master command queue.
-   * 4. Managing its own synchronization fence.
-   * 5. Managing temporary upload/readback buffers.
+   * 2. Managing resource barriers: state transitions, split where other
+   *    commands run in between, and UAV barriers only between dispatches
+   *    that read and write the same range.
+   * 3. Submitting to a command queue from the backend's pool.
+   * 4. Managing its own synchronization fence, which events point into.
+   * 5. Managing its upload ring, constant ring and readback arena.
    */
   class D3D12Stream: public IComputeStream {
   public:
-    D3D12Stream(D3D12Backend* backend);
+    D3D12Stream(D3D12Backend* backend, const StreamDesc& desc);
     virtual ~D3D12Stream();
 
     void RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) override;
-    void ResourceCopyBuffer(IGpuBuffer* dest, IGpuBuffer* src) override;
-    void ResourceUpload(IGpuBuffer* dest, const void* srcData, size_t byteSize) override;
-    void ResourceDownload(const void* destData, IGpuBuffer* src, size_t byteSize) override;
+    void ResourceCopyBuffer(IGpuBuffer* dest, size_t destOffset, IGpuBuffer* src, size_t srcOffset, size_t byteSize) override;
+    void ResourceUpload(IGpuBuffer* dest, size_t destOffset, const void* srcData, size_t byteSize) override;
+    std::shared_ptr<ReadbackCopy> ResourceDownload(const void* destData, IGpuBuffer* src, size_t srcOffset, size_t byteSize) override;
     void SetKernel(IComputeKernel* kernel) override;
-    void SetBuffer(uint32_t slot, IGpuBuffer* buffer) override;
+    void SetBuffer(uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize, BufferAccess access) override;
+    void SetConstants(uint32_t slot, const void* data, size_t byteSize) override;
+    void RecordGraph(IComputeGraph* graph) override;
 
     void Submit() override;
-    void HostWait() override;
+    bool HostWait(uint32_t timeoutMs) override;
     void StreamWait(IComputeEvent* event) override;
     void RecordEvent(IComputeEvent* event) override;
 
+    StagingStats GetStagingStats() const override;
+    BarrierStats GetBarrierStats() const override;
+
+    uint64_t GetRecordedFenceValue() const override;
+    uint64_t GetSubmittedFenceValue() const override;
+    uint64_t GetCompletedFenceValue() const override;
+
   private:
     /**
-     * @brief Resets the command allocator and list to record new commands.
-     * This is called after Submit() or on the first use.
+     * @brief Resets the command list onto a free allocator to record new
+     * commands. This is called after Submit() or on the first use.
      */
     void resetCommandList();
 
+    /**
+     * @brief Picks an allocator the GPU is done with (creating one if all
+     * are in flight and the ring isn't full, waiting otherwise) and resets it.
+     */
+    ID3D12CommandAllocator* acquireCommandAllocator();
+
     /**
      * @brief Manages D3D12 resource barriers.
      * This is the magic. Before a dispatch or copy, this function
      * must be called to transition buffer states.
+     * @note On COPY streams, states are tracked per command list and the
+     * buffer's own state is left alone (see the implementation). A split
+     * transition the buffer is in is ended first.
      * @param buffer The buffer to transition.
      * @param newState The target state (e.g., COPY_DEST, UNORDERED_ACCESS).
      */
@@ -75,26 +114,146 @@ namespace aegis::internal {
 
     /**
      * @brief Flushes all pending barriers in m_pendingBarriers.
+     * @note Buffers in m_returnCandidates that the command being recorded
+     * doesn't use begin their split transition back in the same batch.
      */
     void flushBarriers();
 
+    /**
+     * @brief Marks a buffer a copy took out of UNORDERED_ACCESS, so it
+     * starts going back as soon as a command doesn't use it.
+     * @param wasUnorderedAccess Whether the buffer was in UNORDERED_ACCESS before the copy.
+     */
+    void addReturnCandidate(D3D12Buffer* buffer, bool wasUnorderedAccess);
+
+    /**
+     * @brief Ends every split transition before the list is closed.
+     * @note Call before the last flushBarriers() of a command list.
+     */
+    void endSplitBarriers();
+
+    /**
+     * @brief Adds the UAV barriers the dispatch about to be recorded needs:
+     * one per bound range that overlaps a range an earlier dispatch used
+     * since that buffer's last barrier, if either access writes.
+     */
+    void addUavBarriers();
+
+    /**
+     * @brief Records the copies for every upload in m_pendingUploads.
+     * All destinations are transitioned with a single barrier batch.
+     * @note Must be called before anything that could observe the uploaded data.
+     */
+    void flushUploads();
+
+    /**
+     * @brief Makes the queue wait for the events StreamWait() recorded.
+     * @note Call right before executing this stream's lists. Blocks until
+     * the streams that signal them have submitted the values, a queue runs
+     * nothing while it waits and may be shared with the signaling stream.
+     */
+    void flushWaits();
+
+    /**
+     * @brief Executes the open list without signaling the fence and reopens
+     * it on the same allocator, with the kernel and root arguments bound again.
+     * @note The next Submit() signals the fence after both parts.
+     */
+    void splitCommandList();
+
+    /**
+     * @brief Blocks until m_fence reaches 'value'.
+     */
+    void waitForFence(UINT64 value);
+
+    /**
+     * @brief Drops the downloads another thread finished and recycles
+     * their staging memory.
+     * @note The arena isn't thread-safe, so the completion thread only
+     * copies and this frees.
+     */
+    void collectReadbacks();
+
+    /**
+     * @brief Copies out the downloads of every submission up to a fence
+     * value, which must have completed, so their staging memory can be reused.
+     */
+    void finishReadbacks(UINT64 fenceValue);
+
+    /**
+     * @brief A command allocator and the submission that last used it.
+     */
+    struct CommandAllocator {
+      ComPtr<ID3D12CommandAllocator> allocator;
+      UINT64 fenceValue; // 0 if never submitted
+    };
+
     D3D12Backend* m_backend;
-    ComPtr<ID3D12CommandAllocator> m_commandAllocator;
+    D3D12_COMMAND_LIST_TYPE m_listType;
+    std::vector<CommandAllocator> m_commandAllocators;
+    size_t m_currentAllocator; // The one the open command list records into
+    uint32_t m_maxInFlight;
     ComPtr<ID3D12GraphicsCommandList4> m_commandList;
     ComPtr<ID3D12CommandQueue> m_queue;
 
-    ComPtr<ID3D12Fence> m_fence;
-    UINT64 m_fenceValue;
-    HANDLE m_fenceEvent;
+    ComPtr<ID3D12Fence> m_fence; // Shared with the events recorded on this stream
+    std::shared_ptr<SubmissionTimeline> m_submission; // How far m_fence is on the queue, shared with the events too
+    UINT64 m_fenceValue; // The value the next Submit() will signal
+    std::atomic<UINT64> m_recordedFenceValue; // GetRecordedFenceValue(), read when other threads release objects
 
     D3D12Kernel* m_currentKernel;
     bool m_isListOpen;
+    bool m_hasOnlyWaits; // The open list was opened by StreamWait() and holds no commands yet
+
+    /**
+     * @brief A StreamWait() not issued on the queue yet.
+     */
+    struct PendingWait {
+      ComPtr<ID3D12Fence> fence;
+      UINT64 value;
+      std::shared_ptr<SubmissionTimeline> submission; // nullptr for fences the CPU signals
+    };
+    std::vector<PendingWait> m_pendingWaits; // Issued on the queue by the next submission
+
+    /**
+     * @brief A buffer range a dispatch uses as a UAV.
+     */
+    struct UavAccess {
+      D3D12Buffer* buffer; // nullptr for an unbound slot
+      size_t offset;
+      size_t byteSize;
+      BufferAccess access;
+    };
+
+    std::vector<UavAccess> m_uavBindings; // Per slot, root arguments don't outlive the list or a root signature change
+
+    /**
+     * @brief The root argument SetConstants() set for a cbuffer.
+     */
+    struct ConstantBinding {
+      UINT rootParameterIndex;
+      std::vector<uint32_t> values; // Root constants, empty for a root CBV
+      D3D12_GPU_VIRTUAL_ADDRESS address; // Root CBV
+    };
+    std::vector<ConstantBinding> m_constantBindings; // Dropped like m_uavBindings
+
+    /**
+     * @brief Replaces the root argument recorded for a cbuffer, if any.
+     */
+    void setConstantBinding(ConstantBinding binding);
+    std::vector<UavAccess> m_uavAccesses; // By dispatches since the last UAV barrier or transition of each buffer
+    std::vector<D3D12Buffer*> m_returnCandidates; // Copied from UNORDERED_ACCESS, not begun going back yet
+    std::unordered_map<D3D12Buffer*, D3D12_RESOURCE_STATES> m_splitBarriers; // Begun, with the state before; the buffer's state is the one after
+    BarrierStats m_barrierStats;
 
     std::vector<D3D12_RESOURCE_BARRIER> m_pendingBarriers;
-    std::vector<std::unique_ptr<IGpuBuffer>> m_inFlightResources;
-    std::queue<PendingReadback> m_pendingReadbacks;
+    std::unordered_map<D3D12Buffer*, D3D12_RESOURCE_STATES> m_copyListStates; // COPY streams only: states within the open list
+    std::deque<PendingReadback> m_pendingReadbacks;
 
-    // TODO: Need pools for upload and readback buffers
+    StagingRing m_uploadRing;
+    std::vector<PendingUpload> m_pendingUploads;
+    StagingRing m_constantRing; // Blocks of root CBVs
+    StagingRing m_readbackArena;
   };
 }
 
@@ -0,0 +1,117 @@
+/**
+ * @file deferred_release_queue.h
+ * @brief Destroys backend objects once the GPU is done with them
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief Holds released backend objects until no submitted work can
+   * still use them.
+   *
+   * A released object is tagged with the recorded fence value of every
+   * live stream that has unfinished work, and destroyed once all of those
+   * fences passed. Objects released while the GPU is idle are destroyed
+   * right away. Nothing here ever waits for the GPU, except Drain().
+   *
+   * @note All methods are thread-safe.
+   */
+  class DeferredReleaseQueue {
+  public:
+    /**
+     * @brief Destroys a released stream, given the owning pointer.
+     */
+    using StreamDeleter = std::function<void(std::unique_ptr<IComputeStream>)>;
+
+    DeferredReleaseQueue() = default;
+    ~DeferredReleaseQueue();
+
+    DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+    DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+    /**
+     * @brief Starts tagging released objects with the fence of 'stream'.
+     */
+    void AddStream(IComputeStream* stream);
+
+    /**
+     * @brief Destroys 'object' once the work recorded so far on every stream is done.
+     */
+    template <typename T>
+    void Release(std::unique_ptr<T> object) {
+      if (object) {
+        enqueue(std::make_unique<Holder<T>>(std::move(object)), nullptr);
+      }
+    }
+
+    /**
+     * @brief Stops tracking a stream and destroys it once its submitted work is done.
+     * @note Work recorded but never submitted is dropped.
+     * @param stream The stream, as passed to AddStream().
+     * @param deleter Destroys the stream; runs on whichever thread collects it.
+     */
+    void ReleaseStream(std::unique_ptr<IComputeStream> stream, StreamDeleter deleter);
+
+    /**
+     * @brief Destroys every released object the GPU is done with.
+     */
+    void Collect();
+
+    /**
+     * @brief Destroys everything, waiting for the released streams first.
+     * @note For context destruction, once no live stream is left.
+     */
+    void Drain();
+
+    /**
+     * @brief Gets the number of objects waiting for the GPU.
+     */
+    size_t GetPendingCount() const;
+
+  private:
+    struct IHolder {
+      virtual ~IHolder() = default;
+    };
+
+    template <typename T>
+    struct Holder : IHolder {
+      explicit Holder(std::unique_ptr<T> object) : object(std::move(object)) {}
+      std::unique_ptr<T> object;
+    };
+
+    struct StreamHolder : IHolder {
+      StreamHolder(std::unique_ptr<IComputeStream> stream, StreamDeleter deleter) : stream(std::move(stream)), deleter(std::move(deleter)) {}
+      ~StreamHolder() override { deleter(std::move(stream)); }
+      std::unique_ptr<IComputeStream> stream;
+      StreamDeleter deleter;
+    };
+
+    struct Entry {
+      std::unique_ptr<IHolder> holder;
+      std::vector<std::pair<IComputeStream*, uint64_t>> waits; // Fence values that must pass first
+      IComputeStream* stream; // Set if the entry is a released stream
+    };
+
+    void enqueue(std::unique_ptr<IHolder> holder, IComputeStream* releasedStream);
+
+    /**
+     * @brief Moves the entries whose waits all passed to 'ready'. Entries
+     * waiting on a ready stream stop doing so, its destruction waits for it.
+     */
+    void takeReadyLocked(std::vector<Entry>& ready);
+
+    mutable std::mutex m_mutex; // Protects everything below
+    std::vector<IComputeStream*> m_streams; // Live streams
+    std::vector<Entry> m_entries;
+  };
+}
@@ -0,0 +1,122 @@
+/**
+ * @file host_fence.h
+ * @brief A CPU-side timeline fence (the host equivalent of an ID3D12Fence)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace aegis::internal {
+  /**
+   * @brief A monotonically increasing 64-bit counter that threads can wait on.
+   *
+   * Signal() raises the completed value (it never goes down), Wait() blocks
+   * until the completed value reaches a target.
+   */
+  class HostFence {
+  public:
+    HostFence() : m_completedValue(0) {}
+
+    HostFence(const HostFence&) = delete;
+    HostFence& operator=(const HostFence&) = delete;
+
+    /**
+     * @brief Gets the last value the fence reached.
+     */
+    uint64_t GetCompletedValue() const {
+      return m_completedValue.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Raises the fence to 'value' and wakes any waiters.
+     * @note Lower values than the current one are ignored.
+     */
+    void Signal(uint64_t value) {
+      // Notifying under the lock lets a woken waiter destroy the fence right away
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (value <= m_completedValue.load(std::memory_order_relaxed)) {
+        return;
+      }
+      m_completedValue.store(value); // seq_cst, pairs with the waiter count in WaitAny()
+      m_condition.notify_all();
+
+      if (anyWaiterCount().load() > 0) {
+        std::lock_guard<std::mutex> anyLock(anyMutex());
+        anyCondition().notify_all();
+      }
+    }
+
+    /**
+     * @brief Blocks until the fence reaches 'value'.
+     */
+    void Wait(uint64_t value) {
+      if (GetCompletedValue() >= value) {
+        return;
+      }
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [&] { return m_completedValue.load(std::memory_order_relaxed) >= value; });
+    }
+
+    /**
+     * @brief Blocks until the fence reaches 'value' or the timeout expires.
+     * @return false if the timeout expired first.
+     */
+    bool Wait(uint64_t value, std::chrono::milliseconds timeout) {
+      if (GetCompletedValue() >= value) {
+        return true;
+      }
+      std::unique_lock<std::mutex> lock(m_mutex);
+      return m_condition.wait_for(lock, timeout, [&] { return m_completedValue.load(std::memory_order_relaxed) >= value; });
+    }
+
+    /**
+     * @brief Blocks until one of the fences reaches its value.
+     * @param fences The fences to wait on.
+     * @param values The value to wait for, one per fence.
+     * @param count The number of fences, at least one.
+     * @param timeout How long to wait at most, std::chrono::milliseconds::max() for no limit.
+     * @return The index of a fence that got there, or 'count' on timeout.
+     */
+    static size_t WaitAny(HostFence* const* fences, const uint64_t* values, size_t count,
+                          std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+      size_t index = count;
+      auto reached = [&] {
+        for (size_t i = 0; i < count; ++i) {
+          if (fences[i]->m_completedValue.load() >= values[i]) {
+            index = i;
+            return true;
+          }
+        }
+        return false;
+      };
+
+      // Signals only pay for the shared condition while someone waits here
+      anyWaiterCount()++;
+      {
+        std::unique_lock<std::mutex> lock(anyMutex());
+        if (timeout == std::chrono::milliseconds::max()) {
+          anyCondition().wait(lock, reached);
+        } else {
+          anyCondition().wait_for(lock, timeout, reached);
+        }
+      }
+      anyWaiterCount()--;
+      return index;
+    }
+
+  private:
+    static std::atomic<int>& anyWaiterCount() { static std::atomic<int> count{0}; return count; }
+    static std::mutex& anyMutex() { static std::mutex mutex; return mutex; }
+    static std::condition_variable& anyCondition() { static std::condition_variable condition; return condition; }
+
+    std::atomic<uint64_t> m_completedValue;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+  };
+}
@@ -0,0 +1,68 @@
+/**
+ * @file host_memory_registry.h
+ * @brief Tracks pinned and imported host memory
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace aegis::internal {
+  /**
+   * @brief Maps host address ranges to the HOST buffers backing them.
+   *
+   * Every range from ComputeContext::AllocateHostMemory() or
+   * RegisterHostMemory() is recorded here, so uploads and downloads can
+   * check whether a CPU pointer is GPU-visible and copy straight from/to
+   * it instead of going through staging memory.
+   *
+   * @note All methods are thread-safe.
+   */
+  class HostMemoryRegistry {
+  public:
+    /**
+     * @brief Where a CPU pointer lives in a HOST buffer.
+     */
+    struct Location {
+      IGpuBuffer* buffer = nullptr;
+      size_t offset = 0;
+    };
+
+    /**
+     * @brief Records a range. Throws if it overlaps one that is already recorded.
+     * @param base The first byte of the range.
+     * @param byteSize The size of the range.
+     * @param buffer The HOST buffer whose memory the range is. The registry owns it.
+     * @param isImported Whether the memory belongs to the caller (RegisterHostMemory()).
+     */
+    void Add(const void* base, size_t byteSize, std::unique_ptr<IGpuBuffer> buffer, bool isImported);
+
+    /**
+     * @brief Removes the range starting at 'base'.
+     * @return The buffer backing it, or nullptr if there is no such range of that kind.
+     */
+    std::unique_ptr<IGpuBuffer> Remove(const void* base, bool isImported);
+
+    /**
+     * @brief Looks up a CPU range.
+     * @return true if [pointer, pointer + byteSize) lies in one recorded range.
+     */
+    bool Find(const void* pointer, size_t byteSize, Location& location) const;
+
+  private:
+    struct Entry {
+      size_t byteSize;
+      std::unique_ptr<IGpuBuffer> buffer;
+      bool isImported;
+    };
+
+    mutable std::mutex m_mutex; // Protects m_ranges
+    std::map<uintptr_t, Entry> m_ranges; // By base address
+  };
+}
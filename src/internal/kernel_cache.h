@@ -0,0 +1,109 @@
+/**
+ * @file kernel_cache.h
+ * @brief Content-addressed on-disk cache of compiled kernels
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief 64-bit FNV-1a hash of a byte range.
+   * @param seed The hash of the bytes before, to hash several ranges as one.
+   */
+  uint64_t HashBytes(const void* data, size_t byteSize, uint64_t seed = 0xcbf29ce484222325ull);
+
+  /**
+   * @brief Formats a hash as 16 hex digits.
+   */
+  std::string HashToString(uint64_t hash);
+
+  /**
+   * @brief A file the compiler read besides the source, and its content
+   * hash at the time.
+   */
+  struct KernelDependency {
+    std::string path; // UTF-8, as the compiler asked for it
+    uint64_t contentHash;
+  };
+
+  /**
+   * @brief Where the root signature puts a cbuffer of the kernel.
+   */
+  struct KernelConstants {
+    uint32_t slot; // The b# register
+    uint32_t byteSize; // The size of the cbuffer
+    uint32_t rootParameterIndex;
+    bool isRootConstants; // Else a root CBV
+  };
+
+  /**
+   * @brief What compiling a kernel produced.
+   */
+  struct CachedKernel {
+    std::vector<KernelDependency> includes; // The include closure of the source
+    std::vector<uint8_t> bytecode; // DXIL
+    std::vector<uint8_t> layout; // The serialized root signature
+    std::vector<KernelConstants> constants; // The cbuffers in the layout
+  };
+
+  /**
+   * @brief Stores compiled kernels in a directory, one file per key.
+   *
+   * The key holds everything the output depends on that is known before
+   * compiling (source hash, entry point, compiler arguments and version,
+   * adapter and driver); the file is named after its hash. Includes are
+   * only known afterwards, so an entry lists them with their hashes and
+   * Load() treats the entry as stale if any of them changed.
+   *
+   * Entries are written to a temporary file and renamed, so processes
+   * sharing the directory never read a partial one. I/O errors make Load()
+   * miss and Store() do nothing: the cache only saves time.
+   *
+   * @note Thread-safe, it has no state besides the directory.
+   */
+  class KernelCache {
+  public:
+    /**
+     * @brief Opens or creates the cache directory.
+     * @param directory The directory, the cache is disabled if empty.
+     */
+    explicit KernelCache(std::string directory);
+
+    /**
+     * @brief Whether a directory was given and could be created.
+     */
+    [[nodiscard]] bool IsEnabled() const { return !m_directory.empty(); }
+
+    /**
+     * @brief Looks up a kernel.
+     * @return The kernel, or nullopt if there is no entry for the key, it
+     * is corrupt or one of its includes changed.
+     */
+    [[nodiscard]] std::optional<CachedKernel> Load(const std::string& key) const;
+
+    /**
+     * @brief Adds or replaces the entry of a key.
+     */
+    void Store(const std::string& key, const CachedKernel& kernel) const;
+
+    /**
+     * @brief Reads a whole file of the cache directory.
+     * @return The bytes, or nullopt if the file can't be read.
+     */
+    [[nodiscard]] std::optional<std::vector<uint8_t>> ReadFile(const std::string& name) const;
+
+    /**
+     * @brief Replaces a file of the cache directory in one step.
+     */
+    void WriteFile(const std::string& name, const void* data, size_t byteSize) const;
+
+  private:
+    std::string m_directory; // Empty if disabled
+  };
+}
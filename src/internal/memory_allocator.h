@@ -0,0 +1,111 @@
+/**
+ * @file memory_allocator.h
+ * @brief Suballocates buffers out of large backend heaps
+ */
+
+#pragma once
+
+#include "backend.h"
+#include "tlsf_allocator.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief A block of memory buffers can be placed in.
+   * @note This is a backend-specific wrapper (e.g., ID3D12Heap,
+   * VkDeviceMemory or plain host memory). The allocator only owns it.
+   */
+  class IMemoryHeap {
+  public:
+    virtual ~IMemoryHeap() = default;
+  };
+
+  /**
+   * @brief A backend-neutral heap suballocator.
+   *
+   * Buffers are carved out of heaps of a fixed block size, each managed by
+   * a TlsfAllocator. Requests bigger than half a block get a heap of their
+   * own. Heaps are created through a factory, so the same allocator runs on
+   * top of D3D12 heaps, Vulkan device memory or host memory.
+   *
+   * When a heap becomes empty it is released, except for one that is kept
+   * around so that create/destroy loops don't churn heaps.
+   *
+   * @note All methods are thread-safe.
+   */
+  class MemoryAllocator {
+  public:
+    /**
+     * @brief Creates a heap of the given size, or returns nullptr on failure.
+     */
+    using HeapFactory = std::function<std::unique_ptr<IMemoryHeap>(size_t byteSize)>;
+
+    /**
+     * @brief A placed range. Keep it around to Free() it.
+     */
+    struct Allocation {
+      IMemoryHeap* heap = nullptr;
+      size_t offset = 0;
+      size_t size = 0;
+
+      explicit operator bool() const { return heap != nullptr; }
+
+    private:
+      friend class MemoryAllocator;
+      void* block = nullptr;
+      TlsfAllocator::Allocation range;
+    };
+
+    /**
+     * @param createHeap Creates the backing heaps.
+     * @param blockSize The size of a regular heap in bytes.
+     * @param granularity The smallest unit of allocation (a power of two).
+     */
+    MemoryAllocator(HeapFactory createHeap, size_t blockSize, size_t granularity);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    /**
+     * @brief Reserves byteSize bytes at an offset aligned to 'alignment'.
+     * @return The placement, or an empty Allocation if heap creation failed.
+     */
+    Allocation Allocate(size_t byteSize, size_t alignment);
+
+    /**
+     * @brief Releases an allocation and resets it.
+     */
+    void Free(Allocation& allocation);
+
+    /**
+     * @brief Gets usage and fragmentation counters.
+     */
+    MemoryStats GetStats() const;
+
+  private:
+    struct Block {
+      std::unique_ptr<IMemoryHeap> heap;
+      std::unique_ptr<TlsfAllocator> allocator;
+      bool dedicated;
+    };
+
+    HeapFactory m_createHeap;
+    size_t m_blockSize;
+    size_t m_granularity;
+
+    mutable std::mutex m_mutex; // Protects everything below
+    std::vector<std::unique_ptr<Block>> m_blocks;
+    uint64_t m_dedicatedCount;
+  };
+
+  /**
+   * @brief Adds up the counters of several allocators.
+   */
+  MemoryStats CombineMemoryStats(const MemoryStats& a, const MemoryStats& b);
+}
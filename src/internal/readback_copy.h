@@ -0,0 +1,65 @@
+/**
+ * @file readback_copy.h
+ * @brief The CPU half of a download: the memcpy() out of staging memory
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+namespace aegis::internal {
+  /**
+   * @brief Copies a finished download from staging memory to its destination.
+   *
+   * HostWait() on the recording thread and the completion thread may both
+   * get to a download. Whichever is first does the memcpy(), the other one
+   * waits for it, so the copy runs exactly once and the staging memory is
+   * only reused once IsDone().
+   */
+  class ReadbackCopy {
+  public:
+    /**
+     * @param stagingAddress Mapped pointer into the readback arena.
+     * @param destination Where the data goes.
+     * @param byteSize The size of the download.
+     */
+    ReadbackCopy(const void* stagingAddress, void* destination, size_t byteSize) :
+        m_stagingAddress(stagingAddress), m_destination(destination), m_byteSize(byteSize), m_state(kPending) {}
+
+    ReadbackCopy(const ReadbackCopy&) = delete;
+    ReadbackCopy& operator=(const ReadbackCopy&) = delete;
+
+    /**
+     * @brief Does the copy, or waits for the thread that is doing it.
+     * @note Only call once the GPU finished the download.
+     */
+    void Finish() {
+      int expected = kPending;
+      if (m_state.compare_exchange_strong(expected, kCopying)) {
+        std::memcpy(m_destination, m_stagingAddress, m_byteSize);
+        m_state.store(kDone, std::memory_order_release);
+        m_state.notify_all();
+        return;
+      }
+      while (expected != kDone) {
+        m_state.wait(expected, std::memory_order_acquire);
+        expected = m_state.load(std::memory_order_acquire);
+      }
+    }
+
+    /**
+     * @brief Checks whether the data was copied out and the staging memory is free.
+     */
+    bool IsDone() const { return m_state.load(std::memory_order_acquire) == kDone; }
+
+  private:
+    enum State : int { kPending, kCopying, kDone };
+
+    const void* m_stagingAddress;
+    void* m_destination;
+    size_t m_byteSize;
+    std::atomic<int> m_state;
+  };
+}
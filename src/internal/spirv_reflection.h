@@ -0,0 +1,56 @@
+/**
+ * @file spirv_reflection.h
+ * @brief Minimal SPIR-V reflection for compute shaders
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief The kind of descriptor a SPIR-V resource variable needs.
+   */
+  enum class SpirvResourceKind {
+    /** @brief RWStructuredBuffer, RWByteAddressBuffer, StructuredBuffer... */
+    STORAGE_BUFFER,
+    /** @brief cbuffer / ConstantBuffer. */
+    UNIFORM_BUFFER
+  };
+
+  /**
+   * @brief One descriptor binding used by a shader.
+   */
+  struct SpirvBinding {
+    uint32_t set;
+    uint32_t binding;
+    SpirvResourceKind kind;
+    size_t blockSize; // UNIFORM_BUFFER only: the size the block's layout declares, rounded up to 16 bytes
+  };
+
+  /**
+   * @brief What the Vulkan backend needs to know about a compute shader.
+   */
+  struct SpirvReflection {
+    std::vector<SpirvBinding> bindings;
+    /** @brief The [numthreads] of the entry point, if the module declares it with OpExecutionMode. */
+    uint32_t localSize[3] = {1, 1, 1};
+  };
+
+  /**
+   * @brief Reflects the descriptor bindings of a SPIR-V module.
+   *
+   * This only understands what DXC emits for compute shaders: buffer
+   * resources decorated with DescriptorSet/Binding. Any other resource
+   * (images, samplers) makes it throw, since the backend can't bind them.
+   * Uniform blocks are sized from their Offset/ArrayStride/MatrixStride
+   * decorations.
+   *
+   * @param code The SPIR-V words.
+   * @param byteSize The size of the module in bytes.
+   * @return The reflected bindings, sorted by set and binding.
+   */
+  SpirvReflection ReflectSpirv(const uint32_t* code, size_t byteSize);
+}
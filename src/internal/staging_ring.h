@@ -0,0 +1,198 @@
+/**
+ * @file staging_ring.h
+ * @brief Fence-tracked ring suballocation for upload/readback staging memory
+ */
+
+#pragma once
+
+#include "backend.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief The bookkeeping half of a ring buffer: hands out offsets, no memory.
+   *
+   * Allocations are carved from the head of the ring. Close() tags everything
+   * allocated since the previous Close() with a fence value, and Reclaim()
+   * moves the tail past every tagged range whose fence has completed.
+   * Allocations that don't fit at the end wrap around to offset 0 and the
+   * skipped bytes are reclaimed together with them.
+   */
+  class RingAllocator {
+  public:
+    static constexpr size_t kInvalidOffset = std::numeric_limits<size_t>::max();
+
+    /**
+     * @param capacity The size of the ring in bytes.
+     */
+    explicit RingAllocator(size_t capacity);
+
+    /**
+     * @brief Reserves byteSize bytes.
+     * @param byteSize The number of bytes, must be > 0.
+     * @param alignment The required alignment of the returned offset (a power of two).
+     * @return The offset of the allocation, or kInvalidOffset if the ring is full.
+     */
+    size_t Allocate(size_t byteSize, size_t alignment);
+
+    /**
+     * @brief Tags everything allocated since the last Close() with 'fenceValue'.
+     * @note Fence values must be passed in increasing order.
+     */
+    void Close(uint64_t fenceValue);
+
+    /**
+     * @brief Frees every range whose fence value is <= completedValue.
+     */
+    void Reclaim(uint64_t completedValue);
+
+    size_t GetCapacity() const { return m_capacity; }
+
+    /**
+     * @brief Whether some closed range still waits for its fence.
+     */
+    bool HasClosedRanges() const { return !m_ranges.empty(); }
+
+    /**
+     * @brief Gets the fence value of the oldest closed range.
+     * @note Only valid if HasClosedRanges().
+     */
+    uint64_t GetOldestFenceValue() const { return m_ranges.front().fenceValue; }
+
+    /**
+     * @brief Gets the number of bytes that are allocated or waiting for a fence
+     * (alignment padding and wrap-around waste included).
+     */
+    size_t GetUsedBytes() const { return m_used; }
+
+  private:
+    struct Range {
+      uint64_t fenceValue;
+      size_t end;
+      size_t byteCount;
+    };
+
+    size_t m_capacity;
+    size_t m_head; // Next free byte
+    size_t m_tail; // Oldest byte still in use
+    size_t m_used;
+    size_t m_openBytes; // Allocated since the last Close()
+    std::deque<Range> m_ranges;
+  };
+
+  /**
+   * @brief A persistently mapped UPLOAD or READBACK buffer managed as a ring.
+   *
+   * Streams use this instead of creating a buffer per ResourceUpload() or
+   * ResourceDownload() call.
+   * The ring buffer is created on first use and mapped once. When it runs
+   * out of space it is replaced by one twice the size (the old one is kept
+   * alive until the GPU is done with it), and requests too big for the
+   * ring get a dedicated buffer with the same lifetime rules. Once the
+   * ring reached its maximum size it stops growing: a full ring waits for
+   * its oldest submission instead and is reused.
+   */
+  class StagingRing {
+  public:
+    /**
+     * @brief Blocks until the memory tagged with a fence value can be reused.
+     */
+    using WaitFunction = std::function<void(uint64_t fenceValue)>;
+
+    static constexpr size_t kDefaultCapacity = 4 * 1024 * 1024;
+    static constexpr size_t kMaxCapacity = 64 * 1024 * 1024; // Unless the initial capacity is bigger
+
+    /**
+     * @brief A suballocation.
+     */
+    struct Allocation {
+      IGpuBuffer* buffer; // The buffer to copy to/from
+      size_t offset;      // The offset in 'buffer'
+      void* cpuAddress;   // Mapped pointer to 'offset'
+    };
+
+    /**
+     * @param backend The backend that creates the staging buffers.
+     * @param type UPLOAD or READBACK.
+     * @param capacity The initial ring size in bytes.
+     * @param waitForFence Called when the ring is full at its maximum
+     * size. Without it, such requests get a dedicated buffer.
+     */
+    StagingRing(IComputeBackend* backend, GpuMemoryType type, size_t capacity = kDefaultCapacity,
+                WaitFunction waitForFence = {});
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    /**
+     * @brief Reserves byteSize bytes of mapped staging memory.
+     * @note The memory stays valid until the fence value passed to the next
+     * Close() has been passed to Reclaim().
+     */
+    Allocation Allocate(size_t byteSize, size_t alignment);
+
+    /**
+     * @brief Tags everything allocated since the last Close() with 'fenceValue'.
+     */
+    void Close(uint64_t fenceValue);
+
+    /**
+     * @brief Releases every allocation whose fence value is <= completedValue.
+     */
+    void Reclaim(uint64_t completedValue);
+
+    /**
+     * @brief Gets the usage counters.
+     */
+    StagingPoolStats GetStats() const;
+
+  private:
+    struct RetiredBuffer {
+      uint64_t fenceValue;
+      std::unique_ptr<IGpuBuffer> buffer;
+    };
+
+    /**
+     * @brief Creates a mapped buffer and keeps it until the next Close() fence passes.
+     */
+    Allocation allocateDedicated(size_t byteSize);
+
+    /**
+     * @brief Moves a buffer to the list that is released by the next Close() fence.
+     */
+    void retire(std::unique_ptr<IGpuBuffer> buffer);
+
+    /**
+     * @brief Waits for the oldest submissions still using the ring until
+     * the request fits, for a ring that can't grow anymore.
+     * @return The offset, or kInvalidOffset if the ring is full of work
+     * that wasn't closed yet.
+     */
+    size_t waitForSpace(size_t byteSize, size_t alignment);
+
+    void updateHighWater();
+
+    IComputeBackend* m_backend;
+    GpuMemoryType m_type;
+    size_t m_capacity;
+    size_t m_maxCapacity;
+    WaitFunction m_waitForFence;
+
+    std::unique_ptr<IGpuBuffer> m_buffer;
+    uint8_t* m_mappedPtr;
+    RingAllocator m_allocator;
+
+    std::vector<std::unique_ptr<IGpuBuffer>> m_openRetired; // Retired since the last Close()
+    std::deque<RetiredBuffer> m_retired;
+    size_t m_retiredBytes; // Total size of m_openRetired and m_retired
+
+    StagingPoolStats m_stats;
+  };
+}
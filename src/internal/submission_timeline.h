@@ -0,0 +1,56 @@
+/**
+ * @file submission_timeline.h
+ * @brief How far a stream has put its timeline fence on a hardware queue
+ */
+
+#pragma once
+
+#include "host_fence.h"
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+namespace aegis::internal {
+  /**
+   * @brief Tracks the fence values a stream has submitted to its queue.
+   *
+   * Streams can share a hardware queue, which runs nothing while it waits.
+   * A queue wait for a value that isn't submitted yet could sit in front
+   * of the very submission that signals it, so a stream holds its
+   * submission on the CPU until every value it waits for is submitted.
+   * Shared between the stream and the events recorded on it.
+   */
+  class SubmissionTimeline {
+  public:
+    /**
+     * @brief Records that the stream submitted every value up to 'value'.
+     */
+    void Submitted(uint64_t value) { m_submitted.Signal(value); }
+
+    /**
+     * @brief Records that the calling thread records events on the stream.
+     */
+    void Recorded() { m_recordingThread.store(std::this_thread::get_id()); }
+
+    /**
+     * @brief Blocks until the stream submitted 'value'.
+     * @note Throws if the calling thread recorded the stream's last event,
+     * nothing else would submit it.
+     */
+    void WaitSubmitted(uint64_t value) {
+      if (m_submitted.GetCompletedValue() >= value) {
+        return;
+      }
+      if (m_recordingThread.load() == std::this_thread::get_id()) {
+        throw std::runtime_error("Submit the stream that records an event before a stream that waits for it.");
+      }
+      m_submitted.Wait(value);
+    }
+
+  private:
+    HostFence m_submitted;
+    std::atomic<std::thread::id> m_recordingThread;
+  };
+}
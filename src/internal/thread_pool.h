@@ -0,0 +1,87 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing thread pool shared by the host-side parts of Aegis
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief A fixed-size pool of worker threads with per-worker task deques.
+   *
+   * Each worker pops tasks from the front of its own deque and, when that is
+   * empty, steals from the back of the other workers' deques. Tasks submitted
+   * from a worker thread land on that worker's deque, so nested parallelism
+   * stays local until another worker runs out of work.
+   */
+  class ThreadPool {
+  public:
+    /**
+     * @brief Starts the worker threads.
+     * @param threadCount The number of workers. 0 uses std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool(uint32_t threadCount = 0);
+
+    /**
+     * @brief Finishes all queued tasks and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queues a task. Returns immediately.
+     * @note The task must not throw.
+     * @param task The task to run on a worker.
+     */
+    void Submit(std::function<void()> task);
+
+    /**
+     * @brief Runs body(i) for every i in [0, count) and blocks until all are done.
+     * @note The calling thread helps execute tasks while it waits. If any
+     * invocation throws, the first exception is rethrown here.
+     * @param count The number of iterations.
+     * @param body The function to run for each iteration.
+     */
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    /**
+     * @brief Gets the number of worker threads.
+     */
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+  private:
+    struct WorkerQueue {
+      std::mutex mutex;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(uint32_t index);
+
+    /**
+     * @brief Takes a task: the own queue first (front), then steals (back).
+     * @param index The queue to start from.
+     */
+    bool tryTakeTask(uint32_t index, std::function<void()>& outTask);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    std::atomic<size_t> m_queuedTasks;
+    std::atomic<uint32_t> m_nextQueue;
+    bool m_stopping;
+  };
+}
@@ -0,0 +1,132 @@
+/**
+ * @file tlsf_allocator.h
+ * @brief Two-Level Segregated Fit range allocator
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief Suballocates ranges of a fixed-size address space in O(1).
+   *
+   * This is the bookkeeping half of a heap allocator: it hands out offsets
+   * and never touches memory, so the same code manages ID3D12Heaps,
+   * VkDeviceMemory blocks and plain host memory.
+   *
+   * Free ranges are kept in size classes: the first level is the power of
+   * two of the size, the second level splits every power of two into 16
+   * linear steps. A bitmap per level makes finding a big enough free range
+   * two bit scans. Freed ranges are merged with their free neighbours
+   * immediately.
+   */
+  class TlsfAllocator {
+  public:
+    static constexpr size_t kInvalidOffset = std::numeric_limits<size_t>::max();
+
+    /**
+     * @brief A reserved range.
+     */
+    struct Allocation {
+      size_t offset = kInvalidOffset;
+      size_t size = 0; // The reserved size, rounded up to the granularity
+      void* handle = nullptr;
+
+      bool IsValid() const { return handle != nullptr; }
+    };
+
+    /**
+     * @param capacity The size of the address space in bytes.
+     * @param granularity Every offset and size is a multiple of this (a power of two).
+     */
+    TlsfAllocator(size_t capacity, size_t granularity);
+
+    TlsfAllocator(const TlsfAllocator&) = delete;
+    TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+
+    /**
+     * @brief Reserves a range.
+     * @param byteSize The size in bytes.
+     * @param alignment The required alignment of the offset (a power of two).
+     * @return The range, or an invalid Allocation if no free range is big enough.
+     */
+    Allocation Allocate(size_t byteSize, size_t alignment);
+
+    /**
+     * @brief Releases a range returned by Allocate().
+     */
+    void Free(const Allocation& allocation);
+
+    size_t GetCapacity() const { return m_capacity; }
+    size_t GetUsedBytes() const { return m_usedBytes; }
+    size_t GetFreeBytes() const { return m_capacity - m_usedBytes; }
+    size_t GetAllocationCount() const { return m_allocationCount; }
+    size_t GetFreeRangeCount() const { return m_freeRangeCount; }
+    bool IsEmpty() const { return m_allocationCount == 0; }
+
+    /**
+     * @brief Gets the size of the largest free range.
+     */
+    size_t GetLargestFreeRange() const;
+
+  private:
+    static constexpr uint32_t kSecondLevelLog2 = 4;
+    static constexpr uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+    static constexpr uint32_t kFirstLevelCount = 64;
+
+    /**
+     * @brief A free or used range. Physically adjacent ranges are linked so
+     * they can be merged; free ranges are also linked into their size class.
+     */
+    struct Block {
+      size_t offset;
+      size_t size;
+      Block* prevPhysical;
+      Block* nextPhysical;
+      Block* prevFree;
+      Block* nextFree;
+      bool isFree;
+    };
+
+    /**
+     * @brief Maps a size (in granules) to its size class.
+     */
+    static void mapping(size_t units, uint32_t& firstLevel, uint32_t& secondLevel);
+
+    /**
+     * @brief Finds a free block of at least 'size' bytes, or nullptr.
+     */
+    Block* findFree(size_t size) const;
+
+    void insertFree(Block* block);
+    void removeFree(Block* block);
+
+    /**
+     * @brief Splits the first 'size' bytes off 'block'; the rest becomes a new free block.
+     */
+    void split(Block* block, size_t size);
+
+    Block* newBlock();
+    void deleteBlock(Block* block);
+
+    size_t m_capacity;
+    size_t m_granularity;
+    uint32_t m_granularityLog2;
+
+    uint64_t m_firstLevelBitmap;
+    uint32_t m_secondLevelBitmap[kFirstLevelCount];
+    Block* m_freeLists[kFirstLevelCount][kSecondLevelCount];
+
+    std::deque<Block> m_blockStorage; // Stable addresses
+    std::vector<Block*> m_unusedBlocks;
+
+    size_t m_usedBytes;
+    size_t m_allocationCount;
+    size_t m_freeRangeCount;
+  };
+}
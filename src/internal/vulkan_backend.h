@@ -0,0 +1,253 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_VULKAN)
+
+#include "backend.h"
+#include "memory_allocator.h"
+
+#include <vulkan/vulkan.h>
+#include <dxc/dxcapi.h>
+
+#undef CreateEvent
+
+#include <string>
+#include <memory> // for std::unique_ptr
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#define VkThrowIfFailed(result) if((result) != VK_SUCCESS) { throw std::runtime_error(std::string("Vulkan call failed: ") + #result); }
+#define DxcThrowIfFailed(hr) if(FAILED(hr)) { throw std::runtime_error(std::string("DXC HRESULT failed: ") + #hr); }
+
+namespace aegis::internal {
+  /**
+   * @brief Minimal owning pointer for DXC's COM interfaces.
+   *
+   * WRL's ComPtr only exists on Windows, and the Vulkan backend also has to
+   * build against the Linux DXC package, so this covers the little we need.
+   */
+  template <typename T>
+  class DxcPtr {
+  public:
+    DxcPtr() : m_ptr(nullptr) {}
+    ~DxcPtr() { Reset(); }
+
+    DxcPtr(const DxcPtr&) = delete;
+    DxcPtr& operator=(const DxcPtr&) = delete;
+
+    T* Get() const { return m_ptr; }
+    T* operator->() const { return m_ptr; }
+    explicit operator bool() const { return m_ptr != nullptr; }
+
+    /** @brief Releases the current pointer and returns the address to receive a new one. */
+    T** ReleaseAndGetAddressOf() { Reset(); return &m_ptr; }
+
+    /** @brief Out-parameter for DxcCreateInstance/QueryInterface style calls. */
+    void** PutVoid() { return reinterpret_cast<void**>(ReleaseAndGetAddressOf()); }
+
+    void Reset() {
+      if (m_ptr) {
+        m_ptr->Release();
+        m_ptr = nullptr;
+      }
+    }
+
+  private:
+    T* m_ptr;
+  };
+
+  /**
+   * @brief A VkDeviceMemory block that DEVICE_LOCAL buffers are bound into.
+   */
+  class VulkanHeap : public IMemoryHeap {
+  public:
+    VulkanHeap(VkDevice device, VkDeviceMemory memory) : m_device(device), m_memory(memory) {}
+    ~VulkanHeap() override { vkFreeMemory(m_device, m_memory, nullptr); }
+
+    VkDeviceMemory GetMemory() const { return m_memory; }
+
+  private:
+    VkDevice m_device;
+    VkDeviceMemory m_memory;
+  };
+
+  /**
+   * @brief A VkQueue that streams share.
+   */
+  struct VulkanQueue {
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t familyIndex = 0;
+    StreamType type = StreamType::COMPUTE;
+    StreamPriority priority = StreamPriority::NORMAL; // NORMAL or HIGH
+    uint32_t streamCount = 0; // Protected by the backend's pool mutex
+    std::mutex mutex; // Protects submission
+  };
+
+  /**
+   * @brief The Vulkan implementation of the compute backend interface.
+   *
+   * This class owns the instance, the logical device and the queues the
+   * streams submit to, plus the DXC objects used to compile HLSL to SPIR-V.
+   *
+   * Queue priorities are fixed at device creation, so the compute family's
+   * queues are split into a NORMAL and a HIGH pool up front (REALTIME
+   * streams use the HIGH one). Without a second queue everything shares one.
+   */
+  class VulkanBackend : public IComputeBackend {
+  public:
+    ~VulkanBackend() override;
+
+    /**
+     * @brief Creates and initializes the Vulkan backend.
+     * @param desc The context options (memory block size).
+     * @return A unique_ptr to the new backend. Throws std::runtime_error
+     * saying what is missing if Vulkan 1.2 with timeline semaphores or
+     * dxcompiler isn't available.
+     */
+    static std::unique_ptr<VulkanBackend> Create(const ContextDesc& desc);
+
+    std::unique_ptr<IComputeStream> CreateStream(const StreamDesc& desc) override;
+    std::unique_ptr<IComputeEvent> CreateEvent() override;
+    std::unique_ptr<IGpuBuffer> CreateBuffer(size_t byteSize, GpuMemoryType type) override;
+    std::unique_ptr<IGpuBuffer> ImportHostMemory(void* hostPointer, size_t byteSize) override;
+    std::unique_ptr<IComputeKernel> CreateKernel(const std::string& hlslFilePath, const std::string& entryPoint,
+                                                 const KernelDefines& defines, const KernelCompileOptions& options) override;
+    std::unique_ptr<IComputeKernel> CreateKernelFromSource(const std::string& hlslSource, const std::string& sourceName,
+                                                           const std::string& entryPoint, const KernelDefines& defines,
+                                                           const KernelCompileOptions& options) override;
+    std::unique_ptr<IComputeKernel> CreateKernelFromBytecode(const KernelBytecode& bytecode) override;
+
+    MemoryStats GetMemoryStats() const override;
+    DeviceCapabilities GetCapabilities() const override { return m_capabilities; }
+
+    void WaitForIdle() override;
+    size_t WaitForEvents(IComputeEvent* const* events, size_t count, bool waitAll, uint32_t timeoutMs) override;
+    std::unique_ptr<IComputeEvent> CreateHostEvent() override;
+    void SignalHostEvent(IComputeEvent* event) override;
+    void ResetHostEvent(IComputeEvent* event) override;
+
+    VkDevice GetDevice() const { return m_device; }
+    VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+    const VkPhysicalDeviceProperties& GetDeviceProperties() const { return m_deviceProperties; }
+    uint32_t GetQueueFamilyIndex() const { return m_queueFamilyIndex; }
+
+    /**
+     * @brief Gets the queue family COPY streams submit to.
+     * @note Equal to GetQueueFamilyIndex() if the device has no transfer-only family.
+     */
+    uint32_t GetTransferQueueFamilyIndex() const { return m_transferQueueFamilyIndex; }
+
+    /**
+     * @brief Whether COPY streams have a queue of their own. Buffers are
+     * then shared between both families (VK_SHARING_MODE_CONCURRENT).
+     */
+    bool HasTransferQueue() const { return m_transferQueueFamilyIndex != m_queueFamilyIndex; }
+
+    /**
+     * @brief Gets the alignment imported host pointers and sizes need.
+     * @return 0 if VK_EXT_external_memory_host isn't supported.
+     */
+    size_t GetHostPointerAlignment() const { return m_hostPointerAlignment; }
+
+    /**
+     * @brief Wraps vkGetMemoryHostPointerPropertiesEXT.
+     */
+    VkResult GetMemoryHostPointerProperties(const void* hostPointer, VkMemoryHostPointerPropertiesEXT* properties) const;
+
+    /**
+     * @brief Get the DXC objects of the calling thread, created on first use.
+     * @note Kernels compile on several threads at once (CreateKernels()),
+     * which can't share one compiler.
+     */
+    IDxcCompiler3* GetCompiler();
+    IDxcUtils* GetUtils();
+    IDxcIncludeHandler* GetIncludeHandler();
+
+    /**
+     * @brief Gets the queue with the fewest streams for a new stream.
+     * @note COPY streams get a transfer queue if the device has one.
+     * Pair with ReleaseQueue() when the stream is destroyed.
+     */
+    VulkanQueue* AcquireQueue(StreamType type, StreamPriority priority);
+
+    /**
+     * @brief Returns a queue from AcquireQueue() to the pool.
+     */
+    void ReleaseQueue(VulkanQueue* queue);
+
+    /**
+     * @brief Submits work to a queue from AcquireQueue().
+     * @note VkQueue access must be externally synchronized, so every stream
+     * goes through here.
+     */
+    void SubmitToQueue(VulkanQueue* queue, uint32_t submitCount, const VkSubmitInfo* submits);
+
+    /**
+     * @brief Finds a memory type index for an allocation.
+     * @param typeBits VkMemoryRequirements::memoryTypeBits.
+     * @param required Properties the memory type must have.
+     * @param preferred Additional properties to try first.
+     * @return The memory type index, or throws if none matches 'required'.
+     */
+    uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const;
+
+    /**
+     * @brief Gets the allocator that places buffers in VkDeviceMemory
+     * blocks of one memory type, creating it on first use.
+     * @note Its heaps are VulkanHeaps.
+     */
+    MemoryAllocator& GetDeviceLocalAllocator(uint32_t memoryTypeIndex);
+
+  private:
+    /**
+     * @brief Private constructor. Use VulkanBackend::Create().
+     */
+    explicit VulkanBackend(const ContextDesc& desc);
+
+    /**
+     * @brief The real initialization logic.
+     * @note Throws std::runtime_error with the reason on failure.
+     */
+    void Initialize();
+
+    /**
+     * @brief Picks the best physical device with a compute queue and
+     * timeline semaphore support. Discrete GPUs win, but CPU
+     * implementations (e.g., lavapipe) are accepted.
+     */
+    bool selectPhysicalDevice();
+
+    /**
+     * @brief Fills m_capabilities from the selected physical device.
+     */
+    void queryCapabilities();
+
+    // Core Vulkan Objects
+    VkInstance m_instance;
+    VkPhysicalDevice m_physicalDevice;
+    VkPhysicalDeviceProperties m_deviceProperties;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    VkDevice m_device;
+    uint32_t m_queueFamilyIndex;
+    uint32_t m_transferQueueFamilyIndex; // Same as m_queueFamilyIndex without a transfer-only family
+
+    DeviceCapabilities m_capabilities;
+
+    // VK_EXT_external_memory_host, for ImportHostMemory()
+    size_t m_hostPointerAlignment;
+    PFN_vkGetMemoryHostPointerPropertiesEXT m_getMemoryHostPointerProperties;
+
+    // Queues shared by the streams
+    uint32_t m_maxQueuesPerPool;
+    std::mutex m_queuesMutex; // Protects the stream counts of m_queues
+    std::vector<std::unique_ptr<VulkanQueue>> m_queues;
+
+    // Device memory blocks, one allocator per memory type
+    size_t m_memoryBlockSize;
+    mutable std::mutex m_allocatorsMutex; // Protects m_deviceLocalAllocators
+    std::unordered_map<uint32_t, std::unique_ptr<MemoryAllocator>> m_deviceLocalAllocators;
+  };
+}
+
+#endif
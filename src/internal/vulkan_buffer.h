@@ -0,0 +1,63 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_VULKAN)
+
+#include "backend.h"
+#include "vulkan_backend.h" // for VulkanBackend
+
+namespace aegis::internal {
+  /**
+   * @brief The Vulkan implementation of a GPU buffer.
+   *
+   * This class wraps a VkBuffer. DEVICE_LOCAL buffers are bound into a
+   * block owned by the backend's allocator, the other types (including
+   * DEVICE_HOST_VISIBLE, which has to be mapped) own their VkDeviceMemory. Imported host memory is wrapped through
+   * VK_EXT_external_memory_host.
+   */
+  class VulkanBuffer : public IGpuBuffer {
+  public:
+    /**
+     * @brief Creates a new VulkanBuffer.
+     * @param backend The VulkanBackend that will create this resource.
+     * @param byteSize The size of the buffer to create.
+     * @param type The GpuMemoryType used to pick the memory type.
+     */
+    VulkanBuffer(VulkanBackend* backend, size_t byteSize, GpuMemoryType type);
+
+    /**
+     * @brief Wraps existing host memory as a HOST buffer.
+     * @note Throws if the memory can't be imported. The pointer and size
+     * must be multiples of VulkanBackend::GetHostPointerAlignment().
+     * @param backend The VulkanBackend that will create this resource.
+     * @param hostPointer The start of the memory.
+     * @param byteSize The size of the buffer to create.
+     */
+    VulkanBuffer(VulkanBackend* backend, void* hostPointer, size_t byteSize);
+
+    ~VulkanBuffer() override;
+
+    size_t GetSizeInBytes() const override;
+    void* Map() override;
+    void Unmap() override;
+
+    /**
+     * @brief Gets the underlying Vulkan buffer.
+     */
+    VkBuffer GetBuffer() const { return m_buffer; }
+
+    GpuMemoryType GetMemoryType() const { return m_memoryType; }
+
+  private:
+    VulkanBackend* m_backend;
+    VkBuffer m_buffer;
+    VkDeviceMemory m_memory; // VK_NULL_HANDLE for placed buffers
+    uint32_t m_memoryTypeIndex;
+    MemoryAllocator::Allocation m_allocation;
+    size_t m_byteSize;
+    void* m_mappedPtr;
+    GpuMemoryType m_memoryType;
+    void* m_hostPointer; // Only for imported host memory
+  };
+}
+
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_VULKAN)
+
+#include "backend.h"
+#include "vulkan_backend.h" // for VulkanBackend
+#include "submission_timeline.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace aegis::internal {
+  /**
+   * @brief An owned timeline semaphore.
+   *
+   * Shared between its owner (an event or a stream) and every in-flight
+   * submission that waits on or signals it, so the semaphore outlives
+   * the GPU work that uses it.
+   */
+  class VulkanTimeline {
+  public:
+    /**
+     * @param device The device to create the semaphore on.
+     * @param initialValue The starting counter value.
+     */
+    VulkanTimeline(VkDevice device, uint64_t initialValue);
+    ~VulkanTimeline();
+
+    VulkanTimeline(const VulkanTimeline&) = delete;
+    VulkanTimeline& operator=(const VulkanTimeline&) = delete;
+
+    VkSemaphore GetSemaphore() const { return m_semaphore; }
+
+    /**
+     * @brief Gets the current counter value.
+     */
+    uint64_t GetCompletedValue() const;
+
+    /**
+     * @brief Blocks until the counter reaches 'value'.
+     */
+    void Wait(uint64_t value) const;
+
+    /**
+     * @brief Blocks until the counter reaches 'value' or the timeout expires.
+     * @return false if the timeout expired first.
+     */
+    bool Wait(uint64_t value, uint32_t timeoutMs) const;
+
+    /**
+     * @brief Raises the counter from the CPU.
+     */
+    void Signal(uint64_t value);
+
+  private:
+    VkDevice m_device;
+    VkSemaphore m_semaphore;
+  };
+
+  /**
+   * @brief The Vulkan implementation of a compute event.
+   *
+   * An event owns no semaphore: RecordEvent() points it at a value of the
+   * recording stream's timeline, so creating one is free.
+   */
+  class VulkanEvent : public IComputeEvent {
+  public:
+    /**
+     * @brief Creates a new, unrecorded VulkanEvent.
+     * @param backend The VulkanBackend that owns this event.
+     */
+    explicit VulkanEvent(VulkanBackend* backend);
+    ~VulkanEvent() override;
+
+    /**
+     * @brief Points the event at a stream timeline value.
+     * @param submission What the stream submitted, nullptr for timelines the CPU signals.
+     */
+    void Set(std::shared_ptr<VulkanTimeline> timeline, uint64_t value, std::shared_ptr<SubmissionTimeline> submission = nullptr);
+
+    /**
+     * @brief Gets the timeline and value the event was last recorded at.
+     * @return A null timeline if the event was never recorded.
+     */
+    std::pair<std::shared_ptr<VulkanTimeline>, uint64_t> Get() const;
+
+    /**
+     * @brief Gets what the recording stream submitted, nullptr for host events.
+     */
+    std::shared_ptr<SubmissionTimeline> GetSubmission() const;
+
+    /**
+     * @brief Points the event at the next value of its timeline.
+     */
+    void Advance();
+
+    bool IsComplete() const override;
+    uint64_t GetFenceValue() const override;
+    std::unique_ptr<IComputeEvent> Clone() const override;
+
+  private:
+    VulkanBackend* m_backend;
+    mutable std::mutex m_mutex; // Protects m_timeline, m_value and m_submission
+    std::shared_ptr<VulkanTimeline> m_timeline;
+    uint64_t m_value;
+    std::shared_ptr<SubmissionTimeline> m_submission;
+  };
+}
+
+#endif
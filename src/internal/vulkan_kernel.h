@@ -0,0 +1,101 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_VULKAN)
+
+#include "backend.h"
+#include "vulkan_backend.h" // for VulkanBackend
+#include "spirv_reflection.h"
+
+#include <string>
+#include <vector>
+
+namespace aegis::internal {
+  /**
+   * @brief The binding of cbuffer register b0. DXC shifts cbuffers past the
+   * u# registers, which keep binding = register as SetBuffer() expects.
+   */
+  constexpr uint32_t kConstantBindingShift = 64;
+
+  /**
+   * @brief The Vulkan implementation of a compute kernel.
+   *
+   * This class wraps a VkPipeline and the descriptor set / pipeline layouts
+   * built from the reflected SPIR-V.
+   */
+  class VulkanKernel : public IComputeKernel {
+  public:
+    ~VulkanKernel() override;
+
+    /**
+     * @brief Factory function to create a new VulkanKernel.
+     *
+     * This function loads the HLSL file, compiles it to SPIR-V with DXC
+     * (-spirv), reflects the descriptor bindings to build the layouts, and
+     * finally creates the compute pipeline.
+     *
+     * @param backend The VulkanBackend that will own this kernel.
+     * @param hlslFilePath Path to the .hlsl shader file.
+     * @param entryPoint The name of the [shader("compute")] function.
+     * @return A unique_ptr to the new kernel, or throws an exception on failure.
+     */
+    static std::unique_ptr<VulkanKernel> Create(
+        VulkanBackend* backend,
+        const std::string& hlslFilePath,
+        const std::string& entryPoint,
+        const KernelDefines& defines,
+        const KernelCompileOptions& options);
+
+    /**
+     * @brief Compiles HLSL source from memory, see Create().
+     * @param sourceName The file name DXC reports errors and resolves includes with.
+     */
+    static std::unique_ptr<VulkanKernel> CreateFromSource(
+        VulkanBackend* backend,
+        const std::string& hlslCode,
+        const std::string& sourceName,
+        const std::string& entryPoint,
+        const KernelDefines& defines,
+        const KernelCompileOptions& options);
+
+    /**
+     * @brief Creates the kernel from SPIR-V compiled ahead of time, which
+     * is reflected the same way.
+     * @note cbuffers must have been compiled with -fvk-b-shift 64 0 (see kConstantBindingShift).
+     * @param entryPoint The entry point in the module (DXC keeps the HLSL name).
+     */
+    static std::unique_ptr<VulkanKernel> CreateFromSpirv(
+        VulkanBackend* backend,
+        const uint32_t* spirvCode,
+        size_t spirvSize,
+        const std::string& entryPoint);
+
+    VkPipeline GetPipeline() const { return m_pipeline; }
+    VkPipelineLayout GetPipelineLayout() const { return m_pipelineLayout; }
+    VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_descriptorSetLayout; }
+
+    /** @brief The bindings of descriptor set 0, the order they must be written in. */
+    const std::vector<SpirvBinding>& GetBindings() const { return m_bindings; }
+
+    /**
+     * @brief Finds the uniform block of the cbuffer at register b<slot>.
+     * @return The binding, or nullptr if the kernel has no such cbuffer.
+     */
+    const SpirvBinding* FindConstants(uint32_t slot) const;
+
+    bool HasConstants() const override;
+
+  private:
+    /**
+     * @brief Private constructor. Use VulkanKernel::Create().
+     */
+    VulkanKernel(VulkanBackend* backend, std::vector<SpirvBinding> bindings);
+
+    VulkanBackend* m_backend;
+    VkDescriptorSetLayout m_descriptorSetLayout;
+    VkPipelineLayout m_pipelineLayout;
+    VkPipeline m_pipeline;
+    std::vector<SpirvBinding> m_bindings;
+  };
+}
+
+#endif
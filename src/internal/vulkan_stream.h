@@ -0,0 +1,202 @@
+#pragma once
+
+#if defined(AEGIS_ENABLE_VULKAN)
+
+#include "backend.h"
+#include "vulkan_backend.h"
+#include "staging_ring.h"
+#include "readback_copy.h"
+#include "submission_timeline.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace aegis::internal {
+  class VulkanBuffer;
+  class VulkanKernel;
+  class VulkanTimeline;
+
+  /**
+   * @brief The Vulkan implementation of a compute stream.
+   *
+   * This class owns a command pool, descriptor pools and a timeline
+   * semaphore that tracks how far the GPU has got through its submissions.
+   *
+   * Recorded work is split into "segments", one VkSubmitInfo each, so that
+   * StreamWait() and RecordEvent() land exactly between the commands they
+   * were recorded between. Submit() sends all segments in one
+   * vkQueueSubmit() and signals the stream's timeline at the end.
+   * RecordEvent() reserves a value of the same timeline and signals it
+   * after the segment it closes, so events are points on the timeline.
+   *
+   * Everything a submission uses (command buffers, descriptor pools,
+   * staging memory) is kept until the timeline passes its value and then
+   * recycled.
+   *
+   * Streams share the backend's queues. COPY streams record into a
+   * command pool of the transfer queue family and submit to a transfer
+   * queue, if the device has one.
+   */
+  class VulkanStream : public IComputeStream {
+  public:
+    VulkanStream(VulkanBackend* backend, const StreamDesc& desc);
+    ~VulkanStream() override;
+
+    void RecordDispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ) override;
+    void ResourceCopyBuffer(IGpuBuffer* dest, size_t destOffset, IGpuBuffer* src, size_t srcOffset, size_t byteSize) override;
+    void ResourceUpload(IGpuBuffer* dest, size_t destOffset, const void* srcData, size_t byteSize) override;
+    std::shared_ptr<ReadbackCopy> ResourceDownload(const void* destData, IGpuBuffer* src, size_t srcOffset, size_t byteSize) override;
+    void SetKernel(IComputeKernel* kernel) override;
+    void SetBuffer(uint32_t slot, IGpuBuffer* buffer, size_t offset, size_t byteSize, BufferAccess access) override;
+    void SetConstants(uint32_t slot, const void* data, size_t byteSize) override;
+
+    void Submit() override;
+    bool HostWait(uint32_t timeoutMs) override;
+    void StreamWait(IComputeEvent* event) override;
+    void RecordEvent(IComputeEvent* event) override;
+
+    StagingStats GetStagingStats() const override;
+
+    uint64_t GetRecordedFenceValue() const override;
+    uint64_t GetSubmittedFenceValue() const override;
+    uint64_t GetCompletedFenceValue() const override;
+
+  private:
+    /**
+     * @brief One VkSubmitInfo worth of work.
+     */
+    struct Segment {
+      VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+      std::vector<std::shared_ptr<VulkanTimeline>> waitTimelines;
+      std::vector<uint64_t> waitValues;
+      std::vector<std::shared_ptr<SubmissionTimeline>> waitSubmissions; // nullptr for timelines the CPU signals
+      std::vector<std::shared_ptr<VulkanTimeline>> signalTimelines;
+      std::vector<uint64_t> signalValues;
+    };
+
+    /**
+     * @brief Resources that must stay alive until a submission finishes.
+     */
+    struct InFlightSubmission {
+      uint64_t fenceValue;
+      std::vector<VkCommandBuffer> commandBuffers;
+      std::vector<VkDescriptorPool> descriptorPools;
+      std::vector<std::shared_ptr<VulkanTimeline>> timelines;
+    };
+
+    /**
+     * @brief An upload that has been written to the staging ring but whose
+     * copy hasn't been recorded yet.
+     */
+    struct BoundBuffer {
+      VulkanBuffer* buffer = nullptr;
+      size_t offset = 0;
+      size_t byteSize = 0;
+    };
+
+    struct PendingUpload {
+      VulkanBuffer* dest;
+      size_t destOffset;
+      IGpuBuffer* staging;
+      size_t stagingOffset;
+      size_t byteSize;
+    };
+
+    /**
+     * @brief Holds information for a pending GPU-to-CPU data transfer.
+     */
+    struct PendingReadback {
+      std::shared_ptr<ReadbackCopy> copy; // Also held by ResourceDownloadAsync()'s callback
+      uint64_t fenceValue; // 0 until the copy is submitted
+    };
+
+    /**
+     * @brief Drops the downloads another thread finished and recycles
+     * their staging memory.
+     * @note The arena isn't thread-safe, so the completion thread only
+     * copies and this frees.
+     */
+    void collectReadbacks();
+
+    /**
+     * @brief Copies out the downloads of every submission up to a fence
+     * value, which must have completed, so their staging memory can be reused.
+     */
+    void finishReadbacks(uint64_t fenceValue);
+
+    /**
+     * @brief Makes sure the current segment has a command buffer in the
+     * recording state.
+     */
+    void beginCommands();
+
+    /**
+     * @brief Ends the current segment's command buffer (if any) and queues
+     * the segment for the next Submit().
+     */
+    void closeSegment();
+
+    /**
+     * @brief Emits a memory barrier between everything recorded earlier
+     * and the next command.
+     * @note This is deliberately coarse: one global VkMemoryBarrier that
+     * makes earlier shader and transfer writes visible.
+     */
+    void memoryBarrier(VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    /**
+     * @brief Records the copies for every upload in m_pendingUploads behind
+     * a single barrier.
+     */
+    void flushUploads();
+
+    /**
+     * @brief Allocates a descriptor set, growing the descriptor pools if needed.
+     */
+    VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout);
+
+    /**
+     * @brief Recycles the resources of every submission the GPU has finished.
+     */
+    void reclaimCompleted();
+
+    VulkanBackend* m_backend;
+    StreamType m_type;
+    VulkanQueue* m_queue; // From the backend's pool
+    VkCommandPool m_commandPool;
+    std::shared_ptr<VulkanTimeline> m_timeline;
+    std::shared_ptr<SubmissionTimeline> m_submission; // How far m_timeline is on the queue, shared with the events
+    uint64_t m_fenceValue; // The next timeline value to reserve
+    uint64_t m_submittedValue; // The value the last Submit() signals
+    std::atomic<uint64_t> m_recordedValue; // GetRecordedFenceValue(), read when other threads release objects
+    uint32_t m_maxInFlight;
+
+    VulkanKernel* m_currentKernel;
+    std::vector<BoundBuffer> m_boundBuffers;
+    std::vector<BoundBuffer> m_boundConstants; // Per cbuffer slot, blocks in m_constantRing
+
+    // Recording state
+    Segment m_currentSegment;
+    bool m_hasPriorWork;
+    std::vector<Segment> m_closedSegments;
+    InFlightSubmission m_recordingResources;
+    VkDescriptorPool m_currentDescriptorPool;
+
+    // Recycling
+    std::deque<InFlightSubmission> m_inFlight;
+    std::vector<VkCommandBuffer> m_freeCommandBuffers;
+    std::vector<VkDescriptorPool> m_freeDescriptorPools;
+
+    std::deque<PendingReadback> m_pendingReadbacks;
+
+    StagingRing m_uploadRing;
+    std::vector<PendingUpload> m_pendingUploads;
+    StagingRing m_constantRing; // Blocks of SetConstants()
+    StagingRing m_readbackArena;
+  };
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include "internal/memory_allocator.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using aegis::internal::IMemoryHeap;
+using aegis::internal::MemoryAllocator;
+
+namespace {
+  constexpr size_t kBlockSize = 1024 * 1024;
+  constexpr size_t kGranularity = 256;
+
+  /**
+   * @brief Counts the heaps alive and created, to see what the allocator
+   * keeps and releases.
+   */
+  struct HeapCounter {
+    size_t alive = 0;
+    size_t created = 0;
+    std::vector<size_t> sizes;
+    bool fail = false;
+  };
+
+  class TestHeap : public IMemoryHeap {
+  public:
+    explicit TestHeap(HeapCounter& counter) : m_counter(counter) { m_counter.alive++; }
+    ~TestHeap() override { m_counter.alive--; }
+
+  private:
+    HeapCounter& m_counter;
+  };
+
+  MemoryAllocator::HeapFactory testFactory(HeapCounter& counter) {
+    return [&counter](size_t byteSize) -> std::unique_ptr<IMemoryHeap> {
+      if (counter.fail) {
+        return nullptr;
+      }
+      counter.created++;
+      counter.sizes.push_back(byteSize);
+      return std::make_unique<TestHeap>(counter);
+    };
+  }
+
+  /**
+   * @brief Requests up to half a block share heaps, bigger ones get their
+   * own, which is released with the buffer.
+   */
+  void testDedicatedCutoff() {
+    HeapCounter counter;
+    MemoryAllocator allocator(testFactory(counter), kBlockSize, kGranularity);
+
+    auto half = allocator.Allocate(kBlockSize / 2, kGranularity);
+    AEGIS_CHECK(half && counter.created == 1 && counter.sizes.back() == kBlockSize);
+    auto quarter = allocator.Allocate(kBlockSize / 4, kGranularity);
+    AEGIS_CHECK(quarter.heap == half.heap && counter.created == 1);
+
+    auto big = allocator.Allocate(kBlockSize / 2 + 1, kGranularity);
+    AEGIS_CHECK(big && big.heap != half.heap && big.offset == 0);
+    AEGIS_CHECK(counter.sizes.back() == kBlockSize / 2 + kGranularity); // Rounded, not a whole block
+    AEGIS_CHECK(allocator.GetStats().dedicatedCount == 1 && allocator.GetStats().heapCount == 2);
+
+    allocator.Free(big);
+    AEGIS_CHECK(!big && counter.alive == 1);
+
+    allocator.Free(half);
+    allocator.Free(quarter);
+    AEGIS_CHECK(counter.alive == 1); // The spare
+  }
+
+  /**
+   * @brief Exactly one empty regular heap is kept, and reused.
+   */
+  void testSpareHeap() {
+    HeapCounter counter;
+    MemoryAllocator allocator(testFactory(counter), kBlockSize, kGranularity);
+
+    std::vector<MemoryAllocator::Allocation> allocations;
+    for (int i = 0; i < 6; ++i) {
+      allocations.push_back(allocator.Allocate(kBlockSize * 2 / 5, kGranularity)); // Two per heap
+    }
+    AEGIS_CHECK(counter.created == 3 && counter.alive == 3);
+
+    for (auto& allocation : allocations) {
+      allocator.Free(allocation);
+    }
+    AEGIS_CHECK(counter.alive == 1);
+    const auto stats = allocator.GetStats();
+    AEGIS_CHECK(stats.heapCount == 1 && stats.usedBytes == 0 && stats.allocationCount == 0);
+
+    auto reused = allocator.Allocate(kGranularity, kGranularity);
+    AEGIS_CHECK(reused && counter.created == 3);
+    allocator.Free(reused);
+    AEGIS_CHECK(counter.alive == 1);
+  }
+
+  /**
+   * @brief A failing factory gives an empty allocation instead of throwing.
+   */
+  void testHeapCreationFailure() {
+    HeapCounter counter;
+    counter.fail = true;
+    MemoryAllocator allocator(testFactory(counter), kBlockSize, kGranularity);
+    AEGIS_CHECK(!allocator.Allocate(kGranularity, kGranularity));
+    AEGIS_CHECK(!allocator.Allocate(kBlockSize, kGranularity));
+    AEGIS_CHECK(allocator.GetStats().heapCount == 0);
+  }
+
+  /**
+   * @brief Random allocations never overlap within a heap, and freeing
+   * everything leaves only the spare heap, in one free range.
+   */
+  void testRandomized() {
+    HeapCounter counter;
+    MemoryAllocator allocator(testFactory(counter), kBlockSize, kGranularity);
+
+    std::mt19937 random(5678);
+    std::uniform_int_distribution<size_t> sizes(1, kBlockSize * 3 / 4); // Some of them dedicated
+    std::uniform_int_distribution<uint32_t> alignmentLog2(8, 16);
+    std::vector<MemoryAllocator::Allocation> live;
+
+    for (int step = 0; step < 5000; ++step) {
+      if (live.empty() || random() % 5 < 3) {
+        const size_t byteSize = random() % 4 == 0 ? sizes(random) : sizes(random) / 64 + 1;
+        const size_t alignment = size_t(1) << alignmentLog2(random);
+        auto allocation = allocator.Allocate(byteSize, alignment);
+        AEGIS_CHECK(allocation);
+        AEGIS_CHECK(allocation.offset % alignment == 0 && allocation.size >= byteSize);
+        for (const auto& other : live) {
+          AEGIS_CHECK(other.heap != allocation.heap || other.offset + other.size <= allocation.offset ||
+                      allocation.offset + allocation.size <= other.offset);
+        }
+        live.push_back(allocation);
+      } else {
+        const size_t index = random() % live.size();
+        allocator.Free(live[index]);
+        live[index] = live.back();
+        live.pop_back();
+      }
+      AEGIS_CHECK(allocator.GetStats().allocationCount == live.size());
+    }
+
+    for (auto& allocation : live) {
+      allocator.Free(allocation);
+    }
+    const auto stats = allocator.GetStats();
+    AEGIS_CHECK(counter.alive == 1 && stats.heapCount == 1);
+    AEGIS_CHECK(stats.usedBytes == 0 && stats.freeRangeCount == 1);
+    AEGIS_CHECK(stats.largestFreeRange == kBlockSize && stats.fragmentation == 0.0f);
+  }
+}
+
+int main() {
+  testDedicatedCutoff();
+  testSpareHeap();
+  testHeapCreationFailure();
+  testRandomized();
+  std::puts("memory_allocator_test passed");
+  return 0;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file test_check.h
+ * @brief Minimal assertions for the unit tests, which have no framework
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * @brief Fails the test with the location if the condition is false.
+ * @note Unlike assert(), this stays active in release builds.
+ */
+#define AEGIS_CHECK(condition)                                                     \
+  do {                                                                             \
+    if (!(condition)) {                                                            \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::exit(EXIT_FAILURE);                                                     \
+    }                                                                              \
+  } while (false)
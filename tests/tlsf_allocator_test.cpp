@@ -0,0 +1,130 @@
+#include "internal/tlsf_allocator.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+
+using aegis::internal::TlsfAllocator;
+
+namespace {
+  constexpr size_t kGranularity = 256;
+
+  /**
+   * @brief Splitting the initial range and merging freed neighbours back,
+   * whichever side they are on.
+   */
+  void testSplitAndMerge() {
+    TlsfAllocator allocator(1024 * 1024, kGranularity);
+    AEGIS_CHECK(allocator.GetFreeRangeCount() == 1);
+
+    auto a = allocator.Allocate(1000, kGranularity);
+    auto b = allocator.Allocate(1024, kGranularity);
+    auto c = allocator.Allocate(1024, kGranularity);
+    AEGIS_CHECK(a.IsValid() && b.IsValid() && c.IsValid());
+    AEGIS_CHECK(a.size == 1024); // Rounded up to the granularity
+    AEGIS_CHECK(allocator.GetUsedBytes() == 3 * 1024);
+    AEGIS_CHECK(allocator.GetFreeRangeCount() == 1); // Only the rest of the heap
+
+    // A hole in the middle is a range of its own, too small for this
+    allocator.Free(b);
+    AEGIS_CHECK(allocator.GetFreeRangeCount() == 2);
+    auto d = allocator.Allocate(2048, kGranularity);
+    AEGIS_CHECK(d.IsValid() && d.offset == c.offset + c.size);
+
+    // Merging with the hole on the right...
+    allocator.Free(a);
+    AEGIS_CHECK(allocator.GetFreeRangeCount() == 2); // a+b and the rest
+    AEGIS_CHECK(allocator.GetLargestFreeRange() == 1024 * 1024 - 5 * 1024);
+
+    // ...on the left, and on both sides
+    allocator.Free(c);
+    AEGIS_CHECK(allocator.GetFreeRangeCount() == 2);
+    allocator.Free(d);
+    AEGIS_CHECK(allocator.IsEmpty() && allocator.GetFreeRangeCount() == 1);
+    AEGIS_CHECK(allocator.GetLargestFreeRange() == 1024 * 1024);
+  }
+
+  /**
+   * @brief Aligned offsets, and a heap that is exactly full.
+   */
+  void testAlignmentAndExhaustion() {
+    TlsfAllocator allocator(64 * 1024, kGranularity);
+
+    auto small = allocator.Allocate(kGranularity, kGranularity);
+    auto aligned = allocator.Allocate(kGranularity, 4096);
+    AEGIS_CHECK(aligned.IsValid() && aligned.offset % 4096 == 0);
+    AEGIS_CHECK(aligned.offset != small.offset);
+    allocator.Free(small);
+    allocator.Free(aligned);
+    AEGIS_CHECK(allocator.IsEmpty() && allocator.GetFreeRangeCount() == 1);
+
+    auto all = allocator.Allocate(64 * 1024, kGranularity);
+    AEGIS_CHECK(all.IsValid() && all.offset == 0);
+    AEGIS_CHECK(!allocator.Allocate(1, kGranularity).IsValid());
+    AEGIS_CHECK(allocator.GetLargestFreeRange() == 0);
+    allocator.Free(all);
+    AEGIS_CHECK(allocator.GetLargestFreeRange() == 64 * 1024);
+  }
+
+  /**
+   * @brief Random allocations and frees never overlap, and freeing
+   * everything coalesces the heap back into one range.
+   */
+  void testRandomized() {
+    constexpr size_t kCapacity = 16 * 1024 * 1024;
+    TlsfAllocator allocator(kCapacity, kGranularity);
+
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<size_t> sizes(1, 256 * 1024);
+    std::uniform_int_distribution<uint32_t> alignmentLog2(8, 16);
+    std::map<size_t, TlsfAllocator::Allocation> live; // By offset
+    size_t liveBytes = 0;
+
+    for (int step = 0; step < 20000; ++step) {
+      if (live.empty() || random() % 3 != 0) {
+        const size_t byteSize = sizes(random);
+        const size_t alignment = size_t(1) << alignmentLog2(random);
+        auto allocation = allocator.Allocate(byteSize, alignment);
+        if (!allocation.IsValid()) {
+          continue; // Full or too fragmented for this one
+        }
+        AEGIS_CHECK(allocation.offset % alignment == 0);
+        AEGIS_CHECK(allocation.size >= byteSize && allocation.size % kGranularity == 0);
+        AEGIS_CHECK(allocation.offset + allocation.size <= kCapacity);
+
+        // The neighbours by offset must end before / start after it
+        auto next = live.lower_bound(allocation.offset);
+        AEGIS_CHECK(next == live.end() || allocation.offset + allocation.size <= next->first);
+        AEGIS_CHECK(next == live.begin() || std::prev(next)->first + std::prev(next)->second.size <= allocation.offset);
+
+        live.emplace(allocation.offset, allocation);
+        liveBytes += allocation.size;
+      } else {
+        auto it = std::next(live.begin(), random() % live.size());
+        liveBytes -= it->second.size;
+        allocator.Free(it->second);
+        live.erase(it);
+      }
+      AEGIS_CHECK(allocator.GetUsedBytes() == liveBytes);
+      AEGIS_CHECK(allocator.GetAllocationCount() == live.size());
+    }
+
+    for (auto& [offset, allocation] : live) {
+      allocator.Free(allocation);
+    }
+    AEGIS_CHECK(allocator.IsEmpty());
+    AEGIS_CHECK(allocator.GetUsedBytes() == 0);
+    AEGIS_CHECK(allocator.GetFreeRangeCount() == 1);
+    AEGIS_CHECK(allocator.GetLargestFreeRange() == kCapacity);
+  }
+}
+
+int main() {
+  testSplitAndMerge();
+  testAlignmentAndExhaustion();
+  testRandomized();
+  std::puts("tlsf_allocator_test passed");
+  return 0;
+}